@@ -0,0 +1,152 @@
+#include <cstring>
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QVector>
+
+#include "recorder.h"
+#include "recorderio.h"
+
+extern "C"
+{
+#include "libavcodec/avcodec.h"
+}
+
+// 10 s of a 4 Mbps 60 fps stream per recording, one keyframe per second
+#define BENCH_FRAMES 600
+#define BENCH_FPS 60
+#define BENCH_FRAME_BYTES 8000
+#define BENCH_KEYFRAME_BYTES 60000
+
+struct BenchMode
+{
+    const char *name;
+    RecorderIO::Options options;
+};
+
+static AVPacket *makePacket(int size, qint64 pts, bool keyframe)
+{
+    AVPacket *packet = av_packet_alloc();
+    if (!packet || av_new_packet(packet, size) < 0) {
+        av_packet_free(&packet);
+        return Q_NULLPTR;
+    }
+    for (int i = 0; i < size; i++) {
+        packet->data[i] = static_cast<uint8_t>(i * 131 + 7);
+    }
+    packet->pts = pts;
+    packet->dts = pts;
+    if (keyframe) {
+        packet->flags |= AV_PKT_FLAG_KEY;
+    }
+    return packet;
+}
+
+// all recordings advance frame by frame, like a farm writing concurrently
+static double runBench(const QString &dir, int recordings, qint64 *bytes)
+{
+    // written as is into CodecPrivate, the muxer does not parse it
+    static const uint8_t avcc[] = { 0x01, 0x64, 0x00, 0x1f, 0xff, 0xe1, 0x00, 0x04, 0x67, 0x64, 0x00, 0x1f, 0x01, 0x00, 0x02, 0x68, 0xee };
+    AVPacket *config = makePacket(sizeof(avcc), AV_NOPTS_VALUE, false);
+    AVPacket *frame = makePacket(BENCH_FRAME_BYTES, 0, false);
+    AVPacket *keyframe = makePacket(BENCH_KEYFRAME_BYTES, 0, true);
+    AVPacket *packet = av_packet_alloc();
+    if (!config || !frame || !keyframe || !packet) {
+        return -1;
+    }
+    memcpy(config->data, avcc, sizeof(avcc));
+
+    QVector<Recorder *> recorders;
+    for (int i = 0; i < recordings; i++) {
+        Recorder *recorder = new Recorder(QDir(dir).filePath(QString("bench_%1.mkv").arg(i)));
+        recorder->setFrameSize(QSize(720, 1280));
+        if (!recorder->open() || !recorder->write(config)) {
+            qCritical() << "could not open recording" << i;
+        }
+        recorders.append(recorder);
+    }
+
+    *bytes = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+        AVPacket *source = (f % BENCH_FPS == 0) ? keyframe : frame;
+        for (Recorder *recorder : recorders) {
+            av_packet_ref(packet, source);
+            packet->pts = packet->dts = f * 1000000LL / BENCH_FPS;
+            packet->duration = 1000000LL / BENCH_FPS;
+            recorder->write(packet);
+            av_packet_unref(packet);
+            *bytes += source->size;
+        }
+    }
+    // closing flushes and syncs, it is part of the cost
+    for (Recorder *recorder : recorders) {
+        recorder->close();
+        delete recorder;
+    }
+    double seconds = timer.nsecsElapsed() / 1e9;
+
+    for (int i = 0; i < recordings; i++) {
+        QFile::remove(QDir(dir).filePath(QString("bench_%1.mkv").arg(i)));
+    }
+    av_packet_free(&config);
+    av_packet_free(&frame);
+    av_packet_free(&keyframe);
+    av_packet_free(&packet);
+    return seconds;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QString dir = app.arguments().size() > 1 ? app.arguments().at(1) : QDir::temp().filePath("qtscrcpy_recorderio_bench");
+    if (!QDir().mkpath(dir)) {
+        qCritical() << "cannot create" << dir;
+        return 1;
+    }
+
+    QVector<BenchMode> modes;
+    BenchMode mode;
+    mode.name = "avio_open (default AVIO)";
+    mode.options.bufferSize = 0;
+    modes.append(mode);
+    mode.name = "RecorderIO 4 MB";
+    mode.options = RecorderIO::Options();
+    modes.append(mode);
+    mode.name = "RecorderIO 4 MB, O_DIRECT";
+    mode.options.directIO = true;
+    modes.append(mode);
+    mode.name = "RecorderIO 4 MB, fsync 1 s";
+    mode.options.directIO = false;
+    mode.options.syncIntervalMs = 1000;
+    modes.append(mode);
+
+    QTextStream out(stdout);
+    out << "output directory: " << QFileInfo(dir).absoluteFilePath() << "\n";
+    const int counts[] = { 1, 10, 100 };
+    for (const BenchMode &benchMode : modes) {
+        RecorderIO::setDefaultOptions(benchMode.options);
+        for (int recordings : counts) {
+            qint64 bytes = 0;
+            double seconds = runBench(dir, recordings, &bytes);
+            if (seconds <= 0) {
+                out << benchMode.name << ": failed\n";
+                continue;
+            }
+            out << QString("%1, %2 recordings: %3 MB in %4 s, %5 MB/s\n")
+                       .arg(benchMode.name)
+                       .arg(recordings, 3)
+                       .arg(bytes / 1e6, 0, 'f', 1)
+                       .arg(seconds, 0, 'f', 3)
+                       .arg(bytes / 1e6 / seconds, 0, 'f', 1);
+            out.flush();
+        }
+    }
+    return 0;
+}
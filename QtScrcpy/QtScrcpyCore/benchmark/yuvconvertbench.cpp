@@ -0,0 +1,138 @@
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QVector>
+
+#include "yuvconvert.h"
+
+extern "C"
+{
+#include "libavutil/frame.h"
+#include "libavutil/imgutils.h"
+#include "libswscale/swscale.h"
+}
+
+// a decoded frame's worth of work, repeated until the timing is stable
+#define BENCH_MIN_MS 500
+#define BENCH_MIN_ROUNDS 20
+
+struct BenchSize
+{
+    int width;
+    int height;
+};
+
+// YUV420P with a gradient and some texture, like a decoded phone screen
+static AVFrame *makeFrame(int width, int height)
+{
+    AVFrame *frame = av_frame_alloc();
+    if (!frame) {
+        return Q_NULLPTR;
+    }
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = width;
+    frame->height = height;
+    if (av_frame_get_buffer(frame, 32) < 0) {
+        av_frame_free(&frame);
+        return Q_NULLPTR;
+    }
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            frame->data[0][y * frame->linesize[0] + x] = static_cast<uint8_t>(16 + (x + y) % 220 + ((x * 7 + y * 13) & 3));
+        }
+    }
+    for (int y = 0; y < height / 2; y++) {
+        for (int x = 0; x < width / 2; x++) {
+            frame->data[1][y * frame->linesize[1] + x] = static_cast<uint8_t>(64 + (x * 3) % 128);
+            frame->data[2][y * frame->linesize[2] + x] = static_cast<uint8_t>(192 - (y * 5) % 128);
+        }
+    }
+    return frame;
+}
+
+// mean milliseconds per frame
+template<typename Convert> static double timeConvert(Convert convert)
+{
+    convert(); // warm up caches and lazy init
+    QElapsedTimer timer;
+    timer.start();
+    int rounds = 0;
+    while (rounds < BENCH_MIN_ROUNDS || timer.elapsed() < BENCH_MIN_MS) {
+        convert();
+        rounds++;
+    }
+    return timer.nsecsElapsed() / 1e6 / rounds;
+}
+
+static double timeSws(const AVFrame *frame, int factor, int flags, uint8_t *dst, int dstLinesize)
+{
+    SwsContext *context = sws_getContext(frame->width, frame->height, AV_PIX_FMT_YUV420P, frame->width / factor, frame->height / factor,
+                                         AV_PIX_FMT_RGB32, flags, Q_NULLPTR, Q_NULLPTR, Q_NULLPTR);
+    if (!context) {
+        return -1;
+    }
+    uint8_t *dstData[4] = { dst, Q_NULLPTR, Q_NULLPTR, Q_NULLPTR };
+    int dstLinesizes[4] = { dstLinesize, 0, 0, 0 };
+    double ms = timeConvert([&]() {
+        sws_scale(context, static_cast<const uint8_t *const *>(frame->data), frame->linesize, 0, frame->height, dstData, dstLinesizes);
+    });
+    sws_freeContext(context);
+    return ms;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    const BenchSize sizes[] = { { 720, 1600 }, { 1080, 2400 }, { 1440, 3200 } };
+    const int factors[] = { 1, 2, 4 };
+    const YuvConvert::Isa bestIsa = YuvConvert::isa();
+    out << "best kernels: " << YuvConvert::isaName(bestIsa) << "\n";
+
+    QVector<YuvConvert::Isa> isas;
+    for (YuvConvert::Isa isa : { YuvConvert::ISA_SCALAR, YuvConvert::ISA_SSE2, YuvConvert::ISA_AVX2, YuvConvert::ISA_NEON }) {
+        if (YuvConvert::setIsa(isa)) {
+            isas.append(isa);
+        }
+    }
+
+    for (const BenchSize &size : sizes) {
+        AVFrame *frame = makeFrame(size.width, size.height);
+        if (!frame) {
+            qCritical() << "cannot allocate frame" << size.width << size.height;
+            return 1;
+        }
+        for (int factor : factors) {
+            const int width = size.width / factor;
+            const int height = size.height / factor;
+            const int linesize = width * 4;
+            QVector<uint8_t> dst(linesize * height);
+
+            // the swscale setups the tree used before: AVFrameConvert, ScreenshotEngine
+            const double bicubic = timeSws(frame, factor, SWS_BICUBIC, dst.data(), linesize);
+            const double bilinear = timeSws(frame, factor, SWS_BILINEAR, dst.data(), linesize);
+            out << QString("%1x%2 -> %3x%4: swscale bicubic %5 ms, bilinear %6 ms\n")
+                       .arg(size.width)
+                       .arg(size.height)
+                       .arg(width)
+                       .arg(height)
+                       .arg(bicubic, 0, 'f', 3)
+                       .arg(bilinear, 0, 'f', 3);
+            for (YuvConvert::Isa isa : isas) {
+                YuvConvert::setIsa(isa);
+                const double ms = timeConvert([&]() { YuvConvert::toRgb32(frame, factor, dst.data(), linesize); });
+                out << QString("    %1: %2 ms, %3x bicubic, %4x bilinear\n")
+                           .arg(YuvConvert::isaName(isa), 6)
+                           .arg(ms, 0, 'f', 3)
+                           .arg(bicubic / ms, 0, 'f', 1)
+                           .arg(bilinear / ms, 0, 'f', 1);
+            }
+            out.flush();
+        }
+        av_frame_free(&frame);
+    }
+    YuvConvert::setIsa(bestIsa);
+    return 0;
+}
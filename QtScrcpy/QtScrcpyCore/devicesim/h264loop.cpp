@@ -0,0 +1,296 @@
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+
+extern "C"
+{
+#include "libavcodec/avcodec.h"
+#include "libavutil/opt.h"
+}
+
+#include "h264loop.h"
+
+#define H264_LOOP_CACHE_MAGIC 0x51534c31 // "QSL1"
+#define NAL_TYPE_SPS 7
+#define NAL_TYPE_PPS 8
+
+bool H264Loop::loadAnnexB(const QString &fileName)
+{
+    m_config.clear();
+    m_frames.clear();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_lastError = QString("could not open %1: %2").arg(fileName, file.errorString());
+        return false;
+    }
+    QByteArray stream = file.readAll();
+    file.close();
+
+    const AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_H264);
+    AVCodecParserContext *parser = av_parser_init(AV_CODEC_ID_H264);
+    AVCodecContext *codecCtx = codec ? avcodec_alloc_context3(codec) : Q_NULLPTR;
+    if (!parser || !codecCtx) {
+        m_lastError = "FFmpeg has no H.264 parser";
+        av_parser_close(parser);
+        avcodec_free_context(&codecCtx);
+        return false;
+    }
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(stream.constData());
+    int remaining = stream.size();
+    for (;;) {
+        uint8_t *out = Q_NULLPTR;
+        int outSize = 0;
+        int used = av_parser_parse2(parser, codecCtx, &out, &outSize, data, remaining, AV_NOPTS_VALUE, AV_NOPTS_VALUE, -1);
+        if (used < 0) {
+            break;
+        }
+        data += used;
+        remaining -= used;
+        if (outSize > 0) {
+            Frame frame;
+            frame.data = QByteArray(reinterpret_cast<const char *>(out), outSize);
+            frame.keyframe = parser->key_frame == 1;
+            m_frames.append(frame);
+        }
+        // one more call with no input flushes the last access unit
+        if (remaining <= 0 && outSize <= 0) {
+            break;
+        }
+    }
+
+    av_parser_close(parser);
+    avcodec_free_context(&codecCtx);
+    return finishLoad();
+}
+
+bool H264Loop::encode(const QSize &size, int fps, int bitRate, int seconds, const QString &cacheFile)
+{
+    if (!cacheFile.isEmpty() && QFileInfo::exists(cacheFile) && loadCache(cacheFile)) {
+        return true;
+    }
+
+    m_config.clear();
+    m_frames.clear();
+
+    const AVCodec *codec = avcodec_find_encoder_by_name("libx264");
+    if (!codec) {
+        codec = avcodec_find_encoder(AV_CODEC_ID_H264);
+    }
+    if (!codec) {
+        m_lastError = "FFmpeg has no H.264 encoder, use QTSCRCPY_SIM_VIDEO with a pre-encoded file";
+        return false;
+    }
+
+    AVCodecContext *codecCtx = avcodec_alloc_context3(codec);
+    AVFrame *frame = av_frame_alloc();
+    AVPacket *packet = av_packet_alloc();
+    if (!codecCtx || !frame || !packet) {
+        m_lastError = "out of memory";
+        avcodec_free_context(&codecCtx);
+        av_frame_free(&frame);
+        av_packet_free(&packet);
+        return false;
+    }
+
+    // like the scrcpy server: no B-frames, SPS/PPS out of band
+    codecCtx->width = size.width();
+    codecCtx->height = size.height();
+    codecCtx->time_base = AVRational{ 1, fps };
+    codecCtx->framerate = AVRational{ fps, 1 };
+    codecCtx->pix_fmt = AV_PIX_FMT_YUV420P;
+    codecCtx->bit_rate = bitRate;
+    codecCtx->gop_size = fps;
+    codecCtx->max_b_frames = 0;
+    codecCtx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    // libx264 private options, other encoders just ignore them
+    av_opt_set(codecCtx->priv_data, "preset", "veryfast", 0);
+    av_opt_set(codecCtx->priv_data, "tune", "zerolatency", 0);
+
+    bool ok = avcodec_open2(codecCtx, codec, Q_NULLPTR) >= 0;
+    if (!ok) {
+        m_lastError = QString("could not open encoder %1").arg(codec->name);
+    }
+
+    frame->format = codecCtx->pix_fmt;
+    frame->width = codecCtx->width;
+    frame->height = codecCtx->height;
+    if (ok && av_frame_get_buffer(frame, 0) < 0) {
+        m_lastError = "could not allocate frame";
+        ok = false;
+    }
+
+    const int frameCount = fps * seconds;
+    const int box = qMax(16, size.width() / 6);
+    for (int i = 0; ok && i <= frameCount; i++) {
+        // i == frameCount flushes the encoder
+        if (i < frameCount) {
+            if (av_frame_make_writable(frame) < 0) {
+                ok = false;
+                break;
+            }
+            // scrolling gradient and a box bouncing across the screen, enough motion to
+            // keep the encoder near the requested bitrate
+            int boxX = (i * 8) % qMax(1, size.width() - box);
+            int boxY = (i * 5) % qMax(1, size.height() - box);
+            for (int y = 0; y < size.height(); y++) {
+                uint8_t *line = frame->data[0] + y * frame->linesize[0];
+                for (int x = 0; x < size.width(); x++) {
+                    bool inBox = x >= boxX && x < boxX + box && y >= boxY && y < boxY + box;
+                    line[x] = inBox ? 235 : static_cast<uint8_t>(x + y + i * 3);
+                }
+            }
+            for (int y = 0; y < size.height() / 2; y++) {
+                uint8_t *u = frame->data[1] + y * frame->linesize[1];
+                uint8_t *v = frame->data[2] + y * frame->linesize[2];
+                for (int x = 0; x < size.width() / 2; x++) {
+                    u[x] = static_cast<uint8_t>(128 + ((x + i) & 0x3f) - 32);
+                    v[x] = static_cast<uint8_t>(128 + ((y - i) & 0x3f) - 32);
+                }
+            }
+            frame->pts = i;
+        }
+
+        if (avcodec_send_frame(codecCtx, i < frameCount ? frame : Q_NULLPTR) < 0) {
+            m_lastError = "could not encode frame";
+            ok = false;
+            break;
+        }
+        while (avcodec_receive_packet(codecCtx, packet) >= 0) {
+            Frame encoded;
+            encoded.data = QByteArray(reinterpret_cast<const char *>(packet->data), packet->size);
+            encoded.keyframe = packet->flags & AV_PKT_FLAG_KEY;
+            m_frames.append(encoded);
+            av_packet_unref(packet);
+        }
+    }
+
+    if (ok && codecCtx->extradata_size > 0) {
+        m_config = QByteArray(reinterpret_cast<const char *>(codecCtx->extradata), codecCtx->extradata_size);
+    }
+
+    avcodec_free_context(&codecCtx);
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+
+    if (!ok || !finishLoad()) {
+        return false;
+    }
+    if (!cacheFile.isEmpty() && !saveCache(cacheFile)) {
+        qWarning() << "devicesim: could not write loop cache" << cacheFile;
+    }
+    return true;
+}
+
+const QByteArray &H264Loop::config() const
+{
+    return m_config;
+}
+
+const QVector<H264Loop::Frame> &H264Loop::frames() const
+{
+    return m_frames;
+}
+
+QString H264Loop::lastError() const
+{
+    return m_lastError;
+}
+
+bool H264Loop::loadCache(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream stream(&file);
+    quint32 magic = 0;
+    qint32 count = 0;
+    stream >> magic >> m_config >> count;
+    if (magic != H264_LOOP_CACHE_MAGIC || count <= 0) {
+        return false;
+    }
+    m_frames.clear();
+    m_frames.reserve(count);
+    for (int i = 0; i < count && stream.status() == QDataStream::Ok; i++) {
+        Frame frame;
+        stream >> frame.data >> frame.keyframe;
+        m_frames.append(frame);
+    }
+    if (stream.status() != QDataStream::Ok) {
+        m_frames.clear();
+        return false;
+    }
+    return finishLoad();
+}
+
+bool H264Loop::saveCache(const QString &fileName) const
+{
+    // several simulated devices may start at once, publish the file atomically
+    QString tmpName = QString("%1.%2").arg(fileName).arg(QCoreApplication::applicationPid());
+    QFile file(tmpName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QDataStream stream(&file);
+    stream << quint32(H264_LOOP_CACHE_MAGIC) << m_config << qint32(m_frames.size());
+    for (const Frame &frame : m_frames) {
+        stream << frame.data << frame.keyframe;
+    }
+    file.close();
+    if (stream.status() != QDataStream::Ok) {
+        QFile::remove(tmpName);
+        return false;
+    }
+    QFile::remove(fileName);
+    return QFile::rename(tmpName, fileName);
+}
+
+QByteArray H264Loop::parameterSets(const QByteArray &accessUnit)
+{
+    QByteArray result;
+    const int size = accessUnit.size();
+    const char *data = accessUnit.constData();
+
+    // NAL unit start offsets (including the start code)
+    int nalStart = -1;
+    int nalType = 0;
+    for (int i = 0; i + 3 <= size; i++) {
+        bool startCode = data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1;
+        if (!startCode) {
+            continue;
+        }
+        int codeStart = (i > 0 && data[i - 1] == 0) ? i - 1 : i;
+        if (nalStart >= 0 && (nalType == NAL_TYPE_SPS || nalType == NAL_TYPE_PPS)) {
+            result.append(data + nalStart, codeStart - nalStart);
+        }
+        nalStart = codeStart;
+        nalType = i + 3 < size ? (data[i + 3] & 0x1f) : 0;
+        i += 2;
+    }
+    if (nalStart >= 0 && (nalType == NAL_TYPE_SPS || nalType == NAL_TYPE_PPS)) {
+        result.append(data + nalStart, size - nalStart);
+    }
+    return result;
+}
+
+bool H264Loop::finishLoad()
+{
+    while (!m_frames.isEmpty() && !m_frames.first().keyframe) {
+        m_frames.removeFirst();
+    }
+    if (m_frames.isEmpty()) {
+        m_lastError = "no keyframe in the H.264 stream";
+        return false;
+    }
+    if (m_config.isEmpty()) {
+        m_config = parameterSets(m_frames.first().data);
+    }
+    if (m_config.isEmpty()) {
+        m_lastError = "no SPS/PPS in the H.264 stream";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,49 @@
+#ifndef H264LOOP_H
+#define H264LOOP_H
+
+#include <QByteArray>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+/**
+ * H264Loop - A pre-encoded H.264 clip replayed by the simulated devices
+ *
+ * Frames are Annex-B access units; the first one is a keyframe so the loop can restart
+ * without breaking the decoder. The SPS/PPS are kept apart and sent as the config packet.
+ * A loop is either split from a raw .h264 file or encoded once from a synthetic pattern
+ * and cached, so N simulated devices cost no encoding at all.
+ */
+class H264Loop
+{
+public:
+    struct Frame
+    {
+        QByteArray data;
+        bool keyframe = false;
+    };
+
+    // raw Annex-B H.264 elementary stream (ffmpeg -f h264, scrcpy --record=x.h264)
+    bool loadAnnexB(const QString &fileName);
+    // encode seconds of a moving test pattern, reusing cacheFile when it matches
+    bool encode(const QSize &size, int fps, int bitRate, int seconds, const QString &cacheFile);
+
+    const QByteArray &config() const;
+    const QVector<Frame> &frames() const;
+    QString lastError() const;
+
+private:
+    bool loadCache(const QString &fileName);
+    bool saveCache(const QString &fileName) const;
+    // SPS and PPS NAL units (with their start codes) of an access unit
+    static QByteArray parameterSets(const QByteArray &accessUnit);
+    // drop everything before the first keyframe and make sure we have a config packet
+    bool finishLoad();
+
+private:
+    QByteArray m_config;
+    QVector<Frame> m_frames;
+    QString m_lastError;
+};
+
+#endif // H264LOOP_H
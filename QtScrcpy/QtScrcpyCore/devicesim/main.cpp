@@ -0,0 +1,228 @@
+/**
+ * devicesim - Fake adb that turns every "device" into a synthetic scrcpy server
+ *
+ * Point the farm at it with QTSCRCPY_ADB_PATH=/path/to/devicesim and it sees
+ * QTSCRCPY_SIM_DEVICES devices. push/reverse/forward are recorded in a state directory,
+ * and the "shell ... com.genymobile.scrcpy.Server ..." command becomes a SimulatedDevice
+ * streaming an H.264 loop until the client disconnects or kills the command, exactly
+ * like the real server process. Everything else succeeds with no output.
+ *
+ * Environment:
+ *   QTSCRCPY_SIM_DEVICES       number of devices listed by "adb devices" (default 4)
+ *   QTSCRCPY_SIM_SIZE          native screen size, scaled down to max_size (default 1080x2400)
+ *   QTSCRCPY_SIM_VIDEO         raw Annex-B .h264 file to loop instead of the generated pattern
+ *   QTSCRCPY_SIM_LOOP_SECONDS  length of the generated loop (default 4)
+ *   QTSCRCPY_SIM_STATE_DIR     tunnel state and loop cache (default <tmp>/qtscrcpy-devicesim)
+ */
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QSize>
+#include <QStringList>
+#include <QTextStream>
+
+#include "h264loop.h"
+#include "simulateddevice.h"
+
+#define SIM_DEFAULT_DEVICES 4
+#define SIM_DEFAULT_SIZE QSize(1080, 2400)
+#define SIM_DEFAULT_FPS 30
+#define SIM_DEFAULT_BIT_RATE 4000000
+#define SIM_DEFAULT_LOOP_SECONDS 4
+#define SIM_SERIAL_FORMAT "sim-%1"
+#define SIM_SERVER_CLASS "com.genymobile.scrcpy.Server"
+
+static QString stateDir()
+{
+    QString dir = qEnvironmentVariable("QTSCRCPY_SIM_STATE_DIR");
+    if (dir.isEmpty()) {
+        dir = QDir::temp().filePath("qtscrcpy-devicesim");
+    }
+    QDir().mkpath(dir);
+    return dir;
+}
+
+// one file per tunnel: <serial>@<socket name>, containing "reverse <port>" or "forward <port>"
+static QString tunnelFile(const QString &serial, const QString &socketName)
+{
+    return QDir(stateDir()).filePath(QString("%1@%2.tunnel").arg(serial, socketName));
+}
+
+static bool writeTunnel(const QString &serial, const QString &socketName, const QString &mode, quint16 port)
+{
+    QFile file(tunnelFile(serial, socketName));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    file.write(QString("%1 %2").arg(mode).arg(port).toUtf8());
+    return true;
+}
+
+static bool readTunnel(const QString &serial, const QString &socketName, QString *mode, quint16 *port)
+{
+    QFile file(tunnelFile(serial, socketName));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QStringList fields = QString::fromUtf8(file.readAll()).split(' ');
+    if (fields.size() != 2) {
+        return false;
+    }
+    *mode = fields.at(0);
+    *port = fields.at(1).toUShort();
+    return *port != 0;
+}
+
+static QString stripPrefix(const QString &arg, const QString &prefix)
+{
+    return arg.startsWith(prefix) ? arg.mid(prefix.size()) : QString();
+}
+
+static QSize parseSize(const QString &value, const QSize &fallback)
+{
+    QStringList parts = value.split('x');
+    if (parts.size() != 2 || parts.at(0).toInt() <= 0 || parts.at(1).toInt() <= 0) {
+        return fallback;
+    }
+    return QSize(parts.at(0).toInt(), parts.at(1).toInt());
+}
+
+// same rule as the scrcpy server: the larger side fits max_size, both sides multiple of 8
+static QSize scaledSize(const QSize &native, int maxSize)
+{
+    QSize size = native;
+    if (maxSize > 0 && qMax(size.width(), size.height()) > maxSize) {
+        size.scale(maxSize, maxSize, Qt::KeepAspectRatio);
+    }
+    return QSize(size.width() & ~7, size.height() & ~7);
+}
+
+static int listDevices()
+{
+    bool ok = false;
+    int count = qEnvironmentVariableIntValue("QTSCRCPY_SIM_DEVICES", &ok);
+    if (!ok || count < 0) {
+        count = SIM_DEFAULT_DEVICES;
+    }
+    QTextStream out(stdout);
+    out << "List of devices attached\n";
+    for (int i = 1; i <= count; i++) {
+        out << QString(SIM_SERIAL_FORMAT).arg(i, 4, 10, QChar('0')) << "\tdevice\n";
+    }
+    return 0;
+}
+
+static int runServer(const QString &serial, const QStringList &args)
+{
+    int serverIndex = args.indexOf(SIM_SERVER_CLASS);
+    QString scid;
+    int maxSize = 0;
+    int maxFps = 0;
+    int bitRate = SIM_DEFAULT_BIT_RATE;
+    bool control = true;
+    // server arguments follow the class name and the version
+    for (int i = serverIndex + 2; i < args.size(); i++) {
+        const QString &arg = args.at(i);
+        if (arg.startsWith("scid=")) {
+            scid = stripPrefix(arg, "scid=");
+        } else if (arg.startsWith("max_size=")) {
+            maxSize = stripPrefix(arg, "max_size=").toInt();
+        } else if (arg.startsWith("max_fps=")) {
+            maxFps = stripPrefix(arg, "max_fps=").toInt();
+        } else if (arg.startsWith("video_bit_rate=")) {
+            bitRate = stripPrefix(arg, "video_bit_rate=").toInt();
+        } else if (arg == "control=false") {
+            control = false;
+        }
+    }
+
+    QString mode;
+    quint16 port = 0;
+    QString socketName = scid.isEmpty() ? QString("scrcpy") : QString("scrcpy_%1").arg(scid);
+    if (!readTunnel(serial, socketName, &mode, &port)) {
+        qCritical("devicesim: no tunnel for %s %s, run reverse or forward first", qUtf8Printable(serial), qUtf8Printable(socketName));
+        return 1;
+    }
+
+    QSize size = scaledSize(parseSize(qEnvironmentVariable("QTSCRCPY_SIM_SIZE"), SIM_DEFAULT_SIZE), maxSize);
+    int fps = maxFps > 0 ? maxFps : SIM_DEFAULT_FPS;
+    bool ok = false;
+    int loopSeconds = qEnvironmentVariableIntValue("QTSCRCPY_SIM_LOOP_SECONDS", &ok);
+    if (!ok || loopSeconds <= 0) {
+        loopSeconds = SIM_DEFAULT_LOOP_SECONDS;
+    }
+
+    H264Loop loop;
+    QString video = qEnvironmentVariable("QTSCRCPY_SIM_VIDEO");
+    if (!video.isEmpty()) {
+        ok = loop.loadAnnexB(video);
+    } else {
+        QString cache = QDir(stateDir()).filePath(
+            QString("loop_%1x%2_%3fps_%4bps_%5s.bin").arg(size.width()).arg(size.height()).arg(fps).arg(bitRate).arg(loopSeconds));
+        ok = loop.encode(size, fps, bitRate, loopSeconds, cache);
+    }
+    if (!ok) {
+        qCritical("devicesim: %s", qUtf8Printable(loop.lastError()));
+        return 1;
+    }
+
+    SimulatedDevice device(QString("Simulated %1").arg(serial), &loop, size, fps);
+    QObject::connect(&device, &SimulatedDevice::finished, qApp, &QCoreApplication::quit, Qt::QueuedConnection);
+    device.setControl(control);
+    ok = mode == "forward" ? device.startForward(port) : device.startReverse(port);
+    if (!ok) {
+        return 1;
+    }
+    qInfo("devicesim: %s streaming %dx%d@%d on port %d (%s)", qUtf8Printable(serial), size.width(), size.height(), fps, port, qUtf8Printable(mode));
+    return qApp->exec();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments().mid(1);
+
+    QString serial;
+    if (args.size() >= 2 && args.at(0) == "-s") {
+        serial = args.at(1);
+        args = args.mid(2);
+    }
+    if (args.isEmpty()) {
+        qCritical("devicesim: fake adb, see the header of devicesim/main.cpp");
+        return 1;
+    }
+
+    const QString command = args.at(0);
+    if (command == "devices") {
+        return listDevices();
+    }
+    if (command == "version") {
+        QTextStream(stdout) << "Android Debug Bridge version 1.0.41 (devicesim)\n";
+        return 0;
+    }
+    if (command == "reverse" || command == "forward") {
+        bool remove = args.size() >= 2 && args.at(1) == "--remove";
+        if (remove) {
+            // reverse --remove localabstract:NAME, forward --remove tcp:PORT
+            if (command == "reverse" && args.size() >= 3) {
+                QFile::remove(tunnelFile(serial, stripPrefix(args.at(2), "localabstract:")));
+            }
+            return 0;
+        }
+        if (args.size() < 3) {
+            return 1;
+        }
+        // reverse localabstract:NAME tcp:PORT, forward tcp:PORT localabstract:NAME
+        QString socketArg = command == "reverse" ? args.at(1) : args.at(2);
+        QString portArg = command == "reverse" ? args.at(2) : args.at(1);
+        quint16 port = stripPrefix(portArg, "tcp:").toUShort();
+        return writeTunnel(serial, stripPrefix(socketArg, "localabstract:"), command, port) ? 0 : 1;
+    }
+    if (command == "shell" && args.contains(SIM_SERVER_CLASS)) {
+        return runServer(serial, args);
+    }
+
+    // push, install, other shell commands, start-server...
+    return 0;
+}
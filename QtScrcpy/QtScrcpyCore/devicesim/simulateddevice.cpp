@@ -0,0 +1,200 @@
+#include <QDebug>
+#include <QHostAddress>
+
+#include "h264loop.h"
+#include "simulateddevice.h"
+
+#define DEVICE_NAME_FIELD_LENGTH 64
+#define SC_CODEC_ID_H264 UINT32_C(0x68323634) // "h264"
+#define SC_PACKET_FLAG_CONFIG (UINT64_C(1) << 63)
+#define SC_PACKET_FLAG_KEY_FRAME (UINT64_C(1) << 62)
+// a real encoder stalls when the socket does not drain, we drop frames instead, up to the next
+// keyframe so the client never gets a frame whose reference is missing
+#define MAX_PENDING_VIDEO_BYTES (8 * 1024 * 1024)
+#define STATS_INTERVAL_MS 10000
+
+static void bufferWrite32be(quint8 *buf, quint32 value)
+{
+    buf[0] = value >> 24;
+    buf[1] = value >> 16;
+    buf[2] = value >> 8;
+    buf[3] = value;
+}
+
+static void bufferWrite64be(quint8 *buf, quint64 value)
+{
+    bufferWrite32be(buf, value >> 32);
+    bufferWrite32be(&buf[4], static_cast<quint32>(value));
+}
+
+SimulatedDevice::SimulatedDevice(const QString &deviceName, const H264Loop *loop, const QSize &frameSize, int fps, QObject *parent)
+    : QObject(parent), m_deviceName(deviceName), m_loop(loop), m_frameSize(frameSize), m_fps(qMax(1, fps))
+{
+    // ticking at twice the frame rate keeps the jitter under half a frame
+    m_frameTimer.setTimerType(Qt::PreciseTimer);
+    m_frameTimer.setInterval(qMax(1, 500 / m_fps));
+    connect(&m_frameTimer, &QTimer::timeout, this, &SimulatedDevice::onFrameTimer);
+    connect(&m_server, &QTcpServer::newConnection, this, &SimulatedDevice::onNewConnection);
+}
+
+SimulatedDevice::~SimulatedDevice()
+{
+    printStats();
+}
+
+void SimulatedDevice::setControl(bool control)
+{
+    m_control = control;
+}
+
+bool SimulatedDevice::startReverse(quint16 port)
+{
+    m_forward = false;
+    m_port = port;
+
+    // the client's TcpServer takes the first connection as the video socket
+    m_videoSocket = new QTcpSocket(this);
+    connect(m_videoSocket, &QTcpSocket::connected, this, &SimulatedDevice::onVideoConnected);
+    connect(m_videoSocket, &QTcpSocket::disconnected, this, &SimulatedDevice::finished);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    connect(m_videoSocket, &QAbstractSocket::errorOccurred, this, [this](QAbstractSocket::SocketError error) {
+#else
+    connect(m_videoSocket, QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::error), this, [this](QAbstractSocket::SocketError error) {
+#endif
+        qWarning() << "devicesim: video socket error" << error << "on port" << m_port;
+        emit finished();
+    });
+    m_videoSocket->connectToHost(QHostAddress::LocalHost, port);
+    return true;
+}
+
+bool SimulatedDevice::startForward(quint16 port)
+{
+    m_forward = true;
+    m_port = port;
+
+    if (!m_server.listen(QHostAddress::LocalHost, port)) {
+        qWarning() << "devicesim: could not listen on port" << port << m_server.errorString();
+        return false;
+    }
+    return true;
+}
+
+void SimulatedDevice::onNewConnection()
+{
+    while (m_server.hasPendingConnections()) {
+        QTcpSocket *socket = m_server.nextPendingConnection();
+        socket->setParent(this);
+        connect(socket, &QTcpSocket::disconnected, this, &SimulatedDevice::finished);
+        if (!m_videoSocket) {
+            m_videoSocket = socket;
+            onVideoConnected();
+            if (!m_control) {
+                m_server.close();
+            }
+        } else if (!m_controlSocket) {
+            m_controlSocket = socket;
+            // the client reads one dummy byte from each socket it opened
+            m_controlSocket->write("\0", 1);
+            setupControlSocket();
+            m_server.close();
+        } else {
+            socket->deleteLater();
+        }
+    }
+}
+
+void SimulatedDevice::onVideoConnected()
+{
+    m_videoSocket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+    if (m_forward) {
+        m_videoSocket->write("\0", 1);
+    } else if (m_control) {
+        m_controlSocket = new QTcpSocket(this);
+        connect(m_controlSocket, &QTcpSocket::disconnected, this, &SimulatedDevice::finished);
+        m_controlSocket->connectToHost(QHostAddress::LocalHost, m_port);
+        setupControlSocket();
+    }
+
+    // device meta, then codec meta
+    quint8 meta[DEVICE_NAME_FIELD_LENGTH + 12] = {};
+    QByteArray name = m_deviceName.toUtf8().left(DEVICE_NAME_FIELD_LENGTH - 1);
+    memcpy(meta, name.constData(), static_cast<size_t>(name.size()));
+    bufferWrite32be(&meta[DEVICE_NAME_FIELD_LENGTH], SC_CODEC_ID_H264);
+    bufferWrite32be(&meta[DEVICE_NAME_FIELD_LENGTH + 4], static_cast<quint32>(m_frameSize.width()));
+    bufferWrite32be(&meta[DEVICE_NAME_FIELD_LENGTH + 8], static_cast<quint32>(m_frameSize.height()));
+    m_videoSocket->write(reinterpret_cast<const char *>(meta), sizeof(meta));
+
+    writePacket(m_loop->config(), SC_PACKET_FLAG_CONFIG);
+
+    m_clock.start();
+    m_frameTimer.start();
+    QTimer::singleShot(STATS_INTERVAL_MS, this, &SimulatedDevice::printStats);
+}
+
+void SimulatedDevice::setupControlSocket()
+{
+    connect(m_controlSocket, &QTcpSocket::readyRead, this, &SimulatedDevice::onControlReadyRead);
+}
+
+void SimulatedDevice::onControlReadyRead()
+{
+    // touch, key and clipboard messages are accepted and dropped
+    m_controlBytes += m_controlSocket->readAll().size();
+}
+
+void SimulatedDevice::onFrameTimer()
+{
+    if (!m_videoSocket || m_videoSocket->state() != QAbstractSocket::ConnectedState) {
+        return;
+    }
+
+    const QVector<H264Loop::Frame> &frames = m_loop->frames();
+    // frames are due on a fixed clock, a late tick sends several
+    qint64 due = m_clock.nsecsElapsed() / 1000 * m_fps / 1000000 + 1;
+    while (m_framesSent + m_framesDropped < due) {
+        qint64 index = m_framesSent + m_framesDropped;
+        quint64 pts = static_cast<quint64>(index * 1000000 / m_fps);
+        const H264Loop::Frame &frame = frames.at(static_cast<int>(index % frames.size()));
+
+        if (m_waitKeyframe && frame.keyframe && m_videoSocket->bytesToWrite() <= MAX_PENDING_VIDEO_BYTES) {
+            m_waitKeyframe = false;
+        }
+        if (m_waitKeyframe || m_videoSocket->bytesToWrite() > MAX_PENDING_VIDEO_BYTES) {
+            // the following P-frames reference this one, they go too
+            m_waitKeyframe = true;
+            m_framesDropped++;
+            continue;
+        }
+        writePacket(frame.data, pts | (frame.keyframe ? SC_PACKET_FLAG_KEY_FRAME : 0));
+        m_framesSent++;
+    }
+}
+
+void SimulatedDevice::writePacket(const QByteArray &data, quint64 ptsFlags)
+{
+    quint8 header[12];
+    bufferWrite64be(header, ptsFlags);
+    bufferWrite32be(&header[8], static_cast<quint32>(data.size()));
+    m_videoSocket->write(reinterpret_cast<const char *>(header), sizeof(header));
+    m_videoSocket->write(data);
+    m_bytesSent += sizeof(header) + data.size();
+}
+
+void SimulatedDevice::printStats()
+{
+    if (!m_clock.isValid()) {
+        return;
+    }
+    qint64 elapsedMs = qMax<qint64>(1, m_clock.elapsed());
+    qInfo().noquote() << QString("devicesim: %1 sent %2 frames (%3 dropped), %4 kbps, %5 control bytes")
+                             .arg(m_deviceName)
+                             .arg(m_framesSent)
+                             .arg(m_framesDropped)
+                             .arg(m_bytesSent * 8 / elapsedMs)
+                             .arg(m_controlBytes);
+    if (m_frameTimer.isActive()) {
+        QTimer::singleShot(STATS_INTERVAL_MS, this, &SimulatedDevice::printStats);
+    }
+}
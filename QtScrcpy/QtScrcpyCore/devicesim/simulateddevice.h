@@ -0,0 +1,75 @@
+#ifndef SIMULATEDDEVICE_H
+#define SIMULATEDDEVICE_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
+#include <QSize>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+class H264Loop;
+
+/**
+ * SimulatedDevice - Plays the scrcpy server side of one device connection
+ *
+ * Same wire format as the real server started by Server::execute(): the video socket
+ * carries the 64-byte device name, the codec id and the frame size, the config packet,
+ * then every access unit behind a 12-byte pts/flags + size header. The control socket
+ * is drained and counted, no input is injected anywhere.
+ *
+ * In reverse mode it connects to the client's port (video first, then control); in
+ * forward mode it listens on the forwarded port and sends the dummy bytes. A control=false
+ * session (a second video stream of the same device) has no control socket.
+ */
+class SimulatedDevice : public QObject
+{
+    Q_OBJECT
+public:
+    SimulatedDevice(const QString &deviceName, const H264Loop *loop, const QSize &frameSize, int fps, QObject *parent = Q_NULLPTR);
+    virtual ~SimulatedDevice();
+
+    // before start
+    void setControl(bool control);
+    bool startReverse(quint16 port);
+    bool startForward(quint16 port);
+
+signals:
+    // a socket was closed by the client or could not connect
+    void finished();
+
+private slots:
+    void onVideoConnected();
+    void onControlReadyRead();
+    void onFrameTimer();
+    void onNewConnection();
+
+private:
+    void setupControlSocket();
+    void writePacket(const QByteArray &data, quint64 ptsFlags);
+    void printStats();
+
+private:
+    QString m_deviceName;
+    const H264Loop *m_loop = Q_NULLPTR;
+    QSize m_frameSize;
+    int m_fps = 30;
+    quint16 m_port = 0;
+    bool m_forward = false;
+    bool m_control = true;
+
+    QTcpServer m_server;
+    QPointer<QTcpSocket> m_videoSocket;
+    QPointer<QTcpSocket> m_controlSocket;
+
+    QTimer m_frameTimer;
+    QElapsedTimer m_clock;
+    qint64 m_framesSent = 0;
+    qint64 m_framesDropped = 0;
+    bool m_waitKeyframe = false; // a frame was dropped, the stream resumes at a keyframe
+    qint64 m_bytesSent = 0;
+    qint64 m_controlBytes = 0;
+};
+
+#endif // SIMULATEDDEVICE_H
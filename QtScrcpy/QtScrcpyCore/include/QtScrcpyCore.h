@@ -83,6 +83,12 @@ public:
 signals:
     void deviceConnected(bool success, const QString& serial, const QString& deviceName, const QSize& size);
     void deviceDisconnected(QString serial);
+    void recordingExported(const QString& serial, const QString& filePath, bool success);
+    void clipSaved(const QString& serial, const QString& filePath, bool success);
+    // attachDetailStream() result, size is the detail frame size
+    void detailStreamStarted(const QString& serial, bool success, const QSize& size);
+    // the detail session ended without detachDetailStream(), observers are back on the main stream
+    void detailStreamStopped(const QString& serial);
 
 public:
     virtual void setUserData(void* data) = 0;
@@ -119,6 +125,17 @@ public:
 
     virtual void screenshot() = 0;
     virtual void showTouch(bool show) = 0;
+    // rolling recording only (DeviceParams::recordSegmentSeconds), reported by recordingExported
+    virtual void exportRecording(int lastSeconds, const QString &filePath) = 0;
+    // write the in-memory clip buffer (DeviceParams::clipBufferSeconds) to filePath, reported by clipSaved
+    // false when there is nothing buffered yet
+    virtual bool saveClip(const QString &filePath) = 0;
+    // second, video only scrcpy session (own scid) while the main stream is running, e.g. full
+    // resolution for the device being operated; from its first decoded frame the observers get
+    // its frames instead of the main stream's, until it is detached. Input keeps going through
+    // the main session. false when the main stream is not running
+    virtual bool attachDetailStream(quint16 maxSize, quint32 bitRate, quint32 maxFps) = 0;
+    virtual void detachDetailStream() = 0;
 
     virtual bool isReversePort(quint16 port) = 0;
     virtual const QString &getSerial() = 0;
@@ -137,9 +154,21 @@ public:
     virtual QPointer<IDevice> getDevice(const QString& serial) = 0;
     virtual QStringList getAllConnectedSerials() const = 0;
 
+    // broadcast: the payload is encoded once and the same immutable buffer is queued to every device
+    // returns the clipboard sequence, acknowledged per device through clipboardAcked()
+    virtual quint64 broadcastClipboard(const QStringList &serials, const QString &text, bool paste) = 0;
+    virtual void broadcastTextInput(const QStringList &serials, const QString &text) = 0;
+
+    // snapshot every device without blocking its decoder, conversion and encoding run on a worker pool
+    // format: "png", "jpg" or "webp" (falls back to png), quality: 0-100 or -1 for the default
+    // returns how many screenshots were queued, each one is reported through screenshotSaved()
+    virtual int screenshotAll(const QStringList &serials, const QString &dirPath, const QString &format, int quality = -1) = 0;
+
 signals:
     void deviceConnected(bool success, const QString& serial, const QString& deviceName, const QSize& size);
     void deviceDisconnected(QString serial);
+    void clipboardAcked(const QString& serial, quint64 sequence);
+    void screenshotSaved(const QString& serial, const QString& filePath, bool success);
 };
 
 }
@@ -32,6 +32,9 @@ struct DeviceParams {
     QString recordPath = "";          // 视频保存路径
     QString recordFileFormat = "mp4"; // 视频保存格式 mp4/mkv
     bool recordFile = false;          // 录制到文件
+    int recordSegmentSeconds = 0;     // 分段滚动录制的每段时长(秒)，0表示不分段
+    int recordSegmentCount = 30;      // 分段录制时最多保留的段数，更早的段会被删除
+    int clipBufferSeconds = 0;        // 内存中保留最近多少秒的视频流用于saveClip()，0表示关闭
 
     QString pushFilePath = "/sdcard/"; // 推送到安卓设备的文件保存路径（必须以/结尾）
 
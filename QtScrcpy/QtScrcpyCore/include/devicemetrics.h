@@ -0,0 +1,69 @@
+#ifndef DEVICEMETRICS_H
+#define DEVICEMETRICS_H
+
+#include <atomic>
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+namespace qsc {
+
+/**
+ * DeviceMetrics - Cumulative counters and gauges of one device, for the metrics exporter
+ *
+ * Written by the pipeline threads with relaxed atomics, read by anyone. Counters only
+ * ever grow, rates (fps, bitrate) are left to the scraper.
+ */
+struct DeviceMetrics
+{
+    DeviceMetrics();
+
+    // counters
+    std::atomic<quint64> packetsReceived;
+    std::atomic<quint64> bytesReceived;  // compressed video payload
+    std::atomic<quint64> framesRendered; // decoded frames consumed by the renderer (FpsCounter)
+    std::atomic<quint64> framesSkipped;  // decoded frames replaced before being consumed (FpsCounter)
+    std::atomic<quint64> framesUnchanged; // decoded frames identical to the last one, never offered (VideoBuffer)
+    std::atomic<quint64> connects;       // successful stream starts, the first one is not a reconnect
+
+    // gauges
+    std::atomic<bool> connected;
+    std::atomic<quint32> fps;               // rendered frames of the last FpsCounter second
+    std::atomic<qint64> frameBufferBytes;   // decoder + render AVFrames
+    std::atomic<qint64> clipBufferBytes;    // PacketRing
+    std::atomic<qint64> socketBacklogBytes; // received but not read yet by the demuxer, after its last packet
+
+private:
+    Q_DISABLE_COPY(DeviceMetrics)
+};
+
+/**
+ * DeviceMetricsRegistry - The DeviceMetrics of every device, by serial
+ *
+ * Same lifetime rule as StageLatencyRegistry: entries are never freed, so a reconnected
+ * device keeps its counters and the pipeline can hold raw pointers.
+ */
+class DeviceMetricsRegistry
+{
+public:
+    static DeviceMetricsRegistry &instance();
+
+    // created on first use, nullptr for an empty serial
+    DeviceMetrics *device(const QString &serial);
+    QStringList serials() const;
+
+private:
+    DeviceMetricsRegistry();
+    ~DeviceMetricsRegistry();
+    Q_DISABLE_COPY(DeviceMetricsRegistry)
+
+private:
+    mutable QMutex m_mutex;
+    QHash<QString, DeviceMetrics *> m_devices;
+};
+
+}
+
+#endif // DEVICEMETRICS_H
@@ -0,0 +1,141 @@
+#ifndef STAGELATENCY_H
+#define STAGELATENCY_H
+
+#include <atomic>
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace qsc {
+
+/**
+ * LatencyHistogram - Lock-free log-linear (HDR-style) histogram of durations in microseconds
+ *
+ * 16 linear sub-buckets per power of two: values below 16 us are exact, above that the
+ * relative error is under 6.25%, up to ~70 minutes. record() is a handful of relaxed atomic
+ * operations and never blocks, snapshot() may run concurrently with it.
+ */
+class LatencyHistogram
+{
+public:
+    enum
+    {
+        SUB_BUCKET_BITS = 4,
+        SUB_BUCKETS = 1 << SUB_BUCKET_BITS,
+        MAX_MAGNITUDE = 28,
+        BUCKET_COUNT = SUB_BUCKETS * (MAX_MAGNITUDE + 1)
+    };
+
+    struct Snapshot
+    {
+        quint64 count = 0;
+        qint64 sumUs = 0;
+        qint64 maxUs = 0;
+        QVector<quint64> buckets;
+
+        // pct in [0, 100], 0 when empty
+        qint64 percentile(double pct) const;
+        double meanUs() const;
+        void merge(const Snapshot &other);
+    };
+
+    LatencyHistogram();
+
+    void record(qint64 us);
+    void reset();
+    Snapshot snapshot() const;
+
+    static int bucketIndex(qint64 us);
+    // representative value (middle) of a bucket
+    static qint64 bucketValue(int index);
+
+private:
+    Q_DISABLE_COPY(LatencyHistogram)
+
+    std::atomic<quint64> m_buckets[BUCKET_COUNT];
+    std::atomic<qint64> m_sumUs;
+    std::atomic<qint64> m_maxUs;
+};
+
+/**
+ * StageLatency - Per-device latency histograms of the video pipeline stages
+ *
+ * Always on (QTSCRCPY_STAGE_LATENCY=0 turns it off). Each stage is recorded by the thread
+ * that runs it with the steady clock of StageLatency::now():
+ * - socket read:     frame header received -> payload fully read (demuxer thread)
+ * - parse:           H.264 parser (demuxer thread)
+ * - decode:          packet sent to the decoder -> frame decoded (demuxer thread)
+ * - queue wait:      frame copied for the GUI thread -> picked up by it
+ * - texture upload:  YUV planes uploaded to the GL textures (GUI thread)
+ * - paint:           paintGL() (GUI thread)
+ */
+class StageLatency
+{
+public:
+    enum Stage
+    {
+        SL_SOCKET_READ = 0,
+        SL_PARSE,
+        SL_DECODE,
+        SL_QUEUE_WAIT,
+        SL_TEXTURE_UPLOAD,
+        SL_PAINT,
+        SL_COUNT
+    };
+
+    StageLatency();
+
+    static bool isEnabled();
+    // monotonic clock, in microseconds
+    static qint64 now();
+    static const char *stageName(Stage stage);
+
+    // any thread, lock-free
+    void record(Stage stage, qint64 us);
+    void recordSince(Stage stage, qint64 startUs);
+
+    LatencyHistogram::Snapshot snapshot(Stage stage) const;
+    void reset();
+
+private:
+    Q_DISABLE_COPY(StageLatency)
+
+    LatencyHistogram m_histograms[SL_COUNT];
+};
+
+/**
+ * StageLatencyRegistry - The StageLatency of every device, by serial
+ *
+ * Entries live as long as the process: the pipeline components keep raw pointers for
+ * their hot path, and a reconnected device keeps accumulating into the same histograms.
+ */
+class StageLatencyRegistry
+{
+public:
+    static StageLatencyRegistry &instance();
+
+    // created on first use, nullptr when the instrumentation is disabled
+    StageLatency *device(const QString &serial);
+    QStringList serials() const;
+    // one stage merged over all devices
+    LatencyHistogram::Snapshot farmSnapshot(StageLatency::Stage stage) const;
+    // per device and stage: count, mean, p50, p90, p99 and max, in milliseconds
+    QString dump() const;
+    void resetAll();
+
+private:
+    StageLatencyRegistry();
+    ~StageLatencyRegistry();
+    Q_DISABLE_COPY(StageLatencyRegistry)
+
+private:
+    mutable QMutex m_mutex;
+    QHash<QString, StageLatency *> m_devices;
+};
+
+}
+
+#endif // STAGELATENCY_H
@@ -32,4 +32,11 @@
 #define QTSCRCPY_LAVF_HAS_NEW_ENCODING_DECODING_API
 #endif
 
+// In ffmpeg/doc/APIchanges:
+// 2023-05-xx - lavf 61.0.100 - avio.h
+//   The write_packet callback of avio_alloc_context() takes a const buffer.
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+#define QTSCRCPY_LAVF_HAS_CONST_AVIO_WRITE_PACKET
+#endif
+
 #endif // COMPAT_H
@@ -56,3 +56,38 @@ quint64 BufferUtil::read64(QBuffer &buffer)
     return ((quint64)msb << 32) | lsb;
     ;
 }
+
+quint16 BufferUtil::read16(const uchar *buf)
+{
+    return static_cast<quint16>((buf[0] << 8) | buf[1]);
+}
+
+quint32 BufferUtil::read32(const uchar *buf)
+{
+    return (static_cast<quint32>(buf[0]) << 24) | (static_cast<quint32>(buf[1]) << 16) | (static_cast<quint32>(buf[2]) << 8) | buf[3];
+}
+
+quint64 BufferUtil::read64(const uchar *buf)
+{
+    return (static_cast<quint64>(read32(buf)) << 32) | read32(buf + 4);
+}
+
+void BufferUtil::write16(uchar *buf, quint16 value)
+{
+    buf[0] = static_cast<uchar>(value >> 8);
+    buf[1] = static_cast<uchar>(value);
+}
+
+void BufferUtil::write32(uchar *buf, quint32 value)
+{
+    buf[0] = static_cast<uchar>(value >> 24);
+    buf[1] = static_cast<uchar>(value >> 16);
+    buf[2] = static_cast<uchar>(value >> 8);
+    buf[3] = static_cast<uchar>(value);
+}
+
+void BufferUtil::write64(uchar *buf, quint64 value)
+{
+    write32(buf, static_cast<quint32>(value >> 32));
+    write32(buf + 4, static_cast<quint32>(value));
+}
@@ -11,6 +11,14 @@ public:
     static quint16 read16(QBuffer &buffer);
     static quint32 read32(QBuffer &buffer);
     static quint64 read64(QBuffer &buffer);
+
+    // big endian writes/reads straight from memory, for in place encoding and parsing
+    static void write16(uchar *buf, quint16 value);
+    static void write32(uchar *buf, quint32 value);
+    static void write64(uchar *buf, quint64 value);
+    static quint16 read16(const uchar *buf);
+    static quint32 read32(const uchar *buf);
+    static quint64 read64(const uchar *buf);
 };
 
 #endif // BUFFERUTIL_H
@@ -3,7 +3,9 @@
 
 #include "controller.h"
 #include "controlmsg.h"
+#include "devicemsg.h"
 #include "inputconvertgame.h"
+#include "latencyprobe.h"
 #include "receiver.h"
 #include "videosocket.h"
 
@@ -26,8 +28,24 @@ void Controller::postControlMsg(ControlMsg *controlMsg)
     }
 }
 
+void Controller::postEncodedControl(const QByteArray &encoded)
+{
+    if (encoded.isEmpty()) {
+        return;
+    }
+    // goes through the same event queue as every other message to keep ordering
+    ControlMsg *controlMsg = new ControlMsg(static_cast<ControlMsg::ControlMsgType>(encoded.at(0)));
+    controlMsg->setSerializedData(encoded);
+    postControlMsg(controlMsg);
+}
+
 void Controller::recvDeviceMsg(DeviceMsg *deviceMsg)
 {
+    if (DeviceMsg::DMT_ACK_CLIPBOARD == deviceMsg->type()) {
+        emit clipboardAcked(deviceMsg->getAckClipboardSequence());
+        return;
+    }
+
     if (!m_receiver) {
         return;
     }
@@ -59,6 +77,11 @@ void Controller::updateScript(QString gameScript)
     connect(m_inputConvert, &InputConvertBase::grabCursor, this, &Controller::grabCursor);
 }
 
+void Controller::setLatencyProbe(LatencyProbe *probe)
+{
+    m_latencyProbe = probe;
+}
+
 bool Controller::isCurrentCustomKeymap()
 {
     if (!m_inputConvert) {
@@ -226,7 +249,11 @@ bool Controller::event(QEvent *event)
     if (event && static_cast<ControlMsg::Type>(event->type()) == ControlMsg::Control) {
         ControlMsg *controlMsg = dynamic_cast<ControlMsg *>(event);
         if (controlMsg) {
-            sendControl(controlMsg->serializeData());
+            bool sent = sendControl(controlMsg->serializeData());
+            QPoint pos;
+            if (sent && m_latencyProbe && controlMsg->isTouchDown(pos)) {
+                m_latencyProbe->onTouchSent(pos, controlMsg->createdUs(), LatencyProbe::now());
+            }
         }
         return true;
     }
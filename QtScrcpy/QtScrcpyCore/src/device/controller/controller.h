@@ -11,6 +11,7 @@ class QTcpSocket;
 class Receiver;
 class InputConvertBase;
 class DeviceMsg;
+class LatencyProbe;
 class Controller : public QObject
 {
     Q_OBJECT
@@ -19,10 +20,14 @@ public:
     virtual ~Controller();
 
     void postControlMsg(ControlMsg *controlMsg);
+    // queue an already serialized message, shared with other controllers
+    void postEncodedControl(const QByteArray &encoded);
     void recvDeviceMsg(DeviceMsg *deviceMsg);
     void test(QRect rc);
 
     void updateScript(QString gameScript = "");
+    // not owned, touch downs are reported to it once written to the socket
+    void setLatencyProbe(LatencyProbe *probe);
     bool isCurrentCustomKeymap();
 
     void postGoBack();
@@ -54,6 +59,7 @@ public:
 
 signals:
     void grabCursor(bool grab);
+    void clipboardAcked(quint64 sequence);
 
 protected:
     bool event(QEvent *event);
@@ -66,6 +72,7 @@ private:
     QPointer<Receiver> m_receiver;
     QPointer<InputConvertBase> m_inputConvert;
     std::function<qint64(const QByteArray&)> m_sendData = Q_NULLPTR;
+    LatencyProbe *m_latencyProbe = Q_NULLPTR;
 };
 
 #endif // CONTROLLER_H
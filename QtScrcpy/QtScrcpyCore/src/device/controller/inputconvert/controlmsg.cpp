@@ -2,6 +2,7 @@
 
 #include "bufferutil.h"
 #include "controlmsg.h"
+#include "latencyprobe.h"
 
 #define MIN(X, Y) ((X) < (Y) ? (X) : (Y))
 #define MAX(X, Y) ((X) > (Y) ? (X) : (Y))
@@ -10,19 +11,13 @@
 ControlMsg::ControlMsg(ControlMsgType controlMsgType) : QScrcpyEvent(Control)
 {
     m_data.type = controlMsgType;
-}
-
-ControlMsg::~ControlMsg()
-{
-    if (CMT_SET_CLIPBOARD == m_data.type && Q_NULLPTR != m_data.setClipboard.text) {
-        delete m_data.setClipboard.text;
-        m_data.setClipboard.text = Q_NULLPTR;
-    } else if (CMT_INJECT_TEXT == m_data.type && Q_NULLPTR != m_data.injectText.text) {
-        delete m_data.injectText.text;
-        m_data.injectText.text = Q_NULLPTR;
+    if (LatencyProbe::isEnabled()) {
+        m_createdUs = LatencyProbe::now();
     }
 }
 
+ControlMsg::~ControlMsg() {}
+
 void ControlMsg::setInjectKeycodeMsgData(AndroidKeyeventAction action, AndroidKeycode keycode, quint32 repeat, AndroidMetastate metastate)
 {
     m_data.injectKeycode.action = action;
@@ -38,10 +33,7 @@ void ControlMsg::setInjectTextMsgData(QString &text)
         // injecting a text takes time, so limit the text length
         text = text.left(CONTROL_MSG_INJECT_TEXT_MAX_LENGTH);
     }
-    QByteArray tmp = text.toUtf8();
-    m_data.injectText.text = new char[tmp.length() + 1];
-    memcpy(m_data.injectText.text, tmp.data(), tmp.length());
-    m_data.injectText.text[tmp.length()] = '\0';
+    m_serialized = serializeInjectText(text);
 }
 
 void ControlMsg::setInjectTouchMsgData(
@@ -75,20 +67,43 @@ void ControlMsg::setGetClipboardMsgData(ControlMsg::GetClipboardCopyKey copyKey)
 
 void ControlMsg::setSetClipboardMsgData(QString &text, bool paste)
 {
-    if (text.isEmpty()) {
-        m_data.setClipboard.text = Q_NULLPTR;
-        return;
-    }
     if (CONTROL_MSG_CLIPBOARD_TEXT_MAX_LENGTH < text.length()) {
         text = text.left(CONTROL_MSG_CLIPBOARD_TEXT_MAX_LENGTH);
     }
+    m_serialized = serializeSetClipboard(text, paste);
+}
+
+void ControlMsg::setSerializedData(const QByteArray &data)
+{
+    m_serialized = data;
+}
 
-    QByteArray tmp = text.toUtf8();
-    m_data.setClipboard.text = new char[tmp.length() + 1];
-    memcpy(m_data.setClipboard.text, tmp.data(), tmp.length());
-    m_data.setClipboard.text[tmp.length()] = '\0';
-    m_data.setClipboard.paste = paste;
-    m_data.setClipboard.sequence = 0;
+QByteArray ControlMsg::serializeInjectText(const QString &text)
+{
+    QByteArray utf8 = text.left(CONTROL_MSG_INJECT_TEXT_MAX_LENGTH).toUtf8();
+
+    // type + length(4) + text
+    QByteArray byteArray(5 + utf8.size(), Qt::Uninitialized);
+    uchar *p = reinterpret_cast<uchar *>(byteArray.data());
+    p[0] = CMT_INJECT_TEXT;
+    BufferUtil::write32(p + 1, static_cast<quint32>(utf8.size()));
+    memcpy(p + 5, utf8.constData(), static_cast<size_t>(utf8.size()));
+    return byteArray;
+}
+
+QByteArray ControlMsg::serializeSetClipboard(const QString &text, bool paste, quint64 sequence)
+{
+    QByteArray utf8 = text.left(CONTROL_MSG_CLIPBOARD_TEXT_MAX_LENGTH).toUtf8();
+
+    // type + sequence(8) + paste(1) + length(4) + text
+    QByteArray byteArray(14 + utf8.size(), Qt::Uninitialized);
+    uchar *p = reinterpret_cast<uchar *>(byteArray.data());
+    p[0] = CMT_SET_CLIPBOARD;
+    BufferUtil::write64(p + 1, sequence);
+    p[9] = paste ? 1 : 0;
+    BufferUtil::write32(p + 10, static_cast<quint32>(utf8.size()));
+    memcpy(p + 14, utf8.constData(), static_cast<size_t>(utf8.size()));
+    return byteArray;
 }
 
 void ControlMsg::setDisplayPowerData(bool on)
@@ -101,6 +116,23 @@ void ControlMsg::setBackOrScreenOnData(bool down)
     m_data.backOrScreenOn.action = down ? AKEY_EVENT_ACTION_DOWN : AKEY_EVENT_ACTION_UP;
 }
 
+qint64 ControlMsg::createdUs() const
+{
+    return m_createdUs;
+}
+
+bool ControlMsg::isTouchDown(QPoint &pos) const
+{
+    if (CMT_INJECT_TOUCH != m_data.type || !m_serialized.isEmpty()) {
+        return false;
+    }
+    if (AMOTION_EVENT_ACTION_DOWN != m_data.injectTouch.action && AMOTION_EVENT_ACTION_POINTER_DOWN != (m_data.injectTouch.action & AMOTION_EVENT_ACTION_MASK)) {
+        return false;
+    }
+    pos = m_data.injectTouch.position.topLeft();
+    return true;
+}
+
 void ControlMsg::writePosition(QBuffer &buffer, const QRect &value)
 {
     BufferUtil::write32(buffer, value.left());
@@ -133,6 +165,10 @@ qint16 ControlMsg::flostToI16fp(float f)
 
 QByteArray ControlMsg::serializeData()
 {
+    if (!m_serialized.isEmpty()) {
+        return m_serialized;
+    }
+
     QByteArray byteArray;
     QBuffer buffer(&byteArray);
     buffer.open(QBuffer::WriteOnly);
@@ -145,10 +181,6 @@ QByteArray ControlMsg::serializeData()
         BufferUtil::write32(buffer, m_data.injectKeycode.repeat);
         BufferUtil::write32(buffer, m_data.injectKeycode.metastate);
         break;
-    case CMT_INJECT_TEXT:
-        BufferUtil::write32(buffer, static_cast<quint32>(strlen(m_data.injectText.text)));
-        buffer.write(m_data.injectText.text, strlen(m_data.injectText.text));
-        break;
     case CMT_INJECT_TOUCH: {
         buffer.putChar(m_data.injectTouch.action);
         BufferUtil::write64(buffer, m_data.injectTouch.id);
@@ -178,17 +210,6 @@ QByteArray ControlMsg::serializeData()
     case CMT_GET_CLIPBOARD:
         buffer.putChar(m_data.getClipboard.copyKey);
         break;
-    case CMT_SET_CLIPBOARD:
-        BufferUtil::write64(buffer, m_data.setClipboard.sequence);
-        buffer.putChar(!!m_data.setClipboard.paste);
-        if (m_data.setClipboard.text != Q_NULLPTR) {
-            BufferUtil::write32(buffer, static_cast<quint32>(strlen(m_data.setClipboard.text)));
-            buffer.write(m_data.setClipboard.text, strlen(m_data.setClipboard.text));
-        } else {
-            BufferUtil::write32(buffer, 0);
-            buffer.write(m_data.setClipboard.text, 0);
-        }
-        break;
     case CMT_SET_DISPLAY_POWER:
         buffer.putChar(m_data.setDisplayPower.on);
         break;
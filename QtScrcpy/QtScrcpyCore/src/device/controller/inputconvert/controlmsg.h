@@ -71,8 +71,19 @@ public:
     void setDisplayPowerData(bool on);
     void setBackOrScreenOnData(bool down);
 
+    // Pre-encoded payload, e.g. one broadcast buffer shared by many devices (implicitly shared, not copied)
+    void setSerializedData(const QByteArray &data);
     QByteArray serializeData();
 
+    // Encode once, without going through a ControlMsg instance
+    static QByteArray serializeInjectText(const QString &text);
+    static QByteArray serializeSetClipboard(const QString &text, bool paste, quint64 sequence = 0);
+
+    // latency probe: when the message was created (LatencyProbe::now(), 0 if the probe is off)
+    qint64 createdUs() const;
+    // true for a touch down, pos in frame coordinates
+    bool isTouchDown(QPoint &pos) const;
+
 private:
     void writePosition(QBuffer &buffer, const QRect &value);
     quint16 flostToU16fp(float f);
@@ -92,10 +103,6 @@ private:
                 AndroidMetastate metastate;
             } injectKeycode;
             struct
-            {
-                char *text = Q_NULLPTR;
-            } injectText;
-            struct
             {
                 quint64 id;
                 AndroidMotioneventAction action;
@@ -121,12 +128,6 @@ private:
                 enum GetClipboardCopyKey copyKey;
             } getClipboard;
             struct
-            {
-                uint64_t sequence = 0;
-                char *text = Q_NULLPTR;
-                bool paste = true;
-            } setClipboard;
-            struct
             {
                 bool on;
             } setDisplayPower;
@@ -137,6 +138,9 @@ private:
     };
 
     ControlMsgData m_data;
+    // text messages are encoded up front, no intermediate char copies
+    QByteArray m_serialized;
+    qint64 m_createdUs = 0;
 };
 
 #endif // CONTROLMSG_H
@@ -1,7 +1,6 @@
 #include <QDebug>
 #include <QCursor>
 #include <QGuiApplication>
-#include <QTimer>
 #include <QTime>
 #include <QRandomGenerator>
 
@@ -9,13 +8,12 @@
 
 #define CURSOR_POS_CHECK 50
 
-InputConvertGame::InputConvertGame(Controller *controller) : InputConvertNormal(controller) {
-    m_ctrlSteerWheel.delayData.timer = new QTimer(this);
-    m_ctrlSteerWheel.delayData.timer->setSingleShot(true);
-    connect(m_ctrlSteerWheel.delayData.timer, &QTimer::timeout, this, &InputConvertGame::onSteerWheelTimer);
-}
+InputConvertGame::InputConvertGame(Controller *controller) : InputConvertNormal(controller) {}
 
-InputConvertGame::~InputConvertGame() {}
+InputConvertGame::~InputConvertGame() {
+    // Delayed steps are scheduled on the shared wheel, drop ours
+    TimingWheel::instance().cancelAll(this);
+}
 
 void InputConvertGame::mouseEvent(const QMouseEvent *from, const QSize &frameSize, const QSize &showSize)
 {
@@ -90,8 +88,8 @@ void InputConvertGame::keyEvent(const QKeyEvent *from, const QSize &frameSize, c
             if (QEvent::KeyPress == from->type()) {
                 m_processMouseMove = false;
                 int delay = 30;
-                QTimer::singleShot(delay, this, [this]() { mouseMoveStopTouch(); });
-                QTimer::singleShot(delay * 2, this, [this]() {
+                TimingWheel::instance().schedule(this, delay, [this]() { mouseMoveStopTouch(); });
+                TimingWheel::instance().schedule(this, delay * 2, [this]() {
                     mouseMoveStartTouch(nullptr);
                     m_processMouseMove = true;
                 });
@@ -294,6 +292,7 @@ void InputConvertGame::getDelayQueue(const QPointF& start, const QPointF& end,
 }
 
 void InputConvertGame::onSteerWheelTimer() {
+    m_ctrlSteerWheel.delayData.task = 0;
     if(m_ctrlSteerWheel.delayData.queuePos.empty()) {
         return;
     }
@@ -308,7 +307,8 @@ void InputConvertGame::onSteerWheelTimer() {
     }
 
     if(!m_ctrlSteerWheel.delayData.queuePos.empty()) {
-        m_ctrlSteerWheel.delayData.timer->start(m_ctrlSteerWheel.delayData.queueTimer.dequeue());
+        m_ctrlSteerWheel.delayData.task = TimingWheel::instance().schedule(this, m_ctrlSteerWheel.delayData.queueTimer.dequeue(),
+                                                                           [this]() { onSteerWheelTimer(); });
     }
 }
 
@@ -350,8 +350,9 @@ void InputConvertGame::processSteerWheel(const KeyMap::KeyMapNode &node, const Q
 
     // last key release and timer no active, active timer to detouch
     if (pressedNum == 0) {
-        if (m_ctrlSteerWheel.delayData.timer->isActive()) {
-            m_ctrlSteerWheel.delayData.timer->stop();
+        if (TimingWheel::instance().isPending(m_ctrlSteerWheel.delayData.task)) {
+            TimingWheel::instance().cancel(m_ctrlSteerWheel.delayData.task);
+            m_ctrlSteerWheel.delayData.task = 0;
             m_ctrlSteerWheel.delayData.queueTimer.clear();
             m_ctrlSteerWheel.delayData.queuePos.clear();
         }
@@ -362,7 +363,8 @@ void InputConvertGame::processSteerWheel(const KeyMap::KeyMapNode &node, const Q
     }
 
     // process steer wheel key event
-    m_ctrlSteerWheel.delayData.timer->stop();
+    TimingWheel::instance().cancel(m_ctrlSteerWheel.delayData.task);
+    m_ctrlSteerWheel.delayData.task = 0;
     m_ctrlSteerWheel.delayData.queueTimer.clear();
     m_ctrlSteerWheel.delayData.queuePos.clear();
 
@@ -382,7 +384,7 @@ void InputConvertGame::processSteerWheel(const KeyMap::KeyMapNode &node, const Q
                       m_ctrlSteerWheel.delayData.queuePos,
                       m_ctrlSteerWheel.delayData.queueTimer);
     }
-    m_ctrlSteerWheel.delayData.timer->start();
+    m_ctrlSteerWheel.delayData.task = TimingWheel::instance().schedule(this, 0, [this]() { onSteerWheelTimer(); });
     return;
 }
 
@@ -425,14 +427,14 @@ void InputConvertGame::processKeyClickMulti(const KeyMap::DelayClickNode *nodes,
     for (int i = 0; i < count; i++) {
         delay += nodes[i].delay;
         clickPos = nodes[i].pos;
-        QTimer::singleShot(delay, this, [this, key, clickPos]() {
+        TimingWheel::instance().schedule(this, delay, [this, key, clickPos]() {
             int id = attachTouchID(key);
             sendTouchDownEvent(id, clickPos);
         });
 
         // Don't up it too fast
         delay += 20;
-        QTimer::singleShot(delay, this, [this, key, clickPos]() {
+        TimingWheel::instance().schedule(this, delay, [this, key, clickPos]() {
             int id = getTouchID(key);
             sendTouchUpEvent(id, clickPos);
             detachTouchID(key);
@@ -441,6 +443,7 @@ void InputConvertGame::processKeyClickMulti(const KeyMap::DelayClickNode *nodes,
 }
 
 void InputConvertGame::onDragTimer() {
+    m_dragDelayData.task = 0;
     if(m_dragDelayData.queuePos.empty()) {
         return;
     }
@@ -449,9 +452,6 @@ void InputConvertGame::onDragTimer() {
     sendTouchMoveEvent(id, m_dragDelayData.currentPos);
 
     if(m_dragDelayData.queuePos.empty()) {
-        delete m_dragDelayData.timer;
-        m_dragDelayData.timer = nullptr;
-
         sendTouchUpEvent(id, m_dragDelayData.currentPos);
         detachTouchID(m_dragDelayData.pressKey);
 
@@ -461,7 +461,7 @@ void InputConvertGame::onDragTimer() {
     }
 
     if(!m_dragDelayData.queuePos.empty()) {
-        m_dragDelayData.timer->start(m_dragDelayData.queueTimer.dequeue());
+        m_dragDelayData.task = TimingWheel::instance().schedule(this, m_dragDelayData.queueTimer.dequeue(), [this]() { onDragTimer(); });
     }
 }
 
@@ -469,10 +469,9 @@ void InputConvertGame::processKeyDrag(const QPointF &startPos, QPointF endPos, q
 {
     if (QEvent::KeyPress == from->type()) {
         // stop last
-        if (m_dragDelayData.timer && m_dragDelayData.timer->isActive()) {
-            m_dragDelayData.timer->stop();
-            delete m_dragDelayData.timer;
-            m_dragDelayData.timer = nullptr;
+        if (TimingWheel::instance().isPending(m_dragDelayData.task)) {
+            TimingWheel::instance().cancel(m_dragDelayData.task);
+            m_dragDelayData.task = 0;
             m_dragDelayData.queuePos.clear();
             m_dragDelayData.queueTimer.clear();
 
@@ -487,9 +486,6 @@ void InputConvertGame::processKeyDrag(const QPointF &startPos, QPointF endPos, q
         int id = attachTouchID(from->key());
         sendTouchDownEvent(id, startPos);
 
-        m_dragDelayData.timer = new QTimer(this);
-        m_dragDelayData.timer->setSingleShot(true);
-        connect(m_dragDelayData.timer, &QTimer::timeout, this, &InputConvertGame::onDragTimer);
         m_dragDelayData.pressKey = from->key();
         m_dragDelayData.currentPos = startPos;
         m_dragDelayData.queuePos.clear();
@@ -511,7 +507,7 @@ void InputConvertGame::processKeyDrag(const QPointF &startPos, QPointF endPos, q
                       m_dragDelayData.queuePos,
                       m_dragDelayData.queueTimer);
 
-        m_dragDelayData.timer->start(startDelay);
+        m_dragDelayData.task = TimingWheel::instance().schedule(this, startDelay, [this]() { onDragTimer(); });
     }
 }
 
@@ -602,8 +598,8 @@ bool InputConvertGame::processMouseMove(const QMouseEvent *from)
             if (m_ctrlMouseMove.smallEyes) {
                 m_processMouseMove = false;
                 int delay = 30;
-                QTimer::singleShot(delay, this, [this]() { mouseMoveStopTouch(); });
-                QTimer::singleShot(delay * 2, this, [this]() {
+                TimingWheel::instance().schedule(this, delay, [this]() { mouseMoveStopTouch(); });
+                TimingWheel::instance().schedule(this, delay * 2, [this]() {
                     mouseMoveStartTouch(nullptr);
                     m_processMouseMove = true;
                 });
@@ -6,6 +6,7 @@
 
 #include "inputconvertnormal.h"
 #include "keymap.h"
+#include "timingwheel.h"
 
 #define MULTI_TOUCH_MAX_NUM 10
 class InputConvertGame : public InputConvertNormal
@@ -100,7 +101,7 @@ private:
         // for delay
         struct {
             QPointF currentPos;
-            QTimer* timer = nullptr;
+            TimingWheel::TaskId task = 0;
             QQueue<QPointF> queuePos;
             QQueue<quint32> queueTimer;
             int pressedNum = 0;
@@ -121,7 +122,7 @@ private:
     // for drag delay
     struct {
         QPointF currentPos;
-        QTimer* timer = nullptr;
+        TimingWheel::TaskId task = 0;
         QQueue<QPointF> queuePos;
         QQueue<quint32> queueTimer;
         int pressKey = 0;
@@ -1,14 +1,47 @@
 #include <QCoreApplication>
+#include <QCryptographicHash>
 #include <QDebug>
 #include <QFile>
 #include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QMetaEnum>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QtAlgorithms>
 
 #include "keymap.h"
 
-KeyMap::KeyMap(QObject *parent) : QObject(parent) {}
+namespace
+{
+QMutex s_compiledMutex;
+
+// Latin-1 keys map to [0, 0x100), Qt special keys (0x01000000 + n) to [0x100, 0x200)
+inline int keyTableIndex(int key)
+{
+    if (key >= 0 && key < 0x100) {
+        return key;
+    }
+    if (key >= Qt::Key_Escape && key < Qt::Key_Escape + (KEYMAP_KEY_TABLE_SIZE - 0x100)) {
+        return 0x100 + (key - Qt::Key_Escape);
+    }
+    return -1;
+}
+
+// Qt::MouseButton values are single bits
+inline int mouseTableIndex(int button)
+{
+    if (button <= 0 || (button & (button - 1)) != 0) {
+        return -1;
+    }
+    return static_cast<int>(qCountTrailingZeroBits(static_cast<quint32>(button)));
+}
+}
+
+KeyMap::KeyMap(QObject *parent) : QObject(parent)
+{
+    makeReverseMap();
+}
 
 KeyMap::~KeyMap() {}
 
@@ -19,8 +52,17 @@ void KeyMap::loadKeyMap(const QString &json)
     QJsonDocument jsonDoc;
     QJsonObject rootObj;
     QPair<ActionType, int> switchKey;
+    QByteArray jsonData = json.toUtf8();
+    QByteArray scriptHash = QCryptographicHash::hash(jsonData, QCryptographicHash::Sha1);
+
+    // PERFORMANCE OPTIMIZATION: the same script is usually loaded on every device of the farm,
+    // parse and compile it once and reuse the compiled form for the others
+    if (restoreCompiled(scriptHash)) {
+        qInfo() << "Script updated (cached), current keymap mode:normal, Press ~ key to switch keymap mode";
+        return;
+    }
 
-    jsonDoc = QJsonDocument::fromJson(json.toUtf8(), &jsonError);
+    jsonDoc = QJsonDocument::fromJson(jsonData, &jsonError);
 
     if (jsonError.error != QJsonParseError::NoError) {
         errorString = QString("json error: %1").arg(jsonError.errorString());
@@ -316,6 +358,7 @@ void KeyMap::loadKeyMap(const QString &json)
     }
     // this must be called after m_keyMapNodes is stable
     makeReverseMap();
+    storeCompiled(scriptHash);
     qInfo() << "Script updated, current keymap mode:normal, Press ~ key to switch keymap mode";
 
 parseError:
@@ -327,21 +370,21 @@ parseError:
 
 const KeyMap::KeyMapNode &KeyMap::getKeyMapNode(int key)
 {
-    auto p = m_rmapKey.value(key, &m_invalidNode);
-    if (p == &m_invalidNode) {
-        return *m_rmapMouse.value(key, &m_invalidNode);
+    const KeyMapNode &node = getKeyMapNodeKey(key);
+    if (&node == &m_invalidNode) {
+        return getKeyMapNodeMouse(key);
     }
-    return *p;
+    return node;
 }
 
 const KeyMap::KeyMapNode &KeyMap::getKeyMapNodeKey(int key)
 {
-    return *m_rmapKey.value(key, &m_invalidNode);
+    return lookupDispatch(m_dispatch.key, keyTableIndex(key), m_dispatch.keyOverflow, key);
 }
 
 const KeyMap::KeyMapNode &KeyMap::getKeyMapNodeMouse(int key)
 {
-    return *m_rmapMouse.value(key, &m_invalidNode);
+    return lookupDispatch(m_dispatch.mouse, mouseTableIndex(key), m_dispatch.mouseOverflow, key);
 }
 
 bool KeyMap::isSwitchOnKeyboard()
@@ -356,7 +399,8 @@ int KeyMap::getSwitchKey()
 
 const KeyMap::KeyMapNode &KeyMap::getMouseMoveMap()
 {
-    return m_keyMapNodes[m_idxMouseMove];
+    // at(): never detach the node vector shared with the compiled cache
+    return m_keyMapNodes.at(m_idxMouseMove);
 }
 
 bool KeyMap::isValidMouseMoveMap()
@@ -371,47 +415,114 @@ bool KeyMap::isValidSteerWheelMap()
 
 void KeyMap::makeReverseMap()
 {
-    m_rmapKey.clear();
-    m_rmapMouse.clear();
+    for (int i = 0; i < KEYMAP_KEY_TABLE_SIZE; ++i) {
+        m_dispatch.key[i] = -1;
+    }
+    for (int i = 0; i < KEYMAP_MOUSE_TABLE_SIZE; ++i) {
+        m_dispatch.mouse[i] = -1;
+    }
+    m_dispatch.keyOverflow.clear();
+    m_dispatch.mouseOverflow.clear();
+
+    // later nodes win on duplicate keys, same as the old QMultiHash::value() lookup
     for (int i = 0; i < m_keyMapNodes.size(); ++i) {
-        auto &node = m_keyMapNodes[i];
+        const auto &node = m_keyMapNodes.at(i);
         switch (node.type) {
-        case KMT_CLICK: {
-            QMultiHash<int, KeyMapNode *> &m = node.data.click.keyNode.type == AT_KEY ? m_rmapKey : m_rmapMouse;
-            m.insert(node.data.click.keyNode.key, &node);
-        } break;
-        case KMT_CLICK_TWICE: {
-            QMultiHash<int, KeyMapNode *> &m = node.data.clickTwice.keyNode.type == AT_KEY ? m_rmapKey : m_rmapMouse;
-            m.insert(node.data.clickTwice.keyNode.key, &node);
-        } break;
-        case KMT_CLICK_MULTI: {
-            QMultiHash<int, KeyMapNode *> &m = node.data.clickMulti.keyNode.type == AT_KEY ? m_rmapKey : m_rmapMouse;
-            m.insert(node.data.clickMulti.keyNode.key, &node);
-        } break;
-        case KMT_STEER_WHEEL: {
-            QMultiHash<int, KeyMapNode *> &ml = node.data.steerWheel.left.type == AT_KEY ? m_rmapKey : m_rmapMouse;
-            ml.insert(node.data.steerWheel.left.key, &node);
-            QMultiHash<int, KeyMapNode *> &mr = node.data.steerWheel.right.type == AT_KEY ? m_rmapKey : m_rmapMouse;
-            mr.insert(node.data.steerWheel.right.key, &node);
-            QMultiHash<int, KeyMapNode *> &mu = node.data.steerWheel.up.type == AT_KEY ? m_rmapKey : m_rmapMouse;
-            mu.insert(node.data.steerWheel.up.key, &node);
-            QMultiHash<int, KeyMapNode *> &md = node.data.steerWheel.down.type == AT_KEY ? m_rmapKey : m_rmapMouse;
-            md.insert(node.data.steerWheel.down.key, &node);
-        } break;
-        case KMT_DRAG: {
-            QMultiHash<int, KeyMapNode *> &m = node.data.drag.keyNode.type == AT_KEY ? m_rmapKey : m_rmapMouse;
-            m.insert(node.data.drag.keyNode.key, &node);
-        } break;
-        case KMT_ANDROID_KEY: {
-            QMultiHash<int, KeyMapNode *> &m = node.data.androidKey.keyNode.type == AT_KEY ? m_rmapKey : m_rmapMouse;
-            m.insert(node.data.androidKey.keyNode.key, &node);
-        } break;
+        case KMT_CLICK:
+            insertDispatch(node.data.click.keyNode, i);
+            break;
+        case KMT_CLICK_TWICE:
+            insertDispatch(node.data.clickTwice.keyNode, i);
+            break;
+        case KMT_CLICK_MULTI:
+            insertDispatch(node.data.clickMulti.keyNode, i);
+            break;
+        case KMT_STEER_WHEEL:
+            insertDispatch(node.data.steerWheel.left, i);
+            insertDispatch(node.data.steerWheel.right, i);
+            insertDispatch(node.data.steerWheel.up, i);
+            insertDispatch(node.data.steerWheel.down, i);
+            break;
+        case KMT_DRAG:
+            insertDispatch(node.data.drag.keyNode, i);
+            break;
+        case KMT_ANDROID_KEY:
+            insertDispatch(node.data.androidKey.keyNode, i);
+            break;
         default:
             break;
         }
     }
 }
 
+void KeyMap::insertDispatch(const KeyNode &keyNode, int nodeIndex)
+{
+    if (keyNode.type == AT_KEY) {
+        int idx = keyTableIndex(keyNode.key);
+        if (idx >= 0) {
+            m_dispatch.key[idx] = static_cast<qint16>(nodeIndex);
+        } else {
+            m_dispatch.keyOverflow.insert(keyNode.key, nodeIndex);
+        }
+    } else {
+        int idx = mouseTableIndex(keyNode.key);
+        if (idx >= 0) {
+            m_dispatch.mouse[idx] = static_cast<qint16>(nodeIndex);
+        } else {
+            m_dispatch.mouseOverflow.insert(keyNode.key, nodeIndex);
+        }
+    }
+}
+
+const KeyMap::KeyMapNode &KeyMap::lookupDispatch(const qint16 *table, int tableIndex, const QHash<int, int> &overflow, int key) const
+{
+    int nodeIndex = tableIndex >= 0 ? table[tableIndex] : overflow.value(key, -1);
+    if (nodeIndex < 0) {
+        return m_invalidNode;
+    }
+    return m_keyMapNodes.at(nodeIndex);
+}
+
+bool KeyMap::restoreCompiled(const QByteArray &scriptHash)
+{
+    QMutexLocker locker(&s_compiledMutex);
+    auto &cache = compiledCache();
+    auto it = cache.constFind(scriptHash);
+    if (it == cache.constEnd()) {
+        return false;
+    }
+
+    // QVector is implicitly shared, restoring does not copy the nodes
+    m_keyMapNodes = it->keyMapNodes;
+    m_switchKey = it->switchKey;
+    m_idxSteerWheel = it->idxSteerWheel;
+    m_idxMouseMove = it->idxMouseMove;
+    m_dispatch = it->dispatch;
+    return true;
+}
+
+void KeyMap::storeCompiled(const QByteArray &scriptHash)
+{
+    QMutexLocker locker(&s_compiledMutex);
+    auto &cache = compiledCache();
+    if (cache.size() >= KEYMAP_CACHE_MAX_SCRIPTS) {
+        cache.clear();
+    }
+
+    CompiledKeyMap &compiled = cache[scriptHash];
+    compiled.keyMapNodes = m_keyMapNodes;
+    compiled.switchKey = m_switchKey;
+    compiled.idxSteerWheel = m_idxSteerWheel;
+    compiled.idxMouseMove = m_idxMouseMove;
+    compiled.dispatch = m_dispatch;
+}
+
+QHash<QByteArray, KeyMap::CompiledKeyMap> &KeyMap::compiledCache()
+{
+    static QHash<QByteArray, CompiledKeyMap> cache;
+    return cache;
+}
+
 QString KeyMap::getItemString(const QJsonObject &node, const QString &name)
 {
     return node.value(name).toString();
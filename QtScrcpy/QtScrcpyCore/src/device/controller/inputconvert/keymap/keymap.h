@@ -1,8 +1,8 @@
 #ifndef KEYMAP_H
 #define KEYMAP_H
+#include <QHash>
 #include <QJsonObject>
 #include <QMetaEnum>
-#include <QMultiHash>
 #include <QObject>
 #include <QPair>
 #include <QPointF>
@@ -13,6 +13,13 @@
 
 #define MAX_DELAY_CLICK_NODES 50
 
+// Flat dispatch table layout: Latin-1 keys, then Qt special keys (Qt::Key_Escape based)
+#define KEYMAP_KEY_TABLE_SIZE 0x200
+// One slot per Qt::MouseButton bit
+#define KEYMAP_MOUSE_TABLE_SIZE 32
+// Compiled keymaps kept in the process-wide cache
+#define KEYMAP_CACHE_MAX_SCRIPTS 16
+
 class KeyMap : public QObject
 {
     Q_OBJECT
@@ -129,8 +136,35 @@ public:
     const KeyMap::KeyMapNode &getMouseMoveMap();
 
 private:
-    // set up the reverse map from key/event event to keyMapNode
+    // flat dispatch table from key/mouse button to index in m_keyMapNodes
+    struct DispatchTable
+    {
+        qint16 key[KEYMAP_KEY_TABLE_SIZE];
+        qint16 mouse[KEYMAP_MOUSE_TABLE_SIZE];
+        // keys that don't fit in the flat tables (rare)
+        QHash<int, int> keyOverflow;
+        QHash<int, int> mouseOverflow;
+    };
+
+    // compiled form of a script, shared by every device loading the same script
+    struct CompiledKeyMap
+    {
+        QVector<KeyMapNode> keyMapNodes;
+        KeyNode switchKey;
+        int idxSteerWheel = -1;
+        int idxMouseMove = -1;
+        DispatchTable dispatch;
+    };
+
+    // set up the dispatch table from key/mouse event to keyMapNode
     void makeReverseMap();
+    void insertDispatch(const KeyNode &keyNode, int nodeIndex);
+    const KeyMapNode &lookupDispatch(const qint16 *table, int tableIndex, const QHash<int, int> &overflow, int key) const;
+
+    // compiled keymap cache keyed by script hash
+    bool restoreCompiled(const QByteArray &scriptHash);
+    void storeCompiled(const QByteArray &scriptHash);
+    static QHash<QByteArray, CompiledKeyMap> &compiledCache();
 
     // safe check for base
     bool checkItemString(const QJsonObject &node, const QString &name);
@@ -176,9 +210,8 @@ private:
     QMetaEnum m_metaEnumKey = QMetaEnum::fromType<Qt::Key>();
     QMetaEnum m_metaEnumMouseButtons = QMetaEnum::fromType<Qt::MouseButtons>();
     QMetaEnum m_metaEnumKeyMapType = QMetaEnum::fromType<KeyMap::KeyMapType>();
-    // reverse map of key/mouse event
-    QMultiHash<int, KeyMapNode *> m_rmapKey;
-    QMultiHash<int, KeyMapNode *> m_rmapMouse;
+    // dispatch table of key/mouse event
+    DispatchTable m_dispatch;
 };
 
 #endif // KEYMAP_H
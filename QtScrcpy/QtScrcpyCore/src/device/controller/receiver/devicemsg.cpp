@@ -5,13 +5,7 @@
 
 DeviceMsg::DeviceMsg(QObject *parent) : QObject(parent) {}
 
-DeviceMsg::~DeviceMsg()
-{
-    if (DMT_GET_CLIPBOARD == m_data.type && Q_NULLPTR != m_data.clipboardMsg.text) {
-        delete m_data.clipboardMsg.text;
-        m_data.clipboardMsg.text = Q_NULLPTR;
-    }
-}
+DeviceMsg::~DeviceMsg() {}
 
 DeviceMsg::DeviceMsgType DeviceMsg::type()
 {
@@ -20,47 +14,60 @@ DeviceMsg::DeviceMsgType DeviceMsg::type()
 
 void DeviceMsg::getClipboardMsgData(QString &text)
 {
-    text = QString::fromUtf8(m_data.clipboardMsg.text);
+    text = QString::fromUtf8(m_data.clipboardMsg.text, m_data.clipboardMsg.length);
 }
 
-qint32 DeviceMsg::deserialize(QByteArray &byteArray)
+quint64 DeviceMsg::getAckClipboardSequence()
 {
-    QBuffer buf(&byteArray);
-    buf.open(QBuffer::ReadOnly);
-
-    qint64 len = buf.size();
-    char c = 0;
-    qint32 ret = 0;
+    return m_data.ackClipboardMsg.sequence;
+}
 
-    if (len < 5) {
-        // at least type + empty string length
+qint32 DeviceMsg::deserialize(const char *data, qint32 len)
+{
+    if (len < 1) {
         return 0; // not available
     }
 
-    buf.getChar(&c);
-    m_data.type = (DeviceMsgType)c;
+    const uchar *buf = reinterpret_cast<const uchar *>(data);
+    m_data.type = (DeviceMsgType)buf[0];
     switch (m_data.type) {
     case DMT_GET_CLIPBOARD: {
-        m_data.clipboardMsg.text = Q_NULLPTR;
-        quint16 clipboardLen = BufferUtil::read32(buf);
-        if (clipboardLen > len - 5) {
-            ret = 0; // not available
-            break;
+        if (len < 5) {
+            // at least type + empty string length
+            return 0; // not available
         }
-
-        QByteArray text = buf.readAll();
-        m_data.clipboardMsg.text = new char[text.length() + 1];
-        memcpy(m_data.clipboardMsg.text, text.data(), text.length());
-        m_data.clipboardMsg.text[text.length()] = '\0';
-
-        ret = 5 + clipboardLen;
-        break;
+        quint32 clipboardLen = BufferUtil::read32(buf + 1);
+        if (clipboardLen > DEVICE_MSG_TEXT_MAX_LENGTH) {
+            qWarning("Device clipboard message too large: %u", clipboardLen);
+            return -1;
+        }
+        if (clipboardLen > static_cast<quint32>(len - 5)) {
+            return 0; // not available
+        }
+        m_data.clipboardMsg.text = data + 5;
+        m_data.clipboardMsg.length = static_cast<qint32>(clipboardLen);
+        return 5 + static_cast<qint32>(clipboardLen);
+    }
+    case DMT_ACK_CLIPBOARD: {
+        if (len < 9) {
+            return 0; // not available
+        }
+        m_data.ackClipboardMsg.sequence = BufferUtil::read64(buf + 1);
+        return 9;
+    }
+    case DMT_UHID_OUTPUT: {
+        // type + id(2) + size(2) + data, not used but must be skipped
+        if (len < 5) {
+            return 0; // not available
+        }
+        quint16 size = BufferUtil::read16(buf + 3);
+        if (size > len - 5) {
+            return 0; // not available
+        }
+        return 5 + size;
     }
     default:
         qWarning("Unsupported device msg type: %d", (int)m_data.type);
-        ret = -1; // error, we cannot recover
+        return -1; // error, we cannot recover
     }
-
-    buf.close();
-    return ret;
 }
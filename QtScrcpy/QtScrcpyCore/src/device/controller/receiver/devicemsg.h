@@ -1,7 +1,7 @@
 #ifndef DEVICEMSG_H
 #define DEVICEMSG_H
 
-#include <QBuffer>
+#include <QObject>
 
 #define DEVICE_MSG_MAX_SIZE (1 << 18) // 256k
 // type: 1 byte; length: 4 bytes
@@ -16,28 +16,34 @@ public:
         DMT_NULL = -1,
         // 和服务端对应
         DMT_GET_CLIPBOARD = 0,
+        DMT_ACK_CLIPBOARD,
+        DMT_UHID_OUTPUT,
     };
     explicit DeviceMsg(QObject *parent = nullptr);
     virtual ~DeviceMsg();
 
     DeviceMsg::DeviceMsgType type();
     void getClipboardMsgData(QString &text);
+    quint64 getAckClipboardSequence();
 
-    qint32 deserialize(QByteArray &byteArray);
+    // Decode one message in place from data, nothing is copied:
+    // payload pointers stay valid only as long as data does.
+    // Returns consumed bytes, 0 if incomplete, -1 on unrecoverable error.
+    qint32 deserialize(const char *data, qint32 len);
 
 private:
     struct DeviceMsgData
     {
         DeviceMsgType type = DMT_NULL;
-        union
+        struct
         {
-            struct
-            {
-                char *text = Q_NULLPTR;
-            } clipboardMsg;
-        };
-        DeviceMsgData() {}
-        ~DeviceMsgData() {}
+            const char *text = Q_NULLPTR;
+            qint32 length = 0;
+        } clipboardMsg;
+        struct
+        {
+            quint64 sequence = 0;
+        } ackClipboardMsg;
     };
 
     DeviceMsgData m_data;
@@ -0,0 +1,86 @@
+#include <cstring>
+
+#include <QDebug>
+#include <QIODevice>
+
+#include "devicemsgparser.h"
+
+DeviceMsgParser::DeviceMsgParser(QObject *parent) : QObject(parent)
+{
+    // Allocated once, a full message always fits
+    m_buffer.resize(DEVICE_MSG_MAX_SIZE);
+}
+
+DeviceMsgParser::~DeviceMsgParser() {}
+
+bool DeviceMsgParser::readFrom(QIODevice *device, const std::function<void(DeviceMsg *)> &onMsg)
+{
+    if (!device) {
+        return false;
+    }
+
+    while (device->bytesAvailable() > 0) {
+        if (m_tail == m_buffer.size()) {
+            compact();
+            if (m_tail == m_buffer.size()) {
+                // a whole buffer without a complete message, cannot happen with a sane server
+                qWarning("DeviceMsgParser: device message exceeds %d bytes", DEVICE_MSG_MAX_SIZE);
+                reset();
+                return false;
+            }
+        }
+
+        qint64 r = device->read(m_buffer.data() + m_tail, m_buffer.size() - m_tail);
+        if (r <= 0) {
+            break;
+        }
+        m_tail += static_cast<qint32>(r);
+
+        if (!parseAvailable(onMsg)) {
+            reset();
+            return false;
+        }
+    }
+    return true;
+}
+
+void DeviceMsgParser::reset()
+{
+    m_head = 0;
+    m_tail = 0;
+}
+
+bool DeviceMsgParser::parseAvailable(const std::function<void(DeviceMsg *)> &onMsg)
+{
+    while (m_head < m_tail) {
+        qint32 consume = m_deviceMsg.deserialize(m_buffer.constData() + m_head, m_tail - m_head);
+        if (consume < 0) {
+            return false;
+        }
+        if (consume == 0) {
+            break; // incomplete, wait for more data
+        }
+        m_head += consume;
+        if (onMsg) {
+            onMsg(&m_deviceMsg);
+        }
+    }
+
+    if (m_head == m_tail) {
+        // everything consumed, rewind for free
+        m_head = 0;
+        m_tail = 0;
+    }
+    return true;
+}
+
+void DeviceMsgParser::compact()
+{
+    if (m_head == 0) {
+        return;
+    }
+    qint32 remaining = m_tail - m_head;
+    memmove(m_buffer.data(), m_buffer.constData() + m_head, static_cast<size_t>(remaining));
+    m_head = 0;
+    m_tail = remaining;
+}
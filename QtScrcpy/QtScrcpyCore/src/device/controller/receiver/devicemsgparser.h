@@ -0,0 +1,47 @@
+#ifndef DEVICEMSGPARSER_H
+#define DEVICEMSGPARSER_H
+
+#include <functional>
+
+#include <QByteArray>
+#include <QObject>
+
+#include "devicemsg.h"
+
+class QIODevice;
+
+/**
+ * DeviceMsgParser - Incremental parser for the control socket
+ *
+ * Socket data is read straight into one reusable receive buffer sized for the
+ * largest device message, and messages are decoded in place from it. Nothing is
+ * allocated per message: the DeviceMsg handed to the callback points into the
+ * buffer and is only valid during the callback.
+ *
+ * The buffer is used as a ring whose unparsed tail is moved back to the front
+ * only when a partial message reaches the end of the buffer.
+ */
+class DeviceMsgParser : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DeviceMsgParser(QObject *parent = Q_NULLPTR);
+    virtual ~DeviceMsgParser();
+
+    // Drain everything readable from device and dispatch each complete message.
+    // Returns false on an unrecoverable protocol error: device is out of sync, stop reading it.
+    bool readFrom(QIODevice *device, const std::function<void(DeviceMsg *)> &onMsg);
+    void reset();
+
+private:
+    bool parseAvailable(const std::function<void(DeviceMsg *)> &onMsg);
+    void compact();
+
+private:
+    QByteArray m_buffer;
+    qint32 m_head = 0; // first unparsed byte
+    qint32 m_tail = 0; // end of received data
+    DeviceMsg m_deviceMsg;
+};
+
+#endif // DEVICEMSGPARSER_H
@@ -13,6 +13,10 @@ void Receiver::recvDeviceMsg(DeviceMsg *deviceMsg)
     switch (deviceMsg->type()) {
     case DeviceMsg::DMT_GET_CLIPBOARD: {
         qInfo("Device clipboard copied");
+        if (!qobject_cast<QGuiApplication *>(QCoreApplication::instance())) {
+            // headless: there is no computer clipboard
+            break;
+        }
         QClipboard *board = QApplication::clipboard();
         QString text;
         deviceMsg->getClipboardMsgData(text);
@@ -0,0 +1,257 @@
+#include <limits>
+
+#include <QDebug>
+#include <QThread>
+
+#include "timingwheel.h"
+
+TimingWheel::TimingWheel(QObject *parent) : QObject(parent)
+{
+    m_level0.resize(LEVEL0_SIZE);
+    m_level1.resize(LEVEL1_SIZE);
+
+    // One OS timer for every delayed touch step of every device, it only fires when one is due
+    m_tickTimer.setTimerType(Qt::PreciseTimer);
+    m_tickTimer.setSingleShot(true);
+    connect(&m_tickTimer, &QTimer::timeout, this, &TimingWheel::onTick);
+
+    m_clock.start();
+}
+
+TimingWheel::~TimingWheel()
+{
+    m_tickTimer.stop();
+}
+
+TimingWheel &TimingWheel::instance()
+{
+    static TimingWheel wheel;
+    return wheel;
+}
+
+TimingWheel::TaskId TimingWheel::schedule(QObject *owner, quint32 delayMs, std::function<void()> task)
+{
+    if (!owner || !task) {
+        qWarning() << "TimingWheel: schedule() requires an owner and a task";
+        return 0;
+    }
+    Q_ASSERT(QThread::currentThread() == thread());
+
+    qint64 now = m_clock.elapsed();
+    if (m_tasks.isEmpty()) {
+        // Wheel was idle: drop stale cancelled ids and jump straight to now
+        for (auto &slot : m_level0) {
+            slot.clear();
+        }
+        for (auto &slot : m_level1) {
+            slot.clear();
+        }
+        m_overflow.clear();
+        m_currentTick = now;
+    }
+
+    // The current tick's slot has already been dispatched, earliest is the next one
+    qint64 due = qMax(now + static_cast<qint64>(delayMs), m_currentTick + 1);
+
+    TaskId id = m_nextId++;
+    Task &entry = m_tasks[id];
+    entry.owner = owner;
+    entry.due = due;
+    entry.func = std::move(task);
+    place(id, due);
+
+    if (!m_tickTimer.isActive() || due < m_armedDue) {
+        arm(due);
+    }
+    return id;
+}
+
+void TimingWheel::cancel(TaskId id)
+{
+    // Slot entries are removed lazily when the wheel reaches them
+    m_tasks.remove(id);
+}
+
+void TimingWheel::cancelAll(QObject *owner)
+{
+    for (auto it = m_tasks.begin(); it != m_tasks.end();) {
+        if (it.value().owner.isNull() || it.value().owner.data() == owner) {
+            it = m_tasks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool TimingWheel::isPending(TaskId id) const
+{
+    return id != 0 && m_tasks.contains(id);
+}
+
+int TimingWheel::pendingCount() const
+{
+    return m_tasks.size();
+}
+
+TimingWheel::JitterStats TimingWheel::getJitterStats() const
+{
+    JitterStats stats;
+    stats.dispatched = m_jitterCount;
+    stats.avgJitterMs = m_jitterCount ? static_cast<double>(m_jitterSum) / m_jitterCount : 0.0;
+    stats.maxJitterMs = m_jitterMax;
+    stats.lastJitterMs = m_jitterLast;
+    return stats;
+}
+
+void TimingWheel::resetJitterStats()
+{
+    m_jitterCount = 0;
+    m_jitterSum = 0;
+    m_jitterMax = 0;
+    m_jitterLast = 0;
+}
+
+void TimingWheel::onTick()
+{
+    // The OS timer fires late or only for the next due slot, catch up to now jumping over empty ticks
+    qint64 now = m_clock.elapsed();
+    while (m_currentTick < now && !m_tasks.isEmpty()) {
+        qint64 next = m_currentTick + 1;
+        if ((next & (LEVEL0_SIZE - 1)) != 0) {
+            // Inside a round only its level 0 slots can be due
+            qint64 last = qMin(now, m_currentTick | (LEVEL0_SIZE - 1));
+            while (next <= last && m_level0[next & (LEVEL0_SIZE - 1)].isEmpty()) {
+                ++next;
+            }
+            if (next > last) {
+                m_currentTick = last;
+                continue;
+            }
+            m_currentTick = next;
+            dispatch(m_level0[next & (LEVEL0_SIZE - 1)]);
+            continue;
+        }
+
+        // A new round, its level 0 slots are filled by the cascades only
+        m_currentTick = next;
+        bool overflowCascaded = (next & (LEVEL0_SIZE * LEVEL1_SIZE - 1)) == 0;
+        if (overflowCascaded) {
+            cascade(m_overflow);
+        }
+        QVector<TaskId> &slot = m_level1[(next >> LEVEL0_BITS) & (LEVEL1_SIZE - 1)];
+        if (slot.isEmpty() && !overflowCascaded) {
+            // Nothing in this round, skip it whole
+            m_currentTick = qMin(now, next | (LEVEL0_SIZE - 1));
+            continue;
+        }
+        cascade(slot);
+        dispatch(m_level0[next & (LEVEL0_SIZE - 1)]);
+    }
+
+    if (m_tasks.isEmpty()) {
+        m_tickTimer.stop();
+        return;
+    }
+
+    // Sleep until the earliest pending slot instead of ticking through empty ones
+    qint64 due = nextDue();
+    arm(due > m_currentTick ? due : m_currentTick + 1);
+}
+
+qint64 TimingWheel::nextDue()
+{
+    // The levels are ordered: the rest of the current round, the later rounds of this
+    // level 1 revolution, then the overflow. Cancelled ids are dropped on the way.
+    for (qint64 tick = m_currentTick + 1; (tick & (LEVEL0_SIZE - 1)) != 0; ++tick) {
+        QVector<TaskId> &slot = m_level0[tick & (LEVEL0_SIZE - 1)];
+        if (!slot.isEmpty() && earliest(slot) >= 0) {
+            return tick;
+        }
+    }
+    for (int round = ((m_currentTick >> LEVEL0_BITS) & (LEVEL1_SIZE - 1)) + 1; round < LEVEL1_SIZE; ++round) {
+        QVector<TaskId> &slot = m_level1[round];
+        if (!slot.isEmpty()) {
+            qint64 due = earliest(slot);
+            if (due >= 0) {
+                return due;
+            }
+        }
+    }
+    return earliest(m_overflow);
+}
+
+qint64 TimingWheel::earliest(QVector<TaskId> &slot)
+{
+    qint64 due = -1;
+    for (auto it = slot.begin(); it != slot.end();) {
+        auto task = m_tasks.constFind(*it);
+        if (task == m_tasks.constEnd()) {
+            it = slot.erase(it);
+            continue;
+        }
+        if (due < 0 || task.value().due < due) {
+            due = task.value().due;
+        }
+        ++it;
+    }
+    return due;
+}
+
+void TimingWheel::arm(qint64 due)
+{
+    m_armedDue = due;
+    qint64 delay = qBound<qint64>(0, due - m_clock.elapsed(), std::numeric_limits<int>::max());
+    m_tickTimer.start(static_cast<int>(delay));
+}
+
+void TimingWheel::place(TaskId id, qint64 due)
+{
+    if ((due >> LEVEL0_BITS) == (m_currentTick >> LEVEL0_BITS)) {
+        m_level0[due & (LEVEL0_SIZE - 1)].append(id);
+    } else if ((due >> (LEVEL0_BITS + LEVEL1_BITS)) == (m_currentTick >> (LEVEL0_BITS + LEVEL1_BITS))) {
+        m_level1[(due >> LEVEL0_BITS) & (LEVEL1_SIZE - 1)].append(id);
+    } else {
+        m_overflow.append(id);
+    }
+}
+
+void TimingWheel::cascade(QVector<TaskId> &slot)
+{
+    QVector<TaskId> ids;
+    ids.swap(slot);
+    for (TaskId id : ids) {
+        auto it = m_tasks.constFind(id);
+        if (it != m_tasks.constEnd()) {
+            place(id, it.value().due);
+        }
+    }
+}
+
+void TimingWheel::dispatch(QVector<TaskId> &slot)
+{
+    if (slot.isEmpty()) {
+        return;
+    }
+
+    // Tasks may schedule new tasks, never iterate the live slot
+    QVector<TaskId> ids;
+    ids.swap(slot);
+    for (TaskId id : ids) {
+        auto it = m_tasks.find(id);
+        if (it == m_tasks.end()) {
+            continue;
+        }
+        Task task = std::move(it.value());
+        m_tasks.erase(it);
+
+        qint64 jitter = m_clock.elapsed() - task.due;
+        m_jitterLast = jitter;
+        m_jitterSum += jitter;
+        m_jitterMax = qMax(m_jitterMax, jitter);
+        ++m_jitterCount;
+
+        if (!task.owner.isNull()) {
+            task.func();
+        }
+    }
+}
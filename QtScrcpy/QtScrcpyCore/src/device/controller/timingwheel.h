@@ -0,0 +1,106 @@
+#ifndef TIMINGWHEEL_H
+#define TIMINGWHEEL_H
+
+#include <functional>
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+
+/**
+ * TimingWheel - Shared scheduler for delayed touch steps
+ *
+ * Every InputConvertGame used to own its own QTimer per steer wheel and per drag,
+ * which becomes hundreds of OS timers when a game keymap is mirrored to a farm.
+ * All delayed steps are now scheduled on this single hierarchical wheel driven by
+ * one precise single-shot QTimer, armed for the earliest pending task only.
+ *
+ * Layout (1 ms tick):
+ * - level 0: 256 slots, covers the current 256 ms round
+ * - level 1: 64 slots of 256 ms, covers ~16 s
+ * - overflow list for anything further out, cascaded every 16384 ticks
+ * A wake finds the next due time from the first non-empty slot and jumps over empty
+ * slots and rounds, its cost does not grow with the time slept or the task count.
+ *
+ * Dispatch jitter (actual dispatch time minus due time) is accumulated and
+ * exposed through getJitterStats().
+ *
+ * NOTE: Not thread-safe. Must only be used from the thread that created it
+ * (the GUI thread, where all controllers live).
+ */
+class TimingWheel : public QObject
+{
+    Q_OBJECT
+public:
+    typedef quint64 TaskId;
+
+    struct JitterStats
+    {
+        quint64 dispatched = 0;
+        double avgJitterMs = 0.0;
+        qint64 maxJitterMs = 0;
+        qint64 lastJitterMs = 0;
+    };
+
+    static TimingWheel &instance();
+
+    // Schedule task to run after delayMs. The task is dropped if owner is destroyed first.
+    // Returns a non-zero id usable with cancel().
+    TaskId schedule(QObject *owner, quint32 delayMs, std::function<void()> task);
+    void cancel(TaskId id);
+    void cancelAll(QObject *owner);
+    bool isPending(TaskId id) const;
+    int pendingCount() const;
+
+    JitterStats getJitterStats() const;
+    void resetJitterStats();
+
+private slots:
+    void onTick();
+
+private:
+    explicit TimingWheel(QObject *parent = Q_NULLPTR);
+    ~TimingWheel();
+
+    void arm(qint64 due);
+    // due time of the earliest pending task, -1 if none
+    qint64 nextDue();
+    qint64 earliest(QVector<TaskId> &slot);
+    void place(TaskId id, qint64 due);
+    void cascade(QVector<TaskId> &slot);
+    void dispatch(QVector<TaskId> &slot);
+
+private:
+    struct Task
+    {
+        QPointer<QObject> owner;
+        qint64 due = 0;
+        std::function<void()> func;
+    };
+
+    static const int LEVEL0_BITS = 8;
+    static const int LEVEL1_BITS = 6;
+    static const int LEVEL0_SIZE = 1 << LEVEL0_BITS;
+    static const int LEVEL1_SIZE = 1 << LEVEL1_BITS;
+
+    QTimer m_tickTimer;
+    QElapsedTimer m_clock;
+    qint64 m_currentTick = 0;
+    qint64 m_armedDue = 0;
+    TaskId m_nextId = 1;
+
+    QHash<TaskId, Task> m_tasks;
+    QVector<QVector<TaskId>> m_level0;
+    QVector<QVector<TaskId>> m_level1;
+    QVector<TaskId> m_overflow;
+
+    quint64 m_jitterCount = 0;
+    qint64 m_jitterSum = 0;
+    qint64 m_jitterMax = 0;
+    qint64 m_jitterLast = 0;
+};
+
+#endif // TIMINGWHEEL_H
@@ -1,6 +1,7 @@
 #include <QDebug>
 
 #include "avframeconvert.h"
+#include "yuvconvert.h"
 
 AVFrameConvert::AVFrameConvert() {}
 
@@ -37,9 +38,32 @@ void AVFrameConvert::getDstFrameInfo(int &dstWidth, int &dstHeight, AVPixelForma
 
 bool AVFrameConvert::init()
 {
-    if (m_convertCtx) {
+    if (m_convertCtx || m_fastFactor) {
+        return true;
+    }
+    // the decoder's YUV420P to RGB32, same size or 1/2, 1/4: no SwsContext unless a frame needs it
+    m_fastFactor = fastFactor();
+    if (m_fastFactor) {
         return true;
     }
+    return initSws();
+}
+
+int AVFrameConvert::fastFactor() const
+{
+    if (m_srcFormat != AV_PIX_FMT_YUV420P || m_dstFormat != AV_PIX_FMT_RGB32 || m_dstWidth <= 0 || m_dstHeight <= 0) {
+        return 0;
+    }
+    for (int factor = 1; factor <= 4; factor *= 2) {
+        if (m_srcWidth == m_dstWidth * factor && m_srcHeight == m_dstHeight * factor) {
+            return factor;
+        }
+    }
+    return 0;
+}
+
+bool AVFrameConvert::initSws()
+{
     m_convertCtx = sws_getContext(m_srcWidth, m_srcHeight, m_srcFormat, m_dstWidth, m_dstHeight, m_dstFormat, SWS_BICUBIC, Q_NULLPTR, Q_NULLPTR, Q_NULLPTR);
     if (!m_convertCtx) {
         return false;
@@ -49,11 +73,12 @@ bool AVFrameConvert::init()
 
 bool AVFrameConvert::isInit()
 {
-    return m_convertCtx ? true : false;
+    return (m_convertCtx || m_fastFactor) ? true : false;
 }
 
 void AVFrameConvert::deInit()
 {
+    m_fastFactor = 0;
     if (m_convertCtx) {
         sws_freeContext(m_convertCtx);
         m_convertCtx = Q_NULLPTR;
@@ -62,7 +87,14 @@ void AVFrameConvert::deInit()
 
 bool AVFrameConvert::convert(const AVFrame *srcFrame, AVFrame *dstFrame)
 {
-    if (!m_convertCtx || !srcFrame || !dstFrame) {
+    if (!isInit() || !srcFrame || !dstFrame) {
+        return false;
+    }
+    if (m_fastFactor && srcFrame->width == m_srcWidth && srcFrame->height == m_srcHeight && YuvConvert::supports(srcFrame, m_fastFactor)) {
+        return YuvConvert::toRgb32(srcFrame, m_fastFactor, dstFrame->data[0], dstFrame->linesize[0]);
+    }
+    // full range or odd sized frames
+    if (!m_convertCtx && !initSws()) {
         return false;
     }
     qint32 ret
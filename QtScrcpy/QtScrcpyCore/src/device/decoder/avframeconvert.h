@@ -26,6 +26,11 @@ public:
     void deInit();
     bool convert(const AVFrame *srcFrame, AVFrame *dstFrame);
 
+private:
+    // YuvConvert factor for this src/dst pair, 0 when only swscale can do it
+    int fastFactor() const;
+    bool initSws();
+
 private:
     int m_srcWidth = 0;
     int m_srcHeight = 0;
@@ -34,6 +39,7 @@ private:
     int m_dstHeight = 0;
     AVPixelFormat m_dstFormat = AV_PIX_FMT_NONE;
 
+    int m_fastFactor = 0;
     struct SwsContext *m_convertCtx = Q_NULLPTR;
 };
 
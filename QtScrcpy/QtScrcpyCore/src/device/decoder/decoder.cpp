@@ -10,8 +10,15 @@ extern "C"
 
 #include "compat.h"
 #include "decoder.h"
+#include "ffmpeglog.h"
+#include "latencyprobe.h"
+#include "stagelatency.h"
 #include "videobuffer.h"
 
+// a non-key packet this small may be a repeated frame (the server repeats the last frame of a
+// static screen), its picture is compared with the last one before it is rendered
+#define DECODER_STATIC_PACKET_MAX_BYTES 1024
+
 // CRITICAL: Global mutex to serialize avcodec_open2() and avcodec_close() calls
 // FFmpeg 7.x requires external synchronization for these functions when called
 // from multiple threads, as they access global codec initialization state.
@@ -48,6 +55,26 @@ void Decoder::setFrameSize(const QSize& frameSize)
     m_frameSize = frameSize;
 }
 
+void Decoder::setLatencyProbe(LatencyProbe *probe)
+{
+    m_latencyProbe = probe;
+}
+
+void Decoder::setStageLatency(qsc::StageLatency *latency)
+{
+    m_stageLatency = latency;
+}
+
+void Decoder::setDeviceMetrics(qsc::DeviceMetrics *metrics)
+{
+    m_vb->setDeviceMetrics(metrics);
+}
+
+void Decoder::setLogTag(const FFmpegLogTag *tag)
+{
+    m_logTag = tag;
+}
+
 const char* Decoder::getHardwareDecoderName(AVHWDeviceType type)
 {
     switch (type) {
@@ -89,6 +116,7 @@ bool Decoder::openHardwareDecoder()
             qWarning() << "Could not allocate hardware decoder context for:" << hwDecoderName;
             continue;
         }
+        FFmpegLog::tagContext(m_codecCtx, m_logTag);
 
         // Create hardware device context
         int ret = av_hwdevice_ctx_create(&m_hwDeviceCtx, hwType, nullptr, nullptr, 0);
@@ -165,6 +193,7 @@ bool Decoder::openSoftwareDecoder()
         qCritical("Could not allocate software decoder context");
         return false;
     }
+    FFmpegLog::tagContext(m_codecCtx, m_logTag);
     qInfo() << "openSoftwareDecoder: Codec context allocated at:" << (void*)m_codecCtx;
 
     // CRITICAL: Validate codec context before configuration
@@ -353,6 +382,12 @@ bool Decoder::push(const AVPacket *packet)
         return false;
     }
 
+    if (m_stageLatency) {
+        m_pushStartUs = qsc::StageLatency::now();
+    }
+    // larger packets always carry a change, the pixel comparison is not worth it
+    m_packetMayBeStatic = !(packet->flags & AV_PKT_FLAG_KEY) && packet->size <= DECODER_STATIC_PACKET_MAX_BYTES;
+
     AVFrame *decodingFrame = m_vb->decodingFrame();
 
     if (!decodingFrame) {
@@ -430,12 +465,20 @@ bool Decoder::push(const AVPacket *packet)
     return true;
 }
 
-void Decoder::peekFrame(std::function<void (int, int, uint8_t *)> onFrame)
+void Decoder::peekFrame(std::function<void (int, int, uint8_t *)> onFrame, int downscale)
 {
     if (!m_vb) {
         return;
     }
-    m_vb->peekRenderedFrame(onFrame);
+    m_vb->peekRenderedFrame(onFrame, downscale);
+}
+
+AVFrame *Decoder::refFrame()
+{
+    if (!m_vb) {
+        return Q_NULLPTR;
+    }
+    return m_vb->refRenderedFrame();
 }
 
 void Decoder::pushFrame()
@@ -443,6 +486,18 @@ void Decoder::pushFrame()
     if (!m_vb) {
         return;
     }
+    if (m_stageLatency) {
+        m_stageLatency->recordSince(qsc::StageLatency::SL_DECODE, m_pushStartUs);
+    }
+    if (m_latencyProbe) {
+        // still the decoding frame until it is offered
+        m_latencyProbe->onFrameDecoded(m_vb->decodingFrame());
+    }
+    if (m_packetMayBeStatic && m_vb->isDecodingFrameUnchanged()) {
+        // static screen: no conversion, texture upload or repaint for the same picture
+        m_vb->addUnchangedFrame();
+        return;
+    }
     bool previousFrameSkipped = true;
     m_vb->offerDecodedFrame(previousFrameSkipped);
     if (previousFrameSkipped) {
@@ -491,4 +546,8 @@ void Decoder::onNewFrame() {
     }
 
     m_vb->unLock();
+
+    if (m_latencyProbe) {
+        m_latencyProbe->onFrameRendered();
+    }
 }
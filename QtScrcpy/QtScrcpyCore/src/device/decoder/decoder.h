@@ -11,7 +11,14 @@ extern "C"
 #include <functional>
 #include <QSize>
 
+namespace qsc {
+class StageLatency;
+struct DeviceMetrics;
+}
+struct FFmpegLogTag;
+
 class VideoBuffer;
+class LatencyProbe;
 class Decoder : public QObject
 {
     Q_OBJECT
@@ -22,8 +29,18 @@ public:
     bool open();
     void close();
     bool push(const AVPacket *packet);
-    void peekFrame(std::function<void(int width, int height, uint8_t* dataRGB32)> onFrame);
+    void peekFrame(std::function<void(int width, int height, uint8_t* dataRGB32)> onFrame, int downscale = 1);
+    // refcounted snapshot of the last decoded frame, see VideoBuffer::refRenderedFrame()
+    AVFrame *refFrame();
     void setFrameSize(const QSize& frameSize);
+    // not owned, set before the first packet is pushed
+    void setLatencyProbe(LatencyProbe *probe);
+    // not owned, set before the first packet is pushed
+    void setStageLatency(qsc::StageLatency *latency);
+    // rendered/skipped frame totals and fps, not owned
+    void setDeviceMetrics(qsc::DeviceMetrics *metrics);
+    // FFmpeg lines of the codec context carry the device serial
+    void setLogTag(const FFmpegLogTag *tag);
 
 signals:
     void updateFPS(quint32 fps);
@@ -50,6 +67,11 @@ private:
     bool m_needsInitialization = true;  // Decoder needs open() to be called
     QSize m_frameSize;  // Frame dimensions from server
     std::function<void(int, int, uint8_t*, uint8_t*, uint8_t*, int, int, int)> m_onFrame = Q_NULLPTR;
+    LatencyProbe *m_latencyProbe = Q_NULLPTR;
+    qsc::StageLatency *m_stageLatency = Q_NULLPTR;
+    const FFmpegLogTag *m_logTag = Q_NULLPTR;
+    qint64 m_pushStartUs = 0; // start of the push() that produced the pending frame
+    bool m_packetMayBeStatic = false; // the packet being decoded is small enough to be a repeat
 };
 
 #endif // DECODER_H
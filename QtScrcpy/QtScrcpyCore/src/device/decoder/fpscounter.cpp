@@ -1,6 +1,7 @@
 #include <QDebug>
 #include <QTimerEvent>
 
+#include "devicemetrics.h"
 #include "fpscounter.h"
 
 FpsCounter::FpsCounter(QObject *parent) : QObject(parent) {}
@@ -17,6 +18,9 @@ void FpsCounter::stop()
 {
     stopCounterTimer();
     resetCounter();
+    if (m_metrics) {
+        m_metrics->fps.store(0, std::memory_order_relaxed);
+    }
 }
 
 bool FpsCounter::isStarted()
@@ -27,11 +31,22 @@ bool FpsCounter::isStarted()
 void FpsCounter::addRenderedFrame()
 {
     m_rendered++;
+    if (m_metrics) {
+        m_metrics->framesRendered.fetch_add(1, std::memory_order_relaxed);
+    }
 }
 
 void FpsCounter::addSkippedFrame()
 {
     m_skipped++;
+    if (m_metrics) {
+        m_metrics->framesSkipped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void FpsCounter::setDeviceMetrics(qsc::DeviceMetrics *metrics)
+{
+    m_metrics = metrics;
 }
 
 void FpsCounter::timerEvent(QTimerEvent *event)
@@ -40,6 +55,9 @@ void FpsCounter::timerEvent(QTimerEvent *event)
         m_curRendered = m_rendered;
         m_curSkipped = m_skipped;
         resetCounter();
+        if (m_metrics) {
+            m_metrics->fps.store(m_curRendered, std::memory_order_relaxed);
+        }
         emit updateFPS(m_curRendered);
         //qInfo("FPS:%d Discard:%d", m_curRendered, m_skipped);
     }
@@ -2,6 +2,10 @@
 #define FPSCOUNTER_H
 #include <QObject>
 
+namespace qsc {
+struct DeviceMetrics;
+}
+
 class FpsCounter : public QObject
 {
     Q_OBJECT
@@ -14,6 +18,8 @@ public:
     bool isStarted();
     void addRenderedFrame();
     void addSkippedFrame();
+    // cumulative totals and the last fps are mirrored there, not owned
+    void setDeviceMetrics(qsc::DeviceMetrics *metrics);
 
 signals:
     void updateFPS(quint32 fps);
@@ -33,6 +39,8 @@ private:
 
     quint32 m_rendered = 0;
     quint32 m_skipped = 0;
+
+    qsc::DeviceMetrics *m_metrics = Q_NULLPTR;
 };
 
 #endif // FPSCOUNTER_H
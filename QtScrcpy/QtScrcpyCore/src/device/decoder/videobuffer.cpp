@@ -1,3 +1,14 @@
+#include <QMutexLocker>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VIDEO_BUFFER_SAD_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define VIDEO_BUFFER_SAD_NEON
+#endif
+
+#include "devicemetrics.h"
 #include "videobuffer.h"
 #include "avframeconvert.h"
 extern "C"
@@ -7,6 +18,41 @@ extern "C"
 #include "libavutil/imgutils.h"
 }
 
+// one luma row in this many is compared per frame
+#define VIDEO_BUFFER_SAMPLE_STRIDE 8
+// summed absolute luma difference a sampled row may have and still be "unchanged":
+// a repeated frame decodes to the same pixels, this only absorbs deblocking noise
+#define VIDEO_BUFFER_ROW_SAD_MAX 64
+// an unchanged picture is still offered this often (fps display, missed changes)
+#define VIDEO_BUFFER_REFRESH_MS 1000
+
+// sum of absolute differences of two rows
+static quint32 rowSad(const uint8_t *a, const uint8_t *b, int width)
+{
+    quint32 sad = 0;
+    int x = 0;
+#if defined(VIDEO_BUFFER_SAD_SSE2)
+    __m128i sum = _mm_setzero_si128();
+    for (; x + 16 <= width; x += 16) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + x));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + x));
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(va, vb));
+    }
+    sad = static_cast<quint32>(_mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+#elif defined(VIDEO_BUFFER_SAD_NEON)
+    uint32x4_t sum = vdupq_n_u32(0);
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t diff = vabdq_u8(vld1q_u8(a + x), vld1q_u8(b + x));
+        sum = vpadalq_u16(sum, vpaddlq_u8(diff));
+    }
+    sad = vgetq_lane_u32(sum, 0) + vgetq_lane_u32(sum, 1) + vgetq_lane_u32(sum, 2) + vgetq_lane_u32(sum, 3);
+#endif
+    for (; x < width; x++) {
+        sad += static_cast<quint32>(qAbs(a[x] - b[x]));
+    }
+    return sad;
+}
+
 VideoBuffer::VideoBuffer(QObject *parent) : QObject(parent) {
     connect(&m_fpsCounter, &FpsCounter::updateFPS, this, &VideoBuffer::updateFPS);
 }
@@ -65,11 +111,50 @@ void VideoBuffer::setRenderExpiredFrames(bool renderExpiredFrames)
     m_renderExpiredFrames = renderExpiredFrames;
 }
 
+void VideoBuffer::setDeviceMetrics(qsc::DeviceMetrics *metrics)
+{
+    m_metrics = metrics;
+    m_fpsCounter.setDeviceMetrics(metrics);
+}
+
 AVFrame *VideoBuffer::decodingFrame()
 {
     return m_decodingFrame;
 }
 
+bool VideoBuffer::isDecodingFrameUnchanged()
+{
+    // only this thread swaps the frames, and the renderer only reads the rendering frame
+    const AVFrame *current = m_decodingFrame;
+    const AVFrame *last = m_renderingframe;
+    if (!current || !last || !last->data[0] || !current->data[0]) {
+        return false;
+    }
+    if (current->width != last->width || current->height != last->height || current->format != last->format) {
+        return false;
+    }
+    if (!m_lastOfferTimer.isValid() || m_lastOfferTimer.elapsed() >= VIDEO_BUFFER_REFRESH_MS) {
+        return false;
+    }
+
+    m_samplePhase = (m_samplePhase + 1) % VIDEO_BUFFER_SAMPLE_STRIDE;
+    for (int y = m_samplePhase; y < current->height; y += VIDEO_BUFFER_SAMPLE_STRIDE) {
+        const uint8_t *a = current->data[0] + static_cast<ptrdiff_t>(y) * current->linesize[0];
+        const uint8_t *b = last->data[0] + static_cast<ptrdiff_t>(y) * last->linesize[0];
+        if (rowSad(a, b, current->width) > VIDEO_BUFFER_ROW_SAD_MAX) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void VideoBuffer::addUnchangedFrame()
+{
+    if (m_metrics) {
+        m_metrics->framesUnchanged.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
 void VideoBuffer::offerDecodedFrame(bool &previousFrameSkipped)
 {
     m_mutex.lock();
@@ -90,6 +175,7 @@ void VideoBuffer::offerDecodedFrame(bool &previousFrameSkipped)
     previousFrameSkipped = !m_renderingFrameConsumed;
     m_renderingFrameConsumed = false;
     m_mutex.unlock();
+    m_lastOfferTimer.start();
 }
 
 const AVFrame *VideoBuffer::consumeRenderedFrame()
@@ -107,52 +193,68 @@ const AVFrame *VideoBuffer::consumeRenderedFrame()
     return m_renderingframe;
 }
 
-void VideoBuffer::peekRenderedFrame(std::function<void(int width, int height, uint8_t* dataRGB32)> onFrame)
+void VideoBuffer::peekRenderedFrame(std::function<void(int width, int height, uint8_t* dataRGB32)> onFrame, int downscale)
 {
-    if (!onFrame) {
+    if (!onFrame || downscale < 1) {
         return;
     }
 
-    lock();
-    auto frame = m_renderingframe;
-    int width = frame->width;
-    int height = frame->height;
-    int linesize = frame->linesize[0];
+    // convert from our own reference, the decoder keeps running meanwhile
+    AVFrame *frame = refRenderedFrame();
+    if (!frame) {
+        return;
+    }
+    int width = frame->width / downscale;
+    int height = frame->height / downscale;
+    if (width <= 0 || height <= 0) {
+        av_frame_free(&frame);
+        return;
+    }
 
-    // create buffer
-    uint8_t* rgbBuffer = new uint8_t[linesize * height * 4];
+    int bufferSize = av_image_get_buffer_size(AV_PIX_FMT_RGB32, width, height, 4);
     AVFrame *rgbFrame = av_frame_alloc();
-    if (!rgbFrame) {
-        delete [] rgbBuffer;
+    uint8_t *rgbBuffer = bufferSize > 0 ? static_cast<uint8_t *>(av_malloc(static_cast<size_t>(bufferSize))) : Q_NULLPTR;
+    if (!rgbFrame || !rgbBuffer) {
+        av_free(rgbBuffer);
+        av_frame_free(&rgbFrame);
+        av_frame_free(&frame);
         return;
     }
 
     // bind buffer to AVFrame
     av_image_fill_arrays(rgbFrame->data, rgbFrame->linesize, rgbBuffer, AV_PIX_FMT_RGB32, width, height, 4);
 
-    // convert
+    // convert, YuvConvert kernels for the decoder's YUV420P, swscale otherwise
     AVFrameConvert convert;
-    convert.setSrcFrameInfo(width, height, AV_PIX_FMT_YUV420P);
+    convert.setSrcFrameInfo(frame->width, frame->height, static_cast<AVPixelFormat>(frame->format));
     convert.setDstFrameInfo(width, height, AV_PIX_FMT_RGB32);
-    bool ret = false;
-    ret = convert.init();
-    if (!ret) {
-        delete [] rgbBuffer;
-        av_free(rgbFrame);
-        return;
+    bool ret = convert.init() && convert.convert(frame, rgbFrame);
+    convert.deInit();
+    av_frame_free(&rgbFrame);
+    av_frame_free(&frame);
+
+    if (ret) {
+        onFrame(width, height, rgbBuffer);
     }
-    ret = convert.convert(frame, rgbFrame);
-    if (!ret) {
-        delete [] rgbBuffer;
-        av_free(rgbFrame);
-        return;
+    av_free(rgbBuffer);
+}
+
+AVFrame *VideoBuffer::refRenderedFrame()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_renderingframe || !m_renderingframe->buf[0] || m_renderingframe->width <= 0) {
+        return Q_NULLPTR;
     }
-    convert.deInit();
-    av_free(rgbFrame);
-    unLock();
 
-    onFrame(width, height, rgbBuffer);
-    delete [] rgbBuffer;
+    AVFrame *frame = av_frame_alloc();
+    if (!frame) {
+        return Q_NULLPTR;
+    }
+    if (av_frame_ref(frame, m_renderingframe) < 0) {
+        av_frame_free(&frame);
+        return Q_NULLPTR;
+    }
+    return frame;
 }
 
 void VideoBuffer::interrupt()
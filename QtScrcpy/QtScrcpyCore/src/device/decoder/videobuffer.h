@@ -1,6 +1,7 @@
 #ifndef VIDEO_BUFFER_H
 #define VIDEO_BUFFER_H
 
+#include <QElapsedTimer>
 #include <QMutex>
 #include <QWaitCondition>
 #include <QObject>
@@ -23,8 +24,16 @@ public:
     void lock();
     void unLock();
     void setRenderExpiredFrames(bool renderExpiredFrames);
+    void setDeviceMetrics(qsc::DeviceMetrics *metrics);
 
     AVFrame *decodingFrame();
+    // decoder thread, before offerDecodedFrame(): true when the decoding frame shows the same
+    // picture as the last offered one. Every VIDEO_BUFFER_SAMPLE_STRIDE-th luma row is compared,
+    // starting at a row that rotates per call, so a change between the sampled rows is still
+    // found within a few frames; a frame is offered at least every VIDEO_BUFFER_REFRESH_MS
+    bool isDecodingFrameUnchanged();
+    // the decoding frame is dropped instead of offered
+    void addUnchangedFrame();
     // set the decoder frame as ready for rendering
     // this function locks m_mutex during its execution
     // returns true if the previous frame had been consumed
@@ -36,7 +45,12 @@ public:
     // unlocking m_mutex
     const AVFrame *consumeRenderedFrame();
 
-    void peekRenderedFrame(std::function<void(int width, int height, uint8_t* dataRGB32)> onFrame);
+    // RGB32 copy of the last decoded frame, downscale 2 or 4 for thumbnails
+    void peekRenderedFrame(std::function<void(int width, int height, uint8_t* dataRGB32)> onFrame, int downscale = 1);
+
+    // new reference to the last decoded frame, no pixel copy, only holds m_mutex for the refcount
+    // returns nullptr before the first frame; the caller releases it with av_frame_free()
+    AVFrame *refRenderedFrame();
 
     // wake up and avoid any blocking call
     void interrupt();
@@ -60,6 +74,11 @@ private:
     // interrupted is not used if expired frames are not rendered
     // since offering a frame will never block
     bool m_interrupted = false;
+
+    // unchanged frame detection, decoder thread only
+    QElapsedTimer m_lastOfferTimer;
+    int m_samplePhase = 0;
+    qsc::DeviceMetrics *m_metrics = Q_NULLPTR;
 };
 
 #endif // VIDEO_BUFFER_H
@@ -0,0 +1,526 @@
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || ((defined(__i386__) || defined(_M_IX86)) && (defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)))
+#include <emmintrin.h>
+#include <immintrin.h>
+#define YUV_CONVERT_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+// MSVC emits AVX2 intrinsics without /arch, the caller checks the CPU
+#define YUV_CONVERT_AVX2_TARGET
+#else
+#define YUV_CONVERT_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define YUV_CONVERT_NEON
+#endif
+
+#include "yuvconvert.h"
+
+extern "C"
+{
+#include "libavutil/frame.h"
+#include "libavutil/pixfmt.h"
+}
+
+// BT.601 limited range, scaled by 1 << YUV_SHIFT:
+// R = 1.164 (Y - 16) + 1.596 (V - 128)
+// G = 1.164 (Y - 16) - 0.391 (U - 128) - 0.813 (V - 128)
+// B = 1.164 (Y - 16) + 2.018 (U - 128)
+// small enough that every term fits in 16 bits, only B can saturate, and then it is 255 anyway
+#define YUV_SHIFT 6
+#define YUV_Y_COEF 74
+#define YUV_RV_COEF 102
+#define YUV_GU_COEF 25
+#define YUV_GV_COEF 52
+#define YUV_BU_COEF 129
+
+struct YuvKernels
+{
+    YuvConvert::Isa isa;
+    // width luma pixels, u and v hold (width + 1) / 2
+    void (*convertRow)(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width);
+    // dst[x] is the rounded mean of a[2x..2x+1] and b[2x..2x+1]
+    void (*downscaleRow2x)(const uint8_t *a, const uint8_t *b, uint8_t *dst, int dstWidth);
+    void (*downscaleRow4x)(const uint8_t *const rows[4], uint8_t *dst, int dstWidth);
+};
+
+static inline uint8_t clampPixel(int value)
+{
+    return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+static void convertRowScalar(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width)
+{
+    for (int x = 0; x < width; x++) {
+        const int luma = (y[x] - 16) * YUV_Y_COEF + (1 << (YUV_SHIFT - 1));
+        const int cb = u[x >> 1] - 128;
+        const int cr = v[x >> 1] - 128;
+        dst[4 * x] = clampPixel((luma + YUV_BU_COEF * cb) >> YUV_SHIFT);
+        dst[4 * x + 1] = clampPixel((luma - YUV_GU_COEF * cb - YUV_GV_COEF * cr) >> YUV_SHIFT);
+        dst[4 * x + 2] = clampPixel((luma + YUV_RV_COEF * cr) >> YUV_SHIFT);
+        dst[4 * x + 3] = 0xff;
+    }
+}
+
+static void downscaleRow2xScalar(const uint8_t *a, const uint8_t *b, uint8_t *dst, int dstWidth)
+{
+    for (int x = 0; x < dstWidth; x++) {
+        dst[x] = static_cast<uint8_t>((a[2 * x] + a[2 * x + 1] + b[2 * x] + b[2 * x + 1] + 2) >> 2);
+    }
+}
+
+static void downscaleRow4xScalar(const uint8_t *const rows[4], uint8_t *dst, int dstWidth)
+{
+    for (int x = 0; x < dstWidth; x++) {
+        int sum = 8;
+        for (int r = 0; r < 4; r++) {
+            const uint8_t *p = rows[r] + 4 * x;
+            sum += p[0] + p[1] + p[2] + p[3];
+        }
+        dst[x] = static_cast<uint8_t>(sum >> 4);
+    }
+}
+
+static const YuvKernels s_scalarKernels = { YuvConvert::ISA_SCALAR, convertRowScalar, downscaleRow2xScalar, downscaleRow4xScalar };
+
+#if defined(YUV_CONVERT_X86)
+// 8 pixels: luma and chroma as 16 bit lanes, luma already offset, scaled and rounded
+#define YUV_CONVERT_SSE2_PIXELS(luma, cb, cr, b, g, r)                                                                                               \
+    do {                                                                                                                                             \
+        b = _mm_srai_epi16(_mm_adds_epi16(luma, _mm_mullo_epi16(cb, _mm_set1_epi16(YUV_BU_COEF))), YUV_SHIFT);                                     \
+        g = _mm_srai_epi16(                                                                                                                          \
+            _mm_subs_epi16(_mm_subs_epi16(luma, _mm_mullo_epi16(cb, _mm_set1_epi16(YUV_GU_COEF))), _mm_mullo_epi16(cr, _mm_set1_epi16(YUV_GV_COEF))), \
+            YUV_SHIFT);                                                                                                                              \
+        r = _mm_srai_epi16(_mm_adds_epi16(luma, _mm_mullo_epi16(cr, _mm_set1_epi16(YUV_RV_COEF))), YUV_SHIFT);                                     \
+    } while (0)
+
+static inline __m128i lumaSse2(__m128i y)
+{
+    return _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(y, _mm_set1_epi16(16)), _mm_set1_epi16(YUV_Y_COEF)), _mm_set1_epi16(1 << (YUV_SHIFT - 1)));
+}
+
+static void convertRowSse2(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i chromaOffset = _mm_set1_epi16(128);
+    const __m128i alpha = _mm_set1_epi8(-1);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i yy = _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x));
+        const __m128i uu = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + x / 2)), zero), chromaOffset);
+        const __m128i vv = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + x / 2)), zero), chromaOffset);
+
+        __m128i b0, g0, r0, b1, g1, r1;
+        YUV_CONVERT_SSE2_PIXELS(lumaSse2(_mm_unpacklo_epi8(yy, zero)), _mm_unpacklo_epi16(uu, uu), _mm_unpacklo_epi16(vv, vv), b0, g0, r0);
+        YUV_CONVERT_SSE2_PIXELS(lumaSse2(_mm_unpackhi_epi8(yy, zero)), _mm_unpackhi_epi16(uu, uu), _mm_unpackhi_epi16(vv, vv), b1, g1, r1);
+        const __m128i bb = _mm_packus_epi16(b0, b1);
+        const __m128i gg = _mm_packus_epi16(g0, g1);
+        const __m128i rr = _mm_packus_epi16(r0, r1);
+
+        // BGRA in memory, i.e. 0xAARRGGBB words
+        const __m128i bgLo = _mm_unpacklo_epi8(bb, gg);
+        const __m128i bgHi = _mm_unpackhi_epi8(bb, gg);
+        const __m128i raLo = _mm_unpacklo_epi8(rr, alpha);
+        const __m128i raHi = _mm_unpackhi_epi8(rr, alpha);
+        __m128i *out = reinterpret_cast<__m128i *>(dst + 4 * x);
+        _mm_storeu_si128(out, _mm_unpacklo_epi16(bgLo, raLo));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(bgLo, raLo));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(bgHi, raHi));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(bgHi, raHi));
+    }
+    convertRowScalar(y + x, u + x / 2, v + x / 2, dst + 4 * x, width - x);
+}
+
+// sums of the 8 horizontal byte pairs as 16 bit lanes
+static inline __m128i pairSumsSse2(__m128i v)
+{
+    return _mm_add_epi16(_mm_and_si128(v, _mm_set1_epi16(0x00ff)), _mm_srli_epi16(v, 8));
+}
+
+static void downscaleRow2xSse2(const uint8_t *a, const uint8_t *b, uint8_t *dst, int dstWidth)
+{
+    const __m128i round = _mm_set1_epi16(2);
+    int x = 0;
+    for (; x + 16 <= dstWidth; x += 16) {
+        const __m128i *pa = reinterpret_cast<const __m128i *>(a + 2 * x);
+        const __m128i *pb = reinterpret_cast<const __m128i *>(b + 2 * x);
+        __m128i s0 = _mm_add_epi16(pairSumsSse2(_mm_loadu_si128(pa)), pairSumsSse2(_mm_loadu_si128(pb)));
+        __m128i s1 = _mm_add_epi16(pairSumsSse2(_mm_loadu_si128(pa + 1)), pairSumsSse2(_mm_loadu_si128(pb + 1)));
+        s0 = _mm_srli_epi16(_mm_add_epi16(s0, round), 2);
+        s1 = _mm_srli_epi16(_mm_add_epi16(s1, round), 2);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(s0, s1));
+    }
+    downscaleRow2xScalar(a + 2 * x, b + 2 * x, dst + x, dstWidth - x);
+}
+
+static void downscaleRow4xSse2(const uint8_t *const rows[4], uint8_t *dst, int dstWidth)
+{
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i round = _mm_set1_epi32(8);
+    int x = 0;
+    for (; x + 8 <= dstWidth; x += 8) {
+        __m128i s0 = _mm_setzero_si128();
+        __m128i s1 = _mm_setzero_si128();
+        for (int r = 0; r < 4; r++) {
+            const __m128i *p = reinterpret_cast<const __m128i *>(rows[r] + 4 * x);
+            s0 = _mm_add_epi16(s0, pairSumsSse2(_mm_loadu_si128(p)));
+            s1 = _mm_add_epi16(s1, pairSumsSse2(_mm_loadu_si128(p + 1)));
+        }
+        // adjacent pair sums to 4x4 block sums
+        const __m128i q0 = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(s0, ones), round), 4);
+        const __m128i q1 = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(s1, ones), round), 4);
+        const __m128i words = _mm_packs_epi32(q0, q1);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(words, words));
+    }
+    const uint8_t *tail[4] = { rows[0] + 4 * x, rows[1] + 4 * x, rows[2] + 4 * x, rows[3] + 4 * x };
+    downscaleRow4xScalar(tail, dst + x, dstWidth - x);
+}
+
+static const YuvKernels s_sse2Kernels = { YuvConvert::ISA_SSE2, convertRowSse2, downscaleRow2xSse2, downscaleRow4xSse2 };
+
+#define YUV_CONVERT_AVX2_PIXELS(luma, cb, cr, b, g, r)                                                                                                        \
+    do {                                                                                                                                                      \
+        b = _mm256_srai_epi16(_mm256_adds_epi16(luma, _mm256_mullo_epi16(cb, _mm256_set1_epi16(YUV_BU_COEF))), YUV_SHIFT);                                  \
+        g = _mm256_srai_epi16(                                                                                                                                \
+            _mm256_subs_epi16(_mm256_subs_epi16(luma, _mm256_mullo_epi16(cb, _mm256_set1_epi16(YUV_GU_COEF))), _mm256_mullo_epi16(cr, _mm256_set1_epi16(YUV_GV_COEF))), \
+            YUV_SHIFT);                                                                                                                                       \
+        r = _mm256_srai_epi16(_mm256_adds_epi16(luma, _mm256_mullo_epi16(cr, _mm256_set1_epi16(YUV_RV_COEF))), YUV_SHIFT);                                  \
+    } while (0)
+
+YUV_CONVERT_AVX2_TARGET static inline __m256i lumaAvx2(__m256i y)
+{
+    return _mm256_add_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(y, _mm256_set1_epi16(16)), _mm256_set1_epi16(YUV_Y_COEF)),
+                            _mm256_set1_epi16(1 << (YUV_SHIFT - 1)));
+}
+
+// unpack works per 128 bit lane: the low halves cover pixels 0-7 and 16-23, the high ones 8-15 and 24-31
+YUV_CONVERT_AVX2_TARGET static void convertRowAvx2(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i chromaOffset = _mm256_set1_epi16(128);
+    const __m256i alpha = _mm256_set1_epi8(-1);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        const __m256i yy = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(y + x));
+        const __m256i uu = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(u + x / 2))), chromaOffset);
+        const __m256i vv = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(v + x / 2))), chromaOffset);
+
+        __m256i b0, g0, r0, b1, g1, r1;
+        YUV_CONVERT_AVX2_PIXELS(lumaAvx2(_mm256_unpacklo_epi8(yy, zero)), _mm256_unpacklo_epi16(uu, uu), _mm256_unpacklo_epi16(vv, vv), b0, g0, r0);
+        YUV_CONVERT_AVX2_PIXELS(lumaAvx2(_mm256_unpackhi_epi8(yy, zero)), _mm256_unpackhi_epi16(uu, uu), _mm256_unpackhi_epi16(vv, vv), b1, g1, r1);
+        // back in pixel order: lane 0 is 0-15, lane 1 is 16-31
+        const __m256i bb = _mm256_packus_epi16(b0, b1);
+        const __m256i gg = _mm256_packus_epi16(g0, g1);
+        const __m256i rr = _mm256_packus_epi16(r0, r1);
+
+        const __m256i bgLo = _mm256_unpacklo_epi8(bb, gg);
+        const __m256i bgHi = _mm256_unpackhi_epi8(bb, gg);
+        const __m256i raLo = _mm256_unpacklo_epi8(rr, alpha);
+        const __m256i raHi = _mm256_unpackhi_epi8(rr, alpha);
+        const __m256i p0 = _mm256_unpacklo_epi16(bgLo, raLo); // 0-3, 16-19
+        const __m256i p1 = _mm256_unpackhi_epi16(bgLo, raLo); // 4-7, 20-23
+        const __m256i p2 = _mm256_unpacklo_epi16(bgHi, raHi); // 8-11, 24-27
+        const __m256i p3 = _mm256_unpackhi_epi16(bgHi, raHi); // 12-15, 28-31
+        __m256i *out = reinterpret_cast<__m256i *>(dst + 4 * x);
+        _mm256_storeu_si256(out, _mm256_permute2x128_si256(p0, p1, 0x20));
+        _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(p2, p3, 0x20));
+        _mm256_storeu_si256(out + 2, _mm256_permute2x128_si256(p0, p1, 0x31));
+        _mm256_storeu_si256(out + 3, _mm256_permute2x128_si256(p2, p3, 0x31));
+    }
+    convertRowSse2(y + x, u + x / 2, v + x / 2, dst + 4 * x, width - x);
+}
+
+YUV_CONVERT_AVX2_TARGET static inline __m256i pairSumsAvx2(__m256i v)
+{
+    return _mm256_add_epi16(_mm256_and_si256(v, _mm256_set1_epi16(0x00ff)), _mm256_srli_epi16(v, 8));
+}
+
+YUV_CONVERT_AVX2_TARGET static void downscaleRow2xAvx2(const uint8_t *a, const uint8_t *b, uint8_t *dst, int dstWidth)
+{
+    const __m256i round = _mm256_set1_epi16(2);
+    int x = 0;
+    for (; x + 32 <= dstWidth; x += 32) {
+        const __m256i *pa = reinterpret_cast<const __m256i *>(a + 2 * x);
+        const __m256i *pb = reinterpret_cast<const __m256i *>(b + 2 * x);
+        __m256i s0 = _mm256_add_epi16(pairSumsAvx2(_mm256_loadu_si256(pa)), pairSumsAvx2(_mm256_loadu_si256(pb)));
+        __m256i s1 = _mm256_add_epi16(pairSumsAvx2(_mm256_loadu_si256(pa + 1)), pairSumsAvx2(_mm256_loadu_si256(pb + 1)));
+        s0 = _mm256_srli_epi16(_mm256_add_epi16(s0, round), 2);
+        s1 = _mm256_srli_epi16(_mm256_add_epi16(s1, round), 2);
+        // packus interleaves the lanes of its inputs
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), _mm256_permute4x64_epi64(_mm256_packus_epi16(s0, s1), 0xd8));
+    }
+    downscaleRow2xSse2(a + 2 * x, b + 2 * x, dst + x, dstWidth - x);
+}
+
+static const YuvKernels s_avx2Kernels = { YuvConvert::ISA_AVX2, convertRowAvx2, downscaleRow2xAvx2, downscaleRow4xSse2 };
+
+static bool cpuHasAvx2()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    // OSXSAVE and AVX, then the OS has to save the YMM registers
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    // checks OS support of the YMM state too
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif // YUV_CONVERT_X86
+
+#if defined(YUV_CONVERT_NEON)
+static inline int16x8_t lumaNeon(uint8x8_t y)
+{
+    return vaddq_s16(vmulq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(y)), vdupq_n_s16(16)), YUV_Y_COEF), vdupq_n_s16(1 << (YUV_SHIFT - 1)));
+}
+
+static void convertRowNeon(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width)
+{
+    const int16x8_t chromaOffset = vdupq_n_s16(128);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const uint8x16_t yy = vld1q_u8(y + x);
+        const int16x8_t uu = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(u + x / 2))), chromaOffset);
+        const int16x8_t vv = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(v + x / 2))), chromaOffset);
+        // each chroma sample covers two pixels
+        const int16x8x2_t cb = vzipq_s16(uu, uu);
+        const int16x8x2_t cr = vzipq_s16(vv, vv);
+        const int16x8_t luma[2] = { lumaNeon(vget_low_u8(yy)), lumaNeon(vget_high_u8(yy)) };
+
+        uint8x8_t b[2], g[2], r[2];
+        for (int half = 0; half < 2; half++) {
+            b[half] = vqmovun_s16(vshrq_n_s16(vqaddq_s16(luma[half], vmulq_n_s16(cb.val[half], YUV_BU_COEF)), YUV_SHIFT));
+            g[half] = vqmovun_s16(vshrq_n_s16(
+                vqsubq_s16(vqsubq_s16(luma[half], vmulq_n_s16(cb.val[half], YUV_GU_COEF)), vmulq_n_s16(cr.val[half], YUV_GV_COEF)), YUV_SHIFT));
+            r[half] = vqmovun_s16(vshrq_n_s16(vqaddq_s16(luma[half], vmulq_n_s16(cr.val[half], YUV_RV_COEF)), YUV_SHIFT));
+        }
+        uint8x16x4_t bgra;
+        bgra.val[0] = vcombine_u8(b[0], b[1]);
+        bgra.val[1] = vcombine_u8(g[0], g[1]);
+        bgra.val[2] = vcombine_u8(r[0], r[1]);
+        bgra.val[3] = vdupq_n_u8(0xff);
+        vst4q_u8(dst + 4 * x, bgra);
+    }
+    convertRowScalar(y + x, u + x / 2, v + x / 2, dst + 4 * x, width - x);
+}
+
+static void downscaleRow2xNeon(const uint8_t *a, const uint8_t *b, uint8_t *dst, int dstWidth)
+{
+    int x = 0;
+    for (; x + 16 <= dstWidth; x += 16) {
+        const uint16x8_t s0 = vpadalq_u8(vpaddlq_u8(vld1q_u8(a + 2 * x)), vld1q_u8(b + 2 * x));
+        const uint16x8_t s1 = vpadalq_u8(vpaddlq_u8(vld1q_u8(a + 2 * x + 16)), vld1q_u8(b + 2 * x + 16));
+        vst1q_u8(dst + x, vcombine_u8(vrshrn_n_u16(s0, 2), vrshrn_n_u16(s1, 2)));
+    }
+    downscaleRow2xScalar(a + 2 * x, b + 2 * x, dst + x, dstWidth - x);
+}
+
+static void downscaleRow4xNeon(const uint8_t *const rows[4], uint8_t *dst, int dstWidth)
+{
+    int x = 0;
+    for (; x + 8 <= dstWidth; x += 8) {
+        uint16x8_t s0 = vdupq_n_u16(0);
+        uint16x8_t s1 = vdupq_n_u16(0);
+        for (int r = 0; r < 4; r++) {
+            s0 = vpadalq_u8(s0, vld1q_u8(rows[r] + 4 * x));
+            s1 = vpadalq_u8(s1, vld1q_u8(rows[r] + 4 * x + 16));
+        }
+        const uint16x4_t q0 = vrshrn_n_u32(vpaddlq_u16(s0), 4);
+        const uint16x4_t q1 = vrshrn_n_u32(vpaddlq_u16(s1), 4);
+        vst1_u8(dst + x, vmovn_u16(vcombine_u16(q0, q1)));
+    }
+    const uint8_t *tail[4] = { rows[0] + 4 * x, rows[1] + 4 * x, rows[2] + 4 * x, rows[3] + 4 * x };
+    downscaleRow4xScalar(tail, dst + x, dstWidth - x);
+}
+
+static const YuvKernels s_neonKernels = { YuvConvert::ISA_NEON, convertRowNeon, downscaleRow2xNeon, downscaleRow4xNeon };
+#endif // YUV_CONVERT_NEON
+
+static const YuvKernels *kernelsFor(YuvConvert::Isa isa)
+{
+    switch (isa) {
+#if defined(YUV_CONVERT_X86)
+    case YuvConvert::ISA_SSE2:
+        return &s_sse2Kernels;
+    case YuvConvert::ISA_AVX2:
+        return cpuHasAvx2() ? &s_avx2Kernels : Q_NULLPTR;
+#endif
+#if defined(YUV_CONVERT_NEON)
+    case YuvConvert::ISA_NEON:
+        return &s_neonKernels;
+#endif
+    case YuvConvert::ISA_SCALAR:
+        return &s_scalarKernels;
+    default:
+        return Q_NULLPTR;
+    }
+}
+
+static const YuvKernels *bestKernels()
+{
+#if defined(YUV_CONVERT_X86)
+    return cpuHasAvx2() ? &s_avx2Kernels : &s_sse2Kernels;
+#elif defined(YUV_CONVERT_NEON)
+    return &s_neonKernels;
+#else
+    return &s_scalarKernels;
+#endif
+}
+
+// picked on first use, constant unless a benchmark forces a set
+static std::atomic<const YuvKernels *> s_kernels(Q_NULLPTR);
+
+static const YuvKernels &kernels()
+{
+    const YuvKernels *current = s_kernels.load(std::memory_order_acquire);
+    if (!current) {
+        current = bestKernels();
+        s_kernels.store(current, std::memory_order_release);
+    }
+    return *current;
+}
+
+YuvConvert::Isa YuvConvert::isa()
+{
+    return kernels().isa;
+}
+
+const char *YuvConvert::isaName(Isa isa)
+{
+    switch (isa) {
+    case ISA_SSE2:
+        return "sse2";
+    case ISA_AVX2:
+        return "avx2";
+    case ISA_NEON:
+        return "neon";
+    default:
+        return "scalar";
+    }
+}
+
+bool YuvConvert::setIsa(Isa isa)
+{
+    const YuvKernels *selected = kernelsFor(isa);
+    if (!selected) {
+        return false;
+    }
+    s_kernels.store(selected, std::memory_order_release);
+    return true;
+}
+
+bool YuvConvert::supports(const AVFrame *frame, int factor)
+{
+    if (!frame || frame->format != AV_PIX_FMT_YUV420P || frame->color_range == AVCOL_RANGE_JPEG) {
+        return false;
+    }
+    if (frame->width <= 0 || frame->height <= 0 || !frame->data[0] || !frame->data[1] || !frame->data[2]) {
+        return false;
+    }
+    switch (factor) {
+    case 1:
+        return true;
+    case 2:
+    case 4:
+        // whole chroma blocks, the small frame is 4:2:0 again
+        return frame->width % (2 * factor) == 0 && frame->height % (2 * factor) == 0;
+    default:
+        return false;
+    }
+}
+
+bool YuvConvert::toRgb32(const AVFrame *frame, int factor, uint8_t *dst, int dstLinesize)
+{
+    if (!supports(frame, factor)) {
+        return false;
+    }
+    return toRgb32(frame->data, frame->linesize, frame->width, frame->height, factor, dst, dstLinesize);
+}
+
+bool YuvConvert::toRgb32(const uint8_t *const data[3], const int linesize[3], int width, int height, int factor, uint8_t *dst, int dstLinesize)
+{
+    if (!dst || width <= 0 || height <= 0) {
+        return false;
+    }
+    if (factor == 1) {
+        yuv420pToRgb32(data, linesize, width, height, dst, dstLinesize);
+        return true;
+    }
+    if ((factor != 2 && factor != 4) || width % (2 * factor) != 0 || height % (2 * factor) != 0) {
+        return false;
+    }
+
+    const int dstWidth = width / factor;
+    const int dstHeight = height / factor;
+    const int chromaWidth = dstWidth / 2;
+    const int chromaHeight = dstHeight / 2;
+
+    // the small planes, reused by the thread (a screenshot worker, the GUI thread)
+    static thread_local std::vector<uint8_t> t_planes;
+    const size_t lumaSize = static_cast<size_t>(dstWidth) * static_cast<size_t>(dstHeight);
+    const size_t chromaSize = static_cast<size_t>(chromaWidth) * static_cast<size_t>(chromaHeight);
+    if (t_planes.size() < lumaSize + 2 * chromaSize) {
+        t_planes.resize(lumaSize + 2 * chromaSize);
+    }
+    uint8_t *planes[3] = { t_planes.data(), t_planes.data() + lumaSize, t_planes.data() + lumaSize + chromaSize };
+    const int linesizes[3] = { dstWidth, chromaWidth, chromaWidth };
+
+    downscale(data[0], linesize[0], width, height, factor, planes[0], linesizes[0]);
+    downscale(data[1], linesize[1], width / 2, height / 2, factor, planes[1], linesizes[1]);
+    downscale(data[2], linesize[2], width / 2, height / 2, factor, planes[2], linesizes[2]);
+    yuv420pToRgb32(planes, linesizes, dstWidth, dstHeight, dst, dstLinesize);
+    return true;
+}
+
+int YuvConvert::downscaleFactor(int width, int height, int dstWidth, int dstHeight)
+{
+    for (int factor = 4; factor > 1; factor /= 2) {
+        if (width / factor >= dstWidth && height / factor >= dstHeight && width % (2 * factor) == 0 && height % (2 * factor) == 0) {
+            return factor;
+        }
+    }
+    return 1;
+}
+
+void YuvConvert::yuv420pToRgb32(const uint8_t *const data[3], const int linesize[3], int width, int height, uint8_t *dst, int dstLinesize)
+{
+    const YuvKernels &k = kernels();
+    for (int y = 0; y < height; y++) {
+        const int chromaRow = y >> 1;
+        k.convertRow(data[0] + static_cast<ptrdiff_t>(y) * linesize[0], data[1] + static_cast<ptrdiff_t>(chromaRow) * linesize[1],
+                     data[2] + static_cast<ptrdiff_t>(chromaRow) * linesize[2], dst + static_cast<ptrdiff_t>(y) * dstLinesize, width);
+    }
+}
+
+void YuvConvert::downscale(const uint8_t *src, int srcLinesize, int srcWidth, int srcHeight, int factor, uint8_t *dst, int dstLinesize)
+{
+    const YuvKernels &k = kernels();
+    const int width = srcWidth / factor;
+    const int height = srcHeight / factor;
+    for (int y = 0; y < height; y++) {
+        const uint8_t *row = src + static_cast<ptrdiff_t>(y) * factor * srcLinesize;
+        uint8_t *out = dst + static_cast<ptrdiff_t>(y) * dstLinesize;
+        if (factor == 2) {
+            k.downscaleRow2x(row, row + srcLinesize, out, width);
+        } else if (factor == 4) {
+            const uint8_t *rows[4] = { row, row + srcLinesize, row + 2 * srcLinesize, row + 3 * srcLinesize };
+            k.downscaleRow4x(rows, out, width);
+        } else {
+            memcpy(out, row, static_cast<size_t>(width));
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef YUVCONVERT_H
+#define YUVCONVERT_H
+#include <cstdint>
+#include <QtGlobal>
+
+// forward declarations
+typedef struct AVFrame AVFrame;
+
+/**
+ * YuvConvert - Vectorized YUV420P to RGB32 conversion and 2x/4x box downscale
+ *
+ * The CPU-side frame consumers (screenshots, peeked frames, thumbnails, the software
+ * renderer) only ever see the decoder's YUV420P frames, which swscale handles through its
+ * generic filter chain. These kernels do exactly that one conversion, BT.601 limited range
+ * like swscale's default, in 6 bit fixed point, optionally averaging each 2x2 or 4x4 block
+ * first. The kernel set is picked once from the CPU the process runs on:
+ * - x86: SSE2 (always there on x86-64), AVX2 when the CPU and OS support it
+ * - ARM: NEON
+ * - anything else: scalar
+ * All sets produce the same pixels. Frames the kernels do not cover (other pixel formats,
+ * full range, sizes not a multiple of the block) are reported by supports(), the callers
+ * keep swscale for them.
+ */
+class YuvConvert
+{
+public:
+    enum Isa
+    {
+        ISA_SCALAR = 0,
+        ISA_SSE2,
+        ISA_AVX2,
+        ISA_NEON
+    };
+
+    // kernel set in use, best supported one unless forced
+    static Isa isa();
+    static const char *isaName(Isa isa);
+    // for benchmarks and comparisons; false if the CPU lacks it
+    static bool setIsa(Isa isa);
+
+    // factor is 1, 2 or 4
+    static bool supports(const AVFrame *frame, int factor);
+    // dst holds (width / factor) x (height / factor) RGB32 pixels
+    static bool toRgb32(const AVFrame *frame, int factor, uint8_t *dst, int dstLinesize);
+
+    // same on raw YUV420P planes, width and height of the luma plane
+    static bool toRgb32(const uint8_t *const data[3], const int linesize[3], int width, int height, int factor, uint8_t *dst, int dstLinesize);
+    // largest factor whose result still covers dstWidth x dstHeight, 1 if none does
+    static int downscaleFactor(int width, int height, int dstWidth, int dstHeight);
+
+    static void yuv420pToRgb32(const uint8_t *const data[3], const int linesize[3], int width, int height, uint8_t *dst, int dstLinesize);
+    // one plane, dst is (srcWidth / factor) x (srcHeight / factor)
+    static void downscale(const uint8_t *src, int srcLinesize, int srcWidth, int srcHeight, int factor, uint8_t *dst, int dstLinesize);
+
+private:
+    YuvConvert() = delete;
+};
+
+#endif // YUVCONVERT_H
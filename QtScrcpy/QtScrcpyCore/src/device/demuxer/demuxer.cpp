@@ -3,6 +3,9 @@
 
 #include "compat.h"
 #include "demuxer.h"
+#include "devicemetrics.h"
+#include "ffmpeglog.h"
+#include "stagelatency.h"
 #include "videosocket.h"
 
 #define HEADER_SIZE 12
@@ -20,36 +23,6 @@ Demuxer::Demuxer(QObject *parent)
 
 Demuxer::~Demuxer() {}
 
-static void avLogCallback(void *avcl, int level, const char *fmt, va_list vl)
-{
-    Q_UNUSED(avcl)
-    Q_UNUSED(vl)
-
-    QString localFmt = QString::fromUtf8(fmt);
-    localFmt.prepend("[FFmpeg] ");
-    switch (level) {
-    case AV_LOG_PANIC:
-    case AV_LOG_FATAL:
-        qFatal("%s", localFmt.toUtf8().data());
-        break;
-    case AV_LOG_ERROR:
-        qCritical() << localFmt.toUtf8();
-        break;
-    case AV_LOG_WARNING:
-        qWarning() << localFmt.toUtf8();
-        break;
-    case AV_LOG_INFO:
-        qInfo() << localFmt.toUtf8();
-        break;
-    case AV_LOG_DEBUG:
-        // qDebug() << localFmt.toUtf8();
-        break;
-    }
-
-    // do not forward others, which are too verbose
-    return;
-}
-
 bool Demuxer::init()
 {
 #ifdef QTSCRCPY_LAVF_REQUIRES_REGISTER_ALL
@@ -58,7 +31,7 @@ bool Demuxer::init()
     if (avformat_network_init()) {
         return false;
     }
-    av_log_set_callback(avLogCallback);
+    FFmpegLog::install();
     return true;
 }
 
@@ -78,6 +51,21 @@ void Demuxer::setFrameSize(const QSize &frameSize)
     m_frameSize = frameSize;
 }
 
+void Demuxer::setStageLatency(qsc::StageLatency *latency)
+{
+    m_stageLatency = latency;
+}
+
+void Demuxer::setDeviceMetrics(qsc::DeviceMetrics *metrics)
+{
+    m_deviceMetrics = metrics;
+}
+
+void Demuxer::setLogTag(const FFmpegLogTag *tag)
+{
+    m_logTag = tag;
+}
+
 static quint32 bufferRead32be(quint8 *buf)
 {
     return static_cast<quint32>((buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3]);
@@ -114,25 +102,25 @@ void Demuxer::stopDecode()
     wait();
 }
 
-void Demuxer::run()
+bool Demuxer::openParser()
 {
     m_codecCtx = Q_NULLPTR;
     m_parser = Q_NULLPTR;
-    AVPacket *packet = Q_NULLPTR;
 
     // codec
     const AVCodec* codec = avcodec_find_decoder(AV_CODEC_ID_H264);
     if (!codec) {
         qCritical("H.264 decoder not found");
-        goto runQuit;
+        return false;
     }
 
     // codeCtx
     m_codecCtx = avcodec_alloc_context3(codec);
     if (!m_codecCtx) {
         qCritical("Could not allocate codec context");
-        goto runQuit;
+        return false;
     }
+    FFmpegLog::tagContext(m_codecCtx, m_logTag);
     m_codecCtx->flags |= AV_CODEC_FLAG_LOW_DELAY;
     m_codecCtx->width = m_frameSize.width();
     m_codecCtx->height = m_frameSize.height();
@@ -141,12 +129,38 @@ void Demuxer::run()
     m_parser = av_parser_init(AV_CODEC_ID_H264);
     if (!m_parser) {
         qCritical("Could not initialize parser");
-        goto runQuit;
+        return false;
     }
 
     // We must only pass complete frames to av_parser_parse2()!
     // It's more complicated, but this allows to reduce the latency by 1 frame!
     m_parser->flags |= PARSER_FLAG_COMPLETE_FRAMES;
+    return true;
+}
+
+void Demuxer::closeParser()
+{
+    if (m_pending) {
+        av_packet_free(&m_pending);
+    }
+
+    if (m_parser) {
+        av_parser_close(m_parser);
+        m_parser = Q_NULLPTR;
+    }
+
+    if (m_codecCtx) {
+        avcodec_free_context(&m_codecCtx);
+    }
+}
+
+void Demuxer::run()
+{
+    AVPacket *packet = Q_NULLPTR;
+
+    if (!openParser()) {
+        goto runQuit;
+    }
 
     packet = av_packet_alloc();
     if (!packet) {
@@ -171,18 +185,9 @@ void Demuxer::run()
 
     qDebug("End of frames");
 
-    if (m_pending) {
-        av_packet_free(&m_pending);
-    }
-
-    av_packet_free(&packet);
-
-    av_parser_close(m_parser);
-
 runQuit:
-    if (m_codecCtx) {
-        avcodec_free_context(&m_codecCtx);
-    }
+    av_packet_free(&packet);
+    closeParser();
 
     if (m_videoSocket) {
         m_videoSocket->close();
@@ -226,6 +231,9 @@ bool Demuxer::recvPacket(AVPacket *packet)
     quint32 len = bufferRead32be(&header[8]);
     Q_ASSERT(len);
 
+    // the header wait is idle time between frames, only the payload read is a pipeline stage
+    qint64 readStartUs = m_stageLatency ? qsc::StageLatency::now() : 0;
+
     if (av_new_packet(packet, static_cast<int>(len))) {
         qCritical("Could not allocate packet");
         return false;
@@ -237,6 +245,14 @@ bool Demuxer::recvPacket(AVPacket *packet)
         return false;
     }
 
+    if (m_stageLatency) {
+        m_stageLatency->recordSince(qsc::StageLatency::SL_SOCKET_READ, readStartUs);
+    }
+    if (m_deviceMetrics) {
+        // what the device sent while this packet was read: grows when the demuxer thread falls behind
+        m_deviceMetrics->socketBacklogBytes.store(m_videoSocket->bytesAvailable(), std::memory_order_relaxed);
+    }
+
     if (ptsFlags & SC_PACKET_FLAG_CONFIG) {
         packet->pts = AV_NOPTS_VALUE;
     } else {
@@ -320,7 +336,11 @@ bool Demuxer::parse(AVPacket *packet)
     int inLen = packet->size;
     quint8 *outData = Q_NULLPTR;
     int outLen = 0;
+    qint64 parseStartUs = m_stageLatency ? qsc::StageLatency::now() : 0;
     int r = av_parser_parse2(m_parser, m_codecCtx, &outData, &outLen, inData, inLen, AV_NOPTS_VALUE, AV_NOPTS_VALUE, -1);
+    if (m_stageLatency) {
+        m_stageLatency->recordSince(qsc::StageLatency::SL_PARSE, parseStartUs);
+    }
 
     // PARSER_FLAG_COMPLETE_FRAMES is set
     Q_ASSERT(r == inLen);
@@ -11,6 +11,12 @@ extern "C"
 #include "libavformat/avformat.h"
 }
 
+namespace qsc {
+class StageLatency;
+struct DeviceMetrics;
+}
+struct FFmpegLogTag;
+
 class VideoSocket;
 class Demuxer : public QThread
 {
@@ -25,6 +31,12 @@ public:
 
     void installVideoSocket(VideoSocket* videoSocket);
     void setFrameSize(const QSize &frameSize);
+    // not owned, set before startDecode()
+    void setStageLatency(qsc::StageLatency *latency);
+    // socket backlog gauge, updated after every packet
+    void setDeviceMetrics(qsc::DeviceMetrics *metrics);
+    // FFmpeg lines of the parser context carry the device serial
+    void setLogTag(const FFmpegLogTag *tag);
     bool startDecode();
     void stopDecode();
 
@@ -35,16 +47,23 @@ signals:
 
 protected:
     void run();
+    // parser and codec context used by pushPacket(), set up by run()
+    bool openParser();
+    void closeParser();
     bool recvPacket(AVPacket *packet);
     bool pushPacket(AVPacket *packet);
     bool processConfigPacket(AVPacket *packet);
     bool parse(AVPacket *packet);
     bool processFrame(AVPacket *packet);
-    qint32 recvData(quint8 *buf, qint32 bufSize);
+    // reads from the video socket; virtual so that captures can be replayed from memory
+    virtual qint32 recvData(quint8 *buf, qint32 bufSize);
 
 private:
     QPointer<VideoSocket> m_videoSocket;
     QSize m_frameSize;
+    qsc::StageLatency *m_stageLatency = Q_NULLPTR;
+    qsc::DeviceMetrics *m_deviceMetrics = Q_NULLPTR;
+    const FFmpegLogTag *m_logTag = Q_NULLPTR;
 
     AVCodecContext *m_codecCtx = Q_NULLPTR;
     AVCodecParserContext *m_parser = Q_NULLPTR;
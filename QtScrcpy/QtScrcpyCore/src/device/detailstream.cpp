@@ -0,0 +1,106 @@
+#include <QDebug>
+
+#include "decoder.h"
+#include "demuxer.h"
+#include "detailstream.h"
+
+DetailStream::DetailStream(const FrameCallback &onFrame, const FFmpegLogTag *logTag, QObject *parent) : QObject(parent)
+{
+    m_stream = new Demuxer(this);
+    m_stream->setLogTag(logTag);
+
+    // no parent: moved to the demuxer thread, see Device::Device()
+    m_decoder = new Decoder(onFrame, Q_NULLPTR);
+    m_decoder->setLogTag(logTag);
+    m_decoder->moveToThread(m_stream);
+
+    m_server = new Server(this);
+
+    connect(m_server, &Server::serverStarted, this, [this](bool success, const QString &deviceName, const QSize &size) {
+        Q_UNUSED(deviceName);
+        if (!m_running || m_stopping) {
+            // stopped while connecting
+            return;
+        }
+        if (!success) {
+            m_server->stop();
+            m_running = false;
+            emit started(false, QSize());
+            return;
+        }
+        m_decoder->setFrameSize(size);
+        m_stream->installVideoSocket(m_server->removeVideoSocket());
+        m_stream->setFrameSize(size);
+        m_stream->startDecode();
+        emit started(true, size);
+    });
+    connect(m_server, &Server::serverStoped, this, [this]() {
+        if (m_running && !m_stopping) {
+            stop();
+            emit stopped();
+        }
+    });
+    connect(m_stream, &Demuxer::onStreamStop, this, [this]() {
+        if (m_running && !m_stopping) {
+            stop();
+            emit stopped();
+        }
+    });
+    // Decoder runs in the demuxer thread, see Device::initSignals()
+    connect(m_stream, &Demuxer::getFrame, this, [this](AVPacket *packet) {
+        if (!m_decoder->push(packet)) {
+            qCritical("DetailStream: could not send packet to decoder");
+        }
+    }, Qt::DirectConnection);
+    connect(m_decoder, &Decoder::updateFPS, this, &DetailStream::updateFPS);
+}
+
+DetailStream::~DetailStream()
+{
+    stop();
+    delete m_decoder;
+}
+
+bool DetailStream::start(Server::ServerParams params)
+{
+    if (m_running || m_stream->isFinished()) {
+        return false;
+    }
+    params.control = false;
+    // the main session owns the device settings it restores on exit
+    params.stayAwake = false;
+    m_running = true;
+    qInfo() << "DetailStream: starting" << params.serial << params.maxSize << params.bitRate << params.maxFps
+            << "scid" << QString::number(params.scid, 16);
+    return m_server->start(params);
+}
+
+void DetailStream::stop()
+{
+    if (!m_running || m_stopping) {
+        return;
+    }
+    m_stopping = true;
+    // killing the server closes the video socket, which ends the demuxer thread
+    if (m_server) {
+        m_server->stop();
+    }
+    if (m_stream) {
+        m_stream->stopDecode();
+    }
+    if (m_decoder) {
+        m_decoder->close();
+    }
+    m_running = false;
+    m_stopping = false;
+}
+
+bool DetailStream::isRunning() const
+{
+    return m_running;
+}
+
+AVFrame *DetailStream::refFrame()
+{
+    return m_decoder ? m_decoder->refFrame() : Q_NULLPTR;
+}
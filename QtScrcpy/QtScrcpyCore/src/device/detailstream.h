@@ -0,0 +1,60 @@
+#ifndef DETAILSTREAM_H
+#define DETAILSTREAM_H
+
+#include <functional>
+
+#include <QObject>
+#include <QPointer>
+#include <QSize>
+
+#include "server.h"
+
+// forward declarations
+typedef struct AVFrame AVFrame;
+struct FFmpegLogTag;
+
+class Decoder;
+class Demuxer;
+
+/**
+ * DetailStream - A second, video only scrcpy session of a device that is already streaming
+ *
+ * The scrcpy server runs one session per scid, so a device can serve the low bitrate grid
+ * stream and a full resolution one at the same time. The detail session is started with
+ * control=false on its own scid and borrows the local port of the main session, which
+ * only holds it while connecting. It has its own Server, Demuxer and Decoder (moved to the
+ * demuxer thread, like the main decoder); frames go to the callback from that thread.
+ */
+class DetailStream : public QObject
+{
+    Q_OBJECT
+public:
+    typedef std::function<void(int width, int height, uint8_t *dataY, uint8_t *dataU, uint8_t *dataV, int linesizeY, int linesizeU, int linesizeV)> FrameCallback;
+
+    DetailStream(const FrameCallback &onFrame, const FFmpegLogTag *logTag, QObject *parent = Q_NULLPTR);
+    virtual ~DetailStream();
+
+    // once per instance, control is forced off; reported by started()
+    bool start(Server::ServerParams params);
+    // blocks until the demuxer thread is gone, no callback runs after it returns
+    void stop();
+    bool isRunning() const;
+
+    // refcounted snapshot of the last decoded frame, nullptr before the first one
+    AVFrame *refFrame();
+
+signals:
+    void started(bool success, const QSize &size);
+    // the session ended on its own (server process or socket gone)
+    void stopped();
+    void updateFPS(quint32 fps);
+
+private:
+    QPointer<Server> m_server;
+    QPointer<Demuxer> m_stream;
+    Decoder *m_decoder = Q_NULLPTR; // lives in the demuxer thread, deleted by stop()
+    bool m_running = false;
+    bool m_stopping = false;
+};
+
+#endif // DETAILSTREAM_H
@@ -4,15 +4,48 @@
 
 #include "controller.h"
 #include "devicemsg.h"
+#include "devicemetrics.h"
+#include "devicemsgparser.h"
 #include "decoder.h"
+#include "detailstream.h"
 #include "device.h"
+#include "ffmpeglog.h"
 #include "filehandler.h"
+#include "latencyprobe.h"
+#include "packetring.h"
 #include "recorder.h"
+#include "screenshotengine.h"
 #include "server.h"
+#include "stagelatency.h"
 #include "demuxer.h"
 
+// the detail session's scid, distinct from the random 1-10000 main ones
+#define DETAIL_STREAM_SCID_OFFSET 0x10000
+
 namespace qsc {
 
+static Server::ServerParams serverParams(const DeviceParams &deviceParams)
+{
+    Server::ServerParams params;
+    params.serverLocalPath = deviceParams.serverLocalPath;
+    params.serverRemotePath = deviceParams.serverRemotePath;
+    params.serial = deviceParams.serial;
+    params.localPort = deviceParams.localPort;
+    params.maxSize = deviceParams.maxSize;
+    params.bitRate = deviceParams.bitRate;
+    params.maxFps = deviceParams.maxFps;
+    params.useReverse = deviceParams.useReverse;
+    params.captureOrientationLock = deviceParams.captureOrientationLock;
+    params.captureOrientation = deviceParams.captureOrientation;
+    params.stayAwake = deviceParams.stayAwake;
+    params.serverVersion = deviceParams.serverVersion;
+    params.logLevel = deviceParams.logLevel;
+    params.codecOptions = deviceParams.codecOptions;
+    params.codecName = deviceParams.codecName;
+    params.scid = deviceParams.scid;
+    return params;
+}
+
 Device::Device(DeviceParams params, QObject *parent) : IDevice(parent), m_params(params)
 {
     qInfo() << "========================================";
@@ -22,7 +55,7 @@ Device::Device(DeviceParams params, QObject *parent) : IDevice(parent), m_params
     qInfo() << "  RecordFile:" << params.recordFile;
     qInfo() << "========================================";
 
-    if (!params.display && !m_params.recordFile) {
+    if (!params.display && !m_params.recordFile && params.clipBufferSeconds <= 0) {
         qCritical("not display must be recorded");
         return;
     }
@@ -31,6 +64,14 @@ Device::Device(DeviceParams params, QObject *parent) : IDevice(parent), m_params
     m_stream = new Demuxer(this);
     qInfo() << "Device: Demuxer created successfully";
 
+    // process-lifetime histograms, shared with the render side through the serial
+    StageLatency *stageLatency = StageLatencyRegistry::instance().device(params.serial);
+    m_stream->setStageLatency(stageLatency);
+    const FFmpegLogTag *logTag = FFmpegLog::tag(params.serial);
+    m_stream->setLogTag(logTag);
+    m_metrics = DeviceMetricsRegistry::instance().device(params.serial);
+    m_stream->setDeviceMetrics(m_metrics);
+
     if (params.display) {
         qInfo() << "Device: Creating Decoder WITHOUT parent for moveToThread()...";
         // CRITICAL: Create Decoder WITHOUT parent so it can be moved to another thread
@@ -49,13 +90,17 @@ Device::Device(DeviceParams params, QObject *parent) : IDevice(parent), m_params
             // Thread-safe access to observers using mutex
             QMutexLocker locker(&m_observersMutex);
 
+            m_frameSize = QSize(width, height);
+            if (m_detailFrames) {
+                // still decoded, so detaching the detail stream shows this one at once
+                return;
+            }
+
             if (m_deviceObservers.empty()) {
                 qWarning() << "Device: No observers registered for video frames (serial:" << m_params.serial << ")";
                 return;
             }
 
-            qInfo() << "Device: Dispatching frame to" << m_deviceObservers.size() << "observers for:" << m_params.serial;
-
             // Dispatch frame to all observers
             for (const auto& item : m_deviceObservers) {
                 item->onFrame(width, height, dataY, dataU, dataV, linesizeY, linesizeU, linesizeV);
@@ -84,7 +129,19 @@ Device::Device(DeviceParams params, QObject *parent) : IDevice(parent), m_params
 
             return m_server->getControlSocket()->write(buffer.data(), buffer.length());
         }, params.gameScript, this);
+        m_deviceMsgParser = new DeviceMsgParser(this);
         qInfo() << "Device: Controller created successfully";
+
+        m_decoder->setStageLatency(stageLatency);
+        m_decoder->setDeviceMetrics(m_metrics);
+        m_decoder->setLogTag(logTag);
+
+        if (LatencyProbe::isEnabled()) {
+            m_latencyProbe = new LatencyProbe(params.serial);
+            m_controller->setLatencyProbe(m_latencyProbe);
+            m_decoder->setLatencyProbe(m_latencyProbe);
+            qInfo() << "Device: Latency probe enabled for:" << params.serial;
+        }
     }
 
     qInfo() << "Device: Creating Server...";
@@ -112,9 +169,22 @@ Device::Device(DeviceParams params, QObject *parent) : IDevice(parent), m_params
         }
         qInfo() << "Device: Creating Recorder...";
         m_recorder = new Recorder(absFilePath, this);
+        if (params.recordSegmentSeconds > 0) {
+            m_recorder->setSegmentation(params.recordSegmentSeconds, params.recordSegmentCount);
+        }
+        connect(m_recorder, &Recorder::exportFinished, this, [this](const QString &filePath, bool success) {
+            emit recordingExported(m_params.serial, filePath, success);
+        });
         qInfo() << "Device: Recorder created successfully";
     }
 
+    if (params.clipBufferSeconds > 0) {
+        m_clipRing = new PacketRing(params.clipBufferSeconds, this);
+        connect(m_clipRing, &PacketRing::dumped, this, [this](const QString &filePath, bool success) {
+            emit clipSaved(m_params.serial, filePath, success);
+        });
+    }
+
     qInfo() << "Device: Calling initSignals()...";
     initSignals();
     qInfo() << "Device: initSignals() completed";
@@ -128,6 +198,18 @@ Device::Device(DeviceParams params, QObject *parent) : IDevice(parent), m_params
 Device::~Device()
 {
     Device::disconnectDevice();
+
+    if (m_latencyProbe) {
+        // the demuxer thread is stopped, nothing reports to the probe anymore
+        if (m_controller) {
+            m_controller->setLatencyProbe(Q_NULLPTR);
+        }
+        if (m_decoder) {
+            m_decoder->setLatencyProbe(Q_NULLPTR);
+        }
+        delete m_latencyProbe;
+        m_latencyProbe = Q_NULLPTR;
+    }
 }
 
 void Device::setUserData(void *data)
@@ -179,14 +261,101 @@ void Device::updateScript(QString script)
 
 void Device::screenshot()
 {
-    if (!m_decoder) {
+    if (m_params.recordPath.isEmpty()) {
+        qWarning() << "please select record save path!!!";
         return;
     }
+    saveScreenshot(m_params.recordPath, "png", 100);
+}
 
-    // screenshot
-    m_decoder->peekFrame([this](int width, int height, uint8_t* dataRGB32) {
-       saveFrame(width, height, dataRGB32);
+void Device::exportRecording(int lastSeconds, const QString &filePath)
+{
+    if (!m_recorder || !m_recorder->isSegmented()) {
+        qWarning() << "exportRecording: rolling recording is not enabled for" << m_params.serial;
+        emit recordingExported(m_params.serial, filePath, false);
+        return;
+    }
+    m_recorder->exportRecent(lastSeconds, filePath);
+}
+
+bool Device::saveClip(const QString &filePath)
+{
+    if (!m_clipRing) {
+        qWarning() << "saveClip: clip buffer is not enabled for" << m_params.serial;
+        return false;
+    }
+    return m_clipRing->dump(filePath);
+}
+
+bool Device::attachDetailStream(quint16 maxSize, quint32 bitRate, quint32 maxFps)
+{
+    if (!m_serverStartSuccess || !m_decoder) {
+        qWarning() << "attachDetailStream: main stream is not running for" << m_params.serial;
+        return false;
+    }
+    detachDetailStream();
+
+    // the main session released its port once connected, the detail one borrows it
+    Server::ServerParams params = serverParams(m_params);
+    params.maxSize = maxSize;
+    params.bitRate = bitRate;
+    params.maxFps = maxFps;
+    params.scid = static_cast<qint32>((m_params.scid + DETAIL_STREAM_SCID_OFFSET) & 0x7FFFFFFF);
+
+    DetailStream *detail = new DetailStream([this](int width, int height, uint8_t* dataY, uint8_t* dataU, uint8_t* dataV, int linesizeY, int linesizeU, int linesizeV) {
+        QMutexLocker locker(&m_observersMutex);
+        m_detailFrames = true;
+        for (const auto& item : m_deviceObservers) {
+            item->onFrame(width, height, dataY, dataU, dataV, linesizeY, linesizeU, linesizeV);
+        }
+    }, FFmpegLog::tag(m_params.serial), this);
+    m_detailStream = detail;
+
+    connect(detail, &DetailStream::started, this, [this, detail](bool success, const QSize &size) {
+        if (m_detailStream != detail) {
+            return;
+        }
+        if (!success) {
+            qWarning() << "Device: detail stream failed to start for" << m_params.serial;
+            detachDetailStream();
+        }
+        emit detailStreamStarted(m_params.serial, success, size);
+    });
+    connect(detail, &DetailStream::stopped, this, [this, detail]() {
+        if (m_detailStream != detail) {
+            return;
+        }
+        qWarning() << "Device: detail stream stopped for" << m_params.serial;
+        detachDetailStream();
+        emit detailStreamStopped(m_params.serial);
+    });
+    connect(detail, &DetailStream::updateFPS, this, [this](quint32 fps) {
+        QMutexLocker locker(&m_observersMutex);
+        if (!m_detailFrames) {
+            return;
+        }
+        for (const auto& item : m_deviceObservers) {
+            item->updateFPS(fps);
+        }
     });
+
+    return detail->start(params);
+}
+
+void Device::detachDetailStream()
+{
+    if (!m_detailStream) {
+        return;
+    }
+    DetailStream *detail = m_detailStream;
+    m_detailStream = Q_NULLPTR;
+    // joins its demuxer thread, no detail frame reaches the observers after this
+    detail->stop();
+    {
+        QMutexLocker locker(&m_observersMutex);
+        m_detailFrames = false;
+    }
+    detail->deleteLater();
 }
 
 void Device::showTouch(bool show)
@@ -223,6 +392,13 @@ void Device::initSignals()
                 item->grabCursor(grab);
             }
         });
+        connect(m_controller, &Controller::clipboardAcked, this, [this](quint64 sequence) {
+            m_ackedClipboardSequence = sequence;
+            if (sequence != m_sentClipboardSequence) {
+                qDebug() << "Device: stale clipboard ack" << sequence << "expected" << m_sentClipboardSequence << "for:" << m_params.serial;
+            }
+            emit clipboardAcked(m_params.serial, sequence);
+        });
     }
     if (m_fileHandler) {
         connect(m_fileHandler, &FileHandler::fileHandlerResult, this, [this](FileHandler::FILE_HANDLER_RESULT processResult, bool isApk) {
@@ -267,6 +443,18 @@ void Device::initSignals()
                 double diff = m_startTimeCount.elapsed() / 1000.0;
                 qInfo() << QString("server start finish in %1s").arg(diff).toStdString().c_str();
 
+                if (m_clipRing) {
+                    m_clipRing->setFrameSize(size);
+                }
+
+                if (m_metrics) {
+                    m_metrics->connects.fetch_add(1, std::memory_order_relaxed);
+                    m_metrics->connected.store(true, std::memory_order_relaxed);
+                    // decoding + rendering frame, YUV420P
+                    qint64 frameBytes = m_decoder ? static_cast<qint64>(size.width()) * size.height() * 3 / 2 * 2 : 0;
+                    m_metrics->frameBufferBytes.store(frameBytes, std::memory_order_relaxed);
+                }
+
                 // init recorder
                 if (m_recorder) {
                     m_recorder->setFrameSize(size);
@@ -301,20 +489,21 @@ void Device::initSignals()
 
                 // recv device msg
                 connect(m_server->getControlSocket(), &QTcpSocket::readyRead, this, [this](){
-                    if (!m_controller) {
+                    if (!m_controller || !m_deviceMsgParser) {
                         return;
                     }
 
-                    auto controlSocket = m_server->getControlSocket();
-                    while (controlSocket->bytesAvailable()) {
-                        QByteArray byteArray = controlSocket->peek(controlSocket->bytesAvailable());
-                        DeviceMsg deviceMsg;
-                        qint32 consume = deviceMsg.deserialize(byteArray);
-                        if (0 >= consume) {
-                            break;
-                        }
-                        controlSocket->read(consume);
-                        m_controller->recvDeviceMsg(&deviceMsg);
+                    // PERFORMANCE OPTIMIZATION: decode in place from the parser's reusable buffer,
+                    // no peek()/read() copies and no per message allocation
+                    QTcpSocket *controlSocket = m_server->getControlSocket();
+                    bool ok = m_deviceMsgParser->readFrom(controlSocket, [this](DeviceMsg *deviceMsg) {
+                        m_controller->recvDeviceMsg(deviceMsg);
+                    });
+                    if (!ok) {
+                        // the stream lost its framing, whatever follows would be parsed from the middle of a
+                        // message; stop reading device messages, control messages are still sent
+                        qCritical() << "Device: invalid device message, ignoring the rest of the control stream" << m_params.serial;
+                        disconnect(controlSocket, &QTcpSocket::readyRead, this, Q_NULLPTR);
                     }
                 });
 
@@ -341,28 +530,49 @@ void Device::initSignals()
         // Decoder was moved to Demuxer's thread via moveToThread(), so they share the same thread.
         // This ensures FFmpeg codec operations and packet access happen in the correct thread.
         connect(m_stream, &Demuxer::getFrame, this, [this](AVPacket *packet) {
-            qInfo() << "Device: getFrame signal received, calling decoder->push() from thread:" << QThread::currentThreadId();
+            if (m_latencyProbe) {
+                m_latencyProbe->onPacketReceived(packet->pts);
+            }
             if (m_decoder && !m_decoder->push(packet)) {
                 qCritical("Could not send packet to decoder");
             }
 
-            if (m_recorder && !m_recorder->push(packet)) {
+            if (m_recorder && !m_recorder->push(packet) && !m_recorderFailed) {
+                // every later packet is rejected too, report the failure once
+                m_recorderFailed = true;
                 qCritical("Could not send packet to recorder");
             }
+            if (m_clipRing) {
+                m_clipRing->push(packet);
+            }
+            if (m_metrics) {
+                m_metrics->packetsReceived.fetch_add(1, std::memory_order_relaxed);
+                m_metrics->bytesReceived.fetch_add(static_cast<quint64>(packet->size), std::memory_order_relaxed);
+                if (m_clipRing) {
+                    m_metrics->clipBufferBytes.store(m_clipRing->bufferedBytes(), std::memory_order_relaxed);
+                }
+            }
         }, Qt::DirectConnection); // DirectConnection is safe now - Decoder is in Demuxer's thread!
         connect(m_stream, &Demuxer::getConfigFrame, this, [this](AVPacket *packet) {
             // Config packets are for recorder only (file header)
             // The decoder receives SPS/PPS concatenated with first frame via getFrame signal
             qInfo() << "Device: getConfigFrame signal received, sending to recorder only...";
-            if (m_recorder && !m_recorder->push(packet)) {
+            if (m_recorder && !m_recorder->push(packet) && !m_recorderFailed) {
+                m_recorderFailed = true;
                 qCritical("Could not send config packet to recorder");
             }
+            if (m_clipRing) {
+                m_clipRing->push(packet);
+            }
         }, Qt::DirectConnection);
     }
 
     if (m_decoder) {
         connect(m_decoder, &Decoder::updateFPS, this, [this](quint32 fps) {
             QMutexLocker locker(&m_observersMutex);
+            if (m_detailFrames) {
+                return;
+            }
             for (const auto& item : m_deviceObservers) {
                 item->updateFPS(fps);
             }
@@ -399,23 +609,7 @@ bool Device::connectDevice()
         //m_server->start("192.168.0.174:5555", 27183, m_maxSize, m_bitRate, "");
         // only one devices, serial can be null
         // mark: crop input format: "width:height:x:y" or "" for no crop, for example: "100:200:0:0"
-        Server::ServerParams params;
-        params.serverLocalPath = m_params.serverLocalPath;
-        params.serverRemotePath = m_params.serverRemotePath;
-        params.serial = m_params.serial;
-        params.localPort = m_params.localPort;
-        params.maxSize = m_params.maxSize;
-        params.bitRate = m_params.bitRate;
-        params.maxFps = m_params.maxFps;
-        params.useReverse = m_params.useReverse;
-        params.captureOrientationLock = m_params.captureOrientationLock;
-        params.captureOrientation = m_params.captureOrientation;
-        params.stayAwake = m_params.stayAwake;
-        params.serverVersion = m_params.serverVersion;
-        params.logLevel = m_params.logLevel;
-        params.codecOptions = m_params.codecOptions;
-        params.codecName = m_params.codecName;
-        params.scid = m_params.scid;
+        Server::ServerParams params = serverParams(m_params);
 
         params.crop = "";
         params.control = true;
@@ -444,6 +638,7 @@ void Device::disconnectDevice()
     if (!m_server) {
         return;
     }
+    detachDetailStream();
     m_server->stop();
     m_server = Q_NULLPTR;
 
@@ -457,13 +652,18 @@ void Device::disconnectDevice()
     }
 
     if (m_recorder) {
-        if (m_recorder->isRunning()) {
-            m_recorder->stopRecorder();
-            m_recorder->wait();
-        }
+        // blocks until the mux worker has written everything queued for this device
+        m_recorder->stopRecorder();
         m_recorder->close();
     }
 
+    if (m_metrics) {
+        m_metrics->connected.store(false, std::memory_order_relaxed);
+        m_metrics->frameBufferBytes.store(0, std::memory_order_relaxed);
+        m_metrics->clipBufferBytes.store(0, std::memory_order_relaxed);
+        m_metrics->socketBacklogBytes.store(0, std::memory_order_relaxed);
+    }
+
     if (m_serverStartSuccess) {
         emit deviceDisconnected(m_params.serial);
     }
@@ -722,7 +922,7 @@ void Device::mouseEvent(const QMouseEvent *from, const QSize &frameSize, const Q
     if (!m_controller) {
         return;
     }
-    m_controller->mouseEvent(from, frameSize, showSize);
+    m_controller->mouseEvent(from, controlFrameSize(frameSize), showSize);
 
     QMutexLocker locker(&m_observersMutex);
     for (const auto& item : m_deviceObservers) {
@@ -735,7 +935,7 @@ void Device::wheelEvent(const QWheelEvent *from, const QSize &frameSize, const Q
     if (!m_controller) {
         return;
     }
-    m_controller->wheelEvent(from, frameSize, showSize);
+    m_controller->wheelEvent(from, controlFrameSize(frameSize), showSize);
 
     QMutexLocker locker(&m_observersMutex);
     for (const auto& item : m_deviceObservers) {
@@ -748,7 +948,7 @@ void Device::keyEvent(const QKeyEvent *from, const QSize &frameSize, const QSize
     if (!m_controller) {
         return;
     }
-    m_controller->keyEvent(from, frameSize, showSize);
+    m_controller->keyEvent(from, controlFrameSize(frameSize), showSize);
 
     QMutexLocker locker(&m_observersMutex);
     for (const auto& item : m_deviceObservers) {
@@ -756,6 +956,16 @@ void Device::keyEvent(const QKeyEvent *from, const QSize &frameSize, const QSize
     }
 }
 
+QSize Device::controlFrameSize(const QSize &frameSize)
+{
+    // the server drops events whose frame size is not the one of its own session
+    QMutexLocker locker(&m_observersMutex);
+    if (m_detailFrames && m_frameSize.isValid()) {
+        return m_frameSize;
+    }
+    return frameSize;
+}
+
 bool Device::isCurrentCustomKeymap()
 {
     if (!m_controller) {
@@ -764,36 +974,58 @@ bool Device::isCurrentCustomKeymap()
     return m_controller->isCurrentCustomKeymap();
 }
 
-bool Device::saveFrame(int width, int height, uint8_t* dataRGB32)
+void Device::postEncodedControl(const QByteArray &encoded, quint64 clipboardSequence)
+{
+    if (!m_controller) {
+        return;
+    }
+    if (0 != clipboardSequence) {
+        m_sentClipboardSequence = clipboardSequence;
+    }
+    m_controller->postEncodedControl(encoded);
+}
+
+quint64 Device::getAckedClipboardSequence() const
 {
-    if (!dataRGB32) {
+    return m_ackedClipboardSequence;
+}
+
+bool Device::saveScreenshot(const QString &dirPath, const QByteArray &format, int quality)
+{
+    if (!m_decoder || dirPath.isEmpty()) {
         return false;
     }
 
-    QImage rgbImage(dataRGB32, width, height, QImage::Format_RGB32);
+    // only a refcount bump here, conversion and encoding happen on the engine's workers
+    AVFrame *frame = Q_NULLPTR;
+    if (m_detailStream) {
+        // the full resolution one while it is attached
+        frame = m_detailStream->refFrame();
+    }
+    if (!frame) {
+        frame = m_decoder->refFrame();
+    }
+    if (!frame) {
+        qWarning() << "screenshot: no frame decoded yet for" << m_params.serial;
+        return false;
+    }
 
-    // save
-    QString absFilePath;
-    QString fileDir(m_params.recordPath);
-    if (fileDir.isEmpty()) {
-        qWarning() << "please select record save path!!!";
+    QDir dir(dirPath);
+    if (!dir.exists() && !dir.mkpath(dirPath)) {
+        qCritical() << QString("Failed to create the save folder: %1").arg(dirPath);
+        av_frame_free(&frame);
         return false;
     }
+
+    QByteArray resolvedFormat = ScreenshotEngine::resolveFormat(format);
     QDateTime dateTime = QDateTime::currentDateTime();
     QString fileName = dateTime.toString("_yyyyMMdd_hhmmss_zzz");
     fileName = m_params.serial + fileName;
     fileName.replace(":", "_");
     fileName.replace(".", "_");
-    fileName += ".png";
-    QDir dir(fileDir);
-    absFilePath = dir.absoluteFilePath(fileName);
-    int ret = rgbImage.save(absFilePath, "PNG", 100);
-    if (!ret) {
-        return false;
-    }
+    fileName += "." + QString::fromLatin1(resolvedFormat);
 
-    qInfo() << "screenshot save to " << absFilePath;
-    return true;
+    return ScreenshotEngine::instance().submit(m_params.serial, frame, dir.absoluteFilePath(fileName), resolvedFormat, quality);
 }
 
 }
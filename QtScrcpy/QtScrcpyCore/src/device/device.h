@@ -16,14 +16,20 @@ class Recorder;
 class Server;
 class VideoBuffer;
 class Decoder;
+class DetailStream;
 class FileHandler;
 class Demuxer;
 class VideoForm;
 class Controller;
+class DeviceMsgParser;
+class LatencyProbe;
+class PacketRing;
 struct AVFrame;
 
 namespace qsc {
 
+struct DeviceMetrics;
+
 class Device : public IDevice
 {
     Q_OBJECT
@@ -67,6 +73,10 @@ public:
 
     void screenshot() override;
     void showTouch(bool show) override;
+    void exportRecording(int lastSeconds, const QString &filePath) override;
+    bool saveClip(const QString &filePath) override;
+    bool attachDetailStream(quint16 maxSize, quint32 bitRate, quint32 maxFps) override;
+    void detachDetailStream() override;
 
     bool isReversePort(quint16 port) override;
     const QString &getSerial() override;
@@ -74,9 +84,20 @@ public:
     void updateScript(QString script) override;
     bool isCurrentCustomKeymap() override;
 
+    // queue a payload encoded once for a whole group (see IDeviceManage::broadcastClipboard)
+    void postEncodedControl(const QByteArray &encoded, quint64 clipboardSequence = 0);
+    quint64 getAckedClipboardSequence() const;
+
+    // snapshot the last frame and hand it to ScreenshotEngine, returns false if there is no frame yet
+    bool saveScreenshot(const QString &dirPath, const QByteArray &format, int quality);
+
+signals:
+    void clipboardAcked(const QString &serial, quint64 sequence);
+
 private:
     void initSignals();
-    bool saveFrame(int width, int height, uint8_t* dataRGB32);
+    // input is mapped to the main session's frame size, whatever stream is shown
+    QSize controlFrameSize(const QSize &frameSize);
 
 private:
     // server relevant
@@ -84,16 +105,30 @@ private:
     bool m_serverStartSuccess = false;
     QPointer<Decoder> m_decoder;
     QPointer<Controller> m_controller;
+    QPointer<DeviceMsgParser> m_deviceMsgParser;
     QPointer<FileHandler> m_fileHandler;
     QPointer<Demuxer> m_stream;
     QPointer<Recorder> m_recorder;
+    bool m_recorderFailed = false; // demuxer thread only, push() failure already logged
+    QPointer<PacketRing> m_clipRing;
+    QPointer<DetailStream> m_detailStream;
+    // only with QTSCRCPY_LATENCY_PROBE set, shared by controller and decoder
+    LatencyProbe *m_latencyProbe = Q_NULLPTR;
+    DeviceMetrics *m_metrics = Q_NULLPTR; // owned by DeviceMetricsRegistry
 
     QElapsedTimer m_startTimeCount;
     DeviceParams m_params;
     std::set<DeviceObserver*> m_deviceObservers;
     mutable QMutex m_observersMutex; // Protects m_deviceObservers from concurrent access
+    // both guarded by m_observersMutex
+    bool m_detailFrames = false; // the observers get the detail stream's frames
+    QSize m_frameSize;           // last frame of the main stream
     bool m_firstFrameDecoded = false; // Per-device flag (NOT static)
     void* m_userData = nullptr;
+
+    // clipboard broadcast tracking
+    quint64 m_sentClipboardSequence = 0;
+    quint64 m_ackedClipboardSequence = 0;
 };
 
 }
@@ -203,8 +203,11 @@ void DeviceConnectionPool::cleanup()
 
 StreamQualityProfile DeviceConnectionPool::getOptimalStreamSettings(int totalDeviceCount)
 {
-    QualityTier tier = getQualityTier(totalDeviceCount);
+    return getTierProfile(getQualityTier(totalDeviceCount));
+}
 
+StreamQualityProfile DeviceConnectionPool::getTierProfile(QualityTier tier)
+{
     switch (tier) {
     case TIER_ULTRA:
         return StreamQualityProfile(1080, 8000000, 60, "Ultra (1-5 devices)");
@@ -88,6 +88,7 @@ public:
     // Quality management
     StreamQualityProfile getOptimalStreamSettings(int totalDeviceCount);
     QualityTier getQualityTier(int deviceCount);
+    StreamQualityProfile getTierProfile(QualityTier tier);
     void applyQualityProfile(DeviceParams& params, const StreamQualityProfile& profile);
 
     // Statistics and monitoring
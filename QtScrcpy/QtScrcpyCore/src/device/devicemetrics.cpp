@@ -0,0 +1,57 @@
+#include <QMutexLocker>
+#include <QtAlgorithms>
+
+#include "devicemetrics.h"
+
+namespace qsc {
+
+DeviceMetrics::DeviceMetrics()
+    : packetsReceived(0)
+    , bytesReceived(0)
+    , framesRendered(0)
+    , framesSkipped(0)
+    , framesUnchanged(0)
+    , connects(0)
+    , connected(false)
+    , fps(0)
+    , frameBufferBytes(0)
+    , clipBufferBytes(0)
+    , socketBacklogBytes(0)
+{
+}
+
+DeviceMetricsRegistry::DeviceMetricsRegistry() {}
+
+DeviceMetricsRegistry::~DeviceMetricsRegistry()
+{
+    qDeleteAll(m_devices);
+}
+
+DeviceMetricsRegistry &DeviceMetricsRegistry::instance()
+{
+    static DeviceMetricsRegistry registry;
+    return registry;
+}
+
+DeviceMetrics *DeviceMetricsRegistry::device(const QString &serial)
+{
+    if (serial.isEmpty()) {
+        return Q_NULLPTR;
+    }
+    QMutexLocker locker(&m_mutex);
+    DeviceMetrics *&metrics = m_devices[serial];
+    if (!metrics) {
+        metrics = new DeviceMetrics();
+    }
+    return metrics;
+}
+
+QStringList DeviceMetricsRegistry::serials() const
+{
+    QMutexLocker locker(&m_mutex);
+    QStringList serials = m_devices.keys();
+    serials.sort();
+    return serials;
+}
+
+}
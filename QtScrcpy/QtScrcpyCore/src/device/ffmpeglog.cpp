@@ -0,0 +1,166 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include <QByteArray>
+#include <QDebug>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+
+extern "C"
+{
+#include "libavcodec/avcodec.h"
+#include "libavutil/log.h"
+}
+
+#include "ffmpeglog.h"
+
+#define FFMPEG_LOG_LINE_SIZE 1024
+// a line repeating for longer than this is summarized anyway
+#define FFMPEG_LOG_REPEAT_REPORT_MS 5000
+#define FFMPEG_LOG_TAG_MAGIC 0x51534c54 // "QSLT"
+
+struct FFmpegLogTag
+{
+    quint32 magic;
+    QByteArray serial;
+};
+
+namespace
+{
+// everything a thread needs to format and deduplicate, no allocation per line
+struct ThreadLogState
+{
+    char line[FFMPEG_LOG_LINE_SIZE];
+    char last[FFMPEG_LOG_LINE_SIZE];
+    const char *lastSerial = nullptr;
+    int lastLevel = AV_LOG_QUIET;
+    quint32 repeats = 0;
+    qint64 lastReportMs = 0;
+    int printPrefix = 1;
+};
+}
+
+static thread_local ThreadLogState t_state;
+
+static qint64 steadyMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// the serial carried by an AVCodecContext, nullptr for any other context
+static const char *contextSerial(void *avcl)
+{
+    if (!avcl) {
+        return nullptr;
+    }
+    const AVClass *avClass = *static_cast<const AVClass **>(avcl);
+    if (!avClass || !avClass->class_name || strcmp(avClass->class_name, "AVCodecContext") != 0) {
+        return nullptr;
+    }
+    const FFmpegLogTag *tag = static_cast<const FFmpegLogTag *>(static_cast<AVCodecContext *>(avcl)->opaque);
+    if (!tag || tag->magic != FFMPEG_LOG_TAG_MAGIC) {
+        return nullptr;
+    }
+    return tag->serial.constData();
+}
+
+static void forward(int level, const char *serial, const char *text)
+{
+    // FFmpeg "fatal" is fatal for its context, not for the farm: never qFatal()
+    switch (level) {
+    case AV_LOG_PANIC:
+    case AV_LOG_FATAL:
+    case AV_LOG_ERROR:
+        qCritical("[FFmpeg] [%s] %s", serial, text);
+        break;
+    case AV_LOG_WARNING:
+        qWarning("[FFmpeg] [%s] %s", serial, text);
+        break;
+    default:
+        qInfo("[FFmpeg] [%s] %s", serial, text);
+        break;
+    }
+}
+
+static void flushRepeats(ThreadLogState &state, qint64 nowMs)
+{
+    if (state.repeats == 0) {
+        return;
+    }
+    char summary[64];
+    snprintf(summary, sizeof(summary), "last message repeated %u times", state.repeats);
+    forward(state.lastLevel, state.lastSerial, summary);
+    state.repeats = 0;
+    state.lastReportMs = nowMs;
+}
+
+static void logCallback(void *avcl, int level, const char *fmt, va_list vl)
+{
+    // debug and verbose are too verbose to forward, reject them before formatting
+    if (level > AV_LOG_INFO || level > av_log_get_level()) {
+        return;
+    }
+
+    ThreadLogState &state = t_state;
+    av_log_format_line2(avcl, level, fmt, vl, state.line, sizeof(state.line), &state.printPrefix);
+    size_t length = strlen(state.line);
+    while (length > 0 && (state.line[length - 1] == '\n' || state.line[length - 1] == '\r')) {
+        state.line[--length] = '\0';
+    }
+    if (length == 0) {
+        return;
+    }
+
+    const char *serial = contextSerial(avcl);
+    if (!serial) {
+        serial = "-";
+    }
+    qint64 nowMs = steadyMs();
+
+    if (level == state.lastLevel && serial == state.lastSerial && strcmp(state.line, state.last) == 0) {
+        state.repeats++;
+        if (nowMs - state.lastReportMs >= FFMPEG_LOG_REPEAT_REPORT_MS) {
+            flushRepeats(state, nowMs);
+        }
+        return;
+    }
+
+    flushRepeats(state, nowMs);
+    memcpy(state.last, state.line, length + 1);
+    state.lastLevel = level;
+    state.lastSerial = serial;
+    state.lastReportMs = nowMs;
+    forward(level, serial, state.line);
+}
+
+void FFmpegLog::install()
+{
+    av_log_set_callback(logCallback);
+}
+
+const FFmpegLogTag *FFmpegLog::tag(const QString &serial)
+{
+    if (serial.isEmpty()) {
+        return nullptr;
+    }
+    // never freed: contexts of a disconnected device may still log while they are closed
+    static QMutex mutex;
+    static QHash<QString, FFmpegLogTag *> tags;
+    QMutexLocker locker(&mutex);
+    FFmpegLogTag *&tag = tags[serial];
+    if (!tag) {
+        tag = new FFmpegLogTag;
+        tag->magic = FFMPEG_LOG_TAG_MAGIC;
+        tag->serial = serial.toUtf8();
+    }
+    return tag;
+}
+
+void FFmpegLog::tagContext(AVCodecContext *ctx, const FFmpegLogTag *tag)
+{
+    if (ctx && tag) {
+        ctx->opaque = const_cast<FFmpegLogTag *>(tag);
+    }
+}
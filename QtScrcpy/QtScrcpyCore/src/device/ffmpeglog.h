@@ -0,0 +1,35 @@
+#ifndef FFMPEGLOG_H
+#define FFMPEGLOG_H
+
+#include <QString>
+
+// forward declarations
+typedef struct AVCodecContext AVCodecContext;
+struct FFmpegLogTag;
+
+/**
+ * FFmpegLog - av_log callback of the whole process
+ *
+ * Lines are formatted with av_log_format_line2() into a thread-local fixed buffer, prefixed
+ * with the serial of the device owning the AVCodecContext (carried in its opaque field)
+ * and forwarded to the Qt message handler, i.e. the application's async logger. Levels
+ * above AV_LOG_INFO are rejected before any formatting. A line repeated by the same thread
+ * is counted instead of logged and summarized when the next different line arrives or
+ * after FFMPEG_LOG_REPEAT_REPORT_MS, so a decoder error burst on many devices is a few
+ * lines, not an allocation per packet.
+ */
+class FFmpegLog
+{
+public:
+    static void install();
+
+    // interned, valid for the process lifetime, nullptr for an empty serial
+    static const FFmpegLogTag *tag(const QString &serial);
+    // lines logged through ctx (and its frame threads, which copy opaque) carry the tag
+    static void tagContext(AVCodecContext *ctx, const FFmpegLogTag *tag);
+
+private:
+    FFmpegLog() = delete;
+};
+
+#endif // FFMPEGLOG_H
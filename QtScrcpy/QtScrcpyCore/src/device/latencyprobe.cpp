@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+
+#include "latencyprobe.h"
+
+extern "C"
+{
+#include "libavutil/frame.h"
+}
+
+// luma region compared around the touch point
+#define LATENCY_PROBE_REGION_SIZE 32
+// mean absolute luma difference that counts as a visible change
+#define LATENCY_PROBE_DIFF_THRESHOLD 6
+// give up on a touch that produced no visible change
+#define LATENCY_PROBE_TIMEOUT_US 2000000
+#define LATENCY_PROBE_PACKET_HISTORY 32
+#define LATENCY_PROBE_MAX_SAMPLES 256
+#define LATENCY_PROBE_REPORT_INTERVAL 20
+
+LatencyProbe::LatencyProbe(const QString &serial) : m_serial(serial)
+{
+    m_packetTimes.resize(LATENCY_PROBE_PACKET_HISTORY);
+}
+
+LatencyProbe::~LatencyProbe()
+{
+    if (m_sampleCount > 0) {
+        qInfo().noquote() << report();
+    }
+    av_frame_free(&m_lastFrame);
+}
+
+bool LatencyProbe::isEnabled()
+{
+    static const bool enabled = qEnvironmentVariableIsSet("QTSCRCPY_LATENCY_PROBE");
+    return enabled;
+}
+
+qint64 LatencyProbe::now()
+{
+    static QElapsedTimer clock;
+    static bool started = (clock.start(), true);
+    Q_UNUSED(started);
+    return clock.nsecsElapsed() / 1000;
+}
+
+void LatencyProbe::onTouchSent(const QPoint &framePos, qint64 createdUs, qint64 sentUs)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_armed && sentUs - m_sentUs < LATENCY_PROBE_TIMEOUT_US) {
+        // one measurement at a time, later touches would blur the attribution
+        return;
+    }
+
+    m_armed = true;
+    m_changed = false;
+    m_pos = framePos;
+    m_createdUs = createdUs;
+    m_sentUs = sentUs;
+    m_recvUs = 0;
+    m_decodedUs = 0;
+    m_baseline.clear();
+    if (m_lastFrame) {
+        // the screen as it was when the touch left, empty if nothing was decoded yet
+        sampleRegion(m_lastFrame, m_baseline);
+        av_frame_unref(m_lastFrame);
+    }
+}
+
+void LatencyProbe::onPacketReceived(qint64 pts)
+{
+    qint64 recvUs = now();
+    QMutexLocker locker(&m_mutex);
+    PacketTime &entry = m_packetTimes[m_packetTimesPos];
+    entry.pts = pts;
+    entry.recvUs = recvUs;
+    m_packetTimesPos = (m_packetTimesPos + 1) % m_packetTimes.size();
+}
+
+void LatencyProbe::onFrameDecoded(const AVFrame *frame)
+{
+    if (!frame) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (!m_armed) {
+        keepLastFrame(frame);
+        return;
+    }
+    if (m_changed) {
+        return;
+    }
+
+    qint64 decodedUs = now();
+    if (decodedUs - m_sentUs > LATENCY_PROBE_TIMEOUT_US) {
+        qDebug() << "LatencyProbe: no visible change after touch, sample dropped for:" << m_serial;
+        m_armed = false;
+        return;
+    }
+
+    QByteArray region;
+    if (!sampleRegion(frame, region)) {
+        return;
+    }
+    if (m_baseline.isEmpty()) {
+        // no frame before the touch, the first one after it is the best there is
+        m_baseline = region;
+        return;
+    }
+
+    qint64 diff = 0;
+    const uchar *a = reinterpret_cast<const uchar *>(m_baseline.constData());
+    const uchar *b = reinterpret_cast<const uchar *>(region.constData());
+    for (int i = 0; i < region.size(); ++i) {
+        diff += std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i]));
+    }
+    if (diff < static_cast<qint64>(LATENCY_PROBE_DIFF_THRESHOLD) * region.size()) {
+        return;
+    }
+
+    m_changed = true;
+    m_decodedUs = decodedUs;
+    m_recvUs = decodedUs;
+    if (frame->pts != AV_NOPTS_VALUE) {
+        for (const PacketTime &entry : m_packetTimes) {
+            if (entry.recvUs != 0 && entry.pts == frame->pts) {
+                m_recvUs = entry.recvUs;
+                break;
+            }
+        }
+    }
+}
+
+void LatencyProbe::onFrameRendered()
+{
+    qint64 renderedUs = now();
+    bool reportDue = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_armed || !m_changed) {
+            return;
+        }
+        reportDue = finishSample(renderedUs);
+    }
+    if (reportDue) {
+        qInfo().noquote() << report();
+    }
+}
+
+QString LatencyProbe::report()
+{
+    static const char *names[LS_COUNT] = { "control", "device", "decode", "render", "total" };
+
+    QMutexLocker locker(&m_mutex);
+    QString text = QString("LatencyProbe [%1] %2 samples (p50/p99 ms):").arg(m_serial).arg(m_sampleCount);
+    for (int i = 0; i < LS_COUNT; ++i) {
+        text += QString(" %1 %2/%3")
+                    .arg(names[i])
+                    .arg(percentile(m_samples[i], 50) / 1000.0, 0, 'f', 1)
+                    .arg(percentile(m_samples[i], 99) / 1000.0, 0, 'f', 1);
+    }
+    return text;
+}
+
+bool LatencyProbe::sampleRegion(const AVFrame *frame, QByteArray &region) const
+{
+    const int size = LATENCY_PROBE_REGION_SIZE;
+    if (!frame->data[0] || frame->width < size || frame->height < size) {
+        return false;
+    }
+
+    int x0 = qBound(0, m_pos.x() - size / 2, frame->width - size);
+    int y0 = qBound(0, m_pos.y() - size / 2, frame->height - size);
+    region.resize(size * size);
+    char *dst = region.data();
+    for (int y = 0; y < size; ++y) {
+        memcpy(dst + y * size, frame->data[0] + (y0 + y) * frame->linesize[0] + x0, size);
+    }
+    return true;
+}
+
+void LatencyProbe::keepLastFrame(const AVFrame *frame)
+{
+    if (!m_lastFrame) {
+        m_lastFrame = av_frame_alloc();
+        if (!m_lastFrame) {
+            return;
+        }
+    }
+    av_frame_unref(m_lastFrame);
+    // decoded frames are refcounted, this only takes a reference
+    if (av_frame_ref(m_lastFrame, frame) < 0) {
+        av_frame_unref(m_lastFrame);
+    }
+}
+
+bool LatencyProbe::finishSample(qint64 renderedUs)
+{
+    qint64 stages[LS_COUNT];
+    stages[LS_CONTROL] = m_sentUs - m_createdUs;
+    stages[LS_DEVICE] = m_recvUs - m_sentUs;
+    stages[LS_DECODE] = m_decodedUs - m_recvUs;
+    stages[LS_RENDER] = renderedUs - m_decodedUs;
+    stages[LS_TOTAL] = renderedUs - m_createdUs;
+
+    for (int i = 0; i < LS_COUNT; ++i) {
+        qint64 value = qMax<qint64>(0, stages[i]);
+        if (m_samples[i].size() < LATENCY_PROBE_MAX_SAMPLES) {
+            m_samples[i].append(value);
+        } else {
+            m_samples[i][m_samplePos] = value;
+        }
+    }
+    m_samplePos = (m_samplePos + 1) % LATENCY_PROBE_MAX_SAMPLES;
+    ++m_sampleCount;
+    m_armed = false;
+
+    return 0 == m_sampleCount % LATENCY_PROBE_REPORT_INTERVAL;
+}
+
+qint64 LatencyProbe::percentile(QVector<qint64> values, int pct)
+{
+    if (values.isEmpty()) {
+        return 0;
+    }
+    int idx = qMin(values.size() - 1, (values.size() * pct) / 100);
+    std::nth_element(values.begin(), values.begin() + idx, values.end());
+    return values.at(idx);
+}
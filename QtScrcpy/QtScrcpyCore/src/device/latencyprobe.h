@@ -0,0 +1,98 @@
+#ifndef LATENCYPROBE_H
+#define LATENCYPROBE_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QPoint>
+#include <QString>
+#include <QVector>
+
+// forward declarations
+typedef struct AVFrame AVFrame;
+
+/**
+ * LatencyProbe - Input-to-photon latency instrumentation (per device)
+ *
+ * Enabled with QTSCRCPY_LATENCY_PROBE=1, otherwise every hook is a cheap no-op.
+ *
+ * One touch-down at a time is armed: the luma region around the touch point of the
+ * last frame decoded before the touch is sent becomes the baseline (the first frame
+ * after it may already show the response), and the first later frame whose region
+ * differs is taken as the response. Stages:
+ * - control:  ControlMsg created -> written to the control socket
+ * - device:   written -> first packet of the changed frame received
+ *             (device input, capture, encode and network: no shared clock to split them)
+ * - decode:   packet received -> frame decoded
+ * - render:   frame decoded -> handed to the observers
+ *
+ * A p50/p99 report is logged every LATENCY_PROBE_REPORT_INTERVAL samples.
+ */
+class LatencyProbe
+{
+public:
+    enum Stage
+    {
+        LS_CONTROL = 0,
+        LS_DEVICE,
+        LS_DECODE,
+        LS_RENDER,
+        LS_TOTAL,
+        LS_COUNT
+    };
+
+    explicit LatencyProbe(const QString &serial);
+    ~LatencyProbe();
+
+    static bool isEnabled();
+    // monotonic clock shared by every stage, in microseconds
+    static qint64 now();
+
+    // GUI thread: a touch down at framePos was written to the control socket
+    void onTouchSent(const QPoint &framePos, qint64 createdUs, qint64 sentUs);
+    // demuxer thread
+    void onPacketReceived(qint64 pts);
+    void onFrameDecoded(const AVFrame *frame);
+    void onFrameRendered();
+
+    // "p50/p99" per stage in milliseconds
+    QString report();
+
+private:
+    bool sampleRegion(const AVFrame *frame, QByteArray &region) const;
+    void keepLastFrame(const AVFrame *frame);
+    // returns true when a periodic report is due
+    bool finishSample(qint64 renderedUs);
+    static qint64 percentile(QVector<qint64> values, int pct);
+
+private:
+    QString m_serial;
+    QMutex m_mutex;
+
+    // armed sample
+    bool m_armed = false;
+    bool m_changed = false;
+    QPoint m_pos;
+    qint64 m_createdUs = 0;
+    qint64 m_sentUs = 0;
+    qint64 m_recvUs = 0;
+    qint64 m_decodedUs = 0;
+    QByteArray m_baseline;
+    // reference to the latest frame while disarmed, the baseline of the next touch
+    AVFrame *m_lastFrame = Q_NULLPTR;
+
+    // recent packet arrival times by pts
+    struct PacketTime
+    {
+        qint64 pts = 0;
+        qint64 recvUs = 0;
+    };
+    QVector<PacketTime> m_packetTimes;
+    int m_packetTimesPos = 0;
+
+    // completed samples, ring per stage
+    QVector<qint64> m_samples[LS_COUNT];
+    int m_samplePos = 0;
+    quint64 m_sampleCount = 0;
+};
+
+#endif // LATENCYPROBE_H
@@ -0,0 +1,66 @@
+#include "packetqueue.h"
+
+extern "C"
+{
+#include "libavcodec/avcodec.h"
+}
+
+PacketQueue::PacketQueue(int capacity) : m_head(0), m_tail(0)
+{
+    quint32 size = 2;
+    while (size < static_cast<quint32>(qMax(2, capacity))) {
+        size <<= 1;
+    }
+    m_slots = new AVPacket *[size]();
+    m_mask = size - 1;
+}
+
+PacketQueue::~PacketQueue()
+{
+    clear();
+    delete[] m_slots;
+}
+
+bool PacketQueue::push(AVPacket *packet)
+{
+    const quint32 tail = m_tail.load(std::memory_order_relaxed);
+    const quint32 head = m_head.load(std::memory_order_acquire);
+    if (tail - head > m_mask) {
+        return false;
+    }
+    m_slots[tail & m_mask] = packet;
+    // publish the slot before the new tail
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+AVPacket *PacketQueue::pop()
+{
+    const quint32 head = m_head.load(std::memory_order_relaxed);
+    const quint32 tail = m_tail.load(std::memory_order_acquire);
+    if (head == tail) {
+        return Q_NULLPTR;
+    }
+    AVPacket *packet = m_slots[head & m_mask];
+    m_slots[head & m_mask] = Q_NULLPTR;
+    m_head.store(head + 1, std::memory_order_release);
+    return packet;
+}
+
+void PacketQueue::clear()
+{
+    AVPacket *packet = Q_NULLPTR;
+    while ((packet = pop())) {
+        av_packet_free(&packet);
+    }
+}
+
+int PacketQueue::size() const
+{
+    return static_cast<int>(m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire));
+}
+
+int PacketQueue::capacity() const
+{
+    return static_cast<int>(m_mask + 1);
+}
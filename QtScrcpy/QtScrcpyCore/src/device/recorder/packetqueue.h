@@ -0,0 +1,45 @@
+#ifndef PACKETQUEUE_H
+#define PACKETQUEUE_H
+
+#include <atomic>
+
+#include <QtGlobal>
+
+// forward declarations
+typedef struct AVPacket AVPacket;
+
+/**
+ * PacketQueue - Bounded lock-free single-producer/single-consumer packet queue
+ *
+ * The producer is the demuxer thread of one device, the consumer is the mux worker
+ * that device is assigned to. Neither side takes a lock or wakes the other per packet.
+ * Packets are owned by the queue between push() and pop().
+ */
+class PacketQueue
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit PacketQueue(int capacity);
+    ~PacketQueue();
+
+    // producer: false when full, the caller keeps ownership of packet
+    bool push(AVPacket *packet);
+    // consumer: nullptr when empty
+    AVPacket *pop();
+    // consumer: drop and free everything queued
+    void clear();
+
+    // approximate when called concurrently
+    int size() const;
+    int capacity() const;
+
+private:
+    Q_DISABLE_COPY(PacketQueue)
+
+    AVPacket **m_slots = Q_NULLPTR;
+    quint32 m_mask = 0;
+    std::atomic<quint32> m_head; // next slot to pop, written by the consumer only
+    std::atomic<quint32> m_tail; // next slot to push, written by the producer only
+};
+
+#endif // PACKETQUEUE_H
@@ -0,0 +1,201 @@
+#include <QDebug>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QVector>
+
+#include "packetring.h"
+#include "recorder.h"
+
+extern "C"
+{
+#include "libavcodec/avcodec.h"
+}
+
+// hard limit whatever the window, a high bitrate device with a long GOP must not eat the RAM
+#define PACKET_RING_MAX_BYTES (64 * 1024 * 1024)
+
+class PacketRingDumpJob : public QRunnable
+{
+public:
+    PacketRingDumpJob(PacketRing *ring, const QVector<AVPacket *> &packets, const QString &filePath, const QSize &frameSize)
+        : m_ring(ring), m_packets(packets), m_filePath(filePath), m_frameSize(frameSize)
+    {
+    }
+
+    void run() override
+    {
+        bool ok = false;
+        {
+            Recorder recorder(m_filePath);
+            recorder.setFrameSize(m_frameSize);
+            ok = recorder.writeClip(m_packets);
+        }
+        for (AVPacket *packet : m_packets) {
+            av_packet_free(&packet);
+        }
+        m_packets.clear();
+
+        if (ok) {
+            qInfo() << "PacketRing: clip saved to" << m_filePath;
+        } else {
+            qWarning() << "PacketRing: could not save clip to" << m_filePath;
+        }
+        emit m_ring->dumped(m_filePath, ok);
+
+        // last access: the ring may be destroyed as soon as the count drops
+        QMutexLocker locker(&m_ring->m_mutex);
+        m_ring->m_dumpsRunning--;
+        m_ring->m_dumpsCond.wakeAll();
+    }
+
+private:
+    PacketRing *m_ring = Q_NULLPTR;
+    QVector<AVPacket *> m_packets;
+    QString m_filePath;
+    QSize m_frameSize;
+};
+
+PacketRing::PacketRing(int seconds, QObject *parent) : QObject(parent), m_windowUs(qMax(1, seconds) * 1000000LL) {}
+
+PacketRing::~PacketRing()
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_dumpsRunning > 0) {
+        m_dumpsCond.wait(&m_mutex);
+    }
+    clearPackets();
+    if (m_config) {
+        av_packet_free(&m_config);
+    }
+}
+
+void PacketRing::setFrameSize(const QSize &frameSize)
+{
+    QMutexLocker locker(&m_mutex);
+    m_frameSize = frameSize;
+}
+
+void PacketRing::push(const AVPacket *packet)
+{
+    AVPacket *ref = av_packet_clone(packet);
+    if (!ref) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (ref->pts == AV_NOPTS_VALUE) {
+        // a new config (e.g. after a rotation) makes the buffered packets undecodable
+        clearPackets();
+        if (m_config) {
+            av_packet_free(&m_config);
+        }
+        m_config = ref;
+        return;
+    }
+
+    const bool keyframe = ref->flags & AV_PKT_FLAG_KEY;
+    if (m_packets.isEmpty() && !keyframe) {
+        // wait for a keyframe to start from
+        av_packet_free(&ref);
+        return;
+    }
+
+    m_packets.enqueue(ref);
+    m_bytes += ref->size;
+    if (keyframe) {
+        m_keyframePts.enqueue(ref->pts);
+    }
+
+    // drop a GOP only if the ones after it still cover the window
+    while (m_keyframePts.size() >= 2 && (ref->pts - m_keyframePts.at(1) >= m_windowUs || m_bytes > PACKET_RING_MAX_BYTES)) {
+        dropOldestGop();
+    }
+    if (m_bytes > PACKET_RING_MAX_BYTES) {
+        // a single GOP over the limit, start again at the next keyframe
+        qWarning() << "PacketRing: GOP larger than" << PACKET_RING_MAX_BYTES << "bytes, clip buffer reset";
+        clearPackets();
+    }
+}
+
+void PacketRing::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    clearPackets();
+}
+
+int PacketRing::bufferedMs() const
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_packets.isEmpty()) {
+        return 0;
+    }
+    return static_cast<int>((m_packets.last()->pts - m_packets.head()->pts) / 1000);
+}
+
+qint64 PacketRing::bufferedBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_bytes;
+}
+
+bool PacketRing::dump(const QString &filePath)
+{
+    QString suffix = QFileInfo(filePath).suffix().toLower();
+    if (suffix != "mp4" && suffix != "mkv") {
+        qWarning() << "PacketRing: clips are written as .mp4 or .mkv:" << filePath;
+        return false;
+    }
+
+    QVector<AVPacket *> packets;
+    QSize frameSize;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_config || m_packets.isEmpty()) {
+            return false;
+        }
+        // new references only, the payloads are shared with the ring
+        packets.reserve(m_packets.size() + 1);
+        packets.append(av_packet_clone(m_config));
+        for (AVPacket *packet : m_packets) {
+            packets.append(av_packet_clone(packet));
+        }
+        frameSize = m_frameSize;
+        m_dumpsRunning++;
+    }
+
+    if (packets.contains(Q_NULLPTR)) {
+        for (AVPacket *packet : packets) {
+            av_packet_free(&packet);
+        }
+        QMutexLocker locker(&m_mutex);
+        m_dumpsRunning--;
+        m_dumpsCond.wakeAll();
+        return false;
+    }
+
+    QThreadPool::globalInstance()->start(new PacketRingDumpJob(this, packets, filePath, frameSize));
+    return true;
+}
+
+void PacketRing::dropOldestGop()
+{
+    m_keyframePts.dequeue();
+    const qint64 nextKeyframe = m_keyframePts.head();
+    while (!m_packets.isEmpty() && m_packets.head()->pts != nextKeyframe) {
+        AVPacket *packet = m_packets.dequeue();
+        m_bytes -= packet->size;
+        av_packet_free(&packet);
+    }
+}
+
+void PacketRing::clearPackets()
+{
+    while (!m_packets.isEmpty()) {
+        AVPacket *packet = m_packets.dequeue();
+        av_packet_free(&packet);
+    }
+    m_keyframePts.clear();
+    m_bytes = 0;
+}
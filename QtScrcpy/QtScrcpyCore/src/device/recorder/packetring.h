@@ -0,0 +1,66 @@
+#ifndef PACKETRING_H
+#define PACKETRING_H
+
+#include <QMutex>
+#include <QObject>
+#include <QQueue>
+#include <QSize>
+#include <QString>
+#include <QWaitCondition>
+
+// forward declarations
+typedef struct AVPacket AVPacket;
+
+class PacketRingDumpJob;
+
+/**
+ * PacketRing - The last seconds of one device's compressed stream, kept in memory
+ *
+ * The ring always starts at a keyframe and drops whole GOPs from the front once the
+ * newer ones still cover the window, so a dump is playable from its first frame.
+ * Packets are shared with the demuxer (refcounted, not copied): a few MB per device
+ * instead of continuous disk writes. dump() muxes a snapshot through Recorder on the
+ * global thread pool.
+ */
+class PacketRing : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PacketRing(int seconds, QObject *parent = Q_NULLPTR);
+    virtual ~PacketRing();
+
+    void setFrameSize(const QSize &frameSize);
+    // demuxer thread: keep a reference to packet, config packets replace the current config
+    void push(const AVPacket *packet);
+    void clear();
+    // buffered duration in ms, from the first keyframe to the newest packet
+    int bufferedMs() const;
+    // payload bytes held by the ring
+    qint64 bufferedBytes() const;
+
+    // write the buffered packets to filePath (.mp4 or .mkv), false when there is nothing to write
+    bool dump(const QString &filePath);
+
+signals:
+    // emitted from a pool thread
+    void dumped(const QString &filePath, bool success);
+
+private:
+    friend class PacketRingDumpJob;
+    // m_mutex held
+    void dropOldestGop();
+    void clearPackets();
+
+private:
+    const qint64 m_windowUs;
+    mutable QMutex m_mutex;
+    QWaitCondition m_dumpsCond;
+    QQueue<AVPacket *> m_packets;
+    QQueue<qint64> m_keyframePts; // pts of every keyframe in m_packets, the head is m_packets.head()
+    AVPacket *m_config = Q_NULLPTR;
+    qint64 m_bytes = 0;
+    QSize m_frameSize;
+    int m_dumpsRunning = 0;
+};
+
+#endif // PACKETRING_H
@@ -1,40 +1,73 @@
 #include <QCoreApplication>
 #include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QFileInfo>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThreadPool>
 
 #include "compat.h"
 #include "recorder.h"
+#include "recorderio.h"
+#include "recordingservice.h"
 
 static const AVRational SCRCPY_TIME_BASE = { 1, 1000000 }; // timestamps in us
 
-Recorder::Recorder(const QString &fileName, QObject *parent) : QThread(parent), m_fileName(fileName), m_format(guessRecordFormat(fileName)) {}
-
-Recorder::~Recorder() {}
-
-AVPacket *Recorder::packetNew(const AVPacket *packet)
+// ~68s of backlog at 60fps before the recording is given up
+#define RECORDER_QUEUE_CAPACITY 4096
+// wake the mux worker early instead of waiting for its next flush tick
+#define RECORDER_QUEUE_WAKE_THRESHOLD 64
+// how long an export waits for the mux worker to flush the segment being written
+#define RECORDER_EXPORT_FLUSH_TIMEOUT_MS 2000
+
+Recorder::Recorder(const QString &fileName, QObject *parent)
+    : QObject(parent)
+    , m_fileName(fileName)
+    , m_format(guessRecordFormat(fileName))
+    , m_stopped(false)
+    , m_failed(false)
+    , m_queue(RECORDER_QUEUE_CAPACITY)
+    , m_worker(Q_NULLPTR)
 {
-    AVPacket *rec = av_packet_alloc();
-    if (!rec) {
-        return Q_NULLPTR;
-    }
-
-    if (av_packet_ref(rec, packet)) {
-        delete rec;
-        return Q_NULLPTR;
-    }
-    return rec;
 }
 
-void Recorder::packetDelete(AVPacket *packet)
+class RecorderExportJob : public QRunnable
 {
-    av_packet_unref(packet);
-    av_packet_free(&packet);
-}
+public:
+    RecorderExportJob(Recorder *recorder, int seconds, const QString &filePath) : m_recorder(recorder), m_seconds(seconds), m_filePath(filePath) {}
+
+    void run() override
+    {
+        bool ok = m_recorder->exportSegments(m_seconds, m_filePath);
+        emit m_recorder->exportFinished(m_filePath, ok);
+
+        // last access: the recorder may be destroyed as soon as the count drops
+        QMutexLocker locker(&m_recorder->m_segmentsMutex);
+        m_recorder->m_exportsRunning--;
+        m_recorder->m_exportsCond.wakeAll();
+    }
+
+private:
+    Recorder *m_recorder = Q_NULLPTR;
+    int m_seconds = 0;
+    QString m_filePath;
+};
 
-void Recorder::queueClear()
+Recorder::~Recorder()
 {
-    while (!m_queue.isEmpty()) {
-        packetDelete(m_queue.dequeue());
+    if (m_recording) {
+        stopRecorder();
+    }
+    {
+        QMutexLocker locker(&m_segmentsMutex);
+        while (m_exportsRunning > 0) {
+            m_exportsCond.wait(&m_segmentsMutex);
+        }
+    }
+    if (m_previous) {
+        av_packet_free(&m_previous);
     }
 }
 
@@ -50,6 +83,30 @@ void Recorder::setFormat(Recorder::RecorderFormat format)
 
 bool Recorder::open()
 {
+    if (m_segmentSeconds <= 0) {
+        return openOutput(m_fileName);
+    }
+
+    m_segmentIndex = 0;
+    Segment segment;
+    segment.fileName = segmentFileName(m_segmentIndex);
+    {
+        QMutexLocker locker(&m_segmentsMutex);
+        m_segments.append(segment);
+    }
+    return openOutput(segment.fileName);
+}
+
+void Recorder::close()
+{
+    closeOutput();
+}
+
+bool Recorder::openOutput(const QString &fileName)
+{
+    m_outputFile = fileName;
+    m_headerWritten = false;
+
     // codec
     const AVCodec* inputCodec = avcodec_find_decoder(AV_CODEC_ID_H264);
     if (!inputCodec) {
@@ -102,11 +159,9 @@ bool Recorder::open()
     outStream->codec->height = m_declaredFrameSize.height();
 #endif
 
-    int ret = avio_open(&m_formatCtx->pb, m_fileName.toUtf8().toStdString().c_str(), AVIO_FLAG_WRITE);
-    if (ret < 0) {
-        char errorbuf[255] = { 0 };
-        av_strerror(ret, errorbuf, 254);
-        qCritical() << QString("Failed to open output file: %1 %2").arg(errorbuf).arg(m_fileName).toUtf8().toStdString().c_str();
+    // large sequential writes, see RecorderIO
+    m_formatCtx->pb = RecorderIO::open(fileName);
+    if (!m_formatCtx->pb) {
         // ostream will be cleaned up during context cleaning
         avformat_free_context(m_formatCtx);
         m_formatCtx = Q_NULLPTR;
@@ -116,22 +171,25 @@ bool Recorder::open()
     return true;
 }
 
-void Recorder::close()
+void Recorder::closeOutput()
 {
     if (Q_NULLPTR != m_formatCtx) {
         if (m_headerWritten) {
             int ret = av_write_trailer(m_formatCtx);
             if (ret < 0) {
-                qCritical() << QString("Failed to write trailer to %1").arg(m_fileName).toUtf8().toStdString().c_str();
+                qCritical() << QString("Failed to write trailer to %1").arg(m_outputFile).toUtf8().toStdString().c_str();
                 m_failed = true;
             } else {
-                qInfo() << QString("success record %1").arg(m_fileName).toStdString().c_str();
+                qInfo() << QString("success record %1").arg(m_outputFile).toStdString().c_str();
             }
         } else {
             // the recorded file is empty
             m_failed = true;
         }
-        avio_close(m_formatCtx->pb);
+        if (!RecorderIO::close(&m_formatCtx->pb)) {
+            qCritical() << QString("Failed to flush %1").arg(m_outputFile).toUtf8().toStdString().c_str();
+            m_failed = true;
+        }
         avformat_free_context(m_formatCtx);
         m_formatCtx = Q_NULLPTR;
     }
@@ -139,12 +197,18 @@ void Recorder::close()
 
 bool Recorder::write(AVPacket *packet)
 {
+    if (!m_formatCtx) {
+        // open() failed
+        return false;
+    }
+
     if (!m_headerWritten) {
         if (packet->pts != AV_NOPTS_VALUE) {
             qCritical("The first packet is not a config packet");
             return false;
         }
-        bool ok = recorderWriteHeader(packet);
+        m_extradata = QByteArray(reinterpret_cast<const char *>(packet->data), packet->size);
+        bool ok = recorderWriteHeader(m_extradata);
         if (!ok) {
             return false;
         }
@@ -178,23 +242,23 @@ const AVOutputFormat *Recorder::findMuxer(const char *name)
     return outFormat;
 }
 
-bool Recorder::recorderWriteHeader(const AVPacket *packet)
+bool Recorder::recorderWriteHeader(const QByteArray &extradata)
 {
     AVStream *ostream = m_formatCtx->streams[0];
-    quint8 *extradata = (quint8 *)av_malloc(packet->size * sizeof(quint8));
-    if (!extradata) {
+    quint8 *data = (quint8 *)av_mallocz(extradata.size() + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (!data) {
         qCritical("Cannot allocate extradata");
         return false;
     }
-    // copy the first packet to the extra data
-    memcpy(extradata, packet->data, packet->size);
+    // the config packet becomes the extra data
+    memcpy(data, extradata.constData(), extradata.size());
 
 #ifdef QTSCRCPY_LAVF_HAS_NEW_CODEC_PARAMS_API
-    ostream->codecpar->extradata = extradata;
-    ostream->codecpar->extradata_size = packet->size;
+    ostream->codecpar->extradata = data;
+    ostream->codecpar->extradata_size = extradata.size();
 #else
-    ostream->codec->extradata = extradata;
-    ostream->codec->extradata_size = packet->size;
+    ostream->codec->extradata = data;
+    ostream->codec->extradata_size = extradata.size();
 #endif
 
     int ret = avformat_write_header(m_formatCtx, NULL);
@@ -240,42 +304,22 @@ Recorder::RecorderFormat Recorder::guessRecordFormat(const QString &fileName)
     return Recorder::RECORDER_FORMAT_NULL;
 }
 
-void Recorder::run()
+int Recorder::drain(int maxPackets)
 {
-    qint64 ptsOrigin = AV_NOPTS_VALUE;
-    for (;;) {
-        AVPacket *rec = Q_NULLPTR;
-        {
-            QMutexLocker locker(&m_mutex);
-            while (!m_stopped && m_queue.isEmpty()) {
-                m_recvDataCond.wait(&m_mutex);
-            }
-
-            // if stopped is set, continue to process the remaining events (to
-            // finish the recording) before actually stopping
-            if (m_stopped && m_queue.isEmpty()) {
-                AVPacket *last = m_previous;
-                if (last) {
-                    last->pts -= ptsOrigin;
-                    last->dts = last->pts;
-                    // assign an arbitrary duration to the last packet
-                    last->duration = 100000;
-                    bool ok = write(last);
-                    if (!ok) {
-                        // failing to write the last frame is not very serious, no
-                        // future frame may depend on it, so the resulting file
-                        // will still be valid
-                        qWarning("Could not record last packet");
-                    }
-                    packetDelete(last);
-                }
-                break;
-            }
+    int count = 0;
+    while (count < maxPackets) {
+        AVPacket *rec = m_queue.pop();
+        if (!rec) {
+            break;
+        }
+        count++;
 
-            rec = m_queue.dequeue();
+        if (m_failed) {
+            // discard pending packets
+            av_packet_free(&rec);
+            continue;
         }
 
-        // recorder->previous is only written from this thread, no need to lock
         AVPacket *previous = m_previous;
         m_previous = rec;
 
@@ -291,44 +335,157 @@ void Recorder::run()
         }
 
         if (previous->pts != AV_NOPTS_VALUE) {
-            if (ptsOrigin == AV_NOPTS_VALUE) {
-                ptsOrigin = previous->pts;
+            if (m_ptsOrigin == AV_NOPTS_VALUE) {
+                m_ptsOrigin = previous->pts;
+            } else if (m_segmentSeconds > 0 && (previous->flags & AV_PKT_FLAG_KEY)
+                       && previous->pts - m_ptsOrigin >= m_segmentSeconds * 1000000LL) {
+                // every segment must start with a keyframe to be playable on its own
+                if (!rotateSegment(previous->pts)) {
+                    qCritical("Could not start a new recording segment");
+                    m_failed = true;
+                    av_packet_free(&previous);
+                    continue;
+                }
             }
-            previous->pts -= ptsOrigin;
+            m_segmentEndPts = previous->pts + previous->duration;
+            previous->pts -= m_ptsOrigin;
             previous->dts = previous->pts;
-        }        
+        }
 
         bool ok = write(previous);
-        packetDelete(previous);
+        av_packet_free(&previous);
         if (!ok) {
             qCritical("Could not record packet");
-            QMutexLocker locker(&m_mutex);
             m_failed = true;
-            // discard pending packets
-            queueClear();
-            break;
         }
     }
 
-    qDebug("Recorder thread ended");
+    if (m_segmentSeconds > 0 && count > 0 && m_ptsOrigin != AV_NOPTS_VALUE) {
+        QMutexLocker locker(&m_segmentsMutex);
+        if (!m_segments.isEmpty()) {
+            m_segments.last().startPts = m_ptsOrigin;
+            m_segments.last().endPts = m_segmentEndPts;
+        }
+    }
+    flushOutput();
+    return count;
 }
 
-bool Recorder::startRecorder()
+void Recorder::flushOutput()
 {
-    start();
+    quint64 requested = 0;
+    if (m_segmentSeconds > 0) {
+        QMutexLocker locker(&m_segmentsMutex);
+        requested = m_flushRequests;
+    }
+    bool force = requested != m_flushesDone;
+
+    if (m_formatCtx && m_headerWritten && !m_failed) {
+        // matroska keeps the current cluster in memory, close it so the file is readable up to here
+        if (force && (m_formatCtx->oformat->flags & AVFMT_ALLOW_FLUSH)) {
+            av_write_frame(m_formatCtx, Q_NULLPTR);
+        }
+        if (!RecorderIO::flush(m_formatCtx->pb, force)) {
+            qCritical() << QString("Failed to flush %1").arg(m_outputFile).toUtf8().toStdString().c_str();
+            m_failed = true;
+        }
+    }
+
+    if (force) {
+        QMutexLocker locker(&m_segmentsMutex);
+        m_flushesDone = requested;
+        m_flushedCond.wakeAll();
+    }
+}
+
+bool Recorder::requestFlush()
+{
+    RecordingWorker *worker = m_worker;
+    if (!worker) {
+        // not recording, every segment is closed
+        return true;
+    }
+    quint64 wanted = 0;
+    {
+        QMutexLocker locker(&m_segmentsMutex);
+        wanted = ++m_flushRequests;
+    }
+    worker->wakeUp();
+
+    QMutexLocker locker(&m_segmentsMutex);
+    QElapsedTimer timer;
+    timer.start();
+    while (m_flushesDone < wanted) {
+        qint64 remaining = RECORDER_EXPORT_FLUSH_TIMEOUT_MS - timer.elapsed();
+        if (remaining <= 0 || !m_flushedCond.wait(&m_segmentsMutex, static_cast<unsigned long>(remaining))) {
+            return m_flushesDone >= wanted;
+        }
+    }
     return true;
 }
 
+void Recorder::finish()
+{
+    AVPacket *last = m_previous;
+    m_previous = Q_NULLPTR;
+    if (!last) {
+        return;
+    }
+
+    if (!m_failed && last->pts != AV_NOPTS_VALUE) {
+        last->pts -= m_ptsOrigin;
+        last->dts = last->pts;
+        // assign an arbitrary duration to the last packet
+        last->duration = 100000;
+        bool ok = write(last);
+        if (!ok) {
+            // failing to write the last frame is not very serious, no
+            // future frame may depend on it, so the resulting file
+            // will still be valid
+            qWarning("Could not record last packet");
+        }
+    }
+    av_packet_free(&last);
+}
+
+bool Recorder::isStopping() const
+{
+    return m_stopped;
+}
+
+void Recorder::setWorker(RecordingWorker *worker)
+{
+    m_worker = worker;
+}
+
+bool Recorder::startRecorder()
+{
+    if (m_recording) {
+        return true;
+    }
+    m_stopped = false;
+    m_recording = RecordingService::instance().attach(this);
+    return m_recording;
+}
+
 void Recorder::stopRecorder()
 {
-    QMutexLocker locker(&m_mutex);
+    if (!m_recording) {
+        return;
+    }
+    // the stream reader has stopped, nothing is pushed anymore
     m_stopped = true;
-    m_recvDataCond.wakeOne();
+    RecordingService::instance().detach(this);
+    m_recording = false;
+}
+
+bool Recorder::isRecording() const
+{
+    return m_recording;
 }
 
 bool Recorder::push(const AVPacket *packet)
 {
-    QMutexLocker locker(&m_mutex);
     Q_ASSERT(!m_stopped);
 
     if (m_failed) {
@@ -336,10 +493,247 @@ bool Recorder::push(const AVPacket *packet)
         return false;
     }
 
-    AVPacket *rec = packetNew(packet);
-    if (rec) {
-        m_queue.enqueue(rec);
-        m_recvDataCond.wakeOne();
+    AVPacket *rec = av_packet_alloc();
+    if (!rec) {
+        return false;
+    }
+    // the demuxer's packets are refcounted: this shares the payload, no copy
+    if (av_packet_ref(rec, packet)) {
+        av_packet_free(&rec);
+        return false;
+    }
+
+    if (!m_queue.push(rec)) {
+        av_packet_free(&rec);
+        qCritical() << "Recorder: mux worker cannot keep up, recording stopped:" << m_fileName;
+        m_failed = true;
+        return false;
+    }
+
+    if (m_queue.size() >= RECORDER_QUEUE_WAKE_THRESHOLD) {
+        RecordingWorker *worker = m_worker;
+        if (worker) {
+            worker->wakeUp();
+        }
+    }
+    return true;
+}
+
+bool Recorder::writeClip(const QVector<AVPacket *> &packets)
+{
+    Q_ASSERT(!m_recording);
+    if (packets.isEmpty() || !open()) {
+        return false;
+    }
+
+    bool ok = true;
+    for (int i = 0; ok && i < packets.size(); i++) {
+        AVPacket *packet = av_packet_clone(packets[i]);
+        if (!packet) {
+            ok = false;
+            break;
+        }
+        if (packet->pts != AV_NOPTS_VALUE) {
+            if (m_ptsOrigin == AV_NOPTS_VALUE) {
+                m_ptsOrigin = packet->pts;
+            }
+            // all packets are known up front, no need to hold one back for its duration
+            if (i + 1 < packets.size() && packets[i + 1]->pts != AV_NOPTS_VALUE) {
+                packet->duration = packets[i + 1]->pts - packets[i]->pts;
+            } else {
+                packet->duration = 100000;
+            }
+            packet->pts -= m_ptsOrigin;
+            packet->dts = packet->pts;
+        }
+        ok = write(packet);
+        av_packet_free(&packet);
+    }
+    close();
+    return ok && !m_failed;
+}
+
+void Recorder::setSegmentation(int segmentSeconds, int maxSegments)
+{
+    Q_ASSERT(!m_formatCtx);
+    m_segmentSeconds = qMax(0, segmentSeconds);
+    m_maxSegments = qMax(2, maxSegments);
+    if (m_segmentSeconds > 0) {
+        // an unfinished MP4 is unreadable, a segment cut by a crash must stay usable
+        m_format = RECORDER_FORMAT_MKV;
+    }
+}
+
+bool Recorder::isSegmented() const
+{
+    return m_segmentSeconds > 0;
+}
+
+void Recorder::exportRecent(int seconds, const QString &filePath)
+{
+    if (!isSegmented() || seconds <= 0 || filePath.isEmpty()) {
+        emit exportFinished(filePath, false);
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_segmentsMutex);
+        m_exportsRunning++;
+    }
+    QThreadPool::globalInstance()->start(new RecorderExportJob(this, seconds, filePath));
+}
+
+bool Recorder::rotateSegment(qint64 startPts)
+{
+    closeOutput();
+    m_segmentIndex++;
+
+    Segment segment;
+    segment.fileName = segmentFileName(m_segmentIndex);
+    segment.startPts = startPts;
+    segment.endPts = startPts;
+    {
+        QMutexLocker locker(&m_segmentsMutex);
+        if (!m_segments.isEmpty()) {
+            m_segments.last().endPts = startPts;
+        }
+        m_segments.append(segment);
+        trimSegments();
+    }
+    m_ptsOrigin = startPts;
+
+    if (!openOutput(segment.fileName)) {
+        return false;
+    }
+    // every segment carries the stream configuration in its own header
+    if (!recorderWriteHeader(m_extradata)) {
+        return false;
+    }
+    m_headerWritten = true;
+    return true;
+}
+
+QString Recorder::segmentFileName(int index) const
+{
+    QFileInfo fileInfo(m_fileName);
+    QString name = QString("%1_%2.mkv").arg(fileInfo.completeBaseName()).arg(index, 5, 10, QChar('0'));
+    return QDir(fileInfo.absolutePath()).filePath(name);
+}
+
+void Recorder::trimSegments()
+{
+    if (m_exportsRunning > 0) {
+        // trimmed on the next rotation
+        return;
     }
-    return rec != Q_NULLPTR;
+    while (m_segments.size() > m_maxSegments) {
+        QString fileName = m_segments.takeFirst().fileName;
+        if (!QFile::remove(fileName)) {
+            qWarning() << "Recorder: could not remove old segment" << fileName;
+        }
+    }
+}
+
+bool Recorder::exportSegments(int seconds, const QString &filePath)
+{
+#ifdef QTSCRCPY_LAVF_HAS_NEW_CODEC_PARAMS_API
+    // the segment being written still has its newest packets in memory
+    if (!requestFlush()) {
+        qWarning() << "Recorder: mux worker did not flush in time, export may miss the last seconds" << filePath;
+    }
+
+    QVector<Segment> segments;
+    {
+        QMutexLocker locker(&m_segmentsMutex);
+        segments = m_segments;
+    }
+
+    // whole segments only: the export starts at a keyframe, up to one segment earlier than asked
+    const qint64 wanted = seconds * 1000000LL;
+    qint64 covered = 0;
+    int first = segments.size();
+    while (first > 0 && covered < wanted) {
+        first--;
+        covered += segments[first].endPts - segments[first].startPts;
+    }
+    if (first == segments.size()) {
+        qWarning() << "Recorder: nothing recorded yet, cannot export" << filePath;
+        return false;
+    }
+
+    QByteArray outName = filePath.toUtf8();
+    AVFormatContext *outCtx = Q_NULLPTR;
+    if (avformat_alloc_output_context2(&outCtx, Q_NULLPTR, Q_NULLPTR, outName.constData()) < 0 || !outCtx) {
+        qWarning() << "Recorder: no muxer for export file" << filePath;
+        return false;
+    }
+
+    AVStream *outStream = Q_NULLPTR;
+    AVPacket *packet = av_packet_alloc();
+    bool ok = packet != Q_NULLPTR;
+    bool headerWritten = false;
+    for (int i = first; ok && i < segments.size(); i++) {
+        AVFormatContext *inCtx = Q_NULLPTR;
+        QByteArray inName = segments[i].fileName.toUtf8();
+        if (avformat_open_input(&inCtx, inName.constData(), Q_NULLPTR, Q_NULLPTR) < 0) {
+            // the segment being written may not have flushed its header yet
+            qWarning() << "Recorder: skipping unreadable segment" << segments[i].fileName;
+            continue;
+        }
+        if (inCtx->nb_streams < 1) {
+            avformat_close_input(&inCtx);
+            continue;
+        }
+        AVStream *inStream = inCtx->streams[0];
+
+        if (!outStream) {
+            outStream = avformat_new_stream(outCtx, Q_NULLPTR);
+            ok = outStream && avcodec_parameters_copy(outStream->codecpar, inStream->codecpar) >= 0;
+            if (ok) {
+                // let the output muxer pick its own tag
+                outStream->codecpar->codec_tag = 0;
+                ok = avio_open(&outCtx->pb, outName.constData(), AVIO_FLAG_WRITE) >= 0;
+            }
+            if (ok) {
+                ok = avformat_write_header(outCtx, Q_NULLPTR) >= 0;
+                headerWritten = ok;
+            }
+        }
+
+        // each segment restarts at 0, shift it to its place in the export
+        const qint64 offset = segments[i].startPts - segments[first].startPts;
+        while (ok && av_read_frame(inCtx, packet) >= 0) {
+            if (packet->stream_index == 0 && packet->pts != AV_NOPTS_VALUE) {
+                qint64 pts = av_rescale_q(packet->pts, inStream->time_base, SCRCPY_TIME_BASE) + offset;
+                packet->pts = av_rescale_q(pts, SCRCPY_TIME_BASE, outStream->time_base);
+                packet->dts = packet->pts;
+                packet->duration = av_rescale_q(packet->duration, inStream->time_base, outStream->time_base);
+                packet->pos = -1;
+                ok = av_interleaved_write_frame(outCtx, packet) >= 0;
+            }
+            av_packet_unref(packet);
+        }
+        avformat_close_input(&inCtx);
+    }
+
+    if (headerWritten && av_write_trailer(outCtx) < 0) {
+        ok = false;
+    }
+    ok = ok && headerWritten;
+    av_packet_free(&packet);
+    avio_closep(&outCtx->pb);
+    avformat_free_context(outCtx);
+
+    if (ok) {
+        qInfo() << "Recorder: exported" << (covered / 1000000) << "s to" << filePath;
+    } else {
+        qWarning() << "Recorder: export failed" << filePath;
+        QFile::remove(filePath);
+    }
+    return ok;
+#else
+    Q_UNUSED(seconds);
+    qWarning() << "Recorder: export needs a libavformat with codec parameters" << filePath;
+    return false;
+#endif
 }
@@ -1,10 +1,13 @@
 #ifndef RECORDER_H
 #define RECORDER_H
+#include <atomic>
+
+#include <QByteArray>
 #include <QMutex>
-#include <QQueue>
+#include <QObject>
 #include <QSize>
 #include <QString>
-#include <QThread>
+#include <QVector>
 #include <QWaitCondition>
 
 extern "C"
@@ -12,7 +15,22 @@ extern "C"
 #include "libavformat/avformat.h"
 }
 
-class Recorder : public QThread
+#include "packetqueue.h"
+
+class RecordingWorker;
+class RecorderExportJob;
+
+/**
+ * Recorder - Muxes one device's H.264 stream into an MP4/MKV file
+ *
+ * A Recorder has no thread of its own: startRecorder() hands it to one of the
+ * RecordingService mux workers, which drain its lock-free packet queue in batches.
+ *
+ * With setSegmentation() it becomes a rolling recorder: the output is split into MKV
+ * segments rotated at keyframes and only the newest ones are kept on disk, so disk usage
+ * stays constant. exportRecent() remuxes the last minutes into one file on demand.
+ */
+class Recorder : public QObject
 {
     Q_OBJECT
 public:
@@ -31,41 +49,99 @@ public:
     bool open();
     void close();
     bool write(AVPacket *packet);
+    // attach to a RecordingService mux worker
     bool startRecorder();
+    // write everything still queued and detach, blocks until the worker is done with us
     void stopRecorder();
+    bool isRecording() const;
+    // demuxer thread: queue a new reference to packet (the payload is shared, not copied)
     bool push(const AVPacket *packet);
+    // synchronous, without a mux worker: open, write packets (the config packet first) and close
+    bool writeClip(const QVector<AVPacket *> &packets);
+
+    // rolling recording, call before open(): start a new segment at the first keyframe
+    // after segmentSeconds and keep at most maxSegments segment files (the oldest are deleted)
+    void setSegmentation(int segmentSeconds, int maxSegments);
+    bool isSegmented() const;
+    // remux (no re-encoding) the segments covering at least the last seconds into filePath,
+    // runs on the global thread pool and reports through exportFinished()
+    void exportRecent(int seconds, const QString &filePath);
+
+signals:
+    // emitted from a pool thread
+    void exportFinished(const QString &filePath, bool success);
 
 private:
     const AVOutputFormat *findMuxer(const char *name);
-    bool recorderWriteHeader(const AVPacket *packet);
+    bool openOutput(const QString &fileName);
+    void closeOutput();
+    bool recorderWriteHeader(const QByteArray &extradata);
     void recorderRescalePacket(AVPacket *packet);
     QString recorderGetFormatName(Recorder::RecorderFormat format);
     RecorderFormat guessRecordFormat(const QString &fileName);
 
 private:
-    AVPacket *packetNew(const AVPacket *packet);
-    void packetDelete(AVPacket *packet);
-    void queueClear();
+    friend class RecordingWorker;
+    friend class RecorderExportJob;
+    // mux worker: write up to maxPackets queued packets, returns how many were taken from the queue
+    int drain(int maxPackets);
+    // mux worker: write the last packet once a stopped recorder has been drained
+    void finish();
+    bool isStopping() const;
+    void setWorker(RecordingWorker *worker);
+    // mux worker: get staged output to disk, right away if an export asked for it
+    void flushOutput();
+    // any thread: have the mux worker flush the current segment, false on timeout
+    bool requestFlush();
 
-protected:
-    void run();
+    // mux worker: close the current segment and continue in a new one starting at startPts
+    bool rotateSegment(qint64 startPts);
+    QString segmentFileName(int index) const;
+    // m_segmentsMutex held
+    void trimSegments();
+    // any thread
+    bool exportSegments(int seconds, const QString &filePath);
 
 private:
     QString m_fileName = "";
+    QString m_outputFile = ""; // m_fileName, or the current segment
     AVFormatContext *m_formatCtx = Q_NULLPTR;
     QSize m_declaredFrameSize;
     bool m_headerWritten = false;
     RecorderFormat m_format = RECORDER_FORMAT_NULL;
-    QMutex m_mutex;
-    QWaitCondition m_recvDataCond;
-    bool m_stopped = false; // set on recorder_stop() by the stream reader
-    bool m_failed = false;  // set on packet write failure
-    QQueue<AVPacket *> m_queue;
+    bool m_recording = false;
+    std::atomic<bool> m_stopped; // set on stopRecorder(), after the stream reader stopped
+    std::atomic<bool> m_failed;  // set on packet write failure or queue overflow
+    PacketQueue m_queue;
+    std::atomic<RecordingWorker *> m_worker;
     // we can write a packet only once we received the next one so that we can
     // set its duration (next_pts - current_pts)
-    // "previous" is only accessed from the recorder thread, so it does not
-    // need to be protected by the mutex
+    // "previous" and the pts origin are only accessed from the mux worker, so they
+    // do not need to be protected
     AVPacket *m_previous = Q_NULLPTR;
+    qint64 m_ptsOrigin = AV_NOPTS_VALUE;
+    // config packet, replayed as the header of every segment
+    QByteArray m_extradata;
+
+    // rolling recording
+    struct Segment
+    {
+        QString fileName;
+        qint64 startPts = 0; // device pts, us
+        qint64 endPts = 0;
+    };
+    int m_segmentSeconds = 0;
+    int m_maxSegments = 0;
+    int m_segmentIndex = 0;
+    qint64 m_segmentEndPts = 0; // mux worker only, published in m_segments after each batch
+    QMutex m_segmentsMutex;
+    QWaitCondition m_exportsCond;
+    QVector<Segment> m_segments;
+    int m_exportsRunning = 0; // segment files are not deleted while an export reads them
+    // flushes asked by exports and done by the mux worker, m_segmentsMutex held
+    quint64 m_flushRequests = 0;
+    quint64 m_flushesDone = 0;
+    QWaitCondition m_flushedCond;
 };
 
 #endif // RECORDER_H
@@ -0,0 +1,365 @@
+#include <cstdio>
+#include <cstring>
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "compat.h"
+#include "recorderio.h"
+
+extern "C"
+{
+#include "libavformat/avio.h"
+#include "libavutil/error.h"
+#include "libavutil/mem.h"
+}
+
+// O_DIRECT needs offsets, sizes and memory aligned to the logical block size, 4 KB covers all disks
+#define RECORDER_IO_ALIGNMENT 4096
+// AVIO's own buffer, only a staging step before the large buffer
+#define RECORDER_IO_AVIO_BUFFER_SIZE (64 * 1024)
+
+#ifdef QTSCRCPY_LAVF_HAS_CONST_AVIO_WRITE_PACKET
+typedef const uint8_t *RecorderIOWriteBuffer;
+#else
+typedef uint8_t *RecorderIOWriteBuffer;
+#endif
+
+namespace
+{
+
+class RecorderFile
+{
+public:
+    RecorderFile(const QString &fileName, const RecorderIO::Options &options) : m_file(fileName), m_options(options) {}
+
+    ~RecorderFile()
+    {
+#ifdef Q_OS_LINUX
+        if (m_directFd >= 0) {
+            ::close(m_directFd);
+        }
+#endif
+        qFreeAligned(m_buffer);
+    }
+
+    bool open()
+    {
+        m_bufferSize = (m_options.bufferSize + RECORDER_IO_ALIGNMENT - 1) / RECORDER_IO_ALIGNMENT * RECORDER_IO_ALIGNMENT;
+        m_buffer = static_cast<uint8_t *>(qMallocAligned(m_bufferSize, RECORDER_IO_ALIGNMENT));
+        if (!m_buffer) {
+            return false;
+        }
+        if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered)) {
+            qCritical() << "RecorderIO: could not open" << m_file.fileName() << m_file.errorString();
+            return false;
+        }
+#ifdef Q_OS_LINUX
+        if (m_options.directIO) {
+            m_directFd = ::open(QFile::encodeName(m_file.fileName()).constData(), O_WRONLY | O_DIRECT);
+            if (m_directFd < 0) {
+                // e.g. tmpfs, keep going through the page cache
+                qInfo() << "RecorderIO: O_DIRECT not available for" << m_file.fileName();
+            }
+        }
+#endif
+        m_syncTimer.start();
+        m_flushTimer.start();
+        return true;
+    }
+
+    int write(const uint8_t *data, int size)
+    {
+        int left = size;
+        while (left > 0) {
+            int chunk = qMin(left, m_bufferSize - m_used);
+            memcpy(m_buffer + m_used, data, chunk);
+            m_used += chunk;
+            data += chunk;
+            left -= chunk;
+            if (m_used == m_bufferSize && !writeOut(false)) {
+                return AVERROR(EIO);
+            }
+        }
+        return size;
+    }
+
+    // written out if force or staged for flushIntervalMs; an unforced flush keeps the unaligned tail staged
+    bool flush(bool force)
+    {
+        if (m_used <= 0) {
+            m_flushTimer.restart();
+            return true;
+        }
+        if (!force && (m_options.flushIntervalMs < 0 || m_flushTimer.elapsed() < m_options.flushIntervalMs)) {
+            return true;
+        }
+        return writeOut(force);
+    }
+
+    int64_t seek(int64_t offset, int whence)
+    {
+        whence &= ~AVSEEK_FORCE;
+        if (whence == AVSEEK_SIZE) {
+            return qMax(m_fileSize, m_bufferPos + m_used);
+        }
+        // the muxers only seek to patch headers, the staged data goes out first
+        if (!writeOut(true)) {
+            return AVERROR(EIO);
+        }
+        // a kept tail is in the file already
+        m_used = 0;
+        int64_t position = -1;
+        switch (whence) {
+        case SEEK_SET:
+            position = offset;
+            break;
+        case SEEK_CUR:
+            position = m_bufferPos + offset;
+            break;
+        case SEEK_END:
+            position = m_fileSize + offset;
+            break;
+        default:
+            break;
+        }
+        if (position < 0) {
+            return AVERROR(EINVAL);
+        }
+        m_bufferPos = position;
+        return position;
+    }
+
+    bool close()
+    {
+        bool ok = writeOut(true);
+        if (ok && m_options.syncIntervalMs >= 0) {
+            ok = sync();
+        }
+        m_file.close();
+        return ok;
+    }
+
+private:
+    // all: the file holds every staged byte afterwards. With O_DIRECT the unaligned tail is then
+    // written through the page cache but stays staged, so m_bufferPos keeps on a block boundary
+    // and the next flush rewrites that block with O_DIRECT again.
+    bool writeOut(bool all)
+    {
+        m_flushTimer.restart();
+        if (m_used <= 0) {
+            return true;
+        }
+
+        bool direct = false;
+#ifdef Q_OS_LINUX
+        if (m_directFd >= 0) {
+            // back to a block boundary after a seek, the bytes up to it go through the page cache
+            int head = static_cast<int>((RECORDER_IO_ALIGNMENT - m_bufferPos % RECORDER_IO_ALIGNMENT) % RECORDER_IO_ALIGNMENT);
+            if (head > 0 && head <= m_used) {
+                if (!writeBuffered(head)) {
+                    return false;
+                }
+                consume(head);
+            }
+            int aligned = m_used - m_used % RECORDER_IO_ALIGNMENT;
+            if (m_bufferPos % RECORDER_IO_ALIGNMENT == 0 && aligned > 0) {
+                if (::pwrite(m_directFd, m_buffer, aligned, m_bufferPos) == aligned) {
+                    consume(aligned);
+                } else {
+                    qWarning() << "RecorderIO: O_DIRECT write failed, falling back to buffered writes" << m_file.fileName();
+                    ::close(m_directFd);
+                    m_directFd = -1;
+                }
+            }
+            direct = m_directFd >= 0 && m_bufferPos % RECORDER_IO_ALIGNMENT == 0;
+        }
+#endif
+        if (!direct) {
+            if (!writeBuffered(m_used)) {
+                return false;
+            }
+            consume(m_used);
+        } else if (all && m_used > 0) {
+            if (!writeBuffered(m_used)) {
+                return false;
+            }
+            m_fileSize = qMax(m_fileSize, m_bufferPos + m_used);
+        }
+
+        if (m_options.syncIntervalMs > 0 && m_syncTimer.elapsed() >= m_options.syncIntervalMs) {
+            sync();
+            m_syncTimer.restart();
+        }
+        return true;
+    }
+
+    // the first size staged bytes through the page cache, they stay staged
+    bool writeBuffered(int size)
+    {
+        if (!m_file.seek(m_bufferPos) || m_file.write(reinterpret_cast<const char *>(m_buffer), size) != size) {
+            qCritical() << "RecorderIO: write failed" << m_file.fileName() << m_file.errorString();
+            return false;
+        }
+        return true;
+    }
+
+    // drop the first size staged bytes once they are in the file
+    void consume(int size)
+    {
+        m_used -= size;
+        if (m_used > 0) {
+            memmove(m_buffer, m_buffer + size, m_used);
+        }
+        m_bufferPos += size;
+        m_fileSize = qMax(m_fileSize, m_bufferPos);
+    }
+
+    bool sync()
+    {
+#if defined(Q_OS_WIN)
+        return _commit(m_file.handle()) == 0;
+#elif defined(Q_OS_LINUX)
+        return ::fdatasync(m_file.handle()) == 0;
+#else
+        return ::fsync(m_file.handle()) == 0;
+#endif
+    }
+
+private:
+    QFile m_file;
+    RecorderIO::Options m_options;
+    uint8_t *m_buffer = Q_NULLPTR;
+    int m_bufferSize = 0;
+    int m_used = 0;
+    qint64 m_bufferPos = 0; // file offset of m_buffer[0]
+    qint64 m_fileSize = 0;
+    int m_directFd = -1;
+    QElapsedTimer m_syncTimer;
+    QElapsedTimer m_flushTimer; // since the last write-out
+};
+
+int writePacket(void *opaque, RecorderIOWriteBuffer buf, int size)
+{
+    return static_cast<RecorderFile *>(opaque)->write(buf, size);
+}
+
+int64_t seekPacket(void *opaque, int64_t offset, int whence)
+{
+    return static_cast<RecorderFile *>(opaque)->seek(offset, whence);
+}
+
+RecorderIO::Options environmentOptions()
+{
+    RecorderIO::Options options;
+    bool ok = false;
+    int bufferKb = qEnvironmentVariableIntValue("QTSCRCPY_RECORD_BUFFER_KB", &ok);
+    if (ok && bufferKb >= 0) {
+        options.bufferSize = bufferKb * 1024;
+    }
+    options.directIO = qEnvironmentVariableIntValue("QTSCRCPY_RECORD_DIRECT_IO") != 0;
+    int syncMs = qEnvironmentVariableIntValue("QTSCRCPY_RECORD_FSYNC_MS", &ok);
+    if (ok) {
+        options.syncIntervalMs = syncMs;
+    }
+    int flushMs = qEnvironmentVariableIntValue("QTSCRCPY_RECORD_FLUSH_MS", &ok);
+    if (ok) {
+        options.flushIntervalMs = flushMs;
+    }
+    return options;
+}
+
+QMutex s_optionsMutex;
+RecorderIO::Options s_options = environmentOptions();
+
+} // namespace
+
+RecorderIO::Options RecorderIO::defaultOptions()
+{
+    QMutexLocker locker(&s_optionsMutex);
+    return s_options;
+}
+
+void RecorderIO::setDefaultOptions(const Options &options)
+{
+    QMutexLocker locker(&s_optionsMutex);
+    s_options = options;
+}
+
+AVIOContext *RecorderIO::open(const QString &fileName, const Options &options)
+{
+    if (options.bufferSize <= 0) {
+        AVIOContext *pb = Q_NULLPTR;
+        int ret = avio_open(&pb, fileName.toUtf8().constData(), AVIO_FLAG_WRITE);
+        if (ret < 0) {
+            char errorbuf[255] = { 0 };
+            av_strerror(ret, errorbuf, 254);
+            qCritical() << QString("Failed to open output file: %1 %2").arg(errorbuf).arg(fileName).toUtf8().constData();
+            return Q_NULLPTR;
+        }
+        return pb;
+    }
+
+    RecorderFile *file = new RecorderFile(fileName, options);
+    if (!file->open()) {
+        delete file;
+        return Q_NULLPTR;
+    }
+
+    unsigned char *buffer = static_cast<unsigned char *>(av_malloc(RECORDER_IO_AVIO_BUFFER_SIZE));
+    AVIOContext *pb = buffer ? avio_alloc_context(buffer, RECORDER_IO_AVIO_BUFFER_SIZE, 1, file, Q_NULLPTR, writePacket, seekPacket) : Q_NULLPTR;
+    if (!pb) {
+        av_free(buffer);
+        delete file;
+        qCritical("Could not allocate output context");
+        return Q_NULLPTR;
+    }
+    return pb;
+}
+
+bool RecorderIO::flush(AVIOContext *pb, bool force)
+{
+    if (!pb) {
+        return true;
+    }
+    avio_flush(pb);
+    if (pb->error < 0) {
+        return false;
+    }
+    if (pb->write_packet != writePacket) {
+        // opened by avio_open(), its buffer went to the file
+        return true;
+    }
+    return static_cast<RecorderFile *>(pb->opaque)->flush(force);
+}
+
+bool RecorderIO::close(AVIOContext **pb)
+{
+    if (!pb || !*pb) {
+        return true;
+    }
+    if ((*pb)->write_packet != writePacket) {
+        // opened by avio_open()
+        return avio_closep(pb) >= 0;
+    }
+
+    avio_flush(*pb);
+    bool ok = (*pb)->error >= 0;
+    RecorderFile *file = static_cast<RecorderFile *>((*pb)->opaque);
+    ok = file->close() && ok;
+    delete file;
+
+    av_freep(&(*pb)->buffer);
+    avio_context_free(pb);
+    return ok;
+}
@@ -0,0 +1,51 @@
+#ifndef RECORDERIO_H
+#define RECORDERIO_H
+
+#include <QString>
+
+// forward declarations
+typedef struct AVIOContext AVIOContext;
+
+/**
+ * RecorderIO - Output layer for the recorder muxers
+ *
+ * Instead of the default AVIO file protocol (32 KB writes), packets are staged in a large
+ * page-aligned buffer per file and written out in big sequential chunks, so many
+ * concurrent recordings on one disk do not turn into small interleaved writes.
+ * On Linux the full chunks can bypass the page cache (O_DIRECT). fsync is opt-in.
+ *
+ * Defaults come from the environment:
+ *   QTSCRCPY_RECORD_BUFFER_KB  staging buffer per file, 0 = plain avio_open() (default 4096)
+ *   QTSCRCPY_RECORD_DIRECT_IO  1 = O_DIRECT for aligned chunks, Linux only (default 0)
+ *   QTSCRCPY_RECORD_FSYNC_MS   -1 = never, 0 = on close, > 0 = also every N ms (default -1)
+ *   QTSCRCPY_RECORD_FLUSH_MS   staged data older than this goes out on flush(), -1 = only when
+ *                              the buffer is full (default 1000)
+ * At low bitrates the buffer takes tens of seconds to fill, the age limit keeps that much
+ * video from living only in memory, where exports cannot see it and a crash loses it.
+ * With O_DIRECT an age flush writes whole blocks only, the last partial block (< 4 KB) stays
+ * staged so the file offset keeps its alignment; a forced flush also puts it through the page cache.
+ */
+class RecorderIO
+{
+public:
+    struct Options
+    {
+        int bufferSize = 4 * 1024 * 1024;
+        bool directIO = false;
+        int syncIntervalMs = -1;
+        int flushIntervalMs = 1000;
+    };
+
+    static Options defaultOptions();
+    static void setDefaultOptions(const Options &options);
+
+    // a new AVIOContext writing to fileName, nullptr on failure
+    static AVIOContext *open(const QString &fileName, const Options &options = defaultOptions());
+    // AVIO buffer into the staging buffer, which is written out if force or older than flushIntervalMs;
+    // false on write errors
+    static bool flush(AVIOContext *pb, bool force);
+    // flush, sync according to the options and release, *pb is set to nullptr; false on write errors
+    static bool close(AVIOContext **pb);
+};
+
+#endif // RECORDERIO_H
@@ -0,0 +1,209 @@
+#include <climits>
+
+#include <QDebug>
+#include <QMutexLocker>
+
+#include "recorder.h"
+#include "recordingservice.h"
+
+// how long queued packets may wait before a worker writes them
+#define RECORDING_FLUSH_INTERVAL_MS 50
+// packets written per recorder per pass, keeps one busy device from starving the others
+#define RECORDING_MAX_BATCH 256
+#define RECORDING_MAX_WORKERS_LIMIT 16
+
+RecordingWorker::RecordingWorker(int index, QObject *parent) : QThread(parent), m_index(index), m_wakePending(false) {}
+
+RecordingWorker::~RecordingWorker()
+{
+    stop();
+}
+
+void RecordingWorker::attach(Recorder *recorder)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_recorders.contains(recorder)) {
+        return;
+    }
+    recorder->setWorker(this);
+    m_recorders.append(recorder);
+    // an idle worker waits without a timeout
+    m_wakePending = true;
+    m_wakeCond.wakeOne();
+}
+
+void RecordingWorker::detach(Recorder *recorder)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_recorders.contains(recorder)) {
+        return;
+    }
+    m_wakePending = true;
+    m_wakeCond.wakeOne();
+    while (m_recorders.contains(recorder)) {
+        m_detachedCond.wait(&m_mutex);
+    }
+}
+
+void RecordingWorker::wakeUp()
+{
+    if (m_wakePending.exchange(true)) {
+        return;
+    }
+    QMutexLocker locker(&m_mutex);
+    m_wakeCond.wakeOne();
+}
+
+void RecordingWorker::stop()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_quit = true;
+        m_wakePending = true;
+        m_wakeCond.wakeOne();
+    }
+    wait();
+}
+
+int RecordingWorker::recorderCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_recorders.size();
+}
+
+void RecordingWorker::run()
+{
+    qDebug() << "RecordingWorker" << m_index << "started";
+
+    for (;;) {
+        QVector<Recorder *> recorders;
+        bool quit = false;
+        {
+            QMutexLocker locker(&m_mutex);
+            if (!m_wakePending) {
+                if (m_recorders.isEmpty()) {
+                    // nothing to flush, sleep until attach() or stop()
+                    m_wakeCond.wait(&m_mutex);
+                } else {
+                    m_wakeCond.wait(&m_mutex, RECORDING_FLUSH_INTERVAL_MS);
+                }
+            }
+            m_wakePending = false;
+            quit = m_quit;
+            recorders = m_recorders;
+        }
+
+        // muxing happens without the lock, attach() and wakeUp() never wait for disk I/O
+        QVector<Recorder *> finished;
+        for (Recorder *recorder : recorders) {
+            if (recorder->isStopping() || quit) {
+                // nothing is pushed anymore, write out the rest
+                while (recorder->drain(INT_MAX) > 0) {
+                }
+                recorder->finish();
+                finished.append(recorder);
+            } else {
+                recorder->drain(RECORDING_MAX_BATCH);
+            }
+        }
+
+        if (!finished.isEmpty()) {
+            QMutexLocker locker(&m_mutex);
+            for (Recorder *recorder : finished) {
+                recorder->setWorker(Q_NULLPTR);
+                m_recorders.removeAll(recorder);
+            }
+            m_detachedCond.wakeAll();
+        }
+
+        if (quit) {
+            break;
+        }
+    }
+
+    qDebug() << "RecordingWorker" << m_index << "ended";
+}
+
+RecordingService::RecordingService()
+{
+    bool ok = false;
+    int workers = qEnvironmentVariableIntValue("QTSCRCPY_RECORDING_WORKERS", &ok);
+    if (!ok || workers <= 0) {
+        workers = qBound(1, QThread::idealThreadCount() / 4, 4);
+    }
+    m_maxWorkers = qMin(workers, RECORDING_MAX_WORKERS_LIMIT);
+}
+
+RecordingService::~RecordingService()
+{
+    QMutexLocker locker(&m_mutex);
+    for (RecordingWorker *worker : m_workers) {
+        worker->stop();
+        delete worker;
+    }
+    m_workers.clear();
+    m_assignments.clear();
+}
+
+RecordingService &RecordingService::instance()
+{
+    static RecordingService service;
+    return service;
+}
+
+bool RecordingService::attach(Recorder *recorder)
+{
+    if (!recorder) {
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (m_assignments.contains(recorder)) {
+        return true;
+    }
+
+    RecordingWorker *target = Q_NULLPTR;
+    int targetLoad = INT_MAX;
+    for (RecordingWorker *worker : m_workers) {
+        int load = worker->recorderCount();
+        if (load < targetLoad) {
+            target = worker;
+            targetLoad = load;
+        }
+    }
+
+    if (!target || (targetLoad > 0 && m_workers.size() < m_maxWorkers)) {
+        target = new RecordingWorker(m_workers.size());
+        target->start();
+        m_workers.append(target);
+        qInfo() << "RecordingService: mux workers:" << m_workers.size() << "/" << m_maxWorkers;
+    }
+
+    target->attach(recorder);
+    m_assignments.insert(recorder, target);
+    return true;
+}
+
+void RecordingService::detach(Recorder *recorder)
+{
+    RecordingWorker *worker = Q_NULLPTR;
+    {
+        QMutexLocker locker(&m_mutex);
+        worker = m_assignments.take(recorder);
+    }
+    // outside the service lock: other devices keep attaching while this one flushes
+    if (worker) {
+        worker->detach(recorder);
+    }
+}
+
+int RecordingService::maxWorkers() const
+{
+    return m_maxWorkers;
+}
+
+int RecordingService::workerCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_workers.size();
+}
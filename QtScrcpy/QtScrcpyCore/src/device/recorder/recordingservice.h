@@ -0,0 +1,81 @@
+#ifndef RECORDINGSERVICE_H
+#define RECORDINGSERVICE_H
+
+#include <atomic>
+
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+class Recorder;
+
+/**
+ * RecordingWorker - One mux thread shared by several recorders
+ *
+ * Every RECORDING_FLUSH_INTERVAL_MS (or earlier when a queue fills up) the worker drains
+ * the packet queues of all its recorders in one pass, so writes reach the muxers and the
+ * AVIO buffers in batches instead of one thread wake-up per packet per device.
+ */
+class RecordingWorker : public QThread
+{
+    Q_OBJECT
+public:
+    explicit RecordingWorker(int index, QObject *parent = Q_NULLPTR);
+    virtual ~RecordingWorker();
+
+    void attach(Recorder *recorder);
+    // blocks until the recorder has been drained, finished and removed
+    void detach(Recorder *recorder);
+    // any thread, coalesced: at most one pending wake-up
+    void wakeUp();
+    // finish every remaining recorder and end the thread
+    void stop();
+    int recorderCount() const;
+
+protected:
+    void run() override;
+
+private:
+    int m_index = 0;
+    mutable QMutex m_mutex;
+    QWaitCondition m_wakeCond;
+    QWaitCondition m_detachedCond;
+    QVector<Recorder *> m_recorders;
+    std::atomic<bool> m_wakePending;
+    bool m_quit = false;
+};
+
+/**
+ * RecordingService - Small pool of mux workers for the whole farm
+ *
+ * Recording N devices costs at most RecordingService::maxWorkers() threads instead of N.
+ * Recorders are assigned to the least loaded worker; a new worker is only started
+ * while every existing one is busy and the limit is not reached.
+ * The limit defaults to a quarter of the cores (1..4), QTSCRCPY_RECORDING_WORKERS overrides it.
+ */
+class RecordingService
+{
+public:
+    static RecordingService &instance();
+
+    bool attach(Recorder *recorder);
+    void detach(Recorder *recorder);
+
+    int maxWorkers() const;
+    int workerCount() const;
+
+private:
+    RecordingService();
+    ~RecordingService();
+    Q_DISABLE_COPY(RecordingService)
+
+private:
+    mutable QMutex m_mutex;
+    QVector<RecordingWorker *> m_workers;
+    QHash<Recorder *, RecordingWorker *> m_assignments;
+    int m_maxWorkers = 1;
+};
+
+#endif // RECORDINGSERVICE_H
@@ -0,0 +1,178 @@
+#include <QDebug>
+#include <QImage>
+#include <QImageWriter>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+
+#include "screenshotengine.h"
+#include "yuvconvert.h"
+
+extern "C"
+{
+#include "libavutil/frame.h"
+#include "libswscale/swscale.h"
+}
+
+// idle SwsContexts kept across screenshots, one per worker is enough for a uniform farm
+#define SCREENSHOT_MAX_IDLE_CONTEXTS 32
+
+class ScreenshotJob : public QRunnable
+{
+public:
+    ScreenshotJob(const QString &serial, AVFrame *frame, const QString &filePath, const QByteArray &format, int quality)
+        : m_serial(serial), m_frame(frame), m_filePath(filePath), m_format(format), m_quality(quality)
+    {
+        setAutoDelete(true);
+    }
+
+    void run() override
+    {
+        ScreenshotEngine::instance().encode(m_serial, m_frame, m_filePath, m_format, m_quality);
+    }
+
+private:
+    QString m_serial;
+    AVFrame *m_frame = Q_NULLPTR;
+    QString m_filePath;
+    QByteArray m_format;
+    int m_quality = -1;
+};
+
+ScreenshotEngine::ScreenshotEngine(QObject *parent) : QObject(parent)
+{
+    // leave a core for the GUI and the demuxers
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+    m_pool.setExpiryTimeout(30000);
+}
+
+ScreenshotEngine::~ScreenshotEngine()
+{
+    m_pool.waitForDone();
+
+    QMutexLocker locker(&m_contextMutex);
+    for (SwsContext *context : m_idleContexts) {
+        sws_freeContext(context);
+    }
+    m_idleContexts.clear();
+}
+
+ScreenshotEngine &ScreenshotEngine::instance()
+{
+    static ScreenshotEngine engine;
+    return engine;
+}
+
+bool ScreenshotEngine::submit(const QString &serial, AVFrame *frame, const QString &filePath, const QByteArray &format, int quality)
+{
+    if (!frame) {
+        return false;
+    }
+    if (filePath.isEmpty() || frame->width <= 0 || frame->height <= 0) {
+        av_frame_free(&frame);
+        return false;
+    }
+
+    m_pending.ref();
+    m_pool.start(new ScreenshotJob(serial, frame, filePath, format, quality));
+    return true;
+}
+
+QByteArray ScreenshotEngine::resolveFormat(const QByteArray &format)
+{
+    QByteArray lower = format.toLower();
+    if (lower == "jpeg") {
+        lower = "jpg";
+    }
+    if (lower.isEmpty() || !QImageWriter::supportedImageFormats().contains(lower)) {
+        if (!lower.isEmpty() && lower != "png") {
+            qWarning() << "ScreenshotEngine: image format not supported, using png:" << format;
+        }
+        return "png";
+    }
+    return lower;
+}
+
+void ScreenshotEngine::setMaxThreads(int count)
+{
+    m_pool.setMaxThreadCount(qMax(1, count));
+}
+
+int ScreenshotEngine::pendingCount() const
+{
+    return m_pending.loadAcquire();
+}
+
+void ScreenshotEngine::encode(const QString &serial, AVFrame *frame, const QString &filePath, const QByteArray &format, int quality)
+{
+    bool success = false;
+    const int width = frame->width;
+    const int height = frame->height;
+    const int pixelFormat = frame->format;
+
+    if (YuvConvert::supports(frame, 1)) {
+        // the decoder's own format, vectorized and without a context
+        QImage image(width, height, QImage::Format_RGB32);
+        if (!image.isNull() && YuvConvert::toRgb32(frame, 1, image.bits(), static_cast<int>(image.bytesPerLine()))) {
+            success = image.save(filePath, format.constData(), quality);
+        }
+    } else if (SwsContext *context = acquireContext(width, height, pixelFormat)) {
+        // convert straight into the image, no intermediate RGB buffer
+        QImage image(width, height, QImage::Format_RGB32);
+        if (!image.isNull()) {
+            uint8_t *dstData[4] = { image.bits(), Q_NULLPTR, Q_NULLPTR, Q_NULLPTR };
+            int dstLinesize[4] = { static_cast<int>(image.bytesPerLine()), 0, 0, 0 };
+            if (sws_scale(context, static_cast<const uint8_t *const *>(frame->data), frame->linesize, 0, height, dstData, dstLinesize) > 0) {
+                success = image.save(filePath, format.constData(), quality);
+            }
+        }
+        releaseContext(width, height, pixelFormat, context);
+    } else {
+        qWarning() << "ScreenshotEngine: no converter for pixel format" << pixelFormat << "serial:" << serial;
+    }
+
+    // drop our reference before reporting, the decoder may be waiting to reuse the buffer pool
+    av_frame_free(&frame);
+    m_pending.deref();
+
+    if (success) {
+        qInfo() << "screenshot save to " << filePath;
+    } else {
+        qWarning() << "ScreenshotEngine: failed to save screenshot for" << serial << "to" << filePath;
+    }
+    emit screenshotSaved(serial, filePath, success);
+}
+
+SwsContext *ScreenshotEngine::acquireContext(int width, int height, int format)
+{
+    const quint64 key = contextKey(width, height, format);
+    {
+        QMutexLocker locker(&m_contextMutex);
+        auto it = m_idleContexts.find(key);
+        if (it != m_idleContexts.end()) {
+            SwsContext *context = it.value();
+            m_idleContexts.erase(it);
+            return context;
+        }
+    }
+
+    // same size in and out: the filter only upsamples chroma, bilinear is indistinguishable from bicubic here
+    return sws_getContext(width, height, static_cast<AVPixelFormat>(format), width, height, AV_PIX_FMT_RGB32, SWS_BILINEAR, Q_NULLPTR, Q_NULLPTR, Q_NULLPTR);
+}
+
+void ScreenshotEngine::releaseContext(int width, int height, int format, SwsContext *context)
+{
+    QMutexLocker locker(&m_contextMutex);
+    if (m_idleContexts.size() >= SCREENSHOT_MAX_IDLE_CONTEXTS) {
+        locker.unlock();
+        sws_freeContext(context);
+        return;
+    }
+    m_idleContexts.insert(contextKey(width, height, format), context);
+}
+
+quint64 ScreenshotEngine::contextKey(int width, int height, int format)
+{
+    return (static_cast<quint64>(static_cast<quint16>(format)) << 48) | (static_cast<quint64>(width & 0xffffff) << 24)
+           | static_cast<quint64>(height & 0xffffff);
+}
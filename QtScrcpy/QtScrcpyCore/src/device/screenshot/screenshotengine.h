@@ -0,0 +1,69 @@
+#ifndef SCREENSHOTENGINE_H
+#define SCREENSHOTENGINE_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QMultiHash>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+// forward declarations
+typedef struct AVFrame AVFrame;
+struct SwsContext;
+
+/**
+ * ScreenshotEngine - Farm-wide screenshot conversion and encoding
+ *
+ * Devices hand over a reference to their last decoded frame (av_frame_ref, no pixel copy),
+ * so taking a snapshot costs the decoder nothing more than a refcount bump under the
+ * VideoBuffer lock. YUV->RGB conversion and PNG/JPEG/WebP encoding then run on a private
+ * worker pool, never on the GUI or demuxer threads.
+ *
+ * YUV420P frames, i.e. everything the decoder produces, go through the YuvConvert kernels.
+ * For other formats swscale is kept; SwsContexts are not thread safe, so idle ones are cached
+ * per (size, pixel format) and checked out by one worker at a time instead of being rebuilt
+ * for every screenshot.
+ */
+class ScreenshotEngine : public QObject
+{
+    Q_OBJECT
+public:
+    static ScreenshotEngine &instance();
+
+    // Takes ownership of frame (a reference, released with av_frame_free) in every case.
+    // format as returned by resolveFormat(), quality -1 means the writer default.
+    bool submit(const QString &serial, AVFrame *frame, const QString &filePath, const QByteArray &format, int quality);
+
+    // Normalized QImageWriter format ("png", "jpg", "webp"), also used as the file suffix.
+    // Falls back to png when the format cannot be written (WebP needs the imageformats plugin).
+    static QByteArray resolveFormat(const QByteArray &format);
+
+    void setMaxThreads(int count);
+    int pendingCount() const;
+
+signals:
+    // emitted from a worker thread
+    void screenshotSaved(const QString &serial, const QString &filePath, bool success);
+
+private:
+    friend class ScreenshotJob;
+    explicit ScreenshotEngine(QObject *parent = Q_NULLPTR);
+    virtual ~ScreenshotEngine();
+
+    void encode(const QString &serial, AVFrame *frame, const QString &filePath, const QByteArray &format, int quality);
+    SwsContext *acquireContext(int width, int height, int format);
+    void releaseContext(int width, int height, int format, SwsContext *context);
+
+    static quint64 contextKey(int width, int height, int format);
+
+private:
+    QThreadPool m_pool;
+    QAtomicInt m_pending;
+
+    QMutex m_contextMutex;
+    QMultiHash<quint64, SwsContext *> m_idleContexts;
+};
+
+#endif // SCREENSHOTENGINE_H
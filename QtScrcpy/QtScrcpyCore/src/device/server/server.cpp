@@ -33,6 +33,10 @@ Server::Server(QObject *parent) : QObject(parent)
                 emit serverStarted(false);
                 return;
             }
+            if (!m_params.control) {
+                // video only session, no control socket will follow
+                stopAcceptTimeoutTimer();
+            }
             // Use async reading instead of synchronous readInfo() to avoid race condition
             qInfo("Video socket connected, starting async read of device info...");
             startAsyncReadInfo(m_videoSocket);
@@ -468,10 +472,7 @@ void Server::startAsyncConnect()
 
     // Create new sockets
     VideoSocket *videoSocket = new VideoSocket(this);
-    QTcpSocket *controlSocket = new QTcpSocket(this);
-
     m_pendingVideoSocket = videoSocket;
-    m_pendingControlSocket = controlSocket;
 
     // Connect video socket signals
     connect(videoSocket, &VideoSocket::connected,
@@ -481,6 +482,18 @@ void Server::startAsyncConnect()
             this, &Server::onVideoSocketError,
             Qt::UniqueConnection);
 
+    // Start async connections
+    qDebug() << "Connecting to localhost:" << m_params.localPort;
+    videoSocket->connectToHost(QHostAddress::LocalHost, m_params.localPort);
+
+    // video only session: the device accepts a single connection
+    if (!m_params.control) {
+        return;
+    }
+
+    QTcpSocket *controlSocket = new QTcpSocket(this);
+    m_pendingControlSocket = controlSocket;
+
     // Connect control socket signals
     connect(controlSocket, &QTcpSocket::connected,
             this, &Server::onControlSocketConnected,
@@ -489,9 +502,6 @@ void Server::startAsyncConnect()
             this, &Server::onControlSocketError,
             Qt::UniqueConnection);
 
-    // Start async connections
-    qDebug() << "Connecting to localhost:" << m_params.localPort;
-    videoSocket->connectToHost(QHostAddress::LocalHost, m_params.localPort);
     controlSocket->connectToHost(QHostAddress::LocalHost, m_params.localPort);
 }
 
@@ -614,7 +624,7 @@ void Server::onVideoSocketReadyRead()
     // Check if we can finalize connection based on mode
     if (m_pendingVideoSocket) {
         // Forward tunnel mode - wait for control socket
-        if (m_controlSocketReady) {
+        if (m_controlSocketReady || !m_params.control) {
             stopConnectTimeoutTimer();
             m_videoSocket = m_pendingVideoSocket;
             m_controlSocket = m_pendingControlSocket;
@@ -635,7 +645,7 @@ void Server::onVideoSocketReadyRead()
         // Reverse tunnel mode - device info received
         // Check if control socket is also ready
         qInfo("Device info received in reverse mode, checking for control socket...");
-        if (m_controlSocket && m_controlSocket->isValid()) {
+        if (!m_params.control || (m_controlSocket && m_controlSocket->isValid())) {
             // Both sockets ready - emit success!
             qInfo("Control socket already connected, emitting serverStarted(true)");
             m_serverSocket.close();
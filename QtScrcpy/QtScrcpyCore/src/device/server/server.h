@@ -51,7 +51,7 @@ public:
         QString codecName = "";
 
         QString crop = "";             // 视频裁剪
-        bool control = true;           // 安卓端是否接收键鼠控制
+        bool control = true;           // 安卓端是否接收键鼠控制，false时只有视频连接（同一设备的附加视频会话）
         qint32 scid = -1;             // 随机数，作为localsocket名字后缀，方便同时连接同一个设备多次
     };
 
@@ -0,0 +1,256 @@
+#include <chrono>
+
+#include <QMutexLocker>
+#include <QtAlgorithms>
+
+#include "stagelatency.h"
+
+namespace qsc {
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+int LatencyHistogram::bucketIndex(qint64 us)
+{
+    if (us < SUB_BUCKETS) {
+        return us < 0 ? 0 : static_cast<int>(us);
+    }
+    // magnitude m >= 1 covers [16 << (m - 1), 16 << m) with 16 buckets of width 1 << (m - 1)
+    int msb = 63 - qCountLeadingZeroBits(static_cast<quint64>(us));
+    int magnitude = msb - SUB_BUCKET_BITS + 1;
+    if (magnitude > MAX_MAGNITUDE) {
+        return BUCKET_COUNT - 1;
+    }
+    int sub = static_cast<int>((us >> (magnitude - 1)) & (SUB_BUCKETS - 1));
+    return magnitude * SUB_BUCKETS + sub;
+}
+
+qint64 LatencyHistogram::bucketValue(int index)
+{
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    int magnitude = index / SUB_BUCKETS;
+    qint64 width = Q_INT64_C(1) << (magnitude - 1);
+    qint64 lower = static_cast<qint64>(SUB_BUCKETS + index % SUB_BUCKETS) << (magnitude - 1);
+    return lower + width / 2;
+}
+
+void LatencyHistogram::record(qint64 us)
+{
+    if (us < 0) {
+        us = 0;
+    }
+    m_buckets[bucketIndex(us)].fetch_add(1, std::memory_order_relaxed);
+    m_sumUs.fetch_add(us, std::memory_order_relaxed);
+    qint64 max = m_maxUs.load(std::memory_order_relaxed);
+    while (us > max && !m_maxUs.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset()
+{
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        m_buckets[i].store(0, std::memory_order_relaxed);
+    }
+    m_sumUs.store(0, std::memory_order_relaxed);
+    m_maxUs.store(0, std::memory_order_relaxed);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const
+{
+    // not atomic as a whole: a concurrent record() may show in its bucket but not yet in the sum
+    Snapshot snapshot;
+    snapshot.buckets.resize(BUCKET_COUNT);
+    quint64 count = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        snapshot.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+        count += snapshot.buckets[i];
+    }
+    snapshot.count = count;
+    snapshot.sumUs = m_sumUs.load(std::memory_order_relaxed);
+    snapshot.maxUs = m_maxUs.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+qint64 LatencyHistogram::Snapshot::percentile(double pct) const
+{
+    if (count == 0) {
+        return 0;
+    }
+    quint64 rank = static_cast<quint64>(qBound(0.0, pct, 100.0) / 100.0 * count);
+    if (rank >= count) {
+        rank = count - 1;
+    }
+    quint64 seen = 0;
+    for (int i = 0; i < buckets.size(); i++) {
+        seen += buckets.at(i);
+        if (seen > rank) {
+            return qMin(bucketValue(i), maxUs);
+        }
+    }
+    return maxUs;
+}
+
+double LatencyHistogram::Snapshot::meanUs() const
+{
+    return count > 0 ? static_cast<double>(sumUs) / count : 0.0;
+}
+
+void LatencyHistogram::Snapshot::merge(const Snapshot &other)
+{
+    if (buckets.isEmpty()) {
+        buckets.resize(BUCKET_COUNT);
+    }
+    for (int i = 0; i < other.buckets.size() && i < buckets.size(); i++) {
+        buckets[i] += other.buckets.at(i);
+    }
+    count += other.count;
+    sumUs += other.sumUs;
+    maxUs = qMax(maxUs, other.maxUs);
+}
+
+StageLatency::StageLatency() {}
+
+bool StageLatency::isEnabled()
+{
+    static const bool enabled = qgetenv("QTSCRCPY_STAGE_LATENCY") != "0";
+    return enabled;
+}
+
+qint64 StageLatency::now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char *StageLatency::stageName(Stage stage)
+{
+    switch (stage) {
+    case SL_SOCKET_READ:
+        return "socket_read";
+    case SL_PARSE:
+        return "parse";
+    case SL_DECODE:
+        return "decode";
+    case SL_QUEUE_WAIT:
+        return "queue_wait";
+    case SL_TEXTURE_UPLOAD:
+        return "texture_upload";
+    case SL_PAINT:
+        return "paint";
+    default:
+        return "unknown";
+    }
+}
+
+void StageLatency::record(Stage stage, qint64 us)
+{
+    m_histograms[stage].record(us);
+}
+
+void StageLatency::recordSince(Stage stage, qint64 startUs)
+{
+    m_histograms[stage].record(now() - startUs);
+}
+
+LatencyHistogram::Snapshot StageLatency::snapshot(Stage stage) const
+{
+    return m_histograms[stage].snapshot();
+}
+
+void StageLatency::reset()
+{
+    for (int i = 0; i < SL_COUNT; i++) {
+        m_histograms[i].reset();
+    }
+}
+
+StageLatencyRegistry::StageLatencyRegistry() {}
+
+StageLatencyRegistry::~StageLatencyRegistry()
+{
+    qDeleteAll(m_devices);
+}
+
+StageLatencyRegistry &StageLatencyRegistry::instance()
+{
+    static StageLatencyRegistry registry;
+    return registry;
+}
+
+StageLatency *StageLatencyRegistry::device(const QString &serial)
+{
+    if (!StageLatency::isEnabled() || serial.isEmpty()) {
+        return Q_NULLPTR;
+    }
+    QMutexLocker locker(&m_mutex);
+    StageLatency *&latency = m_devices[serial];
+    if (!latency) {
+        latency = new StageLatency();
+    }
+    return latency;
+}
+
+QStringList StageLatencyRegistry::serials() const
+{
+    QMutexLocker locker(&m_mutex);
+    QStringList serials = m_devices.keys();
+    serials.sort();
+    return serials;
+}
+
+LatencyHistogram::Snapshot StageLatencyRegistry::farmSnapshot(StageLatency::Stage stage) const
+{
+    LatencyHistogram::Snapshot merged;
+    QMutexLocker locker(&m_mutex);
+    for (const StageLatency *latency : m_devices) {
+        merged.merge(latency->snapshot(stage));
+    }
+    return merged;
+}
+
+QString StageLatencyRegistry::dump() const
+{
+    QString text = QString("%1 %2 %3 %4 %5 %6 %7 %8\n")
+                       .arg(QString("serial"), -24)
+                       .arg(QString("stage"), -15)
+                       .arg(QString("count"), 10)
+                       .arg(QString("mean"), 8)
+                       .arg(QString("p50"), 8)
+                       .arg(QString("p90"), 8)
+                       .arg(QString("p99"), 8)
+                       .arg(QString("max"), 8);
+    const QStringList serialList = serials();
+    QMutexLocker locker(&m_mutex);
+    for (const QString &serial : serialList) {
+        const StageLatency *latency = m_devices.value(serial);
+        for (int s = 0; s < StageLatency::SL_COUNT; s++) {
+            LatencyHistogram::Snapshot snapshot = latency->snapshot(static_cast<StageLatency::Stage>(s));
+            if (snapshot.count == 0) {
+                continue;
+            }
+            text += QString("%1 %2 %3 %4 %5 %6 %7 %8\n")
+                        .arg(serial, -24)
+                        .arg(QString(StageLatency::stageName(static_cast<StageLatency::Stage>(s))), -15)
+                        .arg(snapshot.count, 10)
+                        .arg(snapshot.meanUs() / 1000.0, 8, 'f', 2)
+                        .arg(snapshot.percentile(50) / 1000.0, 8, 'f', 2)
+                        .arg(snapshot.percentile(90) / 1000.0, 8, 'f', 2)
+                        .arg(snapshot.percentile(99) / 1000.0, 8, 'f', 2)
+                        .arg(snapshot.maxUs / 1000.0, 8, 'f', 2);
+        }
+    }
+    return text;
+}
+
+void StageLatencyRegistry::resetAll()
+{
+    QMutexLocker locker(&m_mutex);
+    for (StageLatency *latency : m_devices) {
+        latency->reset();
+    }
+}
+
+}
@@ -5,7 +5,9 @@
 
 #include "devicemanage.h"
 #include "device.h"
+#include "controlmsg.h"
 #include "demuxer.h"
+#include "screenshotengine.h"
 
 namespace qsc {
 
@@ -18,6 +20,8 @@ IDeviceManage& IDeviceManage::getInstance() {
 
 DeviceManage::DeviceManage() {
     Demuxer::init();
+    // workers emit from their own threads, delivered queued
+    connect(&ScreenshotEngine::instance(), &ScreenshotEngine::screenshotSaved, this, &IDeviceManage::screenshotSaved);
 }
 
 DeviceManage::~DeviceManage() {
@@ -122,6 +126,7 @@ bool DeviceManage::connectDevice(qsc::DeviceParams params)
     qInfo() << "DeviceManage: Connecting Device signals...";
     connect(device, &Device::deviceConnected, this, &DeviceManage::onDeviceConnected);
     connect(device, &Device::deviceDisconnected, this, &DeviceManage::onDeviceDisconnected);
+    connect(static_cast<Device *>(device), &Device::clipboardAcked, this, &IDeviceManage::clipboardAcked);
 
     // Add device to map BEFORE connecting to make it available for signal handlers
     qInfo() << "DeviceManage: Adding device to m_devices map";
@@ -178,6 +183,36 @@ void DeviceManage::disconnectAllDevice()
     }
 }
 
+quint64 DeviceManage::broadcastClipboard(const QStringList &serials, const QString &text, bool paste)
+{
+    // PERFORMANCE OPTIMIZATION: one UTF-8 encode for the whole group, every device
+    // queues the same implicitly shared buffer
+    quint64 sequence = ++m_clipboardSequence;
+    const QByteArray encoded = ControlMsg::serializeSetClipboard(text, paste, sequence);
+
+    for (const QString &serial : serials) {
+        auto device = qobject_cast<Device *>(m_devices.value(serial).data());
+        if (!device) {
+            continue;
+        }
+        device->postEncodedControl(encoded, sequence);
+    }
+    return sequence;
+}
+
+void DeviceManage::broadcastTextInput(const QStringList &serials, const QString &text)
+{
+    const QByteArray encoded = ControlMsg::serializeInjectText(text);
+
+    for (const QString &serial : serials) {
+        auto device = qobject_cast<Device *>(m_devices.value(serial).data());
+        if (!device) {
+            continue;
+        }
+        device->postEncodedControl(encoded);
+    }
+}
+
 void DeviceManage::onDeviceConnected(bool success, const QString &serial, const QString &deviceName, const QSize &size)
 {
     qInfo() << "========================================";
@@ -236,4 +271,21 @@ void DeviceManage::removeDevice(const QString &serial)
     }
 }
 
+int DeviceManage::screenshotAll(const QStringList &serials, const QString &dirPath, const QString &format, int quality)
+{
+    const QByteArray resolvedFormat = ScreenshotEngine::resolveFormat(format.toLatin1());
+
+    int queued = 0;
+    for (const QString &serial : serials) {
+        auto device = qobject_cast<Device *>(m_devices.value(serial).data());
+        if (!device) {
+            continue;
+        }
+        if (device->saveScreenshot(dirPath, resolvedFormat, quality)) {
+            queued++;
+        }
+    }
+    return queued;
+}
+
 }
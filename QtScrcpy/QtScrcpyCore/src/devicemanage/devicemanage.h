@@ -21,6 +21,10 @@ public:
     bool disconnectDevice(const QString &serial) override;
     void disconnectAllDevice() override;
 
+    quint64 broadcastClipboard(const QStringList &serials, const QString &text, bool paste) override;
+    void broadcastTextInput(const QStringList &serials, const QString &text) override;
+    int screenshotAll(const QStringList &serials, const QString &dirPath, const QString &format, int quality = -1) override;
+
 protected slots:
     void onDeviceConnected(bool success, const QString& serial, const QString& deviceName, const QSize& size);
     void onDeviceDisconnected(QString serial);
@@ -33,6 +37,8 @@ private:
     QMap<QString, QPointer<IDevice>> m_devices;
     quint16 m_localPortStart = 27183;
     QString m_script;
+    // 0 means "no ack requested" for the server, start from 1
+    quint64 m_clipboardSequence = 0;
 };
 
 }
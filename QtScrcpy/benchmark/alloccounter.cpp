@@ -0,0 +1,88 @@
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+
+#include "alloccounter.h"
+
+#if defined(__GLIBC__)
+
+// glibc exports its allocator under these names for exactly this purpose
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t count, size_t size);
+    void *__libc_realloc(void *ptr, size_t size);
+    void *__libc_memalign(size_t alignment, size_t size);
+}
+
+// constant-initialized: malloc() may run before any static constructor
+static std::atomic<quint64> g_allocations(0);
+
+extern "C" void *malloc(size_t size) noexcept
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) noexcept
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size) noexcept
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void *memalign(size_t alignment, size_t size) noexcept
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" void *aligned_alloc(size_t alignment, size_t size) noexcept
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+
+// av_malloc() goes through here
+extern "C" int posix_memalign(void **ptr, size_t alignment, size_t size) noexcept
+{
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = __libc_memalign(alignment, size);
+    if (!p) {
+        return ENOMEM;
+    }
+    *ptr = p;
+    return 0;
+}
+
+bool AllocCounter::isSupported()
+{
+    return true;
+}
+
+quint64 AllocCounter::count()
+{
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+#else
+
+bool AllocCounter::isSupported()
+{
+    return false;
+}
+
+quint64 AllocCounter::count()
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef ALLOCCOUNTER_H
+#define ALLOCCOUNTER_H
+
+#include <QtGlobal>
+
+/**
+ * AllocCounter - Process-wide heap allocation count for the benchmarks
+ *
+ * On glibc the benchmark executable interposes malloc() and friends, so allocations
+ * made by FFmpeg, Qt and the GL driver are all counted. Elsewhere isSupported() is
+ * false and count() stays 0.
+ */
+namespace AllocCounter
+{
+bool isSupported();
+quint64 count();
+}
+
+#endif // ALLOCCOUNTER_H
@@ -0,0 +1,537 @@
+#include <atomic>
+#include <cstring>
+#include <ctime>
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QSemaphore>
+#include <QTextStream>
+#include <QThread>
+
+extern "C"
+{
+#include "libavutil/avutil.h"
+}
+
+#include "alloccounter.h"
+#include "decoder.h"
+#include "demuxer.h"
+#include "h264loop.h"
+#include "qyuvopenglwidget.h"
+
+#define BENCH_DEFAULT_SIZE QSize(720, 1600)
+#define BENCH_DEFAULT_FPS 30
+#define BENCH_DEFAULT_BIT_RATE 4000000
+#define BENCH_LOOP_SECONDS 4
+#define BENCH_WARMUP_PACKETS 30
+#define SC_PACKET_FLAG_CONFIG (UINT64_C(1) << 63)
+#define SC_PACKET_FLAG_KEY_FRAME (UINT64_C(1) << 62)
+
+enum BenchStage
+{
+    BS_RECV = 0, // Demuxer::recvPacket, from memory instead of the socket
+    BS_PARSE,    // Demuxer::pushPacket without the decoder
+    BS_DECODE,   // Decoder::push, including the VideoBuffer hand-off
+    BS_RENDER,   // QYUVOpenGLWidget texture upload and paint, until glFinish()
+    BS_COUNT
+};
+
+static const char *const s_stageNames[BS_COUNT] = { "recv", "parse", "decode", "render" };
+
+// CPU time of the calling thread or of the whole process, 0 where unsupported
+static qint64 cpuTimeNs(bool thread)
+{
+#ifdef Q_OS_UNIX
+    timespec ts;
+    if (clock_gettime(thread ? CLOCK_THREAD_CPUTIME_ID : CLOCK_PROCESS_CPUTIME_ID, &ts) == 0) {
+        return static_cast<qint64>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+#else
+    Q_UNUSED(thread)
+#endif
+    return 0;
+}
+
+struct StageStats
+{
+    qint64 wallNs = 0;
+    qint64 cpuNs = 0;
+    quint64 allocs = 0;
+    qint64 count = 0;
+};
+
+// wall, thread CPU and allocations of one call, nested calls are subtracted by the caller
+struct StageSample
+{
+    qint64 wallNs = 0;
+    qint64 cpuNs = 0;
+    quint64 allocs = 0;
+
+    static StageSample now()
+    {
+        static QElapsedTimer clock;
+        if (!clock.isValid()) {
+            clock.start();
+        }
+        StageSample sample;
+        sample.wallNs = clock.nsecsElapsed();
+        sample.cpuNs = cpuTimeNs(true);
+        sample.allocs = AllocCounter::count();
+        return sample;
+    }
+
+    StageSample operator-(const StageSample &other) const
+    {
+        StageSample diff;
+        diff.wallNs = wallNs - other.wallNs;
+        diff.cpuNs = cpuNs - other.cpuNs;
+        diff.allocs = allocs - other.allocs;
+        return diff;
+    }
+};
+
+static void addSample(StageStats &stats, const StageSample &sample)
+{
+    stats.wallNs += sample.wallNs;
+    stats.cpuNs += sample.cpuNs;
+    stats.allocs += sample.allocs;
+    stats.count++;
+}
+
+static void bufferWrite32be(char *buf, quint32 value)
+{
+    buf[0] = static_cast<char>(value >> 24);
+    buf[1] = static_cast<char>(value >> 16);
+    buf[2] = static_cast<char>(value >> 8);
+    buf[3] = static_cast<char>(value);
+}
+
+static void appendPacket(QByteArray &stream, const QByteArray &data, quint64 ptsFlags)
+{
+    char header[12];
+    bufferWrite32be(header, static_cast<quint32>(ptsFlags >> 32));
+    bufferWrite32be(&header[4], static_cast<quint32>(ptsFlags));
+    bufferWrite32be(&header[8], static_cast<quint32>(data.size()));
+    stream.append(header, sizeof(header));
+    stream.append(data);
+}
+
+/**
+ * Capture - An H.264 capture framed exactly like the scrcpy video socket
+ * (config packet, then 12-byte pts/flags + size headers), replayed from memory
+ */
+struct Capture
+{
+    QByteArray stream;
+    int loopStart = 0; // first frame, after the config packet
+    int frameCount = 0;
+    QSize size;
+
+    bool build(const H264Loop &loop, const QSize &frameSize, int fps)
+    {
+        size = frameSize;
+        stream.clear();
+        appendPacket(stream, loop.config(), SC_PACKET_FLAG_CONFIG);
+        loopStart = stream.size();
+        const QVector<H264Loop::Frame> &frames = loop.frames();
+        for (int i = 0; i < frames.size(); i++) {
+            quint64 pts = static_cast<quint64>(i) * 1000000 / static_cast<quint64>(fps);
+            appendPacket(stream, frames.at(i).data, pts | (frames.at(i).keyframe ? SC_PACKET_FLAG_KEY_FRAME : 0));
+        }
+        frameCount = frames.size();
+        return frameCount > 0;
+    }
+};
+
+/**
+ * ReplayDemuxer - The real Demuxer, reading a Capture instead of the video socket
+ *
+ * The capture loops forever (back to its first keyframe). run() is used for the scaling
+ * runs; the single-device run calls recv() and push() from the main thread to time each stage.
+ */
+class ReplayDemuxer : public Demuxer
+{
+public:
+    ReplayDemuxer(const Capture *capture, int packets) : m_capture(capture), m_packets(packets) {}
+
+    bool open()
+    {
+        return openParser();
+    }
+
+    void close()
+    {
+        closeParser();
+    }
+
+    bool recv(AVPacket *packet)
+    {
+        return recvPacket(packet);
+    }
+
+    bool push(AVPacket *packet)
+    {
+        return pushPacket(packet);
+    }
+
+    // scaling runs: warm up, report ready, wait for the start signal, then replay
+    void setBarrier(QSemaphore *ready, QSemaphore *start)
+    {
+        m_ready = ready;
+        m_start = start;
+    }
+
+protected:
+    qint32 recvData(quint8 *buf, qint32 bufSize) override
+    {
+        const QByteArray &stream = m_capture->stream;
+        if (m_offset + bufSize > stream.size()) {
+            // packets never straddle the end of the capture
+            m_offset = m_capture->loopStart;
+        }
+        memcpy(buf, stream.constData() + m_offset, static_cast<size_t>(bufSize));
+        m_offset += bufSize;
+        return bufSize;
+    }
+
+    void run() override
+    {
+        AVPacket *packet = av_packet_alloc();
+        bool ok = packet && open();
+        for (int i = 0; ok && i < BENCH_WARMUP_PACKETS; i++) {
+            ok = recvPacket(packet) && pushPacket(packet);
+            av_packet_unref(packet);
+        }
+        m_ready->release();
+        m_start->acquire();
+        for (int i = 0; ok && i < m_packets; i++) {
+            ok = recvPacket(packet) && pushPacket(packet);
+            av_packet_unref(packet);
+        }
+        close();
+        av_packet_free(&packet);
+    }
+
+private:
+    const Capture *m_capture = Q_NULLPTR;
+    int m_packets = 0;
+    int m_offset = 0;
+    QSemaphore *m_ready = Q_NULLPTR;
+    QSemaphore *m_start = Q_NULLPTR;
+};
+
+// paintGL() on demand, without waiting for the next vsync-driven update
+class BenchVideoWidget : public QYUVOpenGLWidget
+{
+public:
+    bool isReady()
+    {
+        return context() && context()->isValid();
+    }
+
+    void renderNow()
+    {
+        makeCurrent();
+        paintGL();
+        context()->functions()->glFinish();
+        doneCurrent();
+    }
+};
+
+static QJsonObject stageJson(const StageStats &stats, qint64 frames)
+{
+    QJsonObject json;
+    double n = qMax<qint64>(1, frames);
+    json["calls"] = stats.count;
+    json["wall_us_per_frame"] = stats.wallNs / n / 1000.0;
+    json["cpu_us_per_frame"] = stats.cpuNs / n / 1000.0;
+    json["allocs_per_frame"] = stats.allocs / n;
+    json["throughput_fps"] = stats.wallNs > 0 ? frames * 1e9 / stats.wallNs : 0.0;
+    return json;
+}
+
+// one device in the main thread, every stage timed separately
+static QJsonObject runSingle(const Capture &capture, int frames, bool render, QTextStream &out)
+{
+    StageStats stats[BS_COUNT];
+    bool timing = false;
+    qint64 framesOut = 0;
+    StageSample decodeNested;
+
+    BenchVideoWidget *widget = Q_NULLPTR;
+    if (render) {
+        widget = new BenchVideoWidget();
+        widget->resize(capture.size / 2);
+        widget->show();
+        QApplication::processEvents();
+        if (!widget->isReady()) {
+            out << "render: no OpenGL context, stage skipped\n";
+            delete widget;
+            widget = Q_NULLPTR;
+        }
+    }
+
+    Decoder decoder([&](int width, int height, uint8_t *dataY, uint8_t *dataU, uint8_t *dataV, int linesizeY, int linesizeU, int linesizeV) {
+        framesOut++;
+        if (!widget) {
+            return;
+        }
+        StageSample start = StageSample::now();
+        if (widget->frameSize() != QSize(width, height)) {
+            widget->setFrameSize(QSize(width, height));
+        }
+        widget->updateTextures(dataY, dataU, dataV, linesizeY, linesizeU, linesizeV);
+        widget->renderNow();
+        StageSample spent = StageSample::now() - start;
+        if (timing) {
+            addSample(stats[BS_RENDER], spent);
+        }
+        decodeNested = spent;
+    });
+
+    ReplayDemuxer demuxer(&capture, 0);
+    demuxer.setFrameSize(capture.size);
+    decoder.setFrameSize(capture.size);
+
+    StageSample parseNested;
+    QObject::connect(&demuxer, &Demuxer::getFrame, &demuxer, [&](AVPacket *packet) {
+        decodeNested = StageSample();
+        StageSample start = StageSample::now();
+        decoder.push(packet);
+        StageSample spent = StageSample::now() - start;
+        if (timing) {
+            addSample(stats[BS_DECODE], spent - decodeNested);
+        }
+        parseNested = spent;
+    }, Qt::DirectConnection);
+
+    AVPacket *packet = av_packet_alloc();
+    if (!packet || !demuxer.open()) {
+        av_packet_free(&packet);
+        return QJsonObject();
+    }
+
+    qint64 framesTimed = 0;
+    for (int i = 0; i < BENCH_WARMUP_PACKETS + frames; i++) {
+        timing = i >= BENCH_WARMUP_PACKETS;
+        if (i == BENCH_WARMUP_PACKETS) {
+            framesTimed = framesOut;
+        }
+
+        StageSample start = StageSample::now();
+        bool ok = demuxer.recv(packet);
+        StageSample recvDone = StageSample::now();
+        parseNested = StageSample();
+        ok = ok && demuxer.push(packet);
+        StageSample pushDone = StageSample::now();
+        av_packet_unref(packet);
+        if (!ok) {
+            break;
+        }
+        if (timing) {
+            addSample(stats[BS_RECV], recvDone - start);
+            addSample(stats[BS_PARSE], (pushDone - recvDone) - parseNested);
+        }
+    }
+    framesTimed = framesOut - framesTimed;
+
+    demuxer.close();
+    av_packet_free(&packet);
+    decoder.close();
+    bool rendered = widget != Q_NULLPTR;
+    delete widget;
+
+    QJsonObject stages;
+    StageStats total;
+    out << QString("single device, %1 packets, %2 frames decoded\n").arg(frames).arg(framesTimed);
+    out << QString("  %1 %2 %3 %4 %5\n").arg(QString("stage"), -8).arg(QString("wall us/f"), 10).arg(QString("cpu us/f"), 10).arg(QString("allocs/f"), 10).arg(QString("fps"), 10);
+    for (int s = 0; s < BS_COUNT; s++) {
+        if (s == BS_RENDER && !rendered) {
+            continue;
+        }
+        QJsonObject json = stageJson(stats[s], frames);
+        stages[s_stageNames[s]] = json;
+        total.wallNs += stats[s].wallNs;
+        total.cpuNs += stats[s].cpuNs;
+        total.allocs += stats[s].allocs;
+        out << QString("  %1 %2 %3 %4 %5\n")
+                   .arg(QString(s_stageNames[s]), -8)
+                   .arg(json["wall_us_per_frame"].toDouble(), 10, 'f', 1)
+                   .arg(json["cpu_us_per_frame"].toDouble(), 10, 'f', 1)
+                   .arg(json["allocs_per_frame"].toDouble(), 10, 'f', 1)
+                   .arg(json["throughput_fps"].toDouble(), 10, 'f', 0);
+    }
+    QJsonObject result;
+    result["packets"] = frames;
+    result["frames_decoded"] = framesTimed;
+    result["stages"] = stages;
+    result["total"] = stageJson(total, frames);
+    return result;
+}
+
+// N devices decoding concurrently on their own demuxer threads, like the farm (render excluded)
+static QJsonObject runScaling(const Capture &capture, int devices, int packets, QTextStream &out)
+{
+    std::atomic<qint64> framesOut{ 0 };
+    QSemaphore ready;
+    QSemaphore start;
+    QVector<ReplayDemuxer *> demuxers;
+    QVector<Decoder *> decoders;
+
+    for (int i = 0; i < devices; i++) {
+        Decoder *decoder = new Decoder([&framesOut](int, int, uint8_t *, uint8_t *, uint8_t *, int, int, int) {
+            framesOut.fetch_add(1, std::memory_order_relaxed);
+        });
+        decoder->setFrameSize(capture.size);
+        ReplayDemuxer *demuxer = new ReplayDemuxer(&capture, packets);
+        demuxer->setFrameSize(capture.size);
+        demuxer->setBarrier(&ready, &start);
+        QObject::connect(demuxer, &Demuxer::getFrame, demuxer, [decoder](AVPacket *packet) {
+            decoder->push(packet);
+        }, Qt::DirectConnection);
+        decoders.append(decoder);
+        demuxers.append(demuxer);
+        demuxer->start();
+    }
+
+    // decoders are open and warm, start everyone at once
+    ready.acquire(devices);
+    qint64 framesBefore = framesOut.load();
+    quint64 allocsBefore = AllocCounter::count();
+    qint64 cpuBefore = cpuTimeNs(false);
+    QElapsedTimer wall;
+    wall.start();
+    start.release(devices);
+    for (ReplayDemuxer *demuxer : demuxers) {
+        demuxer->wait();
+    }
+    qint64 wallNs = wall.nsecsElapsed();
+    qint64 cpuNs = cpuTimeNs(false) - cpuBefore;
+    quint64 allocs = AllocCounter::count() - allocsBefore;
+    qint64 frames = framesOut.load() - framesBefore;
+
+    for (int i = 0; i < devices; i++) {
+        decoders.at(i)->close();
+        delete demuxers.at(i);
+        delete decoders.at(i);
+    }
+
+    double n = qMax<qint64>(1, frames);
+    QJsonObject result;
+    result["devices"] = devices;
+    result["frames"] = frames;
+    result["wall_s"] = wallNs / 1e9;
+    result["aggregate_fps"] = wallNs > 0 ? frames * 1e9 / wallNs : 0.0;
+    result["per_device_fps"] = wallNs > 0 ? frames * 1e9 / wallNs / devices : 0.0;
+    result["cpu_us_per_frame"] = cpuNs / n / 1000.0;
+    result["cpu_cores_busy"] = wallNs > 0 ? static_cast<double>(cpuNs) / wallNs : 0.0;
+    result["allocs_per_frame"] = allocs / n;
+    out << QString("  %1 devices: %2 fps total, %3 fps/device, %4 cpu us/f, %5 cores, %6 allocs/f\n")
+               .arg(devices, 4)
+               .arg(result["aggregate_fps"].toDouble(), 8, 'f', 0)
+               .arg(result["per_device_fps"].toDouble(), 7, 'f', 1)
+               .arg(result["cpu_us_per_frame"].toDouble(), 8, 'f', 1)
+               .arg(result["cpu_cores_busy"].toDouble(), 5, 'f', 1)
+               .arg(result["allocs_per_frame"].toDouble(), 6, 'f', 1);
+    out.flush();
+    return result;
+}
+
+static void quietMessageOutput(QtMsgType type, const QMessageLogContext &context, const QString &msg)
+{
+    Q_UNUSED(context)
+    // the decoder is chatty on open, a benchmark only wants its own report
+    if (type == QtWarningMsg || type == QtCriticalMsg || type == QtFatalMsg) {
+        QTextStream(stderr) << msg << "\n";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    qInstallMessageHandler(quietMessageOutput);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("demux -> decode -> render pipeline benchmark");
+    parser.addHelpOption();
+    parser.addPositionalArgument("capture", "Raw Annex-B H.264 capture (default: generated test pattern)", "[capture.h264]");
+    QCommandLineOption sizeOption("size", "Frame size of the generated capture", "WxH", "720x1600");
+    QCommandLineOption packetsOption("packets", "Timed packets for the single device run", "n", "600");
+    QCommandLineOption devicesOption("devices", "Device counts of the scaling runs", "list", "1,10,50,100,200");
+    QCommandLineOption scalePacketsOption("scale-packets", "Packets per device in the scaling runs", "n", "150");
+    QCommandLineOption noRenderOption("no-render", "Skip the OpenGL render stage");
+    QCommandLineOption jsonOption("json", "Write machine-readable results to file", "file");
+    parser.addOptions({ sizeOption, packetsOption, devicesOption, scalePacketsOption, noRenderOption, jsonOption });
+    parser.process(app);
+
+    QTextStream out(stdout);
+    H264Loop loop;
+    QSize size = BENCH_DEFAULT_SIZE;
+    QStringList sizeParts = parser.value(sizeOption).split('x');
+    if (sizeParts.size() == 2 && sizeParts.at(0).toInt() > 0 && sizeParts.at(1).toInt() > 0) {
+        size = QSize(sizeParts.at(0).toInt() & ~7, sizeParts.at(1).toInt() & ~7);
+    }
+    QString source = "generated";
+    bool ok = false;
+    if (!parser.positionalArguments().isEmpty()) {
+        source = parser.positionalArguments().first();
+        ok = loop.loadAnnexB(source);
+    } else {
+        ok = loop.encode(size, BENCH_DEFAULT_FPS, BENCH_DEFAULT_BIT_RATE, BENCH_LOOP_SECONDS, QString());
+    }
+    if (!ok) {
+        QTextStream(stderr) << "could not load capture: " << loop.lastError() << "\n";
+        return 1;
+    }
+
+    Capture capture;
+    if (!capture.build(loop, size, BENCH_DEFAULT_FPS)) {
+        return 1;
+    }
+    out << QString("capture: %1, %2 frames, %3 KB\n").arg(source).arg(capture.frameCount).arg(capture.stream.size() / 1024);
+    if (!AllocCounter::isSupported()) {
+        out << "allocation counting is not supported on this platform\n";
+    }
+
+    QJsonObject results;
+    results["capture"] = source;
+    results["capture_frames"] = capture.frameCount;
+    results["ffmpeg"] = QString::fromUtf8(av_version_info());
+    results["qt"] = QString::fromUtf8(qVersion());
+    results["cpu_count"] = QThread::idealThreadCount();
+    results["allocs_supported"] = AllocCounter::isSupported();
+
+    int packets = qMax(1, parser.value(packetsOption).toInt());
+    results["single"] = runSingle(capture, packets, !parser.isSet(noRenderOption), out);
+
+    QJsonArray scaling;
+    int scalePackets = qMax(1, parser.value(scalePacketsOption).toInt());
+    out << QString("scaling, %1 packets per device, no render\n").arg(scalePackets);
+    const QStringList counts = parser.value(devicesOption).split(',', Qt::SkipEmptyParts);
+    for (const QString &count : counts) {
+        int devices = count.trimmed().toInt();
+        if (devices > 0) {
+            scaling.append(runScaling(capture, devices, scalePackets, out));
+        }
+    }
+    results["scaling"] = scaling;
+
+    QByteArray json = QJsonDocument(results).toJson();
+    if (parser.isSet(jsonOption)) {
+        QFile file(parser.value(jsonOption));
+        if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()) {
+            QTextStream(stderr) << "could not write " << file.fileName() << "\n";
+            return 1;
+        }
+    } else {
+        out << json;
+    }
+    return 0;
+}
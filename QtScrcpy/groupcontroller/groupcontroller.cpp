@@ -1,3 +1,6 @@
+#include <QApplication>
+#include <QClipboard>
+#include <QDebug>
 #include <QPointer>
 
 #include "groupcontroller.h"
@@ -5,7 +8,7 @@
 
 GroupController::GroupController(QObject *parent) : QObject(parent)
 {
-
+    connect(&qsc::IDeviceManage::getInstance(), &qsc::IDeviceManage::clipboardAcked, this, &GroupController::onClipboardAcked);
 }
 
 bool GroupController::isHost(const QString &serial)
@@ -28,6 +31,31 @@ QSize GroupController::getFrameSize(const QString &serial)
     return static_cast<VideoForm*>(data)->frameSize();
 }
 
+QStringList GroupController::getFollowers()
+{
+    QStringList followers;
+    for (const auto& serial : m_devices) {
+        if (!qsc::IDeviceManage::getInstance().getDevice(serial)) {
+            continue;
+        }
+        if (true == isHost(serial)) {
+            continue;
+        }
+        followers.append(serial);
+    }
+    return followers;
+}
+
+void GroupController::onClipboardAcked(const QString &serial, quint64 sequence)
+{
+    if (sequence != m_clipboardSequence || !m_pendingClipboardAcks.remove(serial)) {
+        return;
+    }
+    if (m_pendingClipboardAcks.isEmpty()) {
+        qDebug() << "GroupController: clipboard" << sequence << "acked by all followers";
+    }
+}
+
 GroupController &GroupController::instance()
 {
     static GroupController gc;
@@ -324,17 +352,8 @@ void GroupController::postBackOrScreenOn(bool down)
 
 void GroupController::postTextInput(QString &text)
 {
-    for (const auto& serial : m_devices) {
-        if (true == isHost(serial)) {
-            continue;
-        }
-        auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
-        if (!device) {
-            continue;
-        }
-
-        device->postTextInput(text);
-    }
+    // encoded once, the same buffer is queued to every follower
+    qsc::IDeviceManage::getInstance().broadcastTextInput(getFollowers(), text);
 }
 
 void GroupController::requestDeviceClipboard()
@@ -354,16 +373,21 @@ void GroupController::requestDeviceClipboard()
 
 void GroupController::setDeviceClipboard(bool pause)
 {
-    for (const auto& serial : m_devices) {
-        if (true == isHost(serial)) {
-            continue;
-        }
-        auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
-        if (!device) {
-            continue;
-        }
+    QStringList followers = getFollowers();
+    if (followers.isEmpty()) {
+        return;
+    }
+
+    if (!m_pendingClipboardAcks.isEmpty()) {
+        qDebug() << "GroupController: clipboard" << m_clipboardSequence << "never acked by" << m_pendingClipboardAcks.values();
+    }
 
-        device->setDeviceClipboard(pause);
+    // encoded once, the same buffer is queued to every follower
+    QString text = QApplication::clipboard()->text();
+    m_clipboardSequence = qsc::IDeviceManage::getInstance().broadcastClipboard(followers, text, pause);
+    m_pendingClipboardAcks.clear();
+    for (const auto& serial : followers) {
+        m_pendingClipboardAcks.insert(serial);
     }
 }
 
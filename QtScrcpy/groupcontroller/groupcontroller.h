@@ -2,6 +2,7 @@
 #define GROUPCONTROLLER_H
 
 #include <QObject>
+#include <QSet>
 #include <QVector>
 
 #include "QtScrcpyCore.h"
@@ -48,9 +49,15 @@ private:
     explicit GroupController(QObject *parent = nullptr);
     bool isHost(const QString& serial);
     QSize getFrameSize(const QString& serial);
+    QStringList getFollowers();
+    void onClipboardAcked(const QString& serial, quint64 sequence);
 
 private:
     QVector<QString> m_devices;
+
+    // clipboard broadcast ack tracking
+    quint64 m_clipboardSequence = 0;
+    QSet<QString> m_pendingClipboardAcks;
 };
 
 #endif // GROUPCONTROLLER_H
@@ -0,0 +1,418 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QRandomGenerator>
+#include <QSocketNotifier>
+#include <QStandardPaths>
+
+#ifdef Q_OS_UNIX
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "../util/config.h"
+#include "QtScrcpyCore.h"
+#include "headlessfarm.h"
+#include "stagelatency.h"
+
+#ifdef Q_OS_UNIX
+int HeadlessFarm::s_signalFd[2] = { -1, -1 };
+#endif
+
+static QString headlessServerPath()
+{
+    QString serverPath = QString::fromLocal8Bit(qgetenv("QTSCRCPY_SERVER_PATH"));
+    if (serverPath.isEmpty() || !QFileInfo(serverPath).isFile()) {
+        serverPath = QCoreApplication::applicationDirPath() + "/scrcpy-server";
+    }
+    return serverPath;
+}
+
+HeadlessFarm::HeadlessFarm(const Options &options, QObject *parent) : QObject(parent), m_options(options)
+{
+    connect(&m_adb, &qsc::AdbProcess::adbProcessResult, this, [this](qsc::AdbProcess::ADB_EXEC_RESULT processResult) {
+        if (processResult == qsc::AdbProcess::AER_SUCCESS_EXEC && m_adb.arguments().contains("devices")) {
+            onDevicesDetected(m_adb.getDevicesSerialFromStdOut());
+        } else if (processResult == qsc::AdbProcess::AER_ERROR_EXEC || processResult == qsc::AdbProcess::AER_ERROR_START
+                   || processResult == qsc::AdbProcess::AER_ERROR_MISSING_BINARY) {
+            qWarning() << "HeadlessFarm: adb devices failed:" << processResult;
+        }
+    });
+
+    m_pollTimer.setInterval(m_options.pollIntervalMs);
+    connect(&m_pollTimer, &QTimer::timeout, this, &HeadlessFarm::pollDevices);
+
+    connect(&qsc::IDeviceManage::getInstance(), &qsc::IDeviceManage::deviceConnected, this,
+            [this](bool success, const QString &serial, const QString &deviceName, const QSize &size) {
+                if (!m_devices.contains(serial)) {
+                    return;
+                }
+                DeviceStatus &status = m_devices[serial];
+                status.state = success ? DS_CONNECTED : DS_FAILED;
+                status.name = deviceName;
+                status.size = size;
+                status.since = QDateTime::currentDateTime();
+                qInfo() << "HeadlessFarm:" << serial << (success ? "connected" : "failed to connect") << deviceName << size;
+            });
+    connect(&qsc::IDeviceManage::getInstance(), &qsc::IDeviceManage::deviceDisconnected, this, [this](QString serial) {
+        if (!m_devices.contains(serial)) {
+            return;
+        }
+        // reconnected on the next poll if adb still lists it
+        m_devices[serial].state = DS_DISCONNECTED;
+        m_devices[serial].since = QDateTime::currentDateTime();
+        qInfo() << "HeadlessFarm:" << serial << "disconnected";
+    });
+}
+
+HeadlessFarm::~HeadlessFarm()
+{
+    stop();
+#ifdef Q_OS_UNIX
+    if (s_signalFd[0] != -1) {
+        ::close(s_signalFd[0]);
+        ::close(s_signalFd[1]);
+        s_signalFd[0] = s_signalFd[1] = -1;
+    }
+#endif
+}
+
+bool HeadlessFarm::start()
+{
+    if (m_options.record) {
+        if (m_options.recordPath.isEmpty()) {
+            m_options.recordPath = QDir(QStandardPaths::writableLocation(QStandardPaths::MoviesLocation)).filePath("QtScrcpy");
+        }
+        if (!QDir().mkpath(m_options.recordPath)) {
+            qCritical() << "HeadlessFarm: cannot create record directory" << m_options.recordPath;
+            return false;
+        }
+    } else if (m_options.clipSeconds <= 0) {
+        qCritical() << "HeadlessFarm: nothing to do, enable recording or the clip buffer";
+        return false;
+    }
+
+    m_server = new QLocalServer(this);
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    // a crashed instance leaves its socket file behind
+    QLocalServer::removeServer(m_options.socketName);
+    if (!m_server->listen(m_options.socketName)) {
+        qCritical() << "HeadlessFarm: cannot listen on" << m_options.socketName << m_server->errorString();
+        return false;
+    }
+    connect(m_server, &QLocalServer::newConnection, this, &HeadlessFarm::onNewConnection);
+
+#ifdef Q_OS_UNIX
+    setupSignalHandlers();
+#endif
+
+    qInfo() << "HeadlessFarm: status socket" << m_server->fullServerName();
+    qInfo() << "HeadlessFarm: recording" << (m_options.record ? m_options.recordPath : QString("off")) << "clip buffer" << m_options.clipSeconds << "s";
+    pollDevices();
+    m_pollTimer.start();
+    return true;
+}
+
+void HeadlessFarm::stop()
+{
+    if (m_stopping) {
+        return;
+    }
+    m_stopping = true;
+    m_pollTimer.stop();
+    if (m_server) {
+        m_server->close();
+    }
+    // writes the trailers of every recording
+    qsc::IDeviceManage::getInstance().disconnectAllDevice();
+}
+
+void HeadlessFarm::pollDevices()
+{
+    if (m_stopping || m_adb.isRuning()) {
+        return;
+    }
+    m_adb.execute("", QStringList() << "devices");
+}
+
+void HeadlessFarm::onDevicesDetected(const QStringList &devices)
+{
+    for (const QString &serial : devices) {
+        if ((!m_options.serials.isEmpty() && !m_options.serials.contains(serial)) || m_ignored.contains(serial)) {
+            continue;
+        }
+        auto it = m_devices.constFind(serial);
+        if (it != m_devices.constEnd() && (it->state == DS_CONNECTING || it->state == DS_CONNECTED)) {
+            continue;
+        }
+        connectToDevice(serial);
+    }
+}
+
+void HeadlessFarm::connectToDevice(const QString &serial)
+{
+    qsc::DeviceParams params;
+    params.serial = serial;
+    params.localPort = m_nextPort++;
+    if (m_nextPort > 30000) {
+        m_nextPort = 27183;
+    }
+    params.maxSize = m_options.maxSize;
+    params.bitRate = m_options.bitRate;
+    params.maxFps = m_options.maxFps;
+    params.useReverse = true;
+    params.display = false;
+    params.stayAwake = true;
+    params.recordFile = m_options.record;
+    params.recordPath = m_options.recordPath;
+    params.recordFileFormat = m_options.recordFormat;
+    params.recordSegmentSeconds = m_options.segmentSeconds;
+    params.recordSegmentCount = m_options.segmentCount;
+    params.clipBufferSeconds = m_options.clipSeconds;
+    params.serverLocalPath = headlessServerPath();
+    params.serverRemotePath = Config::getInstance().getServerPath();
+    params.pushFilePath = Config::getInstance().getPushFilePath();
+    params.serverVersion = Config::getInstance().getServerVersion();
+    params.logLevel = Config::getInstance().getLogLevel();
+    params.codecOptions = Config::getInstance().getCodecOptions();
+    params.codecName = Config::getInstance().getCodecName();
+    params.scid = QRandomGenerator::global()->bounded(1, 10000) & 0x7FFFFFFF;
+
+    // a device that dropped is still registered until its teardown finishes
+    qsc::IDeviceManage::getInstance().disconnectDevice(serial);
+
+    DeviceStatus &status = m_devices[serial];
+    status.state = DS_CONNECTING;
+    status.since = QDateTime::currentDateTime();
+    status.attempts++;
+    if (!qsc::IDeviceManage::getInstance().connectDevice(params)) {
+        status.state = DS_FAILED;
+        qWarning() << "HeadlessFarm: could not start connecting to" << serial;
+    }
+}
+
+void HeadlessFarm::onNewConnection()
+{
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { onSocketReadyRead(socket); });
+        connect(socket, &QLocalSocket::disconnected, socket, &QLocalSocket::deleteLater);
+    }
+}
+
+void HeadlessFarm::onSocketReadyRead(QLocalSocket *socket)
+{
+    while (socket->canReadLine()) {
+        QString line = QString::fromUtf8(socket->readLine()).trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        QJsonObject reply = handleCommand(line);
+        socket->write(QJsonDocument(reply).toJson(QJsonDocument::Compact));
+        socket->write("\n");
+        if (m_stopping) {
+            socket->flush();
+            QCoreApplication::quit();
+            return;
+        }
+    }
+}
+
+QJsonObject HeadlessFarm::handleCommand(const QString &line)
+{
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 14, 0))
+    QStringList args = line.split(' ', Qt::SkipEmptyParts);
+#else
+    QStringList args = line.split(' ', QString::SkipEmptyParts);
+#endif
+    const QString command = args.takeFirst().toLower();
+    QJsonObject reply;
+    reply["command"] = command;
+    reply["ok"] = true;
+
+    if (command == "status") {
+        reply["status"] = statusJson();
+    } else if (command == "clip" && args.size() == 2) {
+        QStringList serials;
+        if (args[0] == "all") {
+            serials = qsc::IDeviceManage::getInstance().getAllConnectedSerials();
+        } else {
+            serials << args[0];
+        }
+        const QString stamp = QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss");
+        QDir().mkpath(args[1]);
+        QJsonArray files;
+        for (const QString &serial : serials) {
+            QPointer<qsc::IDevice> device = qsc::IDeviceManage::getInstance().getDevice(serial);
+            QString safeSerial = serial;
+            safeSerial.replace(':', '_').replace('.', '_');
+            QString filePath = QDir(args[1]).filePath(QString("%1_clip_%2.mkv").arg(safeSerial, stamp));
+            if (device && device->saveClip(filePath)) {
+                files.append(filePath);
+            }
+        }
+        // written in the background, the files are complete when clipSaved fires
+        reply["files"] = files;
+        reply["ok"] = !files.isEmpty();
+    } else if (command == "export" && args.size() == 3) {
+        QPointer<qsc::IDevice> device = qsc::IDeviceManage::getInstance().getDevice(args[0]);
+        bool secondsOk = false;
+        int seconds = args[1].toInt(&secondsOk);
+        if (device && secondsOk && seconds > 0) {
+            device->exportRecording(seconds, args[2]);
+            reply["file"] = args[2];
+        } else {
+            reply["ok"] = false;
+        }
+    } else if (command == "disconnect" && args.size() == 1) {
+        reply["ok"] = qsc::IDeviceManage::getInstance().disconnectDevice(args[0]);
+        // not reconnected by the poller
+        m_ignored.insert(args[0]);
+        m_devices.remove(args[0]);
+    } else if (command == "latency" && args.size() <= 1) {
+        // record-only devices have no decoder, only the socket read and parse stages fill up
+        reply["latency"] = qsc::StageLatencyRegistry::instance().dump();
+        if (!args.isEmpty() && args[0] == "reset") {
+            qsc::StageLatencyRegistry::instance().resetAll();
+        }
+    } else if (command == "quit") {
+        stop();
+    } else {
+        reply["ok"] = false;
+        reply["error"] = QString("unknown command or wrong arguments: %1").arg(line);
+    }
+    return reply;
+}
+
+QJsonObject HeadlessFarm::statusJson() const
+{
+    QJsonArray devices;
+    int connected = 0;
+    for (auto it = m_devices.constBegin(); it != m_devices.constEnd(); ++it) {
+        QJsonObject device;
+        device["serial"] = it.key();
+        device["state"] = stateName(it->state);
+        device["name"] = it->name;
+        device["width"] = it->size.width();
+        device["height"] = it->size.height();
+        device["since"] = it->since.toString(Qt::ISODate);
+        device["attempts"] = it->attempts;
+        devices.append(device);
+        if (it->state == DS_CONNECTED) {
+            connected++;
+        }
+    }
+
+    QJsonObject status;
+    status["devices"] = devices;
+    status["connected"] = connected;
+    status["recordPath"] = m_options.record ? m_options.recordPath : QString();
+    status["clipSeconds"] = m_options.clipSeconds;
+    return status;
+}
+
+QString HeadlessFarm::stateName(DeviceState state)
+{
+    switch (state) {
+    case DS_CONNECTING:
+        return "connecting";
+    case DS_CONNECTED:
+        return "connected";
+    case DS_FAILED:
+        return "failed";
+    case DS_DISCONNECTED:
+        return "disconnected";
+    }
+    return "unknown";
+}
+
+bool HeadlessFarm::parseArguments(const QStringList &arguments, Options &options, QString &error)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("QtScrcpy headless farm: record devices without a display");
+    parser.addHelpOption();
+    QCommandLineOption headlessOption("headless", "Run without widgets.");
+    QCommandLineOption serialOption(QStringList() << "s" << "serial", "Only this device (repeatable).", "serial");
+    QCommandLineOption recordDirOption("record-dir", "Record into this directory.", "dir");
+    QCommandLineOption formatOption("record-format", "mp4 or mkv (default mkv).", "format", "mkv");
+    QCommandLineOption noRecordOption("no-record", "Do not record to disk (clip buffer only).");
+    QCommandLineOption segmentOption("segment-seconds", "Rolling recording, segment length.", "seconds", "0");
+    QCommandLineOption segmentCountOption("segment-count", "Rolling recording, segments kept.", "count", "30");
+    QCommandLineOption clipOption("clip-seconds", "In-memory clip buffer per device.", "seconds", "0");
+    QCommandLineOption maxSizeOption("max-size", "Video size limit.", "pixels", "720");
+    QCommandLineOption bitRateOption("bit-rate", "Video bit rate.", "bps", "2000000");
+    QCommandLineOption maxFpsOption("max-fps", "Frame rate limit (0 = device default).", "fps", "0");
+    QCommandLineOption socketOption("socket", "Local socket name for status and commands.", "name", "qtscrcpy-headless");
+    parser.addOptions({ headlessOption, serialOption, recordDirOption, formatOption, noRecordOption, segmentOption, segmentCountOption,
+                        clipOption, maxSizeOption, bitRateOption, maxFpsOption, socketOption });
+
+    if (!parser.parse(arguments)) {
+        error = parser.errorText();
+        return false;
+    }
+    if (parser.isSet("help")) {
+        error = parser.helpText();
+        return false;
+    }
+
+    options.serials = parser.values(serialOption);
+    options.recordPath = parser.value(recordDirOption);
+    options.recordFormat = parser.value(formatOption).toLower();
+    options.record = !parser.isSet(noRecordOption);
+    options.segmentSeconds = parser.value(segmentOption).toInt();
+    options.segmentCount = parser.value(segmentCountOption).toInt();
+    options.clipSeconds = parser.value(clipOption).toInt();
+    options.maxSize = static_cast<quint16>(parser.value(maxSizeOption).toUInt());
+    options.bitRate = parser.value(bitRateOption).toUInt();
+    options.maxFps = parser.value(maxFpsOption).toUInt();
+    options.socketName = parser.value(socketOption);
+
+    if (options.recordFormat != "mp4" && options.recordFormat != "mkv") {
+        error = "record format must be mp4 or mkv";
+        return false;
+    }
+    return true;
+}
+
+#ifdef Q_OS_UNIX
+bool HeadlessFarm::setupSignalHandlers()
+{
+    // same self-pipe pattern as FarmViewer: the handler only writes, the event loop does the work
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, s_signalFd) != 0) {
+        qWarning() << "HeadlessFarm: socketpair failed, Ctrl+C will not stop recordings cleanly";
+        return false;
+    }
+    m_signalNotifier = new QSocketNotifier(s_signalFd[1], QSocketNotifier::Read, this);
+    connect(m_signalNotifier, &QSocketNotifier::activated, this, [this]() {
+        int signalNumber = 0;
+        ssize_t bytesRead = ::read(s_signalFd[1], &signalNumber, sizeof(signalNumber));
+        Q_UNUSED(bytesRead);
+        qInfo() << "HeadlessFarm: signal" << signalNumber << "received, stopping";
+        stop();
+        QCoreApplication::quit();
+    });
+
+    struct sigaction action;
+    action.sa_handler = HeadlessFarm::unixSignalHandler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGINT, &action, Q_NULLPTR);
+    sigaction(SIGTERM, &action, Q_NULLPTR);
+    return true;
+}
+
+void HeadlessFarm::unixSignalHandler(int signalNumber)
+{
+    // async-signal-safe only
+    if (s_signalFd[0] != -1) {
+        ssize_t result = ::write(s_signalFd[0], &signalNumber, sizeof(signalNumber));
+        (void)result;
+    }
+}
+#endif
@@ -0,0 +1,107 @@
+#ifndef HEADLESSFARM_H
+#define HEADLESSFARM_H
+
+#include <QDateTime>
+#include <QJsonObject>
+#include <QMap>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QSize>
+#include <QStringList>
+#include <QTimer>
+
+#include "adbprocess.h"
+
+class QLocalServer;
+class QLocalSocket;
+class QSocketNotifier;
+
+/**
+ * HeadlessFarm - Record-only farm without widgets or OpenGL
+ *
+ * Runs under QCoreApplication: polls adb for devices, connects every one of them with
+ * display=false and records to disk and/or keeps the in-memory clip buffer.
+ * A QLocalServer takes one command per line and answers one JSON object per line:
+ *   status                              all devices and their state
+ *   clip <serial|all> <dir>             save the clip buffer (DeviceParams::clipBufferSeconds)
+ *   export <serial> <seconds> <file>    remux the last seconds of a rolling recording
+ *   disconnect <serial>
+ *   latency [reset]                     per device and stage latency table (qsc::StageLatencyRegistry::dump)
+ *   quit                                stop recording cleanly and exit
+ */
+class HeadlessFarm : public QObject
+{
+    Q_OBJECT
+public:
+    struct Options
+    {
+        QStringList serials; // empty: every device adb reports
+        QString recordPath;
+        QString recordFormat = "mkv";
+        bool record = true;
+        int segmentSeconds = 0;
+        int segmentCount = 30;
+        int clipSeconds = 0;
+        quint16 maxSize = 720;
+        quint32 bitRate = 2000000;
+        quint32 maxFps = 0;
+        QString socketName = "qtscrcpy-headless";
+        int pollIntervalMs = 5000;
+    };
+
+    explicit HeadlessFarm(const Options &options, QObject *parent = Q_NULLPTR);
+    virtual ~HeadlessFarm();
+
+    bool start();
+    void stop();
+
+    // parse the --headless command line, returns false (with a message in error) on bad arguments
+    static bool parseArguments(const QStringList &arguments, Options &options, QString &error);
+
+private:
+    enum DeviceState
+    {
+        DS_CONNECTING,
+        DS_CONNECTED,
+        DS_FAILED,
+        DS_DISCONNECTED,
+    };
+    struct DeviceStatus
+    {
+        DeviceState state = DS_CONNECTING;
+        QString name;
+        QSize size;
+        QDateTime since;
+        int attempts = 0;
+    };
+
+    void pollDevices();
+    void onDevicesDetected(const QStringList &devices);
+    void connectToDevice(const QString &serial);
+    void onNewConnection();
+    void onSocketReadyRead(QLocalSocket *socket);
+    QJsonObject handleCommand(const QString &line);
+    QJsonObject statusJson() const;
+    static QString stateName(DeviceState state);
+#ifdef Q_OS_UNIX
+    bool setupSignalHandlers();
+    static void unixSignalHandler(int signalNumber);
+#endif
+
+private:
+    Options m_options;
+    qsc::AdbProcess m_adb;
+    QTimer m_pollTimer;
+    QLocalServer *m_server = Q_NULLPTR;
+    QMap<QString, DeviceStatus> m_devices;
+    QSet<QString> m_ignored; // disconnected on request
+    quint16 m_nextPort = 27183;
+    bool m_stopping = false;
+#ifdef Q_OS_UNIX
+    QSocketNotifier *m_signalNotifier = Q_NULLPTR;
+    static int s_signalFd[2];
+#endif
+};
+
+#endif // HEADLESSFARM_H
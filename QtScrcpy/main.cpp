@@ -12,18 +12,24 @@ extern "C" {
 #include <libavutil/error.h>
 }
 
+#include "asynclog.h"
 #include "config.h"
 #include "dialog.h"
 #include "mousetap/mousetap.h"
 #include "farmviewer.h"
+#include "headlessfarm.h"
+#include "metricsexporter.h"
 
 static Dialog *g_mainDlg = Q_NULLPTR;
 static QtMessageHandler g_oldMessageHandler = Q_NULLPTR;
 void myMessageOutput(QtMsgType type, const QMessageLogContext &context, const QString &msg);
+void installAsyncLog(bool gui);
 void installTranslator();
 
 static QtMsgType g_msgType = QtInfoMsg;
 QtMsgType covertLogLevel(const QString &logLevel);
+int runHeadless(int argc, char *argv[]);
+void startMetricsExporter(MetricsExporter &exporter);
 
 int main(int argc, char *argv[])
 {
@@ -43,7 +49,10 @@ int main(int argc, char *argv[])
 #endif
 
 #ifdef Q_OS_LINUX
-    qputenv("QTSCRCPY_ADB_PATH", "./adb");  // Use ADB symlink in output directory (works with NixOS)
+    // an explicit adb (e.g. the devicesim fake adb for load tests) wins over the deployed one
+    if (qEnvironmentVariableIsEmpty("QTSCRCPY_ADB_PATH")) {
+        qputenv("QTSCRCPY_ADB_PATH", "./adb");  // Use ADB symlink in output directory (works with NixOS)
+    }
     qputenv("QTSCRCPY_SERVER_PATH", "../../../QtScrcpy/QtScrcpyCore/src/third_party/scrcpy-server");
     qputenv("QTSCRCPY_KEYMAP_PATH", "../../../keymap");
     qputenv("QTSCRCPY_CONFIG_PATH", "../../../config");
@@ -51,6 +60,13 @@ int main(int argc, char *argv[])
 
     g_msgType = covertLogLevel(Config::getInstance().getLogLevel());
 
+    // record-only farm for servers without a display: no QApplication, no OpenGL
+    for (int i = 1; i < argc; i++) {
+        if (0 == qstrcmp(argv[i], "--headless")) {
+            return runHeadless(argc, argv);
+        }
+    }
+
     // CRITICAL: Enable OpenGL context sharing for 78+ device farm
     // This allows multiple QOpenGLWidget instances to share GPU resources
     // Without this, creating 78 OpenGL contexts simultaneously causes GPU driver crash
@@ -91,6 +107,7 @@ int main(int argc, char *argv[])
 
     g_oldMessageHandler = qInstallMessageHandler(myMessageOutput);
     QApplication a(argc, argv);
+    installAsyncLog(true);
 
     // windows下通过qmake VERSION变量或者rc设置版本号和应用名称后，这里可以直接拿到
     // mac下拿到的是CFBundleVersion的值
@@ -159,6 +176,9 @@ int main(int argc, char *argv[])
     qInfo() << "Setting up Unix signal handlers for graceful shutdown...";
     FarmViewer::setupUnixSignalHandlers();
 
+    MetricsExporter metricsExporter;
+    startMetricsExporter(metricsExporter);
+
     g_mainDlg = new Dialog {};
     g_mainDlg->show();
 
@@ -175,6 +195,7 @@ int main(int argc, char *argv[])
     qInfo() << QObject::tr("You can contact me with telegram <https://t.me/+Ylf_5V_rDCMyODQ1>");
 
     int ret = a.exec();
+    AsyncLog::instance().stopWriter();
     delete g_mainDlg;
 
 #if defined(Q_OS_WIN32) || defined(Q_OS_OSX)
@@ -183,6 +204,42 @@ int main(int argc, char *argv[])
     return ret;
 }
 
+int runHeadless(int argc, char *argv[])
+{
+    g_oldMessageHandler = qInstallMessageHandler(myMessageOutput);
+    QCoreApplication a(argc, argv);
+    installAsyncLog(false);
+
+    HeadlessFarm::Options options;
+    QString error;
+    if (!HeadlessFarm::parseArguments(a.arguments(), options, error)) {
+        fprintf(stderr, "%s\n", error.toUtf8().constData());
+        return 1;
+    }
+
+    qsc::AdbProcess::setAdbPath(Config::getInstance().getAdbPath());
+
+    MetricsExporter metricsExporter;
+    startMetricsExporter(metricsExporter);
+
+    HeadlessFarm farm(options);
+    if (!farm.start()) {
+        return 1;
+    }
+    int ret = a.exec();
+    AsyncLog::instance().stopWriter();
+    return ret;
+}
+
+void startMetricsExporter(MetricsExporter &exporter)
+{
+    int port = Config::getInstance().getMetricsPort();
+    if (port <= 0 || port > 65535) {
+        return;
+    }
+    exporter.listen(static_cast<quint16>(port));
+}
+
 void installTranslator()
 {
     static QTranslator translator;
@@ -243,15 +300,15 @@ QtMsgType covertLogLevel(const QString &logLevel)
 #endif
 }
 
-void myMessageOutput(QtMsgType type, const QMessageLogContext &context, const QString &msg)
+void writeLogRecord(const AsyncLog::Record &record)
 {
-    QString outputMsg;
-    
+    // log writer thread
 #ifdef ENABLE_DETAILED_LOGS
-    QString timestamp = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz");
+    QString outputMsg;
+    QString timestamp = QDateTime::fromMSecsSinceEpoch(record.msecsSinceEpoch).toString("yyyy-MM-dd hh:mm:ss.zzz");
     
-    if (context.file && context.line > 0) {
-        QString fileName = QString::fromUtf8(context.file);
+    if (record.file && record.line > 0) {
+        QString fileName = QString::fromUtf8(record.file);
 
         int lastSlash = fileName.lastIndexOf('/');
         if (lastSlash >= 0) {
@@ -262,12 +319,12 @@ void myMessageOutput(QtMsgType type, const QMessageLogContext &context, const QS
             fileName = fileName.mid(lastSlash + 1);
         }
         
-        outputMsg = QString("[ %1 %2: %3 ] %4").arg(timestamp).arg(fileName).arg(context.line).arg(msg);
+        outputMsg = QString("[ %1 %2: %3 ] %4").arg(timestamp).arg(fileName).arg(record.line).arg(record.message);
     } else {
-        outputMsg = QString("[%1] %2").arg(timestamp).arg(msg);
+        outputMsg = QString("[%1] %2").arg(timestamp).arg(record.message);
     }
 
-    switch (type) {
+    switch (record.type) {
     case QtDebugMsg:
         outputMsg.prepend("[debug] ");
         break;
@@ -287,12 +344,33 @@ void myMessageOutput(QtMsgType type, const QMessageLogContext &context, const QS
 
     fprintf(stderr, "%s\n", outputMsg.toUtf8().constData());
 #else
-    outputMsg = msg;
     if (g_oldMessageHandler) {
-        g_oldMessageHandler(type, context, outputMsg);
+        QMessageLogContext context(record.file, record.line, record.function, record.category);
+        g_oldMessageHandler(record.type, context, record.message);
     }
 #endif
+}
 
+void installAsyncLog(bool gui)
+{
+    AsyncLog &log = AsyncLog::instance();
+    log.setWriter(writeLogRecord);
+    log.setRateLimit(Config::getInstance().getLogRateLimit());
+    if (gui) {
+        // one queued call per batch instead of one per message
+        log.setGuiSink([](const QStringList &lines) {
+            QMetaObject::invokeMethod(qApp, [lines]() {
+                if (g_mainDlg && g_mainDlg->isVisible()) {
+                    g_mainDlg->outLogLines(lines);
+                }
+            }, Qt::QueuedConnection);
+        });
+    }
+    log.startWriter();
+}
+
+void myMessageOutput(QtMsgType type, const QMessageLogContext &context, const QString &msg)
+{
     // Is Qt log level higher than warning?
     float fLogLevel = g_msgType;
     if (QtInfoMsg == g_msgType) {
@@ -303,11 +381,8 @@ void myMessageOutput(QtMsgType type, const QMessageLogContext &context, const QS
         fLogLevel2 = QtDebugMsg + 0.5f;
     }
 
-    if (fLogLevel <= fLogLevel2) {
-        if (g_mainDlg && g_mainDlg->isVisible() && !g_mainDlg->filterLog(outputMsg)) {
-            g_mainDlg->outLog(outputMsg);
-        }
-    }
+    // formatting, output and the GUI log view happen on the log writer thread
+    AsyncLog::instance().post(type, context, msg, fLogLevel <= fLogLevel2);
 
     if (QtFatalMsg == type) {
         //abort();
@@ -3,6 +3,7 @@
 #include <QSurfaceFormat>
 
 #include "qyuvopenglwidget.h"
+#include "stagelatency.h"
 
 // 存储顶点坐标和纹理坐标
 // 存在一起缓存在vbo
@@ -142,6 +143,8 @@ void QYUVOpenGLWidget::updateTextures(quint8 *dataY, quint8 *dataU, quint8 *data
     }
 
     if (m_textureInited) {
+        qint64 uploadStartUs = m_stageLatency ? qsc::StageLatency::now() : 0;
+
         // PERFORMANCE OPTIMIZATION: Batch all 3 texture updates in single context switch
         // Reduces context switches from 3 per frame to 1 per frame (5-8% gain)
         // With 1170 total FPS, this reduces from 3,510 to 1,170 context switches/second
@@ -200,12 +203,20 @@ void QYUVOpenGLWidget::updateTextures(quint8 *dataY, quint8 *dataU, quint8 *data
         glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 
         doneCurrent();
+        if (m_stageLatency) {
+            m_stageLatency->recordSince(qsc::StageLatency::SL_TEXTURE_UPLOAD, uploadStartUs);
+        }
         update();
     } else {
         qWarning() << "QYUVOpenGLWidget::updateTextures() - Cannot update textures, m_textureInited is false and frameSize is" << m_frameSize;
     }
 }
 
+void QYUVOpenGLWidget::setStageLatency(qsc::StageLatency *latency)
+{
+    m_stageLatency = latency;
+}
+
 void QYUVOpenGLWidget::initializeGL()
 {
     initializeOpenGLFunctions();
@@ -224,6 +235,8 @@ void QYUVOpenGLWidget::initializeGL()
 
 void QYUVOpenGLWidget::paintGL()
 {
+    qint64 paintStartUs = m_stageLatency ? qsc::StageLatency::now() : 0;
+
     m_shaderProgram.bind();
 
     if (m_needUpdate) {
@@ -246,12 +259,17 @@ void QYUVOpenGLWidget::paintGL()
     }
 
     m_shaderProgram.release();
+
+    // command submission only, the GPU work itself is asynchronous
+    if (m_stageLatency && m_textureInited) {
+        m_stageLatency->recordSince(qsc::StageLatency::SL_PAINT, paintStartUs);
+    }
 }
 
 void QYUVOpenGLWidget::resizeGL(int width, int height)
 {
+    // QOpenGLWidget paints after every resize on its own, textures depend on the frame size only
     glViewport(0, 0, width, height);
-    repaint();
 }
 
 void QYUVOpenGLWidget::initShader()
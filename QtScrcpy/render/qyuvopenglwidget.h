@@ -5,6 +5,10 @@
 #include <QOpenGLShaderProgram>
 #include <QOpenGLWidget>
 
+namespace qsc {
+class StageLatency;
+}
+
 class QYUVOpenGLWidget
     : public QOpenGLWidget
     , protected QOpenGLFunctions
@@ -20,6 +24,8 @@ public:
     void setFrameSize(const QSize &frameSize);
     const QSize &frameSize();
     void updateTextures(quint8 *dataY, quint8 *dataU, quint8 *dataV, quint32 linesizeY, quint32 linesizeU, quint32 linesizeV);
+    // texture upload and paint durations, not owned
+    void setStageLatency(qsc::StageLatency *latency);
 
 protected:
     void initializeGL() override;
@@ -37,6 +43,7 @@ private:
     QSize m_frameSize = { -1, -1 };
     bool m_needUpdate = false;
     bool m_textureInited = false;
+    qsc::StageLatency *m_stageLatency = nullptr;
 
     // 顶点缓冲对象(Vertex Buffer Objects, VBO)：默认即为VertexBuffer(GL_ARRAY_BUFFER)类型
     QOpenGLBuffer m_vbo;
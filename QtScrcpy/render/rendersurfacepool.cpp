@@ -0,0 +1,50 @@
+#include <QWidget>
+
+#include "qyuvopenglwidget.h"
+#include "rendersurfacepool.h"
+
+RenderSurfacePool::RenderSurfacePool(QWidget *park) : QObject(park), m_park(park) {}
+
+QYUVOpenGLWidget *RenderSurfacePool::acquire(QWidget *parent)
+{
+    while (!m_parked.isEmpty()) {
+        QPointer<QYUVOpenGLWidget> surface = m_parked.takeLast();
+        if (!surface) {
+            continue;
+        }
+        surface->setParent(parent);
+        surface->show();
+        return surface;
+    }
+    return nullptr;
+}
+
+void RenderSurfacePool::release(QYUVOpenGLWidget *surface)
+{
+    if (!surface) {
+        return;
+    }
+    if (!m_park || m_parked.size() >= m_maxParked) {
+        surface->deleteLater();
+        return;
+    }
+    surface->hide();
+    surface->setParent(m_park);
+    m_parked.append(surface);
+}
+
+int RenderSurfacePool::parkedCount() const
+{
+    return m_parked.size();
+}
+
+void RenderSurfacePool::setMaxParked(int count)
+{
+    m_maxParked = qMax<int>(MAX_PARKED, count);
+    while (m_parked.size() > m_maxParked) {
+        QPointer<QYUVOpenGLWidget> surface = m_parked.takeFirst();
+        if (surface) {
+            surface->deleteLater();
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef RENDERSURFACEPOOL_H
+#define RENDERSURFACEPOOL_H
+
+#include <QList>
+#include <QObject>
+#include <QPointer>
+
+class QWidget;
+class QYUVOpenGLWidget;
+
+/**
+ * RenderSurfacePool - Recycled video surfaces of the farm grid
+ *
+ * A QYUVOpenGLWidget costs a GL context, its shaders and three textures, and the grid only
+ * needs one for each tile in view. Tiles scrolled away hand their surface back here and the
+ * tiles scrolling in take one over for their device; its textures are kept as long as the
+ * frame size matches. Parked surfaces are hidden children of the park widget, in the same
+ * window as the grid, so their context survives the reparenting. The grid sets the limit to the
+ * tiles it shows (at least MAX_PARKED): a page scroll swaps them all, a jump over the whole farm
+ * does not pile up surfaces nobody shows.
+ */
+class RenderSurfacePool : public QObject
+{
+    Q_OBJECT
+public:
+    enum
+    {
+        MAX_PARKED = 16
+    };
+
+    // parked surfaces are children of park, which deletes them
+    explicit RenderSurfacePool(QWidget *park);
+
+    // a parked surface, reparented to parent and shown; nullptr when none is parked
+    QYUVOpenGLWidget *acquire(QWidget *parent);
+    void release(QYUVOpenGLWidget *surface);
+    int parkedCount() const;
+    // surfaces above the limit are deleted, never below MAX_PARKED
+    void setMaxParked(int count);
+
+private:
+    QPointer<QWidget> m_park;
+    QList<QPointer<QYUVOpenGLWidget>> m_parked;
+    int m_maxParked = MAX_PARKED;
+};
+
+#endif // RENDERSURFACEPOOL_H
@@ -0,0 +1,220 @@
+#include <QDebug>
+#include <QEvent>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QPaintEvent>
+#include <QPainter>
+
+#include "softwarecompositor.h"
+#include "stagelatency.h"
+#include "../QtScrcpyCore/src/device/decoder/yuvconvert.h"
+
+SoftwareCompositor::SoftwareCompositor(QWidget *viewport) : QWidget(viewport)
+{
+    // tiles and their labels stay clickable, the overlay only draws
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setFocusPolicy(Qt::NoFocus);
+    setGeometry(viewport->rect());
+    viewport->installEventFilter(this);
+    raise();
+    show();
+
+    m_timer.setInterval(COMPOSE_INTERVAL_MS);
+    connect(&m_timer, &QTimer::timeout, this, &SoftwareCompositor::compose);
+    m_timer.start();
+}
+
+SoftwareCompositor::~SoftwareCompositor()
+{
+    if (parentWidget()) {
+        parentWidget()->removeEventFilter(this);
+    }
+}
+
+void SoftwareCompositor::setFrame(QWidget *surface, const FrameData &frame, qsc::StageLatency *latency)
+{
+    if (!surface || !frame.buffer || frame.width <= 0 || frame.height <= 0) {
+        return;
+    }
+    auto it = m_tiles.find(surface);
+    if (it == m_tiles.end()) {
+        it = m_tiles.insert(surface, Tile());
+        it->surface = surface;
+        // the grid may have been rebuilt since, stay on top of it
+        raise();
+    }
+    it->frame = frame;
+    it->hasFrame = true;
+    it->frameDirty = true;
+    it->latency = latency;
+}
+
+void SoftwareCompositor::removeSurface(QWidget *surface)
+{
+    auto it = m_tiles.find(surface);
+    if (it == m_tiles.end()) {
+        return;
+    }
+    if (!it->rect.isNull()) {
+        update(it->rect);
+    }
+    m_tiles.erase(it);
+}
+
+bool SoftwareCompositor::isOpenGLAccelerated(QString *renderer)
+{
+    QOffscreenSurface surface;
+    surface.create();
+    QOpenGLContext context;
+    if (!context.create() || !context.makeCurrent(&surface)) {
+        if (renderer) {
+            *renderer = "none";
+        }
+        return false;
+    }
+    const GLubyte *name = context.functions()->glGetString(GL_RENDERER);
+    const QString rendererName = name ? QString::fromLatin1(reinterpret_cast<const char *>(name)) : QString();
+    context.doneCurrent();
+    if (renderer) {
+        *renderer = rendererName;
+    }
+
+    static const char *softwareRenderers[] = { "llvmpipe", "softpipe", "swrast", "SwiftShader", "Software Rasterizer", "GDI Generic" };
+    for (const char *software : softwareRenderers) {
+        if (rendererName.contains(QLatin1String(software), Qt::CaseInsensitive)) {
+            return false;
+        }
+    }
+    return !rendererName.isEmpty();
+}
+
+void SoftwareCompositor::paintEvent(QPaintEvent *event)
+{
+    if (m_backbuffer.isNull()) {
+        return;
+    }
+    // tile rects only, the grid shows through everywhere else
+    QPainter painter(this);
+    const qreal dpr = m_backbuffer.devicePixelRatio();
+    for (const Tile &tile : m_tiles) {
+        const QRect rect = tile.rect & event->rect();
+        if (!rect.isEmpty()) {
+            painter.drawImage(rect, m_backbuffer, QRectF(QPointF(rect.topLeft()) * dpr, QSizeF(rect.size()) * dpr));
+        }
+    }
+}
+
+bool SoftwareCompositor::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == parentWidget() && event->type() == QEvent::Resize) {
+        setGeometry(parentWidget()->rect());
+    }
+    return QWidget::eventFilter(watched, event);
+}
+
+void SoftwareCompositor::compose()
+{
+    if (!isVisible() || m_tiles.isEmpty()) {
+        return;
+    }
+
+    const qreal dpr = devicePixelRatioF();
+    const QSize bufferSize = size() * dpr;
+    if (m_backbuffer.size() != bufferSize) {
+        m_backbuffer = QImage(bufferSize, QImage::Format_RGB32);
+        m_backbuffer.setDevicePixelRatio(dpr);
+        // nothing in it yet, every visible tile is drawn again
+        for (Tile &tile : m_tiles) {
+            tile.rect = QRect();
+        }
+        update();
+    }
+    if (m_backbuffer.isNull()) {
+        return;
+    }
+
+    QRegion changed;
+    QPainter painter;
+    for (auto it = m_tiles.begin(); it != m_tiles.end();) {
+        Tile &tile = it.value();
+        if (!tile.surface) {
+            changed += tile.rect;
+            it = m_tiles.erase(it);
+            continue;
+        }
+
+        QRect rect;
+        if (tile.hasFrame && tile.surface->isVisible()) {
+            rect = QRect(tile.surface->mapTo(parentWidget(), QPoint(0, 0)), tile.surface->size());
+            if (!rect.intersects(this->rect())) {
+                rect = QRect();
+            }
+        }
+        if (rect.isEmpty()) {
+            // scrolled away or hidden: keep the frame, not its image
+            changed += tile.rect;
+            tile.rect = QRect();
+            tile.image = QImage();
+            ++it;
+            continue;
+        }
+
+        bool redraw = rect != tile.rect;
+        if (tile.frameDirty || tile.image.isNull() || rect.size() != tile.rect.size()) {
+            qint64 convertStartUs = tile.latency ? qsc::StageLatency::now() : 0;
+            if (!convert(tile, rect.size() * dpr)) {
+                ++it;
+                continue;
+            }
+            if (tile.latency) {
+                tile.latency->recordSince(qsc::StageLatency::SL_TEXTURE_UPLOAD, convertStartUs);
+            }
+            tile.frameDirty = false;
+            redraw = true;
+        }
+        if (redraw) {
+            qint64 paintStartUs = tile.latency ? qsc::StageLatency::now() : 0;
+            if (!painter.isActive()) {
+                painter.begin(&m_backbuffer);
+                painter.setRenderHint(QPainter::SmoothPixmapTransform);
+            }
+            painter.drawImage(rect, tile.image);
+            if (tile.latency) {
+                tile.latency->recordSince(qsc::StageLatency::SL_PAINT, paintStartUs);
+            }
+            changed += tile.rect;
+            changed += rect;
+            tile.rect = rect;
+        }
+        ++it;
+    }
+    if (painter.isActive()) {
+        painter.end();
+    }
+    if (!changed.isEmpty()) {
+        update(changed);
+    }
+}
+
+bool SoftwareCompositor::convert(Tile &tile, const QSize &targetSize)
+{
+    const FrameData &frame = tile.frame;
+    // the box filter takes most of the reduction, the painter scales the rest
+    const int factor = YuvConvert::downscaleFactor(frame.width, frame.height, targetSize.width(), targetSize.height());
+    const QSize imageSize(frame.width / factor, frame.height / factor);
+    if (tile.image.size() != imageSize) {
+        tile.image = QImage(imageSize, QImage::Format_RGB32);
+        if (tile.image.isNull()) {
+            return false;
+        }
+    }
+
+    const uint8_t *planes[3] = { frame.dataY, frame.dataU, frame.dataV };
+    const int linesizes[3] = { frame.linesizeY, frame.linesizeU, frame.linesizeV };
+    if (!YuvConvert::toRgb32(planes, linesizes, frame.width, frame.height, factor, tile.image.bits(), static_cast<int>(tile.image.bytesPerLine()))) {
+        qWarning() << "SoftwareCompositor: cannot convert frame" << frame.width << "x" << frame.height;
+        return false;
+    }
+    return true;
+}
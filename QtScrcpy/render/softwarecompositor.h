@@ -0,0 +1,79 @@
+#ifndef SOFTWARECOMPOSITOR_H
+#define SOFTWARECOMPOSITOR_H
+
+#include <QHash>
+#include <QImage>
+#include <QPointer>
+#include <QTimer>
+#include <QWidget>
+
+#include "framedata.h"
+
+namespace qsc {
+class StageLatency;
+}
+
+/**
+ * SoftwareCompositor - CPU-only renderer of the farm grid, for hosts without a usable GPU
+ *
+ * With OpenGL every tile is a QOpenGLWidget with its own context, and on a software GL
+ * (Mesa llvmpipe, a VM without GPU) each of them costs a rasterizer pass per frame. In
+ * software mode the tiles keep a plain surface widget and hand their frames over, shared,
+ * without conversion. The compositor is one transparent overlay on the scroll area viewport
+ * that ignores input; every COMPOSE_INTERVAL_MS it:
+ * - skips tiles outside the viewport, their latest frame just waits
+ * - converts the new frames of the visible ones with the YuvConvert kernels, box downscaled
+ *   by 2 or 4 towards the tile size on the way
+ * - scales them into one shared backbuffer, at their place in the viewport
+ * - repaints the changed tile rects with a single update()
+ * Scrolling only recomposes the visible tiles from their converted images. The image of a
+ * tile scrolled away is dropped, its latest frame is converted when it comes back.
+ */
+class SoftwareCompositor : public QWidget
+{
+    Q_OBJECT
+public:
+    enum
+    {
+        COMPOSE_INTERVAL_MS = 67 // the tile frame rate limit of VideoForm
+    };
+
+    // an overlay of viewport, which has to be an ancestor of every surface
+    explicit SoftwareCompositor(QWidget *viewport);
+    virtual ~SoftwareCompositor() override;
+
+    // latest frame of the tile drawn over surface; latency records conversion and compose times
+    void setFrame(QWidget *surface, const FrameData &frame, qsc::StageLatency *latency);
+    void removeSurface(QWidget *surface);
+
+    // false without an OpenGL context or on a software rasterizer; renderer names the implementation
+    static bool isOpenGLAccelerated(QString *renderer = nullptr);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private slots:
+    void compose();
+
+private:
+    struct Tile
+    {
+        QPointer<QWidget> surface;
+        FrameData frame;
+        bool hasFrame = false;
+        bool frameDirty = false; // not converted yet
+        QImage image;            // last converted frame, about tile resolution
+        QRect rect;              // drawn in the backbuffer, viewport coordinates
+        qsc::StageLatency *latency = nullptr;
+    };
+
+    bool convert(Tile &tile, const QSize &targetSize);
+
+private:
+    QHash<QWidget *, Tile> m_tiles;
+    QImage m_backbuffer;
+    QTimer m_timer;
+};
+
+#endif // SOFTWARECOMPOSITOR_H
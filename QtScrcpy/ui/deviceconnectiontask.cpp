@@ -101,6 +101,7 @@ qsc::DeviceParams DeviceConnectionTask::createDeviceParams()
     params.recordFile = false;
     params.recordPath = "";
     params.recordFileFormat = "mp4";
+    params.clipBufferSeconds = Config::getInstance().getClipBufferSeconds();
     params.serverLocalPath = FarmViewer::getServerPath();
     params.serverRemotePath = Config::getInstance().getServerPath();
     params.pushFilePath = Config::getInstance().getPushFilePath();
@@ -3,6 +3,7 @@
 #include <QFileDialog>
 #include <QKeyEvent>
 #include <QRandomGenerator>
+#include <QTextDocument>
 #include <QTime>
 #include <QTimer>
 
@@ -17,6 +18,9 @@
 #include "../util/winutils.h"
 #endif
 
+// lines of the log view, each log line takes two blocks
+#define DIALOG_LOG_MAX_BLOCKS 4000
+
 QString s_keyMapPath = "";
 
 const QString &getKeyMapPath()
@@ -143,6 +147,9 @@ void Dialog::initUI()
 
     setWindowTitle(Config::getInstance().getTitle());
 
+    // the log view keeps a bounded tail, a long running farm would grow it forever
+    ui->outEdit->document()->setMaximumBlockCount(DIALOG_LOG_MAX_BLOCKS);
+
 #ifdef Q_OS_WIN32
     WinUtils::setDarkBorderToWindow((HWND)this->winId(), true);
 #endif
@@ -346,6 +353,9 @@ void Dialog::on_startServerBtn_clicked()
     params.recordFile = ui->recordScreenCheck->isChecked();
     params.recordPath = ui->recordPathEdt->text().trimmed();
     params.recordFileFormat = ui->formatBox->currentText().trimmed();
+    params.recordSegmentSeconds = Config::getInstance().getRecordSegmentSeconds();
+    params.recordSegmentCount = Config::getInstance().getRecordSegmentCount();
+    params.clipBufferSeconds = Config::getInstance().getClipBufferSeconds();
     params.serverLocalPath = getServerPath();
     params.serverRemotePath = Config::getInstance().getServerPath();
     params.pushFilePath = Config::getInstance().getPushFilePath();
@@ -429,6 +439,17 @@ void Dialog::outLog(const QString &log, bool newLine)
     });
 }
 
+void Dialog::outLogLines(const QStringList &lines)
+{
+    for (const QString &line : lines) {
+        if (filterLog(line)) {
+            continue;
+        }
+        ui->outEdit->append(line);
+        ui->outEdit->append("<br/>");
+    }
+}
+
 bool Dialog::filterLog(const QString &log)
 {
     if (log.contains("app_proces")) {
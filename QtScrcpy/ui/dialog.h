@@ -31,6 +31,8 @@ public:
     ~Dialog();
 
     void outLog(const QString &log, bool newLine = true);
+    // a batch of application log lines, GUI thread
+    void outLogLines(const QStringList &lines);
     bool filterLog(const QString &log);
     void getIPbyIp();
 
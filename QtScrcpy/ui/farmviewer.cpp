@@ -2,6 +2,9 @@
 #include "videoform.h"
 #include "../groupcontroller/groupcontroller.h"
 #include "../util/config.h"
+#include "../util/qualitycontroller.h"
+#include "../render/rendersurfacepool.h"
+#include "../render/softwarecompositor.h"
 #include "QtScrcpyCore.h"
 #include "adbprocess.h"
 
@@ -14,7 +17,11 @@
 #include <QFileInfo>
 #include <QCoreApplication>
 #include <QMessageBox>
+#include <QScrollBar>
 #include <QSet>
+#include <QDateTime>
+#include <QDir>
+#include <QStandardPaths>
 
 #include <signal.h>
 #include <unistd.h>
@@ -42,9 +49,15 @@ FarmViewer::FarmViewer(QWidget *parent)
     , m_gridCols(2)
     , m_currentQualityProfile(720, 4000000, 30, "Default")
     , m_currentQualityTier(qsc::DeviceConnectionPool::TIER_HIGH)
+    , m_qualityController(nullptr)
+    , m_focusIdleTimer(nullptr)
+    , m_focusUpdateTimer(nullptr)
+    , m_surfacePool(nullptr)
+    , m_gridResizeTimer(nullptr)
     , m_screenshotAllBtn(nullptr)
     , m_syncActionBtn(nullptr)
     , m_streamAllBtn(nullptr)
+    , m_softwareRenderBtn(nullptr)
     , m_statusLabel(nullptr)
     , m_connectionProgressBar(nullptr)
     , m_isConnecting(false)
@@ -119,6 +132,34 @@ FarmViewer::FarmViewer(QWidget *parent)
     m_deviceDetectionTimer->start();
     qInfo() << "FarmViewer: Periodic device detection enabled (5s interval)";
 
+    // Closed-loop quality: each stream converges on the best tier the host sustains
+    m_qualityController = new QualityController(this);
+    m_qualityController->setEnabled(Config::getInstance().getAdaptiveQuality() != 0);
+    m_qualityController->setStartTier(m_currentQualityTier);
+    m_qualityController->setFocusAware(Config::getInstance().getFocusAwareQuality() != 0);
+    m_qualityController->setDualStream(Config::getInstance().getDualStream() != 0);
+    connect(m_qualityController, &QualityController::qualityChangeRequested, this, &FarmViewer::updateDeviceQuality);
+    connect(m_qualityController, &QualityController::detailStreamRequested, this, &FarmViewer::attachDetailStream);
+    connect(m_qualityController, &QualityController::detailStreamReleased, this, &FarmViewer::detachDetailStream);
+
+    m_focusIdleTimer = new QTimer(this);
+    m_focusIdleTimer->setSingleShot(true);
+    m_focusIdleTimer->setInterval(FOCUS_IDLE_MS);
+    connect(m_focusIdleTimer, &QTimer::timeout, this, [this]() {
+        qDebug() << "FarmViewer: No input for" << m_focusedSerial << "- back to thumbnail";
+        m_focusedSerial.clear();
+        updateDeviceFocus();
+    });
+    m_focusUpdateTimer = new QTimer(this);
+    m_focusUpdateTimer->setSingleShot(true);
+    m_focusUpdateTimer->setInterval(FOCUS_UPDATE_DELAY_MS);
+    connect(m_focusUpdateTimer, &QTimer::timeout, this, &FarmViewer::updateDeviceFocus);
+    connect(m_scrollArea->verticalScrollBar(), &QScrollBar::valueChanged, this, &FarmViewer::scheduleDeviceFocusUpdate);
+    connect(m_scrollArea->horizontalScrollBar(), &QScrollBar::valueChanged, this, &FarmViewer::scheduleDeviceFocusUpdate);
+    // not coalesced: a tile scrolling in needs its surface before it is painted
+    connect(m_scrollArea->verticalScrollBar(), &QScrollBar::valueChanged, this, &FarmViewer::updateVisibleSurfaces);
+    connect(m_scrollArea->horizontalScrollBar(), &QScrollBar::valueChanged, this, &FarmViewer::updateVisibleSurfaces);
+
     qInfo() << "FarmViewer: Connecting to IDeviceManage signals...";
     // Connect to IDeviceManage signals to track connection state
     connect(&qsc::IDeviceManage::getInstance(), &qsc::IDeviceManage::deviceConnected,
@@ -143,6 +184,7 @@ FarmViewer::FarmViewer(QWidget *parent)
 
                 qInfo() << "FarmViewer: Device marked as connected:" << serial;
                 qInfo() << "  Active connections:" << m_activeConnections;
+                m_qualityController->onDeviceConnected(serial);
 
                 // Register VideoForm as observer to receive video frames
                 if (m_deviceForms.contains(serial) && !m_deviceForms[serial].isNull()) {
@@ -151,6 +193,8 @@ FarmViewer::FarmViewer(QWidget *parent)
                     if (device) {
                         qInfo() << "FarmViewer: Got Device pointer, calling registerDeviceObserver()...";
                         device->registerDeviceObserver(m_deviceForms[serial]);
+                        connect(device.data(), &qsc::IDevice::detailStreamStarted, this, &FarmViewer::onDetailStreamStarted, Qt::UniqueConnection);
+                        connect(device.data(), &qsc::IDevice::detailStreamStopped, this, &FarmViewer::onDetailStreamStopped, Qt::UniqueConnection);
                         qInfo() << "FarmViewer: VideoForm registered as observer for:" << serial;
                     } else {
                         qWarning() << "FarmViewer: Failed to get Device pointer for:" << serial;
@@ -184,6 +228,7 @@ FarmViewer::FarmViewer(QWidget *parent)
             if (m_activeConnections > 0) {
                 m_activeConnections--;
             }
+            m_qualityController->onDeviceDisconnected(serial);
 
             qDebug() << "FarmViewer: Device marked as disconnected:" << serial
                      << "Active connections:" << m_activeConnections;
@@ -204,6 +249,32 @@ FarmViewer::FarmViewer(QWidget *parent)
             }
         });
 
+    connect(&qsc::IDeviceManage::getInstance(), &qsc::IDeviceManage::screenshotSaved,
+        this, [this](const QString& serial, const QString& filePath, bool success) {
+            if (m_screenshotPending <= 0 || !m_screenshotSerials.contains(serial)
+                || QFileInfo(filePath).absolutePath() != QDir(m_screenshotDir).absolutePath()) {
+                return; // single device screenshot from a VideoForm
+            }
+            m_screenshotSerials.remove(serial);
+            if (success) {
+                m_screenshotSucceeded++;
+            } else {
+                m_screenshotFailed++;
+            }
+            if (--m_screenshotPending > 0) {
+                return;
+            }
+
+            m_screenshotSerials.clear();
+            m_screenshotAllBtn->setEnabled(true);
+            QString statusText = QString("Saved %1 screenshots to %2").arg(m_screenshotSucceeded).arg(m_screenshotDir);
+            if (m_screenshotFailed > 0) {
+                statusText += QString(" (%1 failed)").arg(m_screenshotFailed);
+            }
+            m_statusLabel->setText(statusText);
+            qInfo() << "FarmViewer:" << statusText;
+        });
+
     qInfo() << "FarmViewer: IDeviceManage signal connections completed";
 
     qInfo() << "FarmViewer: Setting up Unix signal socket notifier...";
@@ -265,6 +336,22 @@ void FarmViewer::showEvent(QShowEvent *event)
     QWidget::showEvent(event);
     // Auto-detection is handled in showFarmViewer(), not here
     // This prevents window recreation issues during first show
+    scheduleDeviceFocusUpdate();
+}
+
+void FarmViewer::hideEvent(QHideEvent *event)
+{
+    QWidget::hideEvent(event);
+    // Nobody looks at a hidden farm: every tile drops to the offscreen trickle
+    scheduleDeviceFocusUpdate();
+}
+
+void FarmViewer::changeEvent(QEvent *event)
+{
+    QWidget::changeEvent(event);
+    if (event->type() == QEvent::WindowStateChange) {
+        scheduleDeviceFocusUpdate();
+    }
 }
 
 void FarmViewer::closeEvent(QCloseEvent *event)
@@ -327,6 +414,11 @@ void FarmViewer::setupUI()
     );
     connect(m_streamAllBtn, &QPushButton::clicked, this, &FarmViewer::onStreamAllClicked);
 
+    m_softwareRenderBtn = new QPushButton("Software Render");
+    m_softwareRenderBtn->setMaximumWidth(130);
+    m_softwareRenderBtn->setCheckable(true);
+    m_softwareRenderBtn->setToolTip("Draw the tiles with the CPU instead of one OpenGL widget each");
+
     // Status label
     m_statusLabel = new QLabel("No devices connected");
     m_statusLabel->setStyleSheet("color: #888; font-size: 12px;");
@@ -341,12 +433,13 @@ void FarmViewer::setupUI()
     m_toolbarLayout->addWidget(m_screenshotAllBtn);
     m_toolbarLayout->addWidget(m_syncActionBtn);
     m_toolbarLayout->addWidget(m_streamAllBtn);  // CLICK-TO-STREAM: Add Stream All button
+    m_toolbarLayout->addWidget(m_softwareRenderBtn);
     m_toolbarLayout->addWidget(m_connectionProgressBar);
     m_toolbarLayout->addStretch();
     m_toolbarLayout->addWidget(m_statusLabel);
 
     // UI IMPROVEMENT: Scroll area for device grid with better styling
-    m_scrollArea = new FarmScrollArea();
+    m_scrollArea = new QScrollArea();
     m_scrollArea->setWidgetResizable(false); // CRITICAL: false for proper scrolling with fixed-size widgets
     m_scrollArea->setHorizontalScrollBarPolicy(Qt::ScrollBarAsNeeded);
     m_scrollArea->setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
@@ -374,6 +467,50 @@ void FarmViewer::setupUI()
     m_mainLayout->addWidget(m_scrollArea, 1);
     
     setLayout(m_mainLayout);
+
+    m_surfacePool = new RenderSurfacePool(this);
+
+    m_gridResizeTimer = new QTimer(this);
+    m_gridResizeTimer->setSingleShot(true);
+    m_gridResizeTimer->setInterval(GRID_RESIZE_DELAY_MS);
+    connect(m_gridResizeTimer, &QTimer::timeout, this, &FarmViewer::applyGridResize);
+
+    // auto: software when there is no GPU behind OpenGL
+    const QString farmRenderer = Config::getInstance().getFarmRenderer().toLower();
+    bool software = farmRenderer == "software";
+    if (farmRenderer != "software" && farmRenderer != "opengl") {
+        QString renderer;
+        software = !SoftwareCompositor::isOpenGLAccelerated(&renderer);
+        qInfo() << "FarmViewer: OpenGL renderer" << renderer << (software ? "is not accelerated, using software rendering" : "");
+    }
+    setSoftwareRendering(software);
+    m_softwareRenderBtn->setChecked(software);
+    connect(m_softwareRenderBtn, &QPushButton::toggled, this, &FarmViewer::onSoftwareRenderToggled);
+}
+
+void FarmViewer::onSoftwareRenderToggled(bool enabled)
+{
+    setSoftwareRendering(enabled);
+}
+
+void FarmViewer::setSoftwareRendering(bool enabled)
+{
+    if (enabled == !m_compositor.isNull()) {
+        return;
+    }
+    qInfo() << "FarmViewer: tile renderer" << (enabled ? "software" : "opengl");
+
+    QPointer<SoftwareCompositor> oldCompositor = m_compositor;
+    m_compositor = enabled ? new SoftwareCompositor(m_scrollArea->viewport()) : nullptr;
+    // every tile recreates its surface with the next frame
+    for (auto it = m_deviceForms.begin(); it != m_deviceForms.end(); ++it) {
+        if (!it.value().isNull()) {
+            it.value()->setCompositor(m_compositor);
+        }
+    }
+    if (oldCompositor) {
+        delete oldCompositor;
+    }
 }
 
 void FarmViewer::addDevice(const QString& serial, const QString& deviceName, const QSize& size)
@@ -394,6 +531,8 @@ void FarmViewer::addDevice(const QString& serial, const QString& deviceName, con
     // Create VideoForm for this device with dynamic sizing
     auto videoForm = new VideoForm(true, false, false, this); // frameless, no skin, no toolbar
     videoForm->setSerial(serial);
+    videoForm->setCompositor(m_compositor);
+    videoForm->setSurfacePool(m_surfacePool);
     // UI IMPROVEMENT: Fixed size policy to match container for proper grid layout
     videoForm->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
     // Set exact size based on tile size, accounting for container margins and label
@@ -416,6 +555,7 @@ void FarmViewer::addDevice(const QString& serial, const QString& deviceName, con
 
     // Connect click signal for click-to-connect functionality
     connect(videoForm, &VideoForm::deviceClicked, this, &FarmViewer::onDeviceTileClicked);
+    connect(videoForm, &VideoForm::deviceInteracted, this, &FarmViewer::onDeviceInteracted);
 
     // SIMPLIFIED: Do NOT auto-register observers or auto-connect to device
     // Just display the placeholder UI - user will click to connect
@@ -448,6 +588,11 @@ void FarmViewer::removeDevice(const QString& serial)
         m_deviceContainers.remove(serial);
     }
 
+    m_qualityController->forgetDevice(serial);
+    if (m_focusedSerial == serial) {
+        m_focusedSerial.clear();
+    }
+
     // Clean up VideoForm (no observer deregistration needed since we never registered)
     if (m_deviceForms.contains(serial) && !m_deviceForms[serial].isNull()) {
         delete m_deviceForms[serial];
@@ -527,33 +672,57 @@ QWidget* FarmViewer::createDeviceWidget(const QString& serial, const QString& de
 
 void FarmViewer::updateGridLayout()
 {
-    // Remove all widgets from layout first
-    while (QLayoutItem* item = m_gridLayout->takeAt(0)) {
-        delete item;
-    }
-
-    // Add devices back to grid
+    // Incremental: a tile only moves when its cell changed, after a hotplug before it or a new
+    // column count. The others keep their layout item and geometry, and their surface is not touched.
+    // Deleted containers have already left the layout on their own.
+    QList<QWidget*> movedTiles;
+    QList<QPoint> movedCells; // x: column, y: row
     int deviceCount = 0;
     for (auto it = m_deviceContainers.begin(); it != m_deviceContainers.end(); ++it) {
-        if (!it.value().isNull()) {
-            int row = deviceCount / m_gridCols;
-            int col = deviceCount % m_gridCols;
-            m_gridLayout->addWidget(it.value(), row, col);
-            deviceCount++;
+        QWidget* container = it.value();
+        if (!container) {
+            continue;
         }
+        int row = deviceCount / m_gridCols;
+        int col = deviceCount % m_gridCols;
+        deviceCount++;
+
+        int index = m_gridLayout->indexOf(container);
+        if (index >= 0) {
+            int currentRow, currentCol, rowSpan, colSpan;
+            m_gridLayout->getItemPosition(index, &currentRow, &currentCol, &rowSpan, &colSpan);
+            if (currentRow == row && currentCol == col) {
+                continue;
+            }
+            m_gridLayout->removeWidget(container);
+        }
+        movedTiles.append(container);
+        movedCells.append(QPoint(col, row));
+    }
+    // all moved tiles are out first, so none lands on a cell that is still taken
+    for (int i = 0; i < movedTiles.size(); i++) {
+        m_gridLayout->addWidget(movedTiles[i], movedCells[i].y(), movedCells[i].x());
     }
-
-    // UI IMPROVEMENT: Force grid widget to resize based on contents
-    // This ensures scroll bars appear when grid exceeds visible area
-    m_gridLayout->activate();
-    m_gridWidget->adjustSize();
 
     // Calculate required size for grid widget
     QSize tileSize = getOptimalTileSize(deviceCount, size());
     int gridWidth = m_gridCols * (tileSize.width() + m_gridLayout->spacing()) + m_gridLayout->contentsMargins().left() + m_gridLayout->contentsMargins().right();
     int gridHeight = ((deviceCount + m_gridCols - 1) / m_gridCols) * (tileSize.height() + m_gridLayout->spacing()) + m_gridLayout->contentsMargins().top() + m_gridLayout->contentsMargins().bottom();
+    QSize gridSize(gridWidth, gridHeight);
 
-    m_gridWidget->setMinimumSize(gridWidth, gridHeight);
+    if (!movedTiles.isEmpty() || gridSize != m_gridWidget->minimumSize()) {
+        qDebug() << "FarmViewer: Grid layout moved" << movedTiles.size() << "of" << deviceCount << "tiles";
+
+        m_gridWidget->setMinimumSize(gridSize);
+        // UI IMPROVEMENT: Force grid widget to resize based on contents
+        // This ensures scroll bars appear when grid exceeds visible area
+        m_gridLayout->activate();
+        m_gridWidget->adjustSize();
+    }
+
+    // tiles moved or the viewport changed size: some may have entered or left it
+    updateVisibleSurfaces();
+    scheduleDeviceFocusUpdate();
 }
 
 void FarmViewer::updateStatus()
@@ -691,50 +860,108 @@ void FarmViewer::applyQualityToAllDevices()
 {
     qDebug() << "FarmViewer: Applying quality profile to all devices:" << m_currentQualityProfile.description;
 
-    // Note: For existing connections, we can't change stream quality on the fly
-    // This will apply to new connections. For a full implementation, you would need to:
-    // 1. Disconnect existing devices
-    // 2. Reconnect with new quality settings
-    // For now, we'll just log a warning
+    // New connections start on the device-count tier. Running streams are not reconnected
+    // all at once: the quality controller moves each of them when its own load says so.
+    m_qualityController->setStartTier(m_currentQualityTier);
 
-    if (!m_deviceForms.isEmpty()) {
-        qWarning() << "FarmViewer: Quality changes will apply to new connections only.";
-        qWarning() << "FarmViewer: Consider reconnecting devices to apply new quality settings.";
+    if (!m_deviceForms.isEmpty() && !m_qualityController->isEnabled()) {
+        qWarning() << "FarmViewer: Quality changes will apply to new connections only (AdaptiveQuality=0).";
     }
 }
 
 void FarmViewer::updateDeviceQuality(const QString& serial, const qsc::StreamQualityProfile& profile)
 {
-    Q_UNUSED(serial);
-    Q_UNUSED(profile);
+    // The scrcpy server fixes the encoder settings at start: a fast reconnect applies them.
+    // connectToDevice() asks the quality controller, which already holds the new tier.
+    if (!isDeviceConnected(serial)) {
+        return;
+    }
+    qInfo() << "FarmViewer: Reconnecting" << serial << "with quality" << profile.description
+            << "Resolution:" << profile.maxSize
+            << "Bitrate:" << (profile.bitRate / 1000000.0) << "Mbps"
+            << "FPS:" << profile.maxFps;
+
+    disconnectDevice(serial);
+    if (m_deviceForms.contains(serial) && !m_deviceForms[serial].isNull()) {
+        m_deviceForms[serial]->updatePlaceholderStatus("Adjusting quality...", "connecting");
+    }
 
-    // Placeholder for per-device quality updates
-    // Would require reconnection with new params
-    qDebug() << "FarmViewer: Per-device quality update requested for" << serial;
+    // give the old server a moment to release its adb tunnel
+    QTimer::singleShot(QUALITY_RECONNECT_DELAY_MS, this, [this, serial]() {
+        if (m_isShuttingDown || !m_deviceForms.contains(serial) || isDeviceConnected(serial)) {
+            return;
+        }
+        connectToDevice(serial);
+    });
+}
+
+void FarmViewer::attachDetailStream(const QString& serial, const qsc::StreamQualityProfile& profile)
+{
+    auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
+    if (!device || !isDeviceConnected(serial)) {
+        return;
+    }
+    qInfo() << "FarmViewer: Attaching detail stream to" << serial << profile.description;
+    if (!device->attachDetailStream(profile.maxSize, profile.bitRate, profile.maxFps)) {
+        m_qualityController->onDetailStreamLost(serial);
+    }
+}
+
+void FarmViewer::detachDetailStream(const QString& serial)
+{
+    auto device = qsc::IDeviceManage::getInstance().getDevice(serial);
+    if (device) {
+        qInfo() << "FarmViewer: Detaching detail stream from" << serial;
+        device->detachDetailStream();
+    }
+}
+
+void FarmViewer::onDetailStreamStarted(const QString& serial, bool success, const QSize& size)
+{
+    if (!success) {
+        m_qualityController->onDetailStreamLost(serial);
+        return;
+    }
+    qInfo() << "FarmViewer: Detail stream of" << serial << "running at" << size;
+}
+
+void FarmViewer::onDetailStreamStopped(const QString& serial)
+{
+    m_qualityController->onDetailStreamLost(serial);
 }
 
 void FarmViewer::resizeEvent(QResizeEvent* event)
 {
     QWidget::resizeEvent(event);
 
-    // Recalculate grid when window resizes
-    int deviceCount = m_deviceForms.size();
-    if (deviceCount > 0) {
-        calculateOptimalGrid(deviceCount, event->size());
+    // Recalculate grid once the window stops changing, not on every step of a drag
+    if (m_gridResizeTimer && !m_deviceForms.isEmpty()) {
+        m_gridResizeTimer->start();
+    }
+}
 
-        // Update widget sizes based on new grid
-        QSize tileSize = getOptimalTileSize(deviceCount, event->size());
+void FarmViewer::applyGridResize()
+{
+    int deviceCount = m_deviceForms.size();
+    if (deviceCount == 0) {
+        return;
+    }
+    calculateOptimalGrid(deviceCount, size());
 
+    // Update widget sizes based on new grid, only when the tile size changed: resizing a tile
+    // resizes its surface, a tile that just moves keeps it as is
+    QSize tileSize = getOptimalTileSize(deviceCount, size());
+    if (tileSize != m_appliedTileSize) {
+        m_appliedTileSize = tileSize;
         for (auto it = m_deviceContainers.begin(); it != m_deviceContainers.end(); ++it) {
             if (!it.value().isNull()) {
                 it.value()->setMinimumSize(tileSize);
                 it.value()->setMaximumSize(tileSize * 2); // Allow some growth
             }
         }
-
-        // Rebuild grid layout
-        updateGridLayout();
     }
+
+    updateGridLayout();
 }
 
 void FarmViewer::showFarmViewer()
@@ -806,15 +1033,47 @@ void FarmViewer::hideFarmViewer()
 
 void FarmViewer::onScreenshotAllClicked()
 {
-    qDebug() << "FarmViewer: Screenshot all devices";
-    // TODO: Implement screenshot all functionality
-    // Need to iterate through devices and call screenshot on each individually
-    for (auto it = m_deviceForms.begin(); it != m_deviceForms.end(); ++it) {
-        if (!it.value().isNull()) {
-            // Each VideoForm would need screenshot capability
-            qDebug() << "Taking screenshot of device:" << it.key();
+    if (m_screenshotPending > 0) {
+        return;
+    }
+
+    QStringList serials;
+    for (const QString& serial : qsc::IDeviceManage::getInstance().getAllConnectedSerials()) {
+        if (m_deviceForms.contains(serial)) {
+            serials << serial;
         }
     }
+    if (serials.isEmpty()) {
+        m_statusLabel->setText("No streaming devices to capture");
+        return;
+    }
+
+    // one folder per run keeps a farm-wide capture together
+    QString baseDir = Config::getInstance().getScreenshotPath();
+    if (baseDir.isEmpty()) {
+        baseDir = QDir(QStandardPaths::writableLocation(QStandardPaths::PicturesLocation)).filePath("QtScrcpy");
+    }
+    m_screenshotDir = QDir(baseDir).filePath(QDateTime::currentDateTime().toString("farm_yyyyMMdd_hhmmss"));
+    m_screenshotSucceeded = 0;
+    m_screenshotFailed = 0;
+
+    // frames are only referenced here, conversion and encoding run on the core's worker pool
+    int queued = qsc::IDeviceManage::getInstance().screenshotAll(serials, m_screenshotDir,
+        Config::getInstance().getScreenshotFormat(), Config::getInstance().getScreenshotQuality());
+    qInfo() << "FarmViewer: Screenshot all queued" << queued << "of" << serials.size() << "devices to" << m_screenshotDir;
+    if (queued <= 0) {
+        m_statusLabel->setText("No frames available for screenshots yet");
+        return;
+    }
+
+    // devices without a frame queued nothing, the count ends the run
+    m_screenshotSerials.clear();
+    for (const QString& serial : serials) {
+        m_screenshotSerials.insert(serial);
+    }
+    m_screenshotPending = queued;
+    m_screenshotAllBtn->setEnabled(false);
+    m_statusLabel->setText(QString("Saving %1 screenshots...").arg(queued));
 }
 
 void FarmViewer::onSyncActionClicked()
@@ -982,6 +1241,8 @@ void FarmViewer::processDetectedDevices(const QStringList& devices)
             // Create VideoForm with default size (will be resized later)
             auto videoForm = new VideoForm(true, false, false, this);
             videoForm->setSerial(serial);
+            videoForm->setCompositor(m_compositor);
+            videoForm->setSurfacePool(m_surfacePool);
 
             // Create container widget
             QWidget* container = createDeviceWidget(serial, serial);
@@ -998,6 +1259,7 @@ void FarmViewer::processDetectedDevices(const QStringList& devices)
 
             // Connect click signal
             connect(videoForm, &VideoForm::deviceClicked, this, &FarmViewer::onDeviceTileClicked);
+            connect(videoForm, &VideoForm::deviceInteracted, this, &FarmViewer::onDeviceInteracted);
 
             videoForm->show();
             devicesAddedCount++;
@@ -1014,6 +1276,7 @@ void FarmViewer::processDetectedDevices(const QStringList& devices)
     // Update all widget sizes based on the final grid calculation
     QSize tileSize = getOptimalTileSize(totalDevices, this->size());
     qInfo() << "FarmViewer: Applying tile size to all devices:" << tileSize;
+    m_appliedTileSize = tileSize;
 
     for (auto it = m_deviceContainers.begin(); it != m_deviceContainers.end(); ++it) {
         if (!it.value().isNull()) {
@@ -1177,9 +1440,9 @@ void FarmViewer::connectToDevice(const QString& serial)
         return;
     }
 
-    // Use the GLOBAL quality profile that was set in processDetectedDevices()
-    // This ensures all devices in this batch use the same quality tier
-    qsc::StreamQualityProfile qualityProfile = m_currentQualityProfile;
+    // Start on the device-count tier, or on the tier the quality controller settled on
+    // for this device (it keeps its history across reconnects)
+    qsc::StreamQualityProfile qualityProfile = m_qualityController->profileFor(serial);
 
     // Create device parameters with adaptive quality settings
     qsc::DeviceParams params;
@@ -1211,6 +1474,7 @@ void FarmViewer::connectToDevice(const QString& serial)
     params.recordFile = false;
     params.recordPath = "";
     params.recordFileFormat = "mp4";
+    params.clipBufferSeconds = Config::getInstance().getClipBufferSeconds();
     params.serverLocalPath = getServerPath();
     params.serverRemotePath = Config::getInstance().getServerPath();
     params.pushFilePath = Config::getInstance().getPushFilePath();
@@ -1314,6 +1578,96 @@ bool FarmViewer::isDeviceConnected(const QString& serial) const
     return m_connectedDevices.contains(serial);
 }
 
+void FarmViewer::onDeviceInteracted(QString serial)
+{
+    m_focusIdleTimer->start();
+    if (m_focusedSerial == serial) {
+        return;
+    }
+    qDebug() << "FarmViewer: Active device is now" << serial;
+    m_focusedSerial = serial;
+    updateDeviceFocus();
+}
+
+void FarmViewer::scheduleDeviceFocusUpdate()
+{
+    if (m_focusUpdateTimer && !m_focusUpdateTimer->isActive()) {
+        m_focusUpdateTimer->start();
+    }
+}
+
+void FarmViewer::updateVisibleSurfaces()
+{
+    if (!m_scrollArea || !m_gridLayout) {
+        return;
+    }
+
+    QWidget* viewport = m_scrollArea->viewport();
+    QRect viewportRect = viewport->rect();
+    int margin = 0;
+    for (auto it = m_deviceContainers.begin(); it != m_deviceContainers.end(); ++it) {
+        if (!it.value().isNull()) {
+            margin = SURFACE_PREFETCH_ROWS * (it.value()->height() + m_gridLayout->spacing());
+            break;
+        }
+    }
+    QRect surfaceRect = viewportRect.adjusted(-margin, -margin, margin, margin);
+
+    QList<QPointer<VideoForm>> attach;
+    QList<QPointer<VideoForm>> detach;
+    for (auto it = m_deviceContainers.begin(); it != m_deviceContainers.end(); ++it) {
+        QWidget* container = it.value();
+        QPointer<VideoForm> videoForm = m_deviceForms.value(it.key());
+        if (!container || !videoForm) {
+            continue;
+        }
+        QRect tileRect(container->mapTo(viewport, QPoint(0, 0)), container->size());
+        if (surfaceRect.intersects(tileRect)) {
+            attach << videoForm;
+        } else {
+            detach << videoForm;
+        }
+    }
+    // a page scroll parks a full page of surfaces, the tiles scrolling in take them over
+    if (m_surfacePool) {
+        m_surfacePool->setMaxParked(attach.size());
+    }
+    for (const QPointer<VideoForm>& videoForm : detach) {
+        if (videoForm) {
+            videoForm->setSurfaceAttached(false);
+        }
+    }
+    for (const QPointer<VideoForm>& videoForm : attach) {
+        if (videoForm) {
+            videoForm->setSurfaceAttached(true);
+        }
+    }
+}
+
+void FarmViewer::updateDeviceFocus()
+{
+    if (!m_qualityController || !m_qualityController->isFocusAware() || !m_scrollArea) {
+        return;
+    }
+
+    QWidget* viewport = m_scrollArea->viewport();
+    QRect viewportRect = viewport->rect();
+    bool windowShown = QWidget::isVisible() && !isMinimized();
+
+    for (auto it = m_deviceContainers.begin(); it != m_deviceContainers.end(); ++it) {
+        QWidget* container = it.value();
+        if (!container) {
+            continue;
+        }
+        QRect tileRect(container->mapTo(viewport, QPoint(0, 0)), container->size());
+        QualityController::Focus focus = QualityController::FOCUS_OFFSCREEN;
+        if (windowShown && viewportRect.intersects(tileRect)) {
+            focus = it.key() == m_focusedSerial ? QualityController::FOCUS_ACTIVE : QualityController::FOCUS_THUMBNAIL;
+        }
+        m_qualityController->setFocus(it.key(), focus);
+    }
+}
+
 void FarmViewer::disconnectDevice(const QString& serial)
 {
     qDebug() << "FarmViewer: Disconnecting device:" << serial;
@@ -1335,6 +1689,7 @@ void FarmViewer::disconnectDevice(const QString& serial)
     if (m_activeConnections > 0) {
         m_activeConnections--;
     }
+    m_qualityController->onDeviceDisconnected(serial);
 
     // Update placeholder to show "Ready to Connect"
     if (m_deviceForms.contains(serial) && !m_deviceForms[serial].isNull()) {
@@ -8,6 +8,7 @@
 #include <QMap>
 #include <QPointer>
 #include <QPushButton>
+#include <QSet>
 #include <QHBoxLayout>
 #include <QVBoxLayout>
 #include <QSplitter>
@@ -20,31 +21,10 @@
 #include "performancemonitor.h"
 #include "../QtScrcpyCore/src/device/deviceconnectionpool.h"
 
-// Custom QScrollArea that forwards paint events to all viewport widgets
-// This prevents Qt from filtering paint events for QOpenGLWidgets outside the visible area
-// which was causing devices 26+ to show black/white screens even though data was streaming
-class FarmScrollArea : public QScrollArea {
-    Q_OBJECT
-public:
-    explicit FarmScrollArea(QWidget* parent = nullptr) : QScrollArea(parent) {}
-
-protected:
-    bool viewportEvent(QEvent* event) override {
-        // Forward paint events to viewport - don't filter them!
-        // This ensures paintGL() is called for all QOpenGLWidget instances
-        // even if they're outside the currently visible scroll area
-        if (event->type() == QEvent::Paint) {
-            // Propagate paint event to viewport and all child widgets
-            if (viewport()) {
-                viewport()->update();
-            }
-            return true;
-        }
-        return QScrollArea::viewportEvent(event);
-    }
-};
-
 class VideoForm;
+class QualityController;
+class SoftwareCompositor;
+class RenderSurfacePool;
 
 class FarmViewer : public QWidget
 {
@@ -71,6 +51,9 @@ public:
     qsc::StreamQualityProfile getOptimalStreamSettings(int totalDeviceCount);
     void applyQualityToAllDevices();
     void updateDeviceQuality(const QString& serial, const qsc::StreamQualityProfile& profile);
+    // dual stream: a second session of the operated device, no reconnect
+    void attachDetailStream(const QString& serial, const qsc::StreamQualityProfile& profile);
+    void detachDetailStream(const QString& serial);
 
     static const QString &getServerPath();
 
@@ -82,6 +65,7 @@ private slots:
     void onSyncActionClicked();
     void onStreamAllClicked();  // CLICK-TO-STREAM: Handler for Stream All button
     void onGridSizeChanged();
+    void onSoftwareRenderToggled(bool enabled);
 
     // Connection management slots
     void onConnectionBatchStarted(int totalDevices);
@@ -90,6 +74,10 @@ private slots:
 
     // Click-to-connect slots
     void onDeviceTileClicked(QString serial);
+    // Focus-aware quality: input sent to a tile makes it the active device
+    void onDeviceInteracted(QString serial);
+    void onDetailStreamStarted(const QString& serial, bool success, const QSize& size);
+    void onDetailStreamStopped(const QString& serial);
 
     // Unix signal handler slot (called via socket notifier)
     void handleUnixSignal();
@@ -101,12 +89,15 @@ private slots:
 protected:
     void resizeEvent(QResizeEvent* event) override;
     void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+    void changeEvent(QEvent *event) override;
     void closeEvent(QCloseEvent *event) override;
 
 private:
     explicit FarmViewer(QWidget *parent = nullptr);
     void setupUI();
     void updateGridLayout();
+    void applyGridResize();
     void updateStatus();
     void createDeviceContainer(const QString& serial, const QString& deviceName);
     QWidget* createDeviceWidget(const QString& serial, const QString& deviceName);
@@ -117,6 +108,13 @@ private:
     void connectDevicesInBatches(const QStringList& devices, int batchIndex);
     void onConnectionComplete(const QString& serial, bool success);
     bool isDeviceConnected(const QString& serial) const;
+    // active / thumbnail / offscreen of every tile, from the scroll position and the focused device
+    void updateDeviceFocus();
+    void scheduleDeviceFocusUpdate();
+    // render surfaces only for the tiles in view and SURFACE_PREFETCH_ROWS around it
+    void updateVisibleSurfaces();
+    // tiles drawn by one QPainter compositor instead of an OpenGL widget each
+    void setSoftwareRendering(bool enabled);
 
     // Helper methods for grid calculation
     QSize getOptimalTileSize(int deviceCount, const QSize& windowSize) const;
@@ -135,7 +133,7 @@ private:
     static void unixSignalHandler(int signalNumber);
     static void setupSocketPair();
 
-    FarmScrollArea* m_scrollArea;
+    QScrollArea* m_scrollArea;
     QWidget* m_gridWidget;
     QGridLayout* m_gridLayout;
     QVBoxLayout* m_mainLayout;
@@ -164,11 +162,26 @@ private:
     int m_gridCols;
     qsc::StreamQualityProfile m_currentQualityProfile;
     qsc::DeviceConnectionPool::QualityTier m_currentQualityTier;
+    // per device tier at runtime, a change reconnects the stream after this delay
+    QualityController* m_qualityController;
+    static const int QUALITY_RECONNECT_DELAY_MS = 500;
+    QString m_focusedSerial;
+    QTimer* m_focusIdleTimer;    // the active device goes back to a thumbnail without input
+    QTimer* m_focusUpdateTimer;  // coalesces scroll and resize steps
+    QPointer<SoftwareCompositor> m_compositor; // set in software render mode
+    RenderSurfacePool* m_surfacePool;          // surfaces of tiles scrolled away, for the ones scrolling in
+    static const int SURFACE_PREFETCH_ROWS = 1;
+    QTimer* m_gridResizeTimer;                 // debounces window resizes into one relayout
+    QSize m_appliedTileSize;
+    static const int GRID_RESIZE_DELAY_MS = 150;
+    static const int FOCUS_IDLE_MS = 60 * 1000;
+    static const int FOCUS_UPDATE_DELAY_MS = 200;
 
     // Controls
     QPushButton* m_screenshotAllBtn;
     QPushButton* m_syncActionBtn;
     QPushButton* m_streamAllBtn;  // CLICK-TO-STREAM: Button to connect all devices at once
+    QPushButton* m_softwareRenderBtn;
     QLabel* m_statusLabel;
     QProgressBar* m_connectionProgressBar;
 
@@ -180,6 +193,13 @@ private:
     bool m_isConnecting;
     bool m_autoDetectionTriggered = false;
 
+    // Screenshot All progress, results arrive asynchronously from the core's encoder pool
+    QString m_screenshotDir;
+    QSet<QString> m_screenshotSerials; // devices of the run whose result has not arrived
+    int m_screenshotPending = 0;
+    int m_screenshotSucceeded = 0;
+    int m_screenshotFailed = 0;
+
     // Unix signal handling using socketpair pattern
     // This is the ONLY async-signal-safe way to handle signals in Qt
     // Signals write to signalFd[0], QSocketNotifier reads from signalFd[1]
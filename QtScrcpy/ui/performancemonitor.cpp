@@ -1,4 +1,5 @@
 #include "performancemonitor.h"
+#include "stagelatency.h"
 #include <QFile>
 #include <QTextStream>
 #include <QProcess>
@@ -11,6 +12,7 @@ PerformanceMonitor::PerformanceMonitor(QWidget *parent)
     , m_systemGroup(nullptr)
     , m_networkGroup(nullptr)
     , m_qualityGroup(nullptr)
+    , m_latencyGroup(nullptr)
     , m_deviceCountLabel(nullptr)
     , m_cpuUsageLabel(nullptr)
     , m_memoryUsageLabel(nullptr)
@@ -91,11 +93,26 @@ void PerformanceMonitor::setupUI()
     m_qualityTierLabel->setStyleSheet("font-weight: bold; color: #ff9800;");
     qualityLayout->addWidget(m_qualityTierLabel, 0, 1);
 
+    // Latency Group: farm-wide p50 / p99 per pipeline stage
+    m_latencyGroup = new QGroupBox("Latency p50 / p99", this);
+    QGridLayout* latencyLayout = new QGridLayout(m_latencyGroup);
+
+    for (int stage = 0; stage < qsc::StageLatency::SL_COUNT; stage++) {
+        QString name = QString(qsc::StageLatency::stageName(static_cast<qsc::StageLatency::Stage>(stage))).replace('_', ' ');
+        latencyLayout->addWidget(new QLabel(name + ":"), stage, 0);
+        QLabel* label = new QLabel("-");
+        label->setStyleSheet("font-weight: bold;");
+        latencyLayout->addWidget(label, stage, 1);
+        m_stageLatencyLabels.append(label);
+    }
+    m_latencyGroup->setVisible(qsc::StageLatency::isEnabled());
+
     // Add all groups to main layout
     mainLayout->addWidget(m_deviceGroup);
     mainLayout->addWidget(m_systemGroup);
     mainLayout->addWidget(m_networkGroup);
     mainLayout->addWidget(m_qualityGroup);
+    mainLayout->addWidget(m_latencyGroup);
     mainLayout->addStretch();
 
     setLayout(mainLayout);
@@ -221,6 +238,42 @@ void PerformanceMonitor::refreshMetrics()
     if (mem > 0) {
         updateMemoryUsage(mem, 0);  // Total is optional
     }
+
+    updateStageLatency();
+}
+
+void PerformanceMonitor::updateStageLatency()
+{
+    if (!qsc::StageLatency::isEnabled()) {
+        return;
+    }
+
+    // Cumulative since startup: the tail is what matters, and it only gets more stable
+    qsc::StageLatencyRegistry& registry = qsc::StageLatencyRegistry::instance();
+    for (int stage = 0; stage < m_stageLatencyLabels.size(); stage++) {
+        qsc::LatencyHistogram::Snapshot snapshot = registry.farmSnapshot(static_cast<qsc::StageLatency::Stage>(stage));
+        if (snapshot.count == 0) {
+            m_stageLatencyLabels[stage]->setText("-");
+            continue;
+        }
+        double p50 = snapshot.percentile(50) / 1000.0;
+        double p99 = snapshot.percentile(99) / 1000.0;
+        m_stageLatencyLabels[stage]->setText(QString("%1 / %2 ms").arg(p50, 0, 'f', 2).arg(p99, 0, 'f', 2));
+
+        // Color coding against a 60 fps frame budget
+        if (p99 < 4.0) {
+            m_stageLatencyLabels[stage]->setStyleSheet("font-weight: bold; color: #4caf50;");
+        } else if (p99 < 16.0) {
+            m_stageLatencyLabels[stage]->setStyleSheet("font-weight: bold; color: #ff9800;");
+        } else {
+            m_stageLatencyLabels[stage]->setStyleSheet("font-weight: bold; color: #f44336;");
+        }
+    }
+}
+
+QString PerformanceMonitor::stageLatencyDump() const
+{
+    return qsc::StageLatencyRegistry::instance().dump();
 }
 
 QString PerformanceMonitor::formatBytes(quint64 bytes) const
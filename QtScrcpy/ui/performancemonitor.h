@@ -7,6 +7,7 @@
 #include <QVBoxLayout>
 #include <QGridLayout>
 #include <QGroupBox>
+#include <QVector>
 
 /**
  * @brief Performance monitoring widget for Farm Manager
@@ -18,6 +19,7 @@
  * - Device count (active connections)
  * - FPS (average across all devices)
  * - Current quality tier
+ * - Farm-wide p50/p99 of each video pipeline stage (see qsc::StageLatency)
  */
 class PerformanceMonitor : public QWidget
 {
@@ -34,6 +36,10 @@ public:
     void updateNetworkBandwidth(quint64 bytesPerSecond);
     void updateAverageFps(double fps);
     void updateQualityTier(const QString& tierName);
+    void updateStageLatency();
+
+    // Per device and stage latency table, for logs and bug reports
+    QString stageLatencyDump() const;
 
     // System resource queries
     double getSystemMemoryAvailablePercent();
@@ -61,6 +67,7 @@ private:
     QGroupBox* m_systemGroup;
     QGroupBox* m_networkGroup;
     QGroupBox* m_qualityGroup;
+    QGroupBox* m_latencyGroup;
 
     QLabel* m_deviceCountLabel;
     QLabel* m_cpuUsageLabel;
@@ -68,6 +75,7 @@ private:
     QLabel* m_bandwidthLabel;
     QLabel* m_avgFpsLabel;
     QLabel* m_qualityTierLabel;
+    QVector<QLabel*> m_stageLatencyLabels;  // indexed by qsc::StageLatency::Stage
 
     // Auto-refresh
     QTimer* m_refreshTimer;
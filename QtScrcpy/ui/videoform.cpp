@@ -23,6 +23,8 @@
 #include "config.h"
 #include "iconhelper.h"
 #include "qyuvopenglwidget.h"
+#include "rendersurfacepool.h"
+#include "softwarecompositor.h"
 #include "toolform.h"
 #include "mousetap/mousetap.h"
 #include "ui_videoform.h"
@@ -53,6 +55,9 @@ VideoForm::VideoForm(bool framelessWindow, bool skin, bool showToolbar, QWidget
 
 VideoForm::~VideoForm()
 {
+    if (m_compositor && m_videoWidget) {
+        m_compositor->removeSurface(m_videoWidget);
+    }
     delete ui;
 }
 
@@ -128,6 +133,26 @@ void VideoForm::createVideoWidget()
         return;
     }
 
+    if (m_compositor) {
+        // nothing to render itself: it places the frame and takes the input, the compositor draws over it
+        m_videoWidget = new QWidget(this);
+        ui->keepRatioWidget->setWidget(m_videoWidget);
+        m_videoWidget->show();
+        m_videoWidget->setMouseTracking(true);
+        qInfo() << "VideoForm::createVideoWidget() software surface created for" << m_serial;
+        return;
+    }
+
+    // a surface another tile no longer shows: no context creation, textures kept if the size matches
+    if (QYUVOpenGLWidget *recycled = m_surfacePool ? m_surfacePool->acquire(this) : nullptr) {
+        recycled->setStageLatency(m_stageLatency);
+        m_videoWidget = recycled;
+        ui->keepRatioWidget->setWidget(m_videoWidget);
+        createFpsLabel();
+        m_videoWidget->setMouseTracking(true);
+        return;
+    }
+
     qInfo() << "========================================";
     qInfo() << "VideoForm::createVideoWidget() CREATING OpenGL widget for" << m_serial;
     qInfo() << "VideoForm::createVideoWidget() - ACQUIRING SEMAPHORE for:" << m_serial;
@@ -144,24 +169,16 @@ void VideoForm::createVideoWidget()
         // Create the OpenGL video widget
         qInfo() << "VideoForm::createVideoWidget() - About to call QYUVOpenGLWidget constructor...";
         qInfo() << "  Parent widget:" << (void*)this;
-        m_videoWidget = new QYUVOpenGLWidget(this);
-        qInfo() << "VideoForm::createVideoWidget() - QYUVOpenGLWidget constructor returned:" << (void*)m_videoWidget;
+        QYUVOpenGLWidget *glWidget = new QYUVOpenGLWidget(this);
+        glWidget->setStageLatency(m_stageLatency);
+        m_videoWidget = glWidget;
+        qInfo() << "VideoForm::createVideoWidget() - QYUVOpenGLWidget constructor returned:" << (void*)glWidget;
 
         qInfo() << "VideoForm::createVideoWidget() - About to call setWidget()...";
         ui->keepRatioWidget->setWidget(m_videoWidget);
         qInfo() << "VideoForm::createVideoWidget() - setWidget() completed";
 
-        // Create FPS label as child of video widget
-        m_fpsLabel = new QLabel(m_videoWidget);
-        QFont ft;
-        ft.setPointSize(15);
-        ft.setWeight(QFont::Light);
-        ft.setBold(true);
-        m_fpsLabel->setFont(ft);
-        m_fpsLabel->move(5, 15);
-        m_fpsLabel->setMinimumWidth(100);
-        m_fpsLabel->setStyleSheet(R"(QLabel {color: #00FF00;})");
-        m_fpsLabel->hide(); // Hidden by default
+        createFpsLabel();
 
         // Show the video widget
         m_videoWidget->show();
@@ -188,6 +205,48 @@ void VideoForm::createVideoWidget()
     }
 }
 
+void VideoForm::createFpsLabel()
+{
+    // Create FPS label as child of video widget
+    m_fpsLabel = new QLabel(m_videoWidget);
+    QFont ft;
+    ft.setPointSize(15);
+    ft.setWeight(QFont::Light);
+    ft.setBold(true);
+    m_fpsLabel->setFont(ft);
+    m_fpsLabel->move(5, 15);
+    m_fpsLabel->setMinimumWidth(100);
+    m_fpsLabel->setStyleSheet(R"(QLabel {color: #00FF00;})");
+    m_fpsLabel->hide(); // Hidden by default
+}
+
+void VideoForm::releaseVideoWidget()
+{
+    if (!m_videoWidget) {
+        return;
+    }
+    if (m_compositor) {
+        m_compositor->removeSurface(m_videoWidget);
+    }
+    // the label belongs to this tile, not to the surface
+    if (m_fpsLabel) {
+        delete m_fpsLabel;
+    }
+
+    QWidget *surface = ui->keepRatioWidget->takeWidget();
+    if (!surface) {
+        surface = m_videoWidget;
+    }
+    m_videoWidget = nullptr;
+    QYUVOpenGLWidget *glWidget = qobject_cast<QYUVOpenGLWidget *>(surface);
+    if (glWidget && m_surfacePool) {
+        glWidget->setStageLatency(nullptr);
+        m_surfacePool->release(glWidget);
+    } else {
+        delete surface;
+    }
+}
+
 bool VideoForm::eventFilter(QObject *watched, QEvent *event)
 {
     // Update footer label position when keepRatioWidget is resized
@@ -267,6 +326,78 @@ void VideoForm::showFPS(bool show)
 }
 
 void VideoForm::updateRender(int width, int height, uint8_t* dataY, uint8_t* dataU, uint8_t* dataV, int linesizeY, int linesizeU, int linesizeV)
+{
+    if (m_compositor || !m_surfaceAttached) {
+        // composed on the next tick or shown once attached, after this buffer is gone
+        updateRender(FrameData::create(width, height, dataY, dataU, dataV, linesizeY, linesizeU, linesizeV));
+        return;
+    }
+    if (!prepareVideoWidget(width, height)) {
+        return;
+    }
+
+    QYUVOpenGLWidget *glWidget = qobject_cast<QYUVOpenGLWidget *>(m_videoWidget.data());
+    if (!glWidget) {
+        return;
+    }
+    glWidget->setFrameSize(QSize(width, height));
+    glWidget->updateTextures(dataY, dataU, dataV, linesizeY, linesizeU, linesizeV);
+}
+
+void VideoForm::updateRender(const FrameData &frame)
+{
+    // the last frame outlives the surface, a tile scrolled back in shows it before the next one arrives
+    m_lastFrame = frame;
+    if (!m_surfaceAttached) {
+        return;
+    }
+    if (!m_compositor) {
+        updateRender(frame.width, frame.height, frame.dataY, frame.dataU, frame.dataV, frame.linesizeY, frame.linesizeU, frame.linesizeV);
+        return;
+    }
+    if (!prepareVideoWidget(frame.width, frame.height)) {
+        return;
+    }
+    m_compositor->setFrame(m_videoWidget, frame, m_stageLatency);
+}
+
+void VideoForm::setCompositor(SoftwareCompositor *compositor)
+{
+    if (m_compositor == compositor) {
+        return;
+    }
+    if (m_compositor && m_videoWidget) {
+        m_compositor->removeSurface(m_videoWidget);
+    }
+    m_compositor = compositor;
+    // the surface type changes, the next frame creates the new one
+    if (m_videoWidget) {
+        delete m_videoWidget;
+    }
+}
+
+void VideoForm::setSurfacePool(RenderSurfacePool *pool)
+{
+    m_surfacePool = pool;
+}
+
+void VideoForm::setSurfaceAttached(bool attached)
+{
+    if (m_surfaceAttached == attached) {
+        return;
+    }
+    m_surfaceAttached = attached;
+    if (!attached) {
+        releaseVideoWidget();
+        return;
+    }
+    if (m_lastFrame.buffer) {
+        FrameData frame = m_lastFrame;
+        updateRender(frame);
+    }
+}
+
+bool VideoForm::prepareVideoWidget(int width, int height)
 {
     // DIAGNOSTIC: Per-instance frame counter (member variable - thread-safe for this instance)
     m_frameCounter++;
@@ -274,11 +405,13 @@ void VideoForm::updateRender(int width, int height, uint8_t* dataY, uint8_t* dat
     if (m_frameCounter <= 5 || m_frameCounter % 30 == 0) {  // Log first 5 frames + every 30 frames
         qInfo() << "VideoForm::updateRender() Frame" << m_frameCounter
                 << "for" << m_serial << "Size:" << width << "x" << height
-                << "Strides:" << linesizeY << linesizeU << linesizeV
                 << "Widget exists:" << (m_videoWidget != nullptr)
                 << "Widget size:" << (m_videoWidget ? m_videoWidget->size() : QSize());
     }
 
+    // the surface only needs placing when it is new, shown again or the frame size changed
+    bool placeSurface = !m_videoWidget || m_frameSize != QSize(width, height);
+
     // Create OpenGL video widget on-demand when first frame arrives
     // This prevents GPU resource exhaustion when showing 78+ device tiles
     if (!m_videoWidget) {
@@ -286,17 +419,17 @@ void VideoForm::updateRender(int width, int height, uint8_t* dataY, uint8_t* dat
             createVideoWidget();
         } catch (const std::exception& e) {
             qCritical() << "VideoForm::updateRender() - EXCEPTION in createVideoWidget():" << e.what();
-            return;
+            return false;
         } catch (...) {
             qCritical() << "VideoForm::updateRender() - UNKNOWN EXCEPTION in createVideoWidget()";
-            return;
+            return false;
         }
     }
 
     // Safety check - should never happen but be defensive
     if (!m_videoWidget) {
         qWarning() << "VideoForm::updateRender() - Failed to create video widget for:" << m_serial;
-        return;
+        return false;
     }
 
     if (m_videoWidget->isHidden()) {
@@ -304,9 +437,13 @@ void VideoForm::updateRender(int width, int height, uint8_t* dataY, uint8_t* dat
             m_loadingWidget->close();
         }
         m_videoWidget->show();
+        placeSurface = true;
     }
 
     updateShowSize(QSize(width, height));
+    if (!placeSurface) {
+        return true;
+    }
 
     // GEOMETRY FIX: Force keepRatioWidget to recalculate video widget geometry
     // 1. Process all pending events to ensure keepRatioWidget has new size from window resize
@@ -315,14 +452,16 @@ void VideoForm::updateRender(int width, int height, uint8_t* dataY, uint8_t* dat
     //    This recalculates the video widget's geometry inside the keepRatioWidget
     QResizeEvent keepRatioResize(ui->keepRatioWidget->size(), ui->keepRatioWidget->size());
     QApplication::sendEvent(ui->keepRatioWidget, &keepRatioResize);
-
-    m_videoWidget->setFrameSize(QSize(width, height));
-    m_videoWidget->updateTextures(dataY, dataU, dataV, linesizeY, linesizeU, linesizeV);
+    return true;
 }
 
 void VideoForm::setSerial(const QString &serial)
 {
     m_serial = serial;
+    m_stageLatency = qsc::StageLatencyRegistry::instance().device(serial);
+    if (QYUVOpenGLWidget *glWidget = qobject_cast<QYUVOpenGLWidget *>(m_videoWidget.data())) {
+        glWidget->setStageLatency(m_stageLatency);
+    }
 
     // Update footer label with serial number
     if (m_footerLabel) {
@@ -779,10 +918,12 @@ void VideoForm::onFrame(int width, int height, uint8_t *dataY, uint8_t *dataU, u
                                                 linesizeY, linesizeU, linesizeV);
 
         // Capture frameData by value - the shared_ptr keeps the buffer alive
-        QMetaObject::invokeMethod(this, [this, frameData]() {
-            updateRender(frameData.width, frameData.height,
-                        frameData.dataY, frameData.dataU, frameData.dataV,
-                        frameData.linesizeY, frameData.linesizeU, frameData.linesizeV);
+        qint64 queuedUs = qsc::StageLatency::now();
+        QMetaObject::invokeMethod(this, [this, frameData, queuedUs]() {
+            if (m_stageLatency) {
+                m_stageLatency->recordSince(qsc::StageLatency::SL_QUEUE_WAIT, queuedUs);
+            }
+            updateRender(frameData);
         }, Qt::QueuedConnection);
     } else {
         // Already in main GUI thread - call directly
@@ -856,7 +997,7 @@ void VideoForm::mousePressEvent(QMouseEvent *event)
         qDebug() << "  -> Forwarding mouse event to device";
         QPointF mappedPos = m_videoWidget->mapFrom(this, localPos.toPoint());
         QMouseEvent newEvent(event->type(), mappedPos, globalPos, event->button(), event->buttons(), event->modifiers());
-        emit device->mouseEvent(&newEvent, m_videoWidget->frameSize(), m_videoWidget->size());
+        emit device->mouseEvent(&newEvent, m_frameSize, m_videoWidget->size());
         qDebug() << "  -> Mouse event forwarded successfully";
 
         // debug keymap pos
@@ -904,7 +1045,11 @@ void VideoForm::mouseReleaseEvent(QMouseEvent *event)
             local.setY(m_videoWidget->height());
         }
         QMouseEvent newEvent(event->type(), local, globalPos, event->button(), event->buttons(), event->modifiers());
-        emit device->mouseEvent(&newEvent, m_videoWidget->frameSize(), m_videoWidget->size());
+        emit device->mouseEvent(&newEvent, m_frameSize, m_videoWidget->size());
+        // only once the gesture is complete, a focus change may reconnect the stream
+        if (event->buttons() == Qt::NoButton) {
+            emit deviceInteracted(m_serial);
+        }
     } else {
         m_dragPosition = QPoint(0, 0);
     }
@@ -926,7 +1071,7 @@ void VideoForm::mouseMoveEvent(QMouseEvent *event)
         }
         QPointF mappedPos = m_videoWidget->mapFrom(this, localPos.toPoint());
         QMouseEvent newEvent(event->type(), mappedPos, globalPos, event->button(), event->buttons(), event->modifiers());
-        emit device->mouseEvent(&newEvent, m_videoWidget->frameSize(), m_videoWidget->size());
+        emit device->mouseEvent(&newEvent, m_frameSize, m_videoWidget->size());
     } else if (!m_dragPosition.isNull()) {
         if (event->buttons() & Qt::LeftButton) {
             move(globalPos.toPoint() - m_dragPosition);
@@ -961,7 +1106,7 @@ void VideoForm::mouseDoubleClickEvent(QMouseEvent *event)
 #endif
         QPointF mappedPos = m_videoWidget->mapFrom(this, localPos.toPoint());
         QMouseEvent newEvent(event->type(), mappedPos, globalPos, event->button(), event->buttons(), event->modifiers());
-        emit device->mouseEvent(&newEvent, m_videoWidget->frameSize(), m_videoWidget->size());
+        emit device->mouseEvent(&newEvent, m_frameSize, m_videoWidget->size());
     }
 }
 
@@ -984,7 +1129,8 @@ void VideoForm::wheelEvent(QWheelEvent *event)
             pos, event->globalPosF(), event->pixelDelta(), event->angleDelta(), event->delta(), event->orientation(),
             event->buttons(), event->modifiers(), event->phase(), event->source(), event->inverted());
 #endif
-        emit device->wheelEvent(&wheelEvent, m_videoWidget->frameSize(), m_videoWidget->size());
+        emit device->wheelEvent(&wheelEvent, m_frameSize, m_videoWidget->size());
+        emit deviceInteracted(m_serial);
     }
 }
 
@@ -999,7 +1145,7 @@ void VideoForm::keyPressEvent(QKeyEvent *event)
     }
 
     if (m_videoWidget) {
-        emit device->keyEvent(event, m_videoWidget->frameSize(), m_videoWidget->size());
+        emit device->keyEvent(event, m_frameSize, m_videoWidget->size());
     }
 }
 
@@ -1010,7 +1156,10 @@ void VideoForm::keyReleaseEvent(QKeyEvent *event)
         return;
     }
     if (m_videoWidget) {
-        emit device->keyEvent(event, m_videoWidget->frameSize(), m_videoWidget->size());
+        emit device->keyEvent(event, m_frameSize, m_videoWidget->size());
+        if (!event->isAutoRepeat()) {
+            emit deviceInteracted(m_serial);
+        }
     }
 }
 
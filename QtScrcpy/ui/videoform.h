@@ -7,57 +7,8 @@
 #include <memory>
 
 #include "../QtScrcpyCore/include/QtScrcpyCore.h"
-
-// PERFORMANCE OPTIMIZATION: Single-allocation frame data structure
-// Reduces malloc overhead from 3 separate allocations to 1 (10-15% gain)
-// C++11 compatible: uses custom deleter for proper array cleanup
-struct FrameData {
-    std::shared_ptr<uint8_t> buffer;  // Single contiguous buffer for all planes
-    uint8_t* dataY;  // Pointer into buffer
-    uint8_t* dataU;  // Pointer into buffer
-    uint8_t* dataV;  // Pointer into buffer
-    int width;
-    int height;
-    int linesizeY;
-    int linesizeU;
-    int linesizeV;
-
-    // Factory method to create FrameData with single allocation
-    static FrameData create(int width, int height,
-                           const uint8_t* srcY, const uint8_t* srcU, const uint8_t* srcV,
-                           int linesizeY, int linesizeU, int linesizeV) {
-        FrameData data;
-        data.width = width;
-        data.height = height;
-        data.linesizeY = linesizeY;
-        data.linesizeU = linesizeU;
-        data.linesizeV = linesizeV;
-
-        // Calculate sizes
-        int sizeY = linesizeY * height;
-        int sizeU = linesizeU * (height / 2);
-        int sizeV = linesizeV * (height / 2);
-        int totalSize = sizeY + sizeU + sizeV;
-
-        // CRITICAL C++11 FIX: Use custom deleter for array allocation
-        // In C++11, shared_ptr<T[]> doesn't exist, so we must use shared_ptr<T>
-        // with std::default_delete<T[]> to ensure delete[] is called instead of delete
-        data.buffer = std::shared_ptr<uint8_t>(new uint8_t[totalSize],
-                                                std::default_delete<uint8_t[]>());
-
-        // Set up plane pointers within the buffer
-        data.dataY = data.buffer.get();
-        data.dataU = data.dataY + sizeY;
-        data.dataV = data.dataU + sizeU;
-
-        // Copy data
-        memcpy(data.dataY, srcY, sizeY);
-        memcpy(data.dataU, srcU, sizeU);
-        memcpy(data.dataV, srcV, sizeV);
-
-        return data;
-    }
-};
+#include "../QtScrcpyCore/include/stagelatency.h"
+#include "../render/framedata.h"
 
 namespace Ui
 {
@@ -67,6 +18,8 @@ namespace Ui
 class ToolForm;
 class FileHandler;
 class QYUVOpenGLWidget;
+class SoftwareCompositor;
+class RenderSurfacePool;
 class QLabel;
 class VideoForm : public QWidget, public qsc::DeviceObserver
 {
@@ -78,6 +31,12 @@ public:
     void staysOnTop(bool top = true);
     void updateShowSize(const QSize &newSize);
     void updateRender(int width, int height, uint8_t* dataY, uint8_t* dataU, uint8_t* dataV, int linesizeY, int linesizeU, int linesizeV);
+    // render through compositor instead of an OpenGL widget, nullptr goes back to OpenGL
+    void setCompositor(SoftwareCompositor *compositor);
+    // OpenGL surfaces come from and go back to pool instead of being created and deleted
+    void setSurfacePool(RenderSurfacePool *pool);
+    // false hands the render surface back and only keeps the latest frame, true shows it again
+    void setSurfaceAttached(bool attached);
     void setSerial(const QString& serial);
     QRect getGrabCursorRect();
     const QSize &frameSize();
@@ -90,6 +49,9 @@ public:
 
 signals:
     void deviceClicked(QString serial);
+    // a forwarded tap, key stroke or wheel step ended: the operator is working with the device.
+    // Not sent on press, the focus change it triggers may reconnect the stream mid-gesture
+    void deviceInteracted(QString serial);
 
 private:
     void onFrame(int width, int height, uint8_t* dataY, uint8_t* dataU, uint8_t* dataV,
@@ -101,6 +63,12 @@ private:
     QMargins getMargins(bool vertical);
     void initUI();
     void createVideoWidget();
+    void createFpsLabel();
+    void releaseVideoWidget();
+    // creates and shows the surface for a width x height frame, false if there is none
+    bool prepareVideoWidget(int width, int height);
+    // the frame outlives the call, handed to the compositor as is
+    void updateRender(const FrameData &frame);
 
     void showToolForm(bool show = true);
     void moveCenter();
@@ -133,7 +101,11 @@ private:
     Ui::videoForm *ui;
     QPointer<ToolForm> m_toolForm;
     QPointer<QWidget> m_loadingWidget;
-    QPointer<QYUVOpenGLWidget> m_videoWidget;
+    QPointer<QWidget> m_videoWidget; // QYUVOpenGLWidget, or a plain surface under m_compositor
+    QPointer<SoftwareCompositor> m_compositor;
+    QPointer<RenderSurfacePool> m_surfacePool;
+    bool m_surfaceAttached = true;
+    FrameData m_lastFrame; // latest frame, shown again when the tile gets a surface back
     QPointer<QLabel> m_fpsLabel;
     QPointer<QLabel> m_footerLabel;
 
@@ -145,6 +117,7 @@ private:
     bool m_skin = true;
     QPoint m_fullScreenBeforePos;
     QString m_serial;
+    qsc::StageLatency *m_stageLatency = nullptr; // GUI thread stages, owned by the registry
     QElapsedTimer m_lastFrameTime;  // Per-instance frame rate limiter
     int m_frameCounter = 0;  // Per-instance frame counter for diagnostics
 
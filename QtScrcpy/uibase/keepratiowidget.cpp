@@ -16,6 +16,13 @@ void KeepRatioWidget::setWidget(QWidget *w)
     m_subWidget = w;
 }
 
+QWidget *KeepRatioWidget::takeWidget()
+{
+    QWidget *w = m_subWidget;
+    m_subWidget = nullptr;
+    return w;
+}
+
 void KeepRatioWidget::setWidthHeightRatio(float widthHeightRatio)
 {
     if (fabs(m_widthHeightRatio - widthHeightRatio) < 0.000001f) {
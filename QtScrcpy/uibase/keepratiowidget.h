@@ -12,6 +12,8 @@ public:
     ~KeepRatioWidget();
 
     void setWidget(QWidget *w);
+    // stops laying out the widget and returns it, still parented here
+    QWidget *takeWidget();
     void setWidthHeightRatio(float widthHeightRatio);
     const QSize goodSize();
 
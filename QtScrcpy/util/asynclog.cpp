@@ -0,0 +1,252 @@
+#include <cstdio>
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutexLocker>
+#include <QPair>
+
+#include "asynclog.h"
+
+// a call site may burst for this long before the token bucket throttles it
+#define LOG_RATE_BURST_SECONDS 2
+// without QT_MESSAGELOGCONTEXT (release builds) the call site is approximated by the message prefix
+#define LOG_SITE_PREFIX_LENGTH 32
+
+namespace
+{
+struct TokenBucket
+{
+    double tokens = 0.0;
+    qint64 lastMs = 0;
+    quint32 suppressed = 0;
+};
+}
+
+AsyncLog &AsyncLog::instance()
+{
+    static AsyncLog log;
+    return log;
+}
+
+AsyncLog::AsyncLog() : QThread(), m_enqueuePos(0), m_dropped(0), m_running(false), m_rateLimit(0)
+{
+    for (quint64 i = 0; i < RING_SIZE; i++) {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+AsyncLog::~AsyncLog()
+{
+    stopWriter();
+}
+
+void AsyncLog::setRateLimit(int messagesPerSecond)
+{
+    m_rateLimit.store(qMax(0, messagesPerSecond), std::memory_order_relaxed);
+}
+
+void AsyncLog::setWriter(const Writer &writer)
+{
+    m_writer = writer;
+}
+
+void AsyncLog::setGuiSink(const GuiSink &guiSink)
+{
+    m_guiSink = guiSink;
+}
+
+void AsyncLog::startWriter()
+{
+    if (m_running.exchange(true)) {
+        return;
+    }
+    start(QThread::LowPriority);
+}
+
+void AsyncLog::stopWriter()
+{
+    if (!m_running.exchange(false)) {
+        return;
+    }
+    m_wakeCond.wakeOne();
+    wait();
+
+    // producers that saw m_running just before it flipped, the writer thread is gone so this
+    // thread is the only consumer now
+    Record record;
+    while (pop(record)) {
+        write(record);
+    }
+}
+
+void AsyncLog::post(QtMsgType type, const QMessageLogContext &context, const QString &message, bool toGui)
+{
+    Record record;
+    record.msecsSinceEpoch = QDateTime::currentMSecsSinceEpoch();
+    record.type = type;
+    record.file = context.file;
+    record.function = context.function;
+    record.category = context.category;
+    record.line = context.line;
+    record.toGui = toGui;
+    record.message = message;
+
+    // fatal aborts as soon as the handler returns, it cannot wait for the writer
+    if (type == QtFatalMsg || !m_running.load(std::memory_order_acquire)) {
+        write(record);
+        return;
+    }
+
+    if (!allow(context, record)) {
+        return;
+    }
+    if (!push(record)) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (type == QtWarningMsg || type == QtCriticalMsg) {
+        m_wakeCond.wakeOne();
+    }
+}
+
+bool AsyncLog::allow(const QMessageLogContext &context, Record &record)
+{
+    int rate = m_rateLimit.load(std::memory_order_relaxed);
+    if (rate <= 0) {
+        return true;
+    }
+
+    // per thread, so no locking; the key is the call site
+    static thread_local QHash<QPair<const void *, uint>, TokenBucket> buckets;
+    QPair<const void *, uint> site = context.file
+        ? qMakePair(static_cast<const void *>(context.file), static_cast<uint>(context.line))
+        : qMakePair(static_cast<const void *>(context.category), static_cast<uint>(qHash(record.message.left(LOG_SITE_PREFIX_LENGTH))));
+    TokenBucket &bucket = buckets[site];
+
+    const double burst = rate * LOG_RATE_BURST_SECONDS;
+    if (bucket.lastMs == 0) {
+        bucket.tokens = burst;
+    } else {
+        bucket.tokens = qMin(burst, bucket.tokens + (record.msecsSinceEpoch - bucket.lastMs) * rate / 1000.0);
+    }
+    bucket.lastMs = record.msecsSinceEpoch;
+
+    if (bucket.tokens < 1.0) {
+        bucket.suppressed++;
+        return false;
+    }
+    bucket.tokens -= 1.0;
+    record.suppressed = bucket.suppressed;
+    bucket.suppressed = 0;
+    return true;
+}
+
+// bounded MPMC queue of Dmitry Vyukov, used with a single consumer
+bool AsyncLog::push(Record &record)
+{
+    quint64 pos = m_enqueuePos.load(std::memory_order_relaxed);
+    Slot *slot = Q_NULLPTR;
+    for (;;) {
+        slot = &m_slots[pos & (RING_SIZE - 1)];
+        quint64 sequence = slot->sequence.load(std::memory_order_acquire);
+        qint64 diff = static_cast<qint64>(sequence - pos);
+        if (diff == 0) {
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // full
+            return false;
+        } else {
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    slot->record = std::move(record);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool AsyncLog::pop(Record &record)
+{
+    Slot &slot = m_slots[m_dequeuePos & (RING_SIZE - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != m_dequeuePos + 1) {
+        return false;
+    }
+    record = std::move(slot.record);
+    slot.record.message = QString();
+    slot.sequence.store(m_dequeuePos + RING_SIZE, std::memory_order_release);
+    m_dequeuePos++;
+    return true;
+}
+
+void AsyncLog::write(Record &record)
+{
+    if (record.suppressed > 0) {
+        record.message += QString(" (%1 similar messages suppressed)").arg(record.suppressed);
+        record.suppressed = 0;
+    }
+    if (m_writer) {
+        m_writer(record);
+    } else {
+        fprintf(stderr, "%s\n", record.message.toUtf8().constData());
+    }
+}
+
+void AsyncLog::flushGui()
+{
+    if (m_guiLines.isEmpty()) {
+        return;
+    }
+    if (m_guiDropped > 0) {
+        m_guiLines.prepend(QString("... %1 older lines skipped").arg(m_guiDropped));
+        m_guiDropped = 0;
+    }
+    if (m_guiSink) {
+        m_guiSink(m_guiLines);
+    }
+    m_guiLines.clear();
+}
+
+void AsyncLog::run()
+{
+    QElapsedTimer guiTimer;
+    guiTimer.start();
+    Record record;
+
+    for (;;) {
+        bool running = m_running.load(std::memory_order_acquire);
+
+        while (pop(record)) {
+            write(record);
+            if (record.toGui && m_guiSink) {
+                // bounded tail: the GUI never gets more than it can append in one go
+                if (m_guiLines.size() >= GUI_TAIL_LINES) {
+                    m_guiLines.removeFirst();
+                    m_guiDropped++;
+                }
+                m_guiLines.append(record.message);
+            }
+        }
+
+        quint64 dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0) {
+            Record note;
+            note.msecsSinceEpoch = QDateTime::currentMSecsSinceEpoch();
+            note.type = QtWarningMsg;
+            note.message = QString("AsyncLog: log ring full, %1 messages dropped").arg(dropped);
+            write(note);
+        }
+
+        if (!running || guiTimer.elapsed() >= GUI_FLUSH_MS) {
+            flushGui();
+            guiTimer.restart();
+        }
+        if (!running) {
+            break;
+        }
+
+        QMutexLocker locker(&m_wakeMutex);
+        m_wakeCond.wait(&m_wakeMutex, WRITER_IDLE_MS);
+    }
+}
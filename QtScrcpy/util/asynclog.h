@@ -0,0 +1,109 @@
+#ifndef ASYNCLOG_H
+#define ASYNCLOG_H
+
+#include <atomic>
+#include <functional>
+
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QWaitCondition>
+
+/**
+ * AsyncLog - Qt message handler backend that keeps formatting and I/O off the calling thread
+ *
+ * post() only takes a timestamp, checks a token bucket and moves the message into a
+ * bounded lock-free ring (multi-producer, single consumer). A writer thread does the
+ * text formatting, the stderr writes and batches lines for the GUI log view. Nothing
+ * on the producer side locks or blocks: a full ring drops the message and counts it.
+ *
+ * Rate limiting is per call site (file:line) and per thread. Every device streams on its
+ * own demuxer thread, so a noisy device or a log line in a per-frame path is throttled
+ * without silencing the others; the number of suppressed messages is appended to the
+ * next one that gets through.
+ */
+class AsyncLog : public QThread
+{
+    Q_OBJECT
+public:
+    struct Record
+    {
+        qint64 msecsSinceEpoch = 0;
+        QtMsgType type = QtDebugMsg;
+        // string literals of QMessageLogContext, valid for the whole process
+        const char *file = nullptr;
+        const char *function = nullptr;
+        const char *category = nullptr;
+        int line = 0;
+        quint32 suppressed = 0;
+        bool toGui = false;
+        QString message;
+    };
+
+    // writer thread: outputs one record, e.g. through the previous Qt message handler
+    typedef std::function<void(const Record &record)> Writer;
+    // writer thread: at most every AsyncLog::GUI_FLUSH_MS, never more than GUI_TAIL_LINES lines
+    typedef std::function<void(const QStringList &lines)> GuiSink;
+
+    enum
+    {
+        RING_SIZE = 8192, // power of two
+        GUI_TAIL_LINES = 500,
+        GUI_FLUSH_MS = 100,
+        WRITER_IDLE_MS = 20
+    };
+
+    static AsyncLog &instance();
+
+    // messages per second per call site and thread, 0 = unlimited; bursts of 2 seconds pass
+    void setRateLimit(int messagesPerSecond);
+    void setWriter(const Writer &writer);
+    void setGuiSink(const GuiSink &guiSink);
+
+    void startWriter();
+    // drain the ring and join the writer, later messages are written synchronously
+    void stopWriter();
+
+    // any thread
+    void post(QtMsgType type, const QMessageLogContext &context, const QString &message, bool toGui);
+
+protected:
+    void run() override;
+
+private:
+    AsyncLog();
+    ~AsyncLog();
+
+    struct Slot
+    {
+        std::atomic<quint64> sequence;
+        Record record;
+    };
+
+    // token bucket of the call site, fills record.suppressed
+    bool allow(const QMessageLogContext &context, Record &record);
+    bool push(Record &record);
+    bool pop(Record &record);
+    void write(Record &record);
+    void flushGui();
+
+private:
+    Slot m_slots[RING_SIZE];
+    std::atomic<quint64> m_enqueuePos;
+    quint64 m_dequeuePos = 0; // writer thread only
+    std::atomic<quint64> m_dropped;
+    std::atomic<bool> m_running;
+    std::atomic<int> m_rateLimit;
+
+    QMutex m_wakeMutex;
+    QWaitCondition m_wakeCond;
+
+    // writer thread only, set before startWriter()
+    Writer m_writer;
+    GuiSink m_guiSink;
+    QStringList m_guiLines;
+    quint32 m_guiDropped = 0;
+};
+
+#endif // ASYNCLOG_H
@@ -44,12 +44,48 @@
 #define COMMON_LOG_LEVEL_KEY "LogLevel"
 #define COMMON_LOG_LEVEL_DEF "info"
 
+#define COMMON_LOG_RATE_LIMIT_KEY "LogRateLimit"
+#define COMMON_LOG_RATE_LIMIT_DEF 20
+
 #define COMMON_CODEC_OPTIONS_KEY "CodecOptions"
 #define COMMON_CODEC_OPTIONS_DEF ""
 
 #define COMMON_CODEC_NAME_KEY "CodecName"
 #define COMMON_CODEC_NAME_DEF ""
 
+#define COMMON_SCREENSHOT_PATH_KEY "ScreenshotPath"
+#define COMMON_SCREENSHOT_PATH_DEF ""
+
+#define COMMON_SCREENSHOT_FORMAT_KEY "ScreenshotFormat"
+#define COMMON_SCREENSHOT_FORMAT_DEF "png"
+
+#define COMMON_SCREENSHOT_QUALITY_KEY "ScreenshotQuality"
+#define COMMON_SCREENSHOT_QUALITY_DEF -1
+
+#define COMMON_RECORD_SEGMENT_SECONDS_KEY "RecordSegmentSeconds"
+#define COMMON_RECORD_SEGMENT_SECONDS_DEF 0
+
+#define COMMON_RECORD_SEGMENT_COUNT_KEY "RecordSegmentCount"
+#define COMMON_RECORD_SEGMENT_COUNT_DEF 30
+
+#define COMMON_CLIP_BUFFER_SECONDS_KEY "ClipBufferSeconds"
+#define COMMON_CLIP_BUFFER_SECONDS_DEF 0
+
+#define COMMON_METRICS_PORT_KEY "MetricsPort"
+#define COMMON_METRICS_PORT_DEF 0
+
+#define COMMON_ADAPTIVE_QUALITY_KEY "AdaptiveQuality"
+#define COMMON_ADAPTIVE_QUALITY_DEF 1
+
+#define COMMON_FOCUS_AWARE_QUALITY_KEY "FocusAwareQuality"
+#define COMMON_FOCUS_AWARE_QUALITY_DEF 1
+
+#define COMMON_DUAL_STREAM_KEY "DualStream"
+#define COMMON_DUAL_STREAM_DEF 1
+
+#define COMMON_FARM_RENDERER_KEY "FarmRenderer"
+#define COMMON_FARM_RENDERER_DEF "auto"
+
 // user config
 #define COMMON_RECORD_KEY "RecordPath"
 #define COMMON_RECORD_DEF ""
@@ -349,6 +385,15 @@ QString Config::getLogLevel()
     return logLevel;
 }
 
+int Config::getLogRateLimit()
+{
+    int logRateLimit = COMMON_LOG_RATE_LIMIT_DEF;
+    m_settings->beginGroup(GROUP_COMMON);
+    logRateLimit = m_settings->value(COMMON_LOG_RATE_LIMIT_KEY, COMMON_LOG_RATE_LIMIT_DEF).toInt();
+    m_settings->endGroup();
+    return logRateLimit;
+}
+
 QString Config::getCodecOptions()
 {
     QString codecOptions;
@@ -367,6 +412,105 @@ QString Config::getCodecName()
     return codecName;
 }
 
+QString Config::getScreenshotPath()
+{
+    QString screenshotPath;
+    m_settings->beginGroup(GROUP_COMMON);
+    screenshotPath = m_settings->value(COMMON_SCREENSHOT_PATH_KEY, COMMON_SCREENSHOT_PATH_DEF).toString();
+    m_settings->endGroup();
+    return screenshotPath;
+}
+
+QString Config::getScreenshotFormat()
+{
+    QString screenshotFormat;
+    m_settings->beginGroup(GROUP_COMMON);
+    screenshotFormat = m_settings->value(COMMON_SCREENSHOT_FORMAT_KEY, COMMON_SCREENSHOT_FORMAT_DEF).toString();
+    m_settings->endGroup();
+    return screenshotFormat;
+}
+
+int Config::getScreenshotQuality()
+{
+    int screenshotQuality = -1;
+    m_settings->beginGroup(GROUP_COMMON);
+    screenshotQuality = m_settings->value(COMMON_SCREENSHOT_QUALITY_KEY, COMMON_SCREENSHOT_QUALITY_DEF).toInt();
+    m_settings->endGroup();
+    return screenshotQuality;
+}
+
+int Config::getRecordSegmentSeconds()
+{
+    int recordSegmentSeconds = 0;
+    m_settings->beginGroup(GROUP_COMMON);
+    recordSegmentSeconds = m_settings->value(COMMON_RECORD_SEGMENT_SECONDS_KEY, COMMON_RECORD_SEGMENT_SECONDS_DEF).toInt();
+    m_settings->endGroup();
+    return recordSegmentSeconds;
+}
+
+int Config::getRecordSegmentCount()
+{
+    int recordSegmentCount = 30;
+    m_settings->beginGroup(GROUP_COMMON);
+    recordSegmentCount = m_settings->value(COMMON_RECORD_SEGMENT_COUNT_KEY, COMMON_RECORD_SEGMENT_COUNT_DEF).toInt();
+    m_settings->endGroup();
+    return recordSegmentCount;
+}
+
+int Config::getClipBufferSeconds()
+{
+    int clipBufferSeconds = 0;
+    m_settings->beginGroup(GROUP_COMMON);
+    clipBufferSeconds = m_settings->value(COMMON_CLIP_BUFFER_SECONDS_KEY, COMMON_CLIP_BUFFER_SECONDS_DEF).toInt();
+    m_settings->endGroup();
+    return clipBufferSeconds;
+}
+
+int Config::getMetricsPort()
+{
+    int metricsPort = 0;
+    m_settings->beginGroup(GROUP_COMMON);
+    metricsPort = m_settings->value(COMMON_METRICS_PORT_KEY, COMMON_METRICS_PORT_DEF).toInt();
+    m_settings->endGroup();
+    return metricsPort;
+}
+
+int Config::getAdaptiveQuality()
+{
+    int adaptiveQuality = COMMON_ADAPTIVE_QUALITY_DEF;
+    m_settings->beginGroup(GROUP_COMMON);
+    adaptiveQuality = m_settings->value(COMMON_ADAPTIVE_QUALITY_KEY, COMMON_ADAPTIVE_QUALITY_DEF).toInt();
+    m_settings->endGroup();
+    return adaptiveQuality;
+}
+
+int Config::getFocusAwareQuality()
+{
+    int focusAwareQuality = COMMON_FOCUS_AWARE_QUALITY_DEF;
+    m_settings->beginGroup(GROUP_COMMON);
+    focusAwareQuality = m_settings->value(COMMON_FOCUS_AWARE_QUALITY_KEY, COMMON_FOCUS_AWARE_QUALITY_DEF).toInt();
+    m_settings->endGroup();
+    return focusAwareQuality;
+}
+
+int Config::getDualStream()
+{
+    int dualStream = COMMON_DUAL_STREAM_DEF;
+    m_settings->beginGroup(GROUP_COMMON);
+    dualStream = m_settings->value(COMMON_DUAL_STREAM_KEY, COMMON_DUAL_STREAM_DEF).toInt();
+    m_settings->endGroup();
+    return dualStream;
+}
+
+QString Config::getFarmRenderer()
+{
+    QString farmRenderer;
+    m_settings->beginGroup(GROUP_COMMON);
+    farmRenderer = m_settings->value(COMMON_FARM_RENDERER_KEY, COMMON_FARM_RENDERER_DEF).toString();
+    m_settings->endGroup();
+    return farmRenderer;
+}
+
 QStringList Config::getConnectedGroups()
 {
     return m_userData->childGroups();
@@ -45,8 +45,20 @@ public:
     QString getServerPath();
     QString getAdbPath();
     QString getLogLevel();
+    int getLogRateLimit();
     QString getCodecOptions();
     QString getCodecName();
+    QString getScreenshotPath();
+    QString getScreenshotFormat();
+    int getScreenshotQuality();
+    int getRecordSegmentSeconds();
+    int getRecordSegmentCount();
+    int getClipBufferSeconds();
+    int getMetricsPort();
+    int getAdaptiveQuality();
+    int getFocusAwareQuality();
+    int getDualStream();
+    QString getFarmRenderer();
     QStringList getConnectedGroups();
 
     // user data:common
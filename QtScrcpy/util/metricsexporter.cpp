@@ -0,0 +1,275 @@
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QTcpSocket>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+#include "devicemetrics.h"
+#include "metricsexporter.h"
+#include "stagelatency.h"
+#include "../QtScrcpyCore/src/device/controller/timingwheel.h"
+
+// a scrape request is a single line plus a few headers
+#define METRICS_MAX_REQUEST_BYTES 8192
+#define METRICS_CONTENT_TYPE "text/plain; version=0.0.4; charset=utf-8"
+
+static void writeFamily(QByteArray &out, const char *name, const char *type, const char *help)
+{
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+// label value escaping of the text format: backslash, double quote and line feed
+static QByteArray labelValue(const QString &value)
+{
+    QByteArray escaped = value.toUtf8();
+    escaped.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+    return escaped;
+}
+
+static void writeSample(QByteArray &out, const char *name, const QByteArray &labels, double value)
+{
+    out += name;
+    if (!labels.isEmpty()) {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+    out += ' ';
+    out += QByteArray::number(value, 'g', 15);
+    out += '\n';
+}
+
+#ifdef Q_OS_LINUX
+static void writeProcessMetrics(QByteArray &out)
+{
+    QFile statFile("/proc/self/stat");
+    if (!statFile.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    // the command name may contain spaces and parentheses, the fields start after the last ')'
+    QByteArray stat = statFile.readAll();
+    QList<QByteArray> fields = stat.mid(stat.lastIndexOf(')') + 2).split(' ');
+    // fields[0] is field 3 (state) of proc(5)
+    if (fields.size() < 22) {
+        return;
+    }
+    double ticks = static_cast<double>(sysconf(_SC_CLK_TCK));
+    double cpuSeconds = (fields.at(11).toULongLong() + fields.at(12).toULongLong()) / ticks;
+    double virtualBytes = static_cast<double>(fields.at(20).toULongLong());
+    double residentBytes = static_cast<double>(fields.at(21).toULongLong()) * sysconf(_SC_PAGESIZE);
+    int openFds = QDir("/proc/self/fd").entryList(QDir::Files | QDir::System | QDir::NoDotAndDotDot).size();
+
+    writeFamily(out, "process_cpu_seconds_total", "counter", "Total user and system CPU time spent in seconds.");
+    writeSample(out, "process_cpu_seconds_total", QByteArray(), cpuSeconds);
+    writeFamily(out, "process_resident_memory_bytes", "gauge", "Resident memory size in bytes.");
+    writeSample(out, "process_resident_memory_bytes", QByteArray(), residentBytes);
+    writeFamily(out, "process_virtual_memory_bytes", "gauge", "Virtual memory size in bytes.");
+    writeSample(out, "process_virtual_memory_bytes", QByteArray(), virtualBytes);
+    writeFamily(out, "process_open_fds", "gauge", "Number of open file descriptors.");
+    writeSample(out, "process_open_fds", QByteArray(), openFds);
+}
+#endif
+
+MetricsExporter::MetricsExporter(QObject *parent) : QObject(parent)
+{
+    connect(&m_server, &QTcpServer::newConnection, this, &MetricsExporter::onNewConnection);
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    close();
+}
+
+bool MetricsExporter::listen(quint16 port, const QHostAddress &address)
+{
+    if (!m_server.listen(address, port)) {
+        qWarning() << "MetricsExporter: could not listen on" << address.toString() << port << m_server.errorString();
+        return false;
+    }
+    qInfo() << "MetricsExporter: serving" << QString("http://%1:%2/metrics").arg(address.toString()).arg(m_server.serverPort());
+    return true;
+}
+
+void MetricsExporter::close()
+{
+    m_server.close();
+}
+
+QByteArray MetricsExporter::render() const
+{
+    struct DeviceSample
+    {
+        QByteArray labels;
+        qsc::DeviceMetrics *metrics;
+    };
+
+    QList<DeviceSample> devices;
+    int connected = 0;
+    const QStringList serials = qsc::DeviceMetricsRegistry::instance().serials();
+    for (const QString &serial : serials) {
+        DeviceSample sample;
+        sample.labels = "serial=\"" + labelValue(serial) + "\"";
+        sample.metrics = qsc::DeviceMetricsRegistry::instance().device(serial);
+        if (sample.metrics->connected.load(std::memory_order_relaxed)) {
+            connected++;
+        }
+        devices.append(sample);
+    }
+
+    QByteArray out;
+    out.reserve(4096 + devices.size() * 2048);
+
+    writeFamily(out, "qtscrcpy_devices_connected", "gauge", "Devices with a running video stream.");
+    writeSample(out, "qtscrcpy_devices_connected", QByteArray(), connected);
+
+    writeFamily(out, "qtscrcpy_device_connected", "gauge", "Whether the device video stream is running.");
+    for (const DeviceSample &device : devices) {
+        writeSample(out, "qtscrcpy_device_connected", device.labels, device.metrics->connected.load(std::memory_order_relaxed) ? 1 : 0);
+    }
+    writeFamily(out, "qtscrcpy_device_connects_total", "counter", "Successful stream starts.");
+    for (const DeviceSample &device : devices) {
+        writeSample(out, "qtscrcpy_device_connects_total", device.labels, device.metrics->connects.load(std::memory_order_relaxed));
+    }
+    writeFamily(out, "qtscrcpy_device_reconnects_total", "counter", "Stream starts after the first one.");
+    for (const DeviceSample &device : devices) {
+        quint64 connects = device.metrics->connects.load(std::memory_order_relaxed);
+        writeSample(out, "qtscrcpy_device_reconnects_total", device.labels, connects > 0 ? connects - 1 : 0);
+    }
+    writeFamily(out, "qtscrcpy_device_received_packets_total", "counter", "Video packets received from the device.");
+    for (const DeviceSample &device : devices) {
+        writeSample(out, "qtscrcpy_device_received_packets_total", device.labels, device.metrics->packetsReceived.load(std::memory_order_relaxed));
+    }
+    writeFamily(out, "qtscrcpy_device_received_bytes_total", "counter", "Compressed video bytes received, rate() gives the bitrate.");
+    for (const DeviceSample &device : devices) {
+        writeSample(out, "qtscrcpy_device_received_bytes_total", device.labels, device.metrics->bytesReceived.load(std::memory_order_relaxed));
+    }
+    writeFamily(out, "qtscrcpy_device_rendered_frames_total", "counter", "Decoded frames consumed by the renderer.");
+    for (const DeviceSample &device : devices) {
+        writeSample(out, "qtscrcpy_device_rendered_frames_total", device.labels, device.metrics->framesRendered.load(std::memory_order_relaxed));
+    }
+    writeFamily(out, "qtscrcpy_device_skipped_frames_total", "counter", "Decoded frames replaced before the renderer consumed them.");
+    for (const DeviceSample &device : devices) {
+        writeSample(out, "qtscrcpy_device_skipped_frames_total", device.labels, device.metrics->framesSkipped.load(std::memory_order_relaxed));
+    }
+    writeFamily(out, "qtscrcpy_device_unchanged_frames_total", "counter", "Decoded frames identical to the previous picture, not rendered.");
+    for (const DeviceSample &device : devices) {
+        writeSample(out, "qtscrcpy_device_unchanged_frames_total", device.labels, device.metrics->framesUnchanged.load(std::memory_order_relaxed));
+    }
+    writeFamily(out, "qtscrcpy_device_fps", "gauge", "Rendered frames during the last second.");
+    for (const DeviceSample &device : devices) {
+        writeSample(out, "qtscrcpy_device_fps", device.labels, device.metrics->fps.load(std::memory_order_relaxed));
+    }
+    writeFamily(out, "qtscrcpy_device_buffer_bytes", "gauge", "Memory held for the device by the decoded frames and the clip ring.");
+    for (const DeviceSample &device : devices) {
+        writeSample(out, "qtscrcpy_device_buffer_bytes", device.labels + ",kind=\"frames\"", device.metrics->frameBufferBytes.load(std::memory_order_relaxed));
+        writeSample(out, "qtscrcpy_device_buffer_bytes", device.labels + ",kind=\"clip\"", device.metrics->clipBufferBytes.load(std::memory_order_relaxed));
+    }
+    writeFamily(out, "qtscrcpy_device_socket_backlog_bytes", "gauge", "Video bytes received but not yet read by the demuxer.");
+    for (const DeviceSample &device : devices) {
+        writeSample(out, "qtscrcpy_device_socket_backlog_bytes", device.labels, device.metrics->socketBacklogBytes.load(std::memory_order_relaxed));
+    }
+
+    if (qsc::StageLatency::isEnabled()) {
+        qsc::StageLatencyRegistry &registry = qsc::StageLatencyRegistry::instance();
+        static const double quantiles[] = { 0.5, 0.9, 0.99 };
+        writeFamily(out, "qtscrcpy_stage_latency_seconds", "summary", "Video pipeline stage durations since startup.");
+        const QStringList latencySerials = registry.serials();
+        for (const QString &serial : latencySerials) {
+            qsc::StageLatency *latency = registry.device(serial);
+            for (int stage = 0; stage < qsc::StageLatency::SL_COUNT; stage++) {
+                qsc::LatencyHistogram::Snapshot snapshot = latency->snapshot(static_cast<qsc::StageLatency::Stage>(stage));
+                QByteArray labels = "serial=\"" + labelValue(serial) + "\",stage=\"" + qsc::StageLatency::stageName(static_cast<qsc::StageLatency::Stage>(stage)) + "\"";
+                for (double quantile : quantiles) {
+                    writeSample(out, "qtscrcpy_stage_latency_seconds", labels + ",quantile=\"" + QByteArray::number(quantile) + "\"",
+                                snapshot.percentile(quantile * 100) / 1e6);
+                }
+                writeSample(out, "qtscrcpy_stage_latency_seconds_sum", labels, snapshot.sumUs / 1e6);
+                writeSample(out, "qtscrcpy_stage_latency_seconds_count", labels, snapshot.count);
+            }
+        }
+    }
+
+    // the wheel lives on the GUI thread, like the exporter
+    TimingWheel::JitterStats jitter = TimingWheel::instance().getJitterStats();
+    writeFamily(out, "qtscrcpy_input_timer_dispatched_total", "counter", "Delayed touch steps run by the shared timing wheel.");
+    writeSample(out, "qtscrcpy_input_timer_dispatched_total", QByteArray(), jitter.dispatched);
+    writeFamily(out, "qtscrcpy_input_timer_jitter_seconds", "gauge", "Delay of the delayed touch steps past their due time.");
+    writeSample(out, "qtscrcpy_input_timer_jitter_seconds", "stat=\"avg\"", jitter.avgJitterMs / 1e3);
+    writeSample(out, "qtscrcpy_input_timer_jitter_seconds", "stat=\"max\"", jitter.maxJitterMs / 1e3);
+    writeSample(out, "qtscrcpy_input_timer_jitter_seconds", "stat=\"last\"", jitter.lastJitterMs / 1e3);
+
+#ifdef Q_OS_LINUX
+    writeProcessMetrics(out);
+#endif
+    return out;
+}
+
+void MetricsExporter::onNewConnection()
+{
+    while (m_server.hasPendingConnections()) {
+        QTcpSocket *socket = m_server.nextPendingConnection();
+        m_requests.insert(socket, QByteArray());
+        connect(socket, &QTcpSocket::readyRead, this, &MetricsExporter::onReadyRead);
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            m_requests.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void MetricsExporter::onReadyRead()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (!socket || !m_requests.contains(socket)) {
+        return;
+    }
+    QByteArray &request = m_requests[socket];
+    request += socket->readAll();
+    if (request.size() > METRICS_MAX_REQUEST_BYTES) {
+        reply(socket, "431 Request Header Fields Too Large", "text/plain", "request too large\n");
+        return;
+    }
+    if (!request.contains("\r\n\r\n") && !request.contains("\n\n")) {
+        return;
+    }
+
+    // "GET /metrics?x=y HTTP/1.1"
+    QList<QByteArray> requestLine = request.left(request.indexOf('\n')).trimmed().split(' ');
+    QByteArray method = requestLine.value(0);
+    QByteArray path = requestLine.value(1);
+    path = path.left(path.indexOf('?') >= 0 ? path.indexOf('?') : path.size());
+
+    if (method != "GET") {
+        reply(socket, "405 Method Not Allowed", "text/plain", "only GET is supported\n");
+    } else if (path == "/metrics") {
+        reply(socket, "200 OK", METRICS_CONTENT_TYPE, render());
+    } else {
+        reply(socket, "404 Not Found", "text/plain", "metrics are served on /metrics\n");
+    }
+}
+
+void MetricsExporter::reply(QTcpSocket *socket, const QByteArray &status, const QByteArray &contentType, const QByteArray &body)
+{
+    // one request per connection
+    disconnect(socket, &QTcpSocket::readyRead, this, &MetricsExporter::onReadyRead);
+    m_requests[socket].clear();
+
+    QByteArray header = "HTTP/1.0 " + status + "\r\n";
+    header += "Content-Type: " + contentType + "\r\n";
+    header += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    header += "Connection: close\r\n\r\n";
+    socket->write(header);
+    socket->write(body);
+    socket->disconnectFromHost();
+}
@@ -0,0 +1,48 @@
+#ifndef METRICSEXPORTER_H
+#define METRICSEXPORTER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QHostAddress>
+#include <QObject>
+#include <QTcpServer>
+
+class QTcpSocket;
+
+/**
+ * MetricsExporter - Prometheus text exposition (version 0.0.4) of the farm on GET /metrics
+ *
+ * Per device: connection state, reconnects, received packets/bytes, rendered, skipped and unchanged
+ * frames, last fps, buffer memory and socket backlog (qsc::DeviceMetricsRegistry), plus a summary per
+ * pipeline stage (qsc::StageLatencyRegistry) and the dispatch jitter of the delayed touch steps
+ * (TimingWheel). Process totals follow the standard
+ * process_* names. Rates such as bitrate are left to the scraper: rate(..._bytes_total).
+ *
+ * A minimal HTTP/1.0 responder, one request per connection, runs on the thread owning it.
+ */
+class MetricsExporter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MetricsExporter(QObject *parent = Q_NULLPTR);
+    virtual ~MetricsExporter();
+
+    // loopback by default: the endpoint has no authentication
+    bool listen(quint16 port, const QHostAddress &address = QHostAddress::LocalHost);
+    void close();
+
+    QByteArray render() const;
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+
+private:
+    void reply(QTcpSocket *socket, const QByteArray &status, const QByteArray &contentType, const QByteArray &body);
+
+private:
+    QTcpServer m_server;
+    QHash<QTcpSocket *, QByteArray> m_requests;
+};
+
+#endif // METRICSEXPORTER_H
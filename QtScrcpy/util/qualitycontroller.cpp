@@ -0,0 +1,524 @@
+#include <algorithm>
+
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QList>
+#include <QPair>
+#include <QStringList>
+
+#include "devicemetrics.h"
+#include "qualitycontroller.h"
+#include "stagelatency.h"
+
+// fewer frames than this in a window say nothing about skipping
+#define QUALITY_MIN_WINDOW_FRAMES 10
+// share of skipped frames the renderer may drop before the stream is too heavy for it
+#define QUALITY_SKIP_RATIO_MAX 0.25
+// share of the frame interval the decoder may take on the demuxer thread
+#define QUALITY_DECODE_BUDGET_SHARE 0.5
+// socket backlog allowed, in milliseconds of the stream bitrate
+#define QUALITY_BACKLOG_MAX_MS 500
+// host CPU above which the heaviest streams step down, below which upgrades are allowed
+#define QUALITY_CPU_HIGH_PERCENT 85.0
+#define QUALITY_CPU_UPGRADE_PERCENT 60.0
+// offscreen devices keep a live-ish tile at almost no cost
+#define QUALITY_TRICKLE_MAX_SIZE 180
+#define QUALITY_TRICKLE_BIT_RATE 150000
+#define QUALITY_TRICKLE_MAX_FPS 1
+// a window is idle with at least this many repeated frames and at most this many changed ones
+// (VideoBuffer still offers an unchanged picture once a second)
+#define QUALITY_IDLE_MIN_UNCHANGED_FRAMES 4
+#define QUALITY_IDLE_MAX_CHANGED_FRAMES 3
+#define QUALITY_IDLE_MAX_FPS 5
+
+QualityController::QualityController(QObject *parent) : QObject(parent)
+{
+    m_timer.setInterval(CONTROL_INTERVAL_MS);
+    connect(&m_timer, &QTimer::timeout, this, &QualityController::evaluate);
+    m_timer.start();
+    m_focusTimer.setInterval(FOCUS_INTERVAL_MS);
+    connect(&m_focusTimer, &QTimer::timeout, this, &QualityController::processFocusChanges);
+    // first reading is the baseline of the next one
+    hostCpuPercent();
+}
+
+QualityController::~QualityController() {}
+
+void QualityController::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    if (m_enabled) {
+        m_timer.start();
+    } else {
+        m_timer.stop();
+    }
+}
+
+bool QualityController::isEnabled() const
+{
+    return m_enabled;
+}
+
+void QualityController::setFocusAware(bool focusAware)
+{
+    m_focusAware = focusAware;
+}
+
+bool QualityController::isFocusAware() const
+{
+    return m_focusAware;
+}
+
+void QualityController::setDualStream(bool dualStream)
+{
+    m_dualStream = dualStream;
+}
+
+void QualityController::setStartTier(qsc::DeviceConnectionPool::QualityTier tier)
+{
+    // running streams keep their tier, the loop moves them if the host disagrees
+    m_startLevel = tier;
+}
+
+qsc::StreamQualityProfile QualityController::profileFor(const QString &serial) const
+{
+    auto it = m_devices.constFind(serial);
+    if (it == m_devices.constEnd()) {
+        return tierProfile(qMax(m_startLevel, bestLevel(FOCUS_THUMBNAIL)));
+    }
+    return profileOf(*it);
+}
+
+QualityController::DeviceState &QualityController::stateFor(const QString &serial)
+{
+    auto it = m_devices.find(serial);
+    if (it == m_devices.end()) {
+        DeviceState state;
+        state.level = qMax(m_startLevel, bestLevel(FOCUS_THUMBNAIL));
+        state.activeLevel = bestLevel(FOCUS_ACTIVE);
+        it = m_devices.insert(serial, state);
+    }
+    return it.value();
+}
+
+bool QualityController::hasDetail(const DeviceState &state) const
+{
+    return m_dualStream && !state.detailFailed && state.appliedFocus == FOCUS_ACTIVE;
+}
+
+QualityController::Focus QualityController::streamFocus(const DeviceState &state) const
+{
+    return hasDetail(state) ? FOCUS_THUMBNAIL : state.appliedFocus;
+}
+
+int &QualityController::ladderLevel(DeviceState &state) const
+{
+    return streamFocus(state) == FOCUS_ACTIVE ? state.activeLevel : state.level;
+}
+
+int QualityController::bestLevel(Focus focus) const
+{
+    if (focus == FOCUS_THUMBNAIL && m_focusAware) {
+        return THUMBNAIL_BEST_TIER;
+    }
+    return qsc::DeviceConnectionPool::TIER_ULTRA;
+}
+
+qsc::StreamQualityProfile QualityController::activeProfile(const DeviceState &state) const
+{
+    return tierProfile(m_enabled ? state.activeLevel : bestLevel(FOCUS_ACTIVE));
+}
+
+qsc::StreamQualityProfile QualityController::profileOf(const DeviceState &state) const
+{
+    switch (streamFocus(state)) {
+    case FOCUS_ACTIVE:
+        return activeProfile(state);
+    case FOCUS_OFFSCREEN:
+        return trickleProfile();
+    default:
+        break;
+    }
+    qsc::StreamQualityProfile profile = tierProfile(m_enabled ? state.level : qMax(m_startLevel, bestLevel(FOCUS_THUMBNAIL)));
+    if (state.idle && (profile.maxFps == 0 || profile.maxFps > QUALITY_IDLE_MAX_FPS)) {
+        profile.maxFps = QUALITY_IDLE_MAX_FPS;
+        profile.description += " (idle)";
+    }
+    return profile;
+}
+
+void QualityController::onDeviceConnected(const QString &serial)
+{
+    DeviceState &state = stateFor(serial);
+    state.streaming = true;
+    state.hasBaseline = false;
+    state.pressureTicks = 0;
+    state.healthyTicks = 0;
+    state.cooldownTicks = qMax(state.cooldownTicks, static_cast<int>(WARMUP_TICKS));
+    // a reconnect of the main stream drops its detail stream
+    if (hasDetail(state)) {
+        emit detailStreamRequested(serial, activeProfile(state));
+    }
+}
+
+void QualityController::onDeviceDisconnected(const QString &serial)
+{
+    auto it = m_devices.find(serial);
+    if (it != m_devices.end()) {
+        it->streaming = false;
+    }
+}
+
+void QualityController::forgetDevice(const QString &serial)
+{
+    m_devices.remove(serial);
+}
+
+void QualityController::setFocus(const QString &serial, Focus focus)
+{
+    if (!m_focusAware) {
+        return;
+    }
+    DeviceState &state = stateFor(serial);
+    if (state.focus == focus) {
+        return;
+    }
+    state.focus = focus;
+    state.focusSinceMs = QDateTime::currentMSecsSinceEpoch();
+
+    // the operator is waiting for this one; a stopped stream just connects with the new focus
+    if (focus == FOCUS_ACTIVE || !state.streaming) {
+        applyFocus(serial, state);
+        return;
+    }
+    if (!m_focusTimer.isActive()) {
+        m_focusTimer.start();
+    }
+}
+
+void QualityController::onDetailStreamLost(const QString &serial)
+{
+    auto it = m_devices.find(serial);
+    if (it == m_devices.end() || !hasDetail(*it)) {
+        return;
+    }
+    DeviceState &state = it.value();
+    state.detailFailed = true;
+    qWarning() << "QualityController:" << serial << "has no detail stream, reconnecting on its active tier instead";
+    if (state.streaming) {
+        state.hasBaseline = false;
+        emit qualityChangeRequested(serial, profileOf(state));
+    }
+}
+
+void QualityController::applyFocus(const QString &serial, DeviceState &state)
+{
+    qsc::StreamQualityProfile before = profileOf(state);
+    bool detailBefore = hasDetail(state);
+    if (state.appliedFocus != state.focus) {
+        // idleness is only tracked as a thumbnail, it starts over under the new focus
+        state.idle = false;
+        state.idleTicks = 0;
+    }
+    state.appliedFocus = state.focus;
+    qsc::StreamQualityProfile after = profileOf(state);
+    bool detailAfter = hasDetail(state);
+    state.pressureTicks = 0;
+    state.healthyTicks = 0;
+    state.hasBaseline = false;
+
+    if (state.streaming && detailBefore != detailAfter) {
+        if (detailAfter) {
+            qsc::StreamQualityProfile detail = activeProfile(state);
+            qInfo() << "QualityController:" << serial << "detail stream" << detail.description;
+            emit detailStreamRequested(serial, detail);
+        } else {
+            emit detailStreamReleased(serial);
+        }
+    }
+    if (!state.streaming || (before.maxSize == after.maxSize && before.bitRate == after.bitRate && before.maxFps == after.maxFps)) {
+        return;
+    }
+    static const char *focusNames[] = { "thumbnail", "active", "offscreen" };
+    qInfo() << "QualityController:" << serial << "->" << after.description << "(" << focusNames[state.appliedFocus] << ")";
+    emit qualityChangeRequested(serial, after);
+}
+
+void QualityController::processFocusChanges()
+{
+    qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+    // (priority, serial): tiles coming back into view first
+    QList<QPair<int, QString>> transitions;
+    bool waiting = false;
+
+    for (auto it = m_devices.begin(); it != m_devices.end(); ++it) {
+        DeviceState &state = it.value();
+        if (state.focus == state.appliedFocus) {
+            continue;
+        }
+        if (!state.streaming) {
+            state.appliedFocus = state.focus;
+            state.idle = false;
+            state.idleTicks = 0;
+            continue;
+        }
+        if (state.focus == FOCUS_OFFSCREEN) {
+            if (nowMs - state.focusSinceMs < OFFSCREEN_DELAY_MS) {
+                waiting = true;
+                continue;
+            }
+            transitions.append(qMakePair(1, it.key()));
+        } else {
+            transitions.append(qMakePair(0, it.key()));
+        }
+    }
+
+    std::sort(transitions.begin(), transitions.end());
+    for (int i = 0; i < transitions.size() && i < MAX_FOCUS_RESTARTS_PER_TICK; i++) {
+        const QString &serial = transitions.at(i).second;
+        applyFocus(serial, m_devices[serial]);
+    }
+    if (!waiting && transitions.size() <= MAX_FOCUS_RESTARTS_PER_TICK) {
+        m_focusTimer.stop();
+    }
+}
+
+qsc::StreamQualityProfile QualityController::tierProfile(int level)
+{
+    return qsc::DeviceConnectionPool::instance().getTierProfile(static_cast<qsc::DeviceConnectionPool::QualityTier>(level));
+}
+
+qsc::StreamQualityProfile QualityController::trickleProfile()
+{
+    return qsc::StreamQualityProfile(QUALITY_TRICKLE_MAX_SIZE, QUALITY_TRICKLE_BIT_RATE, QUALITY_TRICKLE_MAX_FPS, "Trickle (off-screen)");
+}
+
+bool QualityController::sample(const QString &serial, DeviceState &state, QString &pressure, bool &idle)
+{
+    qsc::DeviceMetrics *metrics = qsc::DeviceMetricsRegistry::instance().device(serial);
+    if (!metrics) {
+        return false;
+    }
+    quint64 rendered = metrics->framesRendered.load(std::memory_order_relaxed);
+    quint64 skipped = metrics->framesSkipped.load(std::memory_order_relaxed);
+    quint64 unchanged = metrics->framesUnchanged.load(std::memory_order_relaxed);
+    qint64 backlog = metrics->socketBacklogBytes.load(std::memory_order_relaxed);
+    quint64 decodeCount = 0;
+    qint64 decodeSumUs = 0;
+    qsc::StageLatency *latency = qsc::StageLatencyRegistry::instance().device(serial);
+    if (latency) {
+        qsc::LatencyHistogram::Snapshot decode = latency->snapshot(qsc::StageLatency::SL_DECODE);
+        decodeCount = decode.count;
+        decodeSumUs = decode.sumUs;
+    }
+
+    bool hadBaseline = state.hasBaseline;
+    quint64 windowRendered = rendered - state.framesRendered;
+    quint64 windowSkipped = skipped - state.framesSkipped;
+    quint64 windowUnchanged = unchanged - state.framesUnchanged;
+    quint64 windowDecodeCount = decodeCount - state.decodeCount;
+    qint64 windowDecodeSumUs = decodeSumUs - state.decodeSumUs;
+    state.hasBaseline = true;
+    state.framesRendered = rendered;
+    state.framesSkipped = skipped;
+    state.framesUnchanged = unchanged;
+    state.decodeCount = decodeCount;
+    state.decodeSumUs = decodeSumUs;
+    if (!hadBaseline) {
+        return false;
+    }
+
+    qsc::StreamQualityProfile profile = profileOf(state);
+    QStringList reasons;
+    quint64 windowFrames = windowRendered + windowSkipped;
+    idle = windowUnchanged >= QUALITY_IDLE_MIN_UNCHANGED_FRAMES && windowFrames <= QUALITY_IDLE_MAX_CHANGED_FRAMES;
+    if (windowFrames >= QUALITY_MIN_WINDOW_FRAMES) {
+        double skipRatio = static_cast<double>(windowSkipped) / windowFrames;
+        if (skipRatio > QUALITY_SKIP_RATIO_MAX) {
+            reasons << QString("skipped %1%").arg(skipRatio * 100, 0, 'f', 0);
+        }
+    }
+    if (windowDecodeCount > 0 && profile.maxFps > 0) {
+        double decodeMeanMs = windowDecodeSumUs / 1000.0 / windowDecodeCount;
+        double budgetMs = 1000.0 / profile.maxFps * QUALITY_DECODE_BUDGET_SHARE;
+        if (decodeMeanMs > budgetMs) {
+            reasons << QString("decode %1 ms").arg(decodeMeanMs, 0, 'f', 1);
+        }
+    }
+    qint64 backlogMax = static_cast<qint64>(profile.bitRate) / 8 * QUALITY_BACKLOG_MAX_MS / 1000;
+    if (backlog > backlogMax) {
+        reasons << QString("backlog %1 KB").arg(backlog / 1024);
+    }
+    pressure = reasons.join(", ");
+    return true;
+}
+
+void QualityController::changeLevel(const QString &serial, DeviceState &state, int level, const QString &reason)
+{
+    int &current = ladderLevel(state);
+    if (level > current) {
+        // the tier it is pushed off is not worth a reconnect for a while
+        state.failedLevel = current;
+        state.failedAtMs = QDateTime::currentMSecsSinceEpoch();
+    }
+    current = level;
+    state.pressureTicks = 0;
+    state.healthyTicks = 0;
+    state.cooldownTicks = COOLDOWN_TICKS;
+    state.hasBaseline = false;
+
+    // keeps the idle fps cap of a static thumbnail
+    qsc::StreamQualityProfile profile = profileOf(state);
+    qInfo() << "QualityController:" << serial << "->" << profile.description << "(" << reason << ")";
+    emit qualityChangeRequested(serial, profile);
+}
+
+void QualityController::evaluate()
+{
+    if (!m_enabled || m_devices.isEmpty()) {
+        return;
+    }
+
+    double cpu = hostCpuPercent();
+    qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+    // (level, serial): sorted, the heaviest streams come first
+    QList<QPair<int, QString>> downgrades;
+    QList<QPair<int, QString>> upgrades;
+    QList<QPair<int, QString>> cpuCandidates;
+    // (0 wake / 1 sleep, serial): a device showing changes again first
+    QList<QPair<int, QString>> idleChanges;
+    QHash<QString, QString> reasons;
+
+    for (auto it = m_devices.begin(); it != m_devices.end(); ++it) {
+        DeviceState &state = it.value();
+        // an offscreen trickle skips by design, a pending focus change restarts the stream anyway
+        if (!state.streaming || state.appliedFocus == FOCUS_OFFSCREEN || state.focus != state.appliedFocus) {
+            continue;
+        }
+        if (state.cooldownTicks > 0) {
+            state.cooldownTicks--;
+            // the window after a reconnect starts when the cooldown ends
+            state.hasBaseline = false;
+            continue;
+        }
+
+        QString pressure;
+        bool idle = false;
+        if (!sample(it.key(), state, pressure, idle)) {
+            continue;
+        }
+        // plain thumbnails only: waking the hidden main stream of a dual stream device would
+        // reconnect it and drop its detail stream
+        if (state.appliedFocus == FOCUS_THUMBNAIL) {
+            state.idleTicks = idle ? state.idleTicks + 1 : 0;
+            bool wake = state.idle && !idle;
+            bool sleep = !state.idle && state.idleTicks >= IDLE_TICKS;
+            if (wake || sleep) {
+                idleChanges.append(qMakePair(wake ? 0 : 1, it.key()));
+                continue;
+            }
+        }
+        if (!pressure.isEmpty()) {
+            state.pressureTicks++;
+            state.healthyTicks = 0;
+        } else {
+            state.pressureTicks = 0;
+            state.healthyTicks++;
+        }
+
+        int level = ladderLevel(state);
+        if (state.pressureTicks >= PRESSURE_TICKS && level < qsc::DeviceConnectionPool::TIER_MINIMAL) {
+            downgrades.append(qMakePair(level, it.key()));
+            reasons.insert(it.key(), pressure);
+        } else if (state.healthyTicks >= HEALTHY_TICKS && level > bestLevel(streamFocus(state)) && !state.idle) {
+            bool backoff = state.failedLevel == level - 1 && nowMs - state.failedAtMs < UPGRADE_BACKOFF_MS;
+            if (!backoff) {
+                upgrades.append(qMakePair(level, it.key()));
+            }
+        }
+        // the active device is the one that has to look sharp, the thumbnails give way;
+        // idle ones already cost next to nothing at their capped frame rate
+        if (level < qsc::DeviceConnectionPool::TIER_MINIMAL && streamFocus(state) != FOCUS_ACTIVE && !state.idle) {
+            cpuCandidates.append(qMakePair(level, it.key()));
+        }
+    }
+
+    std::sort(idleChanges.begin(), idleChanges.end());
+    for (int i = 0; i < idleChanges.size() && i < MAX_IDLE_CHANGES_PER_TICK; i++) {
+        const QString &serial = idleChanges.at(i).second;
+        DeviceState &state = m_devices[serial];
+        state.idle = idleChanges.at(i).first == 1;
+        state.idleTicks = 0;
+        state.pressureTicks = 0;
+        state.healthyTicks = 0;
+        state.hasBaseline = false;
+        qsc::StreamQualityProfile profile = profileOf(state);
+        qInfo() << "QualityController:" << serial << "->" << profile.description << "(" << (state.idle ? "static screen" : "screen changing") << ")";
+        emit qualityChangeRequested(serial, profile);
+    }
+
+    // every stream is fine on its own but the host is saturated: the heaviest give way
+    if (downgrades.isEmpty() && cpu > QUALITY_CPU_HIGH_PERCENT) {
+        downgrades = cpuCandidates;
+        for (const auto &candidate : cpuCandidates) {
+            reasons.insert(candidate.second, QString("host cpu %1%").arg(cpu, 0, 'f', 0));
+        }
+    }
+
+    if (!downgrades.isEmpty()) {
+        std::sort(downgrades.begin(), downgrades.end());
+        for (int i = 0; i < downgrades.size() && i < MAX_DOWNGRADES_PER_TICK; i++) {
+            const QString &serial = downgrades.at(i).second;
+            DeviceState &state = m_devices[serial];
+            changeLevel(serial, state, ladderLevel(state) + 1, reasons.value(serial));
+        }
+        return;
+    }
+
+    // upgrades only with CPU headroom, lightest streams first; unknown CPU does not block
+    if (cpu >= QUALITY_CPU_UPGRADE_PERCENT) {
+        return;
+    }
+    std::sort(upgrades.begin(), upgrades.end());
+    for (int i = upgrades.size() - 1, done = 0; i >= 0 && done < MAX_UPGRADES_PER_TICK; i--, done++) {
+        const QString &serial = upgrades.at(i).second;
+        DeviceState &state = m_devices[serial];
+        QString reason = cpu >= 0 ? QString("healthy, host cpu %1%").arg(cpu, 0, 'f', 0) : QString("healthy");
+        changeLevel(serial, state, ladderLevel(state) - 1, reason);
+    }
+}
+
+double QualityController::hostCpuPercent()
+{
+#ifdef Q_OS_LINUX
+    QFile file("/proc/stat");
+    if (!file.open(QIODevice::ReadOnly)) {
+        return -1.0;
+    }
+    // "cpu  user nice system idle iowait irq softirq steal guest guest_nice"
+    QList<QByteArray> fields = file.readLine().simplified().split(' ');
+    if (fields.size() < 5 || fields.at(0) != "cpu") {
+        return -1.0;
+    }
+    // guest and guest_nice are already counted in user and nice
+    quint64 total = 0;
+    for (int i = 1; i < qMin(fields.size(), 9); i++) {
+        total += fields.at(i).toULongLong();
+    }
+    // a CPU waiting for I/O is free for the decoders
+    quint64 idle = fields.at(4).toULongLong() + (fields.size() > 5 ? fields.at(5).toULongLong() : 0);
+
+    quint64 totalDiff = total - m_lastCpuTotal;
+    quint64 idleDiff = idle - m_lastCpuIdle;
+    bool first = m_lastCpuTotal == 0;
+    m_lastCpuTotal = total;
+    m_lastCpuIdle = idle;
+    if (first || totalDiff == 0) {
+        return -1.0;
+    }
+    return 100.0 * (totalDiff - idleDiff) / totalDiff;
+#else
+    return -1.0;
+#endif
+}
@@ -0,0 +1,173 @@
+#ifndef QUALITYCONTROLLER_H
+#define QUALITYCONTROLLER_H
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+#include "../QtScrcpyCore/src/device/deviceconnectionpool.h"
+
+/**
+ * QualityController - Closed-loop resolution, bitrate and fps per device stream
+ *
+ * The quality tiers of qsc::DeviceConnectionPool form a ladder. A device starts on the tier
+ * picked from the device count, then every CONTROL_INTERVAL_MS its last window is checked
+ * against what the host sustains:
+ * - skipped frames (FpsCounter): the renderer does not keep up
+ * - mean decode time against the frame interval: the decoder does not keep up
+ * - socket backlog (qsc::DeviceMetrics): the demuxer thread does not keep up
+ * - host CPU (/proc/stat, Linux only)
+ * A device under pressure for PRESSURE_TICKS steps down one tier, a device healthy for
+ * HEALTHY_TICKS on a host with CPU headroom steps up one tier, so the farm converges on
+ * the best quality it can sustain. Host-wide CPU pressure steps down the heaviest streams.
+ *
+ * With focus awareness, each device is also in one of three states set by the viewer:
+ * - active:    the device the operator works with, on its own ladder starting at the top
+ * - thumbnail: visible in the grid, never above THUMBNAIL_BEST_TIER
+ * - offscreen: scrolled away or window hidden, a 1 fps trickle at the smallest size
+ * Going active is applied at once; thumbnail and offscreen transitions are queued and
+ * rate limited, and offscreen only after OFFSCREEN_DELAY_MS, so scrolling through the
+ * grid does not restart every stream it passes.
+ *
+ * The scrcpy server cannot change its encoder settings on a running stream, so a change is
+ * a fast reconnect, done by the owner on qualityChangeRequested(). Changes are limited per
+ * tick, a device waits COOLDOWN_TICKS after one, and a tier it was pushed off is not tried
+ * again for UPGRADE_BACKOFF_MS.
+ *
+ * A thumbnail whose frames have all been repeats of the same picture (qsc::DeviceMetrics
+ * framesUnchanged) for IDLE_TICKS is idle: its stream is capped at a few fps until a window
+ * shows changes again.
+ *
+ * With dual streams the active device keeps its thumbnail stream and gets a second scrcpy
+ * session on its active tier (detailStreamRequested/Released), so going active and back is
+ * never a reconnect. A device whose detail stream fails falls back to the reconnect path.
+ */
+class QualityController : public QObject
+{
+    Q_OBJECT
+public:
+    enum Focus
+    {
+        FOCUS_THUMBNAIL = 0,
+        FOCUS_ACTIVE,
+        FOCUS_OFFSCREEN
+    };
+
+    enum
+    {
+        CONTROL_INTERVAL_MS = 2000,
+        PRESSURE_TICKS = 2,
+        HEALTHY_TICKS = 15,
+        COOLDOWN_TICKS = 10,
+        WARMUP_TICKS = 3, // first keyframe and decoder setup after a (re)connect
+        UPGRADE_BACKOFF_MS = 5 * 60 * 1000,
+        MAX_DOWNGRADES_PER_TICK = 2,
+        MAX_UPGRADES_PER_TICK = 1,
+
+        FOCUS_INTERVAL_MS = 250,
+        OFFSCREEN_DELAY_MS = 3000,
+        MAX_FOCUS_RESTARTS_PER_TICK = 2,
+        IDLE_TICKS = 15,
+        MAX_IDLE_CHANGES_PER_TICK = 2,
+        THUMBNAIL_BEST_TIER = qsc::DeviceConnectionPool::TIER_MEDIUM
+    };
+
+    explicit QualityController(QObject *parent = Q_NULLPTR);
+    virtual ~QualityController();
+
+    // the closed loop, off: devices stay on their start tier
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+    // off: every device is a thumbnail, setFocus() is ignored
+    void setFocusAware(bool focusAware);
+    bool isFocusAware() const;
+    // off: the active device is reconnected on its active tier instead
+    void setDualStream(bool dualStream);
+    // where devices without history start, from the device count
+    void setStartTier(qsc::DeviceConnectionPool::QualityTier tier);
+
+    // profile to (re)connect serial with
+    qsc::StreamQualityProfile profileFor(const QString &serial) const;
+
+    // stream state of the device, the tier history survives reconnects
+    void onDeviceConnected(const QString &serial);
+    void onDeviceDisconnected(const QString &serial);
+    // the device left the farm
+    void forgetDevice(const QString &serial);
+
+    void setFocus(const QString &serial, Focus focus);
+    // the detail stream could not start or ended on its own
+    void onDetailStreamLost(const QString &serial);
+
+signals:
+    // the stream of serial has to be restarted with profile
+    void qualityChangeRequested(const QString &serial, const qsc::StreamQualityProfile &profile);
+    // attach a second stream with profile next to the running one, or drop it
+    void detailStreamRequested(const QString &serial, const qsc::StreamQualityProfile &profile);
+    void detailStreamReleased(const QString &serial);
+
+private slots:
+    void evaluate();
+    void processFocusChanges();
+
+private:
+    struct DeviceState
+    {
+        int level = 0;       // thumbnail ladder, QualityTier, 0 is the best
+        int activeLevel = 0; // ladder while active
+        Focus focus = FOCUS_THUMBNAIL;        // requested by the viewer
+        Focus appliedFocus = FOCUS_THUMBNAIL; // the running stream
+        qint64 focusSinceMs = 0;
+        bool streaming = false;
+        int pressureTicks = 0;
+        int healthyTicks = 0;
+        int cooldownTicks = 0;
+        int failedLevel = -1;
+        qint64 failedAtMs = 0;
+        bool detailFailed = false; // no dual stream for this device
+        bool idle = false;         // static screen, fps capped
+        int idleTicks = 0;
+
+        // counters at the start of the window
+        bool hasBaseline = false;
+        quint64 framesRendered = 0;
+        quint64 framesSkipped = 0;
+        quint64 framesUnchanged = 0;
+        quint64 decodeCount = 0;
+        qint64 decodeSumUs = 0;
+    };
+
+    DeviceState &stateFor(const QString &serial);
+    // the active device keeps a thumbnail main stream while it has a detail stream
+    bool hasDetail(const DeviceState &state) const;
+    Focus streamFocus(const DeviceState &state) const;
+    // the ladder the running stream is on
+    int &ladderLevel(DeviceState &state) const;
+    int bestLevel(Focus focus) const;
+    qsc::StreamQualityProfile activeProfile(const DeviceState &state) const;
+    qsc::StreamQualityProfile profileOf(const DeviceState &state) const;
+
+    // false until a full window was sampled; fills the window values and moves the baseline
+    bool sample(const QString &serial, DeviceState &state, QString &pressure, bool &idle);
+    void changeLevel(const QString &serial, DeviceState &state, int level, const QString &reason);
+    void applyFocus(const QString &serial, DeviceState &state);
+    static qsc::StreamQualityProfile tierProfile(int level);
+    static qsc::StreamQualityProfile trickleProfile();
+    // host CPU usage since the last call, -1 when unknown
+    double hostCpuPercent();
+
+private:
+    bool m_enabled = true;
+    bool m_focusAware = true;
+    bool m_dualStream = false;
+    int m_startLevel = qsc::DeviceConnectionPool::TIER_HIGH;
+    QHash<QString, DeviceState> m_devices;
+    QTimer m_timer;
+    QTimer m_focusTimer;
+
+    quint64 m_lastCpuTotal = 0;
+    quint64 m_lastCpuIdle = 0;
+};
+
+#endif // QUALITYCONTROLLER_H